@@ -0,0 +1,195 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ColorKernels.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "ColorKernels"
+#include <ABE/ABE.h>
+#include <math.h>
+
+#include "ImageConverter.h"
+#include "ColorKernels.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+#define YUV_LAYOUT(FORMAT, LAYOUT, Y0, CB, Y1, CR, DEPTH, SHIFT, ...)  { FORMAT, LAYOUT, Y0, CB, Y1, CR, DEPTH, SHIFT },
+static const YUVLayout kYUVLayouts[] = {
+    YUV_FORMATS(YUV_LAYOUT)
+    // END OF LIST
+    { kPixelFormatUnknown, kYUVLayoutUnknown, 0, 0, 0, 0, 0, 0 },
+};
+
+const YUVLayout * GetYUVLayout(ePixelFormat format) {
+    for (UInt32 i = 0; kYUVLayouts[i].format != kPixelFormatUnknown; ++i) {
+        if (kYUVLayouts[i].format == format) return &kYUVLayouts[i];
+    }
+    return Nil;
+}
+
+// derived from Kr & Kb, @see MediaTypes.h
+static const struct {
+    eColorMatrix    matrix;
+    Float64         kr, kb;
+    Bool            full;           ///< full range or video range
+} kColorMatrices[] = {
+    { kColorMatrixJPEG,         0.299,      0.114,      True    },
+    { kColorMatrixBT601,        0.299,      0.114,      False   },
+    { kColorMatrixBT709,        0.2126,     0.0722,     False   },
+    { kColorMatrixBT709Full,    0.2126,     0.0722,     True    },
+    { kColorMatrixBT2020,       0.2627,     0.0593,     False   },
+    { kColorMatrixBT2020Full,   0.2627,     0.0593,     True    },
+};
+#define NELEM(x)    (sizeof(x) / sizeof(x[0]))
+
+static FORCE_INLINE Int16 Q13(Float64 x) { return (Int16)lrint(x * 8192); }
+static FORCE_INLINE Int16 Q14(Float64 x) { return (Int16)lrint(x * 16384); }
+
+static void InitColorParams(ColorParams * p, UInt32 i) {
+    const Float64 kr    = kColorMatrices[i].kr;
+    const Float64 kb    = kColorMatrices[i].kb;
+    const Float64 kg    = 1 - kr - kb;
+    const Bool full     = kColorMatrices[i].full;
+    const Float64 ys    = full ? 1 : 255.0 / 219;   // luma [16, 235]
+    const Float64 cs    = full ? 1 : 255.0 / 224;   // chroma [16, 240]
+
+    p->matrix   = kColorMatrices[i].matrix;
+    p->offset   = full ? 0 : 16;
+    p->y        = Q13(ys);
+    p->rv       = Q13(2 * (1 - kr) * cs);
+    p->gu       = Q13(-2 * (1 - kb) * kb / kg * cs);
+    p->gv       = Q13(-2 * (1 - kr) * kr / kg * cs);
+    p->bu       = Q13(2 * (1 - kb) * cs);
+
+    // inverse, G takes the rounding error, so gray stays gray: Y' of each
+    // row sums to the range exactly, and Cb/Cr sum to 0
+    p->ky[0]    = Q14(kr / ys);
+    p->ky[2]    = Q14(kb / ys);
+    p->ky[1]    = Q14(1 / ys) - p->ky[0] - p->ky[2];
+    p->ku[0]    = Q14(-kr / (2 * (1 - kb)) / cs);
+    p->ku[2]    = Q14(0.5 / cs);
+    p->ku[1]    = -p->ku[0] - p->ku[2];
+    p->kv[0]    = Q14(0.5 / cs);
+    p->kv[2]    = Q14(-kb / (2 * (1 - kr)) / cs);
+    p->kv[1]    = -p->kv[0] - p->kv[2];
+
+    // same math as SIMD kernels
+    for (Int x = 0; x < 256; ++x) {
+        p->lutY[x]  = ((x - p->offset) * 128 * p->y) >> 16;
+        p->lutRV[x] = ((x - 128) * 128 * p->rv) >> 16;
+        p->lutGU[x] = ((x - 128) * 128 * p->gu) >> 16;
+        p->lutGV[x] = ((x - 128) * 128 * p->gv) >> 16;
+        p->lutBU[x] = ((x - 128) * 128 * p->bu) >> 16;
+    }
+}
+
+static ColorParams  sColorParams[NELEM(kColorMatrices)];
+
+static Bool InitColorParamsOnce() {
+    for (UInt32 i = 0; i < NELEM(kColorMatrices); ++i) {
+        InitColorParams(&sColorParams[i], i);
+    }
+    return True;
+}
+
+const ColorParams * GetColorParams(eColorMatrix matrix) {
+    // thread safe since c++11
+    static const Bool once = InitColorParamsOnce();
+    (void)once;
+
+    // BT601 is the most common one for raw images
+    if (matrix == kColorMatrixNull) matrix = kColorMatrixBT601;
+
+    for (UInt32 i = 0; i < NELEM(kColorMatrices); ++i) {
+        if (sColorParams[i].matrix == matrix) return &sColorParams[i];
+    }
+    return Nil;
+}
+
+ColorRow GetColorRow(const ColorKernels * kernels, ePixelFormat iformat, ePixelFormat oformat) {
+    for (const ColorRowEntry * e = kernels->rows; e->iformat != kPixelFormatUnknown; ++e) {
+        if (e->iformat == iformat && e->oformat == oformat) return e->row;
+    }
+    return Nil;
+}
+
+RGBRow GetRGBRow(const ColorKernels * kernels, ePixelFormat format) {
+    for (const RGBRowEntry * e = kernels->rgbs; e->format != kPixelFormatUnknown; ++e) {
+        if (e->format == format) return e->row;
+    }
+    return Nil;
+}
+
+#pragma mark C Kernels
+#define ROW_C(YUV, RGB)     { (ePixelFormat)YUV, (ePixelFormat)RGB, ColorRow_C<YUVTraits<YUV>, RGBTraits<RGB> > },
+static const ColorRowEntry kRowsC[] = {
+    COLOR_PAIRS(ROW_C)
+    // END OF LIST
+    { kPixelFormatUnknown, kPixelFormatUnknown, Nil }
+};
+
+#define RGB_ROW_C(RGB, ...) { (ePixelFormat)RGB, RGBRow_C<RGBTraits<RGB> > },
+static const RGBRowEntry kRGBRowsC[] = {
+    RGB_FORMATS(RGB_ROW_C)
+    // END OF LIST
+    { kPixelFormatUnknown, Nil }
+};
+
+static Bool SupportedC() { return True; }
+
+const ColorKernels kColorKernelsC = {
+    "C",
+    SupportedC,
+    kRowsC,
+    kRGBRowsC,
+};
+
+// best kernels comes first
+static const ColorKernels * kColorKernels[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    &kColorKernelsAVX2,
+    &kColorKernelsSSSE3,
+    &kColorKernelsSSE2,
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    &kColorKernelsNEON,
+#endif
+    &kColorKernelsC,
+};
+
+const ColorKernels * GetColorKernels() {
+    for (UInt32 i = 0; i < NELEM(kColorKernels); ++i) {
+        if (kColorKernels[i]->supported()) return kColorKernels[i];
+    }
+    return &kColorKernelsC;
+}
+
+__END_NAMESPACE_MFWK
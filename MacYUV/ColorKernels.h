@@ -0,0 +1,392 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ColorKernels.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// row kernels for Y'CbCr -> RGB and RGB -> Y'CbCr, private to ImageConverter.
+//
+// all kernels share the same fixed-point math, so every SIMD path is
+// bit-exact with the C path, which is also used for row tails:
+//  Y, U, V are samples normalized to 15 bits, e.g. 8-bit sample << 7
+//  Y'  = ((Y - offset * 128) * Ky) >> 16           // Q13 coefficients
+//  Cb  = U - 128 * 128, Cr = V - 128 * 128
+//  R   = Y' + ((Cr * Krv) >> 16)                   // Q4
+//  G   = Y' + ((Cb * Kgu) >> 16) + ((Cr * Kgv) >> 16)
+//  B   = Y' + ((Cb * Kbu) >> 16)
+//  8-bit output:   (R + 8) >> 4
+//  16-bit output:  R * 16 + R / 16, R clamped to [0, 255 * 16]
+// which maps to pmulhw on x86 and vmull+vshrn on arm. each term depends on
+// one input only, so the C path reads them from lookup tables for 8-bit.
+// max error vs float math is 1 LSB for all matrices, full & limited range,
+// 16-bit output has 12 significant bits, within 1/4 LSB of 8-bit output.
+// both are checked by Tests/KernelTests.cpp.
+//
+// row kernels are templates on input & output pixel layout, every byte
+// position is a compile-time constant, so each (Y'CbCr, RGB) pair gets its
+// own fully specialized row, without any runtime shuffle or swap.
+// the rows are generated from the format lists below, a new format only
+// needs a new line here.
+//
+// RGB -> Y'CbCr rows are bit-exact the same way, in Q14 coefficients:
+//  Y'  = (R * Kyr + G * Kyg + B * Kyb + offset << 14 + 8192) >> 14
+//  Cb  = (R * Kur + G * Kug + B * Kub) >> 8        // Q6, without 128
+//  Cr  = (R * Kvr + G * Kvg + B * Kvb) >> 8
+// which maps to pmaddwd on x86 and vmull+vmlal on arm. Cb/Cr are produced
+// for every pixel and downsampled by the caller, with its own filter.
+//
+
+#ifndef MACYUV_COLOR_KERNELS_H
+#define MACYUV_COLOR_KERNELS_H
+
+#include <MediaFramework/MediaTypes.h>
+
+#include "PixelFormats.h"
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+enum eYUVLayout {
+    kYUVLayoutUnknown,
+    kYUVLayoutPlanar,           ///< 3 planes, full width chroma, I444/YV24
+    kYUVLayoutPlanarH2,         ///< 3 planes, half width chroma, I420/YV12/I422/YV16
+    kYUVLayoutSemiPlanar,       ///< 2 planes, interleaved half width chroma, NV12/NV21
+    kYUVLayoutPacked,           ///< 1 plane, packed 4:2:2, YUY2/YVYU/VYUY/UYVY
+};
+
+#pragma mark Formats
+// Y'CbCr formats: X(format, layout, Y'0, Cb, Y'1, Cr, depth, shift, ...)
+//  packed:         sample position of Y'0/Cb/Y'1/Cr in a macro pixel
+//  semi-planar:    sample position of Cb/Cr in a CbCr pair
+//  planar:         plane of Cb/Cr, 0 - 2nd plane, 1 - 3rd plane
+//  depth:          significant bits of a sample, 16 bits sample if > 8
+//  shift:          position of significant bits, 0 for LSBs
+#define YUV_FORMATS(X, ...)                                                                                 \
+    X(kPixelFormat420YpCbCrPlanar,      kYUVLayoutPlanarH2,     0, 0, 0, 1, 8,  0, __VA_ARGS__)             \
+    X(kPixelFormat420YpCrCbPlanar,      kYUVLayoutPlanarH2,     0, 1, 0, 0, 8,  0, __VA_ARGS__)             \
+    X(kPixelFormat422YpCbCrPlanar,      kYUVLayoutPlanarH2,     0, 0, 0, 1, 8,  0, __VA_ARGS__)             \
+    X(kPixelFormat422YpCrCbPlanar,      kYUVLayoutPlanarH2,     0, 1, 0, 0, 8,  0, __VA_ARGS__)             \
+    X(kPixelFormat444YpCbCrPlanar,      kYUVLayoutPlanar,       0, 0, 0, 1, 8,  0, __VA_ARGS__)             \
+    X(kPixelFormat444YpCrCbPlanar,      kYUVLayoutPlanar,       0, 1, 0, 0, 8,  0, __VA_ARGS__)             \
+    X(kPixelFormat420YpCbCrSemiPlanar,  kYUVLayoutSemiPlanar,   0, 0, 0, 1, 8,  0, __VA_ARGS__)             \
+    X(kPixelFormat420YpCrCbSemiPlanar,  kYUVLayoutSemiPlanar,   0, 1, 0, 0, 8,  0, __VA_ARGS__)             \
+    X(kPixelFormat422YpCbCr,            kYUVLayoutPacked,       0, 1, 2, 3, 8,  0, __VA_ARGS__)   /* Y'0 Cb Y'1 Cr */ \
+    X(kPixelFormat422YpCrCb,            kYUVLayoutPacked,       0, 3, 2, 1, 8,  0, __VA_ARGS__)   /* Y'0 Cr Y'1 Cb */ \
+    X(kPixelFormat422YpCbCrWO,          kYUVLayoutPacked,       1, 2, 3, 0, 8,  0, __VA_ARGS__)   /* Cr Y'0 Cb Y'1 */ \
+    X(kPixelFormat422YpCrCbWO,          kYUVLayoutPacked,       1, 0, 3, 2, 8,  0, __VA_ARGS__)   /* Cb Y'0 Cr Y'1 */ \
+    X(kPixelFormat420YpCbCr10SemiPlanar,kYUVLayoutSemiPlanar,   0, 0, 0, 1, 10, 6, __VA_ARGS__)             \
+    X(kPixelFormat420YpCbCr16SemiPlanar,kYUVLayoutSemiPlanar,   0, 0, 0, 1, 16, 0, __VA_ARGS__)             \
+    X(kPixelFormat420YpCbCr10PlanarLE,  kYUVLayoutPlanarH2,     0, 0, 0, 1, 10, 0, __VA_ARGS__)             \
+    X(kPixelFormat422YpCbCr10PlanarLE,  kYUVLayoutPlanarH2,     0, 0, 0, 1, 10, 0, __VA_ARGS__)             \
+    X(kPixelFormat444YpCbCr10PlanarLE,  kYUVLayoutPlanar,       0, 0, 0, 1, 10, 0, __VA_ARGS__)             \
+    X(kPixelFormat444YpCbCr16Planar,    kYUVLayoutPlanar,       0, 0, 0, 1, 16, 0, __VA_ARGS__)             \
+    X(kPixelFormat422YpCbCr10,          kYUVLayoutPacked,       0, 1, 2, 3, 10, 6, __VA_ARGS__)   /* Y'0 Cb Y'1 Cr */
+
+// RGB formats: X(format, R, G, B, A, depth, ...), sample position of each channel
+#define RGB_FORMATS(X, ...)                                                                                 \
+    X(kPixelFormatBGRA,                 2, 1, 0, 3, 8,  __VA_ARGS__)                                        \
+    X(kPixelFormatRGBA,                 0, 1, 2, 3, 8,  __VA_ARGS__)                                        \
+    X(kPixelFormatARGB,                 1, 2, 3, 0, 8,  __VA_ARGS__)                                        \
+    X(kPixelFormatABGR,                 3, 2, 1, 0, 8,  __VA_ARGS__)                                        \
+    X(kPixelFormatRGBA64,               0, 1, 2, 3, 16, __VA_ARGS__)
+
+// X(yuv, rgb) for each pair of formats
+#define COLOR_PAIR_RGB(RGB, R, G, B, A, DEPTH, X, YUV)                  X(YUV, RGB)
+#define COLOR_PAIR_YUV(YUV, LAYOUT, Y0, CB, Y1, CR, DEPTH, SHIFT, X)    RGB_FORMATS(COLOR_PAIR_RGB, X, YUV)
+#define COLOR_PAIRS(X)                                                  YUV_FORMATS(COLOR_PAIR_YUV, X)
+
+template <UInt32 BYTES> struct ColorSample;
+template <> struct ColorSample<1> { typedef UInt8   type; };
+template <> struct ColorSample<2> { typedef UInt16  type; };
+
+template <UInt32 FORMAT> struct YUVTraits;
+template <UInt32 FORMAT> struct RGBTraits;
+
+// samples are normalized to 15 bits by (((x >> shift) & mask) << up) >> down,
+// mask drops bits above depth, which may be garbage in LSB aligned samples
+#define YUV_TRAITS(FORMAT, LAYOUT, Y0, CB, Y1, CR, DEPTH, SHIFT, ...)                                      \
+template <> struct YUVTraits<FORMAT> {                                                                      \
+    typedef ColorSample<(DEPTH + 7) / 8>::type sample;                                                      \
+    static const UInt32     format  = FORMAT;                                                               \
+    static const eYUVLayout layout  = LAYOUT;                                                               \
+    static const UInt32     y0      = Y0;                                                                   \
+    static const UInt32     cb      = CB;                                                                   \
+    static const UInt32     y1      = Y1;                                                                   \
+    static const UInt32     cr      = CR;                                                                   \
+    static const UInt32     depth   = DEPTH;                                                                \
+    static const UInt32     shift   = SHIFT;                                                                \
+    static const UInt32     mask    = (1 << DEPTH) - 1;                                                     \
+    static const UInt32     up      = DEPTH < 15 ? 15 - DEPTH : 0;                                          \
+    static const UInt32     down    = DEPTH > 15 ? DEPTH - 15 : 0;                                          \
+};
+YUV_FORMATS(YUV_TRAITS)
+#undef YUV_TRAITS
+
+#define RGB_TRAITS(FORMAT, R, G, B, A, DEPTH, ...)                                                          \
+template <> struct RGBTraits<FORMAT> {                                                                      \
+    typedef ColorSample<DEPTH / 8>::type sample;                                                            \
+    static const UInt32     format  = FORMAT;                                                               \
+    static const UInt32     r       = R;                                                                    \
+    static const UInt32     g       = G;                                                                    \
+    static const UInt32     b       = B;                                                                    \
+    static const UInt32     a       = A;                                                                    \
+    static const UInt32     depth   = DEPTH;                                                                \
+};
+RGB_FORMATS(RGB_TRAITS)
+#undef RGB_TRAITS
+
+typedef struct YUVLayout {
+    ePixelFormat        format;
+    eYUVLayout          layout;
+    UInt8               y0;         ///< @see YUV_FORMATS
+    UInt8               cb;
+    UInt8               y1;
+    UInt8               cr;
+    UInt8               depth;
+    UInt8               shift;
+} YUVLayout;
+
+/**
+ * get layout of a Y'CbCr pixel format
+ * @return return Nil if pixel format is not supported by kernels
+ */
+const YUVLayout *   GetYUVLayout(ePixelFormat);
+
+typedef struct ColorParams {
+    eColorMatrix        matrix;
+    Int16               offset;     ///< luma black level
+    Int16               y;          ///< Q13 coefficients
+    Int16               rv;
+    Int16               gu;
+    Int16               gv;
+    Int16               bu;
+    Int16               ky[3];      ///< Q14 coefficients of R/G/B -> Y'
+    Int16               ku[3];      ///< ... -> Cb
+    Int16               kv[3];      ///< ... -> Cr
+    Int16               lutY[256];  ///< terms of each input value, Q4
+    Int16               lutRV[256];
+    Int16               lutGU[256];
+    Int16               lutGV[256];
+    Int16               lutBU[256];
+} ColorParams;
+
+/**
+ * get params of a color matrix, which are built once and shared.
+ * @return return Nil if matrix is not supported
+ */
+const ColorParams * GetColorParams(eColorMatrix);
+
+/**
+ * convert n pixels of one row.
+ * samples and output channels are 16 bits if their depth > 8.
+ * planar:      y/u/v -> Y'/2nd/3rd planes
+ * semi-planar: y/u   -> Y'/CbCr planes, v is Nil
+ * packed:      y     -> packed plane, u & v are Nil
+ */
+typedef void (*ColorRow)(const UInt8 * y, const UInt8 * u, const UInt8 * v,
+                         UInt8 * rgba, UInt32 n, const ColorParams *);
+
+typedef struct ColorRowEntry {
+    ePixelFormat        iformat;
+    ePixelFormat        oformat;
+    ColorRow            row;
+} ColorRowEntry;
+
+/**
+ * convert n RGB pixels of one row to Y' and full width Cb/Cr in Q6.
+ */
+typedef void (*RGBRow)(const UInt8 * rgba, UInt8 * y, Int16 * u, Int16 * v,
+                       UInt32 n, const ColorParams *);
+
+typedef struct RGBRowEntry {
+    ePixelFormat        format;
+    RGBRow              row;
+} RGBRowEntry;
+
+typedef struct ColorKernels {
+    const Char *        name;
+    Bool                (*supported)();
+    const ColorRowEntry * rows;     ///< end with kPixelFormatUnknown
+    const RGBRowEntry * rgbs;       ///< end with kPixelFormatUnknown
+} ColorKernels;
+
+/**
+ * get row kernel for iformat -> oformat
+ * @return return Nil if not supported
+ */
+ColorRow    GetColorRow(const ColorKernels *, ePixelFormat, ePixelFormat);
+
+/**
+ * get row kernel for RGB format -> Y'CbCr
+ * @return return Nil if not supported
+ */
+RGBRow      GetRGBRow(const ColorKernels *, ePixelFormat);
+
+extern const ColorKernels kColorKernelsC;
+#if defined(__x86_64__) || defined(__i386__)
+extern const ColorKernels kColorKernelsSSE2;
+extern const ColorKernels kColorKernelsSSSE3;
+extern const ColorKernels kColorKernelsAVX2;
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+extern const ColorKernels kColorKernelsNEON;
+#endif
+
+/**
+ * get the best kernels supported by this cpu
+ */
+const ColorKernels *    GetColorKernels();
+
+#pragma mark C Kernels
+// shared by all kernels for row tails
+static FORCE_INLINE UInt8 ColorClamp(Int x) {
+    return x < 0 ? 0 : (x > 255 ? 255 : x);
+}
+
+// Q4 -> 16 bits
+static FORCE_INLINE UInt16 ColorExpand(Int x) {
+    x = x < 0 ? 0 : (x > 255 * 16 ? 255 * 16 : x);
+    return (x << 4) + (x >> 4);
+}
+
+// normalize sample to 15 bits
+template <class YUV>
+static FORCE_INLINE Int ColorNormalize(UInt32 x) {
+    return (((x >> YUV::shift) & YUV::mask) << YUV::up) >> YUV::down;
+}
+
+// one pixel of Y'/Cb/Cr samples -> R/G/B/A @ rgba[i]
+template <class YUV, class RGB>
+static FORCE_INLINE void YUV2RGB(const ColorParams * p, UInt32 y, UInt32 u, UInt32 v, UInt8 * rgba, UInt32 i) {
+    Int yc, r, g, b;
+    if (YUV::depth == 8) {
+        yc  = p->lutY[y];
+        r   = p->lutRV[v];
+        g   = p->lutGU[u] + p->lutGV[v];
+        b   = p->lutBU[u];
+    } else {
+        const Int cb    = ColorNormalize<YUV>(u) - 128 * 128;
+        const Int cr    = ColorNormalize<YUV>(v) - 128 * 128;
+        yc  = ((ColorNormalize<YUV>(y) - p->offset * 128) * p->y) >> 16;
+        r   = (cr * p->rv) >> 16;
+        g   = ((cb * p->gu) >> 16) + ((cr * p->gv) >> 16);
+        b   = (cb * p->bu) >> 16;
+    }
+
+    if (RGB::depth == 8) {
+        UInt8 * out     = rgba + 4 * i;
+        out[RGB::r]     = ColorClamp((yc + r + 8) >> 4);
+        out[RGB::g]     = ColorClamp((yc + g + 8) >> 4);
+        out[RGB::b]     = ColorClamp((yc + b + 8) >> 4);
+        out[RGB::a]     = 0xFF;
+    } else {
+        UInt16 * out    = (UInt16 *)rgba + 4 * i;
+        out[RGB::r]     = ColorExpand(yc + r);
+        out[RGB::g]     = ColorExpand(yc + g);
+        out[RGB::b]     = ColorExpand(yc + b);
+        out[RGB::a]     = 0xFFFF;
+    }
+}
+
+// convert pixels [i, n) of one row
+template <class YUV, class RGB>
+static FORCE_INLINE void ColorPixels_C(const UInt8 * y8, const UInt8 * u8, const UInt8 * v8,
+                                       UInt8 * rgba, UInt32 i, UInt32 n, const ColorParams * p) {
+    typedef typename YUV::sample T;
+    const T * y = (const T *)y8;
+    const T * u = (const T *)u8;
+    const T * v = (const T *)v8;
+    // Cb/Cr planes for planar
+    const T * cb = YUV::cb ? v : u;
+    const T * cr = YUV::cr ? v : u;
+    for (; i < n; ++i) {
+        switch (YUV::layout) {
+            case kYUVLayoutPlanar:
+                YUV2RGB<YUV, RGB>(p, y[i], cb[i], cr[i], rgba, i);
+                break;
+            case kYUVLayoutPlanarH2:
+                YUV2RGB<YUV, RGB>(p, y[i], cb[i / 2], cr[i / 2], rgba, i);
+                break;
+            case kYUVLayoutSemiPlanar: {
+                const T * c = u + (i / 2) * 2;
+                YUV2RGB<YUV, RGB>(p, y[i], c[YUV::cb], c[YUV::cr], rgba, i);
+            } break;
+            case kYUVLayoutPacked: {
+                const T * m = y + (i / 2) * 4;
+                YUV2RGB<YUV, RGB>(p, m[(i & 1) ? YUV::y1 : YUV::y0], m[YUV::cb], m[YUV::cr], rgba, i);
+            } break;
+            default:
+                break;
+        }
+    }
+}
+
+template <class YUV, class RGB>
+void ColorRow_C(const UInt8 * y, const UInt8 * u, const UInt8 * v,
+                UInt8 * rgba, UInt32 n, const ColorParams * p) {
+    ColorPixels_C<YUV, RGB>(y, u, v, rgba, 0, n, p);
+}
+
+// one pixel of R/G/B @ rgba[i] -> Y' & Cb/Cr in Q6
+// 16-bit channels are scaled down in the same products, no overflow as
+// coefficients of each row sum to at most 1.0
+template <class RGB>
+static FORCE_INLINE void RGB2YUV(const ColorParams * p, const UInt8 * rgba, UInt32 i,
+                                 UInt8 * y, Int16 * u, Int16 * v) {
+    typedef typename RGB::sample T;
+    const UInt32 down   = RGB::depth - 8;
+    const T * in        = (const T *)rgba + 4 * i;
+    const Int r         = in[RGB::r];
+    const Int g         = in[RGB::g];
+    const Int b         = in[RGB::b];
+    y[i] = ColorClamp((r * p->ky[0] + g * p->ky[1] + b * p->ky[2] +
+                       (((p->offset << 14) + 8192) << down)) >> (14 + down));
+    u[i] = (r * p->ku[0] + g * p->ku[1] + b * p->ku[2]) >> (8 + down);
+    v[i] = (r * p->kv[0] + g * p->kv[1] + b * p->kv[2]) >> (8 + down);
+}
+
+// convert pixels [i, n) of one row
+template <class RGB>
+static FORCE_INLINE void RGBPixels_C(const UInt8 * rgba, UInt8 * y, Int16 * u, Int16 * v,
+                                     UInt32 i, UInt32 n, const ColorParams * p) {
+    for (; i < n; ++i) {
+        RGB2YUV<RGB>(p, rgba, i, y, u, v);
+    }
+}
+
+template <class RGB>
+void RGBRow_C(const UInt8 * rgba, UInt8 * y, Int16 * u, Int16 * v, UInt32 n, const ColorParams * p) {
+    RGBPixels_C<RGB>(rgba, y, u, v, 0, n, p);
+}
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_COLOR_KERNELS_H
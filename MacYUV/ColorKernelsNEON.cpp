@@ -0,0 +1,311 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ColorKernelsNEON.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "ColorKernels.neon"
+#include <ABE/ABE.h>
+
+#include "ColorKernels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+__BEGIN_NAMESPACE_MFWK
+
+struct CoeffsNEON {
+    int16x8_t   offset, c128, round;
+    int16x4_t   y, rv, gu, gv, bu;
+};
+
+static FORCE_INLINE void LoadCoeffs(CoeffsNEON& k, const ColorParams * p) {
+    k.offset    = vdupq_n_s16(p->offset << 7);
+    k.c128      = vdupq_n_s16(128 << 7);
+    k.round     = vdupq_n_s16(8);
+    k.y         = vdup_n_s16(p->y);
+    k.rv        = vdup_n_s16(p->rv);
+    k.gu        = vdup_n_s16(p->gu);
+    k.gv        = vdup_n_s16(p->gv);
+    k.bu        = vdup_n_s16(p->bu);
+}
+
+// same as pmulhw: (a * b) >> 16
+static FORCE_INLINE int16x8_t MulHi(int16x8_t a, int16x4_t b) {
+    return vcombine_s16(vshrn_n_s32(vmull_s16(vget_low_s16(a), b), 16),
+                        vshrn_n_s32(vmull_s16(vget_high_s16(a), b), 16));
+}
+
+// 8 pixels in 15 bits -> R/G/B in Q4
+static FORCE_INLINE void YUV2RGB8(const CoeffsNEON& k, int16x8_t y, int16x8_t u, int16x8_t v,
+                                  int16x8_t& r, int16x8_t& g, int16x8_t& b) {
+    y = MulHi(vsubq_s16(y, k.offset), k.y);
+    u = vsubq_s16(u, k.c128);
+    v = vsubq_s16(v, k.c128);
+    r = vaddq_s16(y, MulHi(v, k.rv));
+    g = vaddq_s16(y, vaddq_s16(MulHi(u, k.gu), MulHi(v, k.gv)));
+    b = vaddq_s16(y, MulHi(u, k.bu));
+}
+
+// Q4 -> 8 bits
+static FORCE_INLINE uint8x8_t Round8(const CoeffsNEON& k, int16x8_t x) {
+    return vqmovun_s16(vshrq_n_s16(vaddq_s16(x, k.round), 4));
+}
+
+// Q4 -> 16 bits, @see ColorExpand
+static FORCE_INLINE uint16x8_t Expand8(int16x8_t x) {
+    const uint16x8_t c = vreinterpretq_u16_s16(vminq_s16(vmaxq_s16(x, vdupq_n_s16(0)), vdupq_n_s16(255 * 16)));
+    return vsraq_n_u16(vshlq_n_u16(c, 4), c, 4);
+}
+
+// 16 pixels -> 64 bytes, or 128 bytes for 16 bits per channel
+template <class RGB>
+static FORCE_INLINE void YUV2RGBA16(const CoeffsNEON& k, const int16x8_t y[2], const int16x8_t u[2],
+                                    const int16x8_t v[2], UInt8 * dst) {
+    int16x8_t r0, g0, b0, r1, g1, b1;
+    YUV2RGB8(k, y[0], u[0], v[0], r0, g0, b0);
+    YUV2RGB8(k, y[1], u[1], v[1], r1, g1, b1);
+    if (RGB::depth == 8) {
+        uint8x16x4_t out;
+        out.val[RGB::r] = vcombine_u8(Round8(k, r0), Round8(k, r1));
+        out.val[RGB::g] = vcombine_u8(Round8(k, g0), Round8(k, g1));
+        out.val[RGB::b] = vcombine_u8(Round8(k, b0), Round8(k, b1));
+        out.val[RGB::a] = vdupq_n_u8(0xFF);
+        vst4q_u8(dst, out);
+    } else {
+        uint16x8x4_t out;
+        out.val[RGB::r] = Expand8(r0);
+        out.val[RGB::g] = Expand8(g0);
+        out.val[RGB::b] = Expand8(b0);
+        out.val[RGB::a] = vdupq_n_u16(0xFFFF);
+        vst4q_u16((UInt16 *)dst, out);
+        out.val[RGB::r] = Expand8(r1);
+        out.val[RGB::g] = Expand8(g1);
+        out.val[RGB::b] = Expand8(b1);
+        vst4q_u16((UInt16 *)dst + 32, out);
+    }
+}
+
+// 8 chroma samples -> 16 pixels
+static FORCE_INLINE uint8x16_t Dup8(uint8x8_t c) {
+    const uint8x8x2_t z = vzip_u8(c, c);
+    return vcombine_u8(z.val[0], z.val[1]);
+}
+
+// 16 bytes -> 2 x 8 samples in 15 bits
+static FORCE_INLINE void Widen8(uint8x16_t x, int16x8_t w[2]) {
+    w[0] = vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(x), 7));
+    w[1] = vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(x), 7));
+}
+
+// 8 samples of 16 bits -> 15 bits
+template <class YUV>
+static FORCE_INLINE int16x8_t Normalize8(uint16x8_t x) {
+    x = vshlq_u16(x, vdupq_n_s16(-(Int16)YUV::shift));
+    if (YUV::shift + YUV::depth < 16) x = vandq_u16(x, vdupq_n_u16(YUV::mask));
+    x = vshlq_u16(x, vdupq_n_s16((Int16)YUV::up - (Int16)YUV::down));
+    return vreinterpretq_s16_u16(x);
+}
+
+// 2 x 8 samples of a & b interleaved
+static FORCE_INLINE void Zip8(int16x8_t a, int16x8_t b, int16x8_t w[2]) {
+    const int16x8x2_t z = vzipq_s16(a, b);
+    w[0] = z.val[0];
+    w[1] = z.val[1];
+}
+
+// load 16 pixels as Y'/Cb/Cr, one byte per pixel
+template <class YUV>
+static FORCE_INLINE void LoadBytes16(const UInt8 * y, const UInt8 * u, const UInt8 * v, UInt32 i,
+                                     uint8x16_t& Y, uint8x16_t& U, uint8x16_t& V) {
+    const UInt8 * cb = YUV::cb ? v : u;
+    const UInt8 * cr = YUV::cr ? v : u;
+    switch (YUV::layout) {
+        case kYUVLayoutPlanar:
+            Y = vld1q_u8(y + i);
+            U = vld1q_u8(cb + i);
+            V = vld1q_u8(cr + i);
+            break;
+        case kYUVLayoutPlanarH2:
+            Y = vld1q_u8(y + i);
+            U = Dup8(vld1_u8(cb + i / 2));
+            V = Dup8(vld1_u8(cr + i / 2));
+            break;
+        case kYUVLayoutSemiPlanar: {
+            const uint8x8x2_t c = vld2_u8(u + i);
+            Y = vld1q_u8(y + i);
+            U = Dup8(c.val[YUV::cb]);
+            V = Dup8(c.val[YUV::cr]);
+        } break;
+        case kYUVLayoutPacked: {
+            // 8 macro pixels, one byte position per lane
+            const uint8x8x4_t m = vld4_u8(y + 2 * i);
+            const uint8x8x2_t l = vzip_u8(m.val[YUV::y0], m.val[YUV::y1]);
+            Y = vcombine_u8(l.val[0], l.val[1]);
+            U = Dup8(m.val[YUV::cb]);
+            V = Dup8(m.val[YUV::cr]);
+        } break;
+        default:
+            break;
+    }
+}
+
+// load 16 pixels as Y'/Cb/Cr, 16 bits per sample
+template <class YUV>
+static FORCE_INLINE void LoadWords16(const UInt8 * y8, const UInt8 * u8, const UInt8 * v8, UInt32 i,
+                                     int16x8_t Y[2], int16x8_t U[2], int16x8_t V[2]) {
+    const UInt16 * y = (const UInt16 *)y8;
+    const UInt16 * u = (const UInt16 *)u8;
+    const UInt16 * v = (const UInt16 *)v8;
+    const UInt16 * cb = YUV::cb ? v : u;
+    const UInt16 * cr = YUV::cr ? v : u;
+    switch (YUV::layout) {
+        case kYUVLayoutPlanar:
+            Y[0] = Normalize8<YUV>(vld1q_u16(y + i));
+            Y[1] = Normalize8<YUV>(vld1q_u16(y + i + 8));
+            U[0] = Normalize8<YUV>(vld1q_u16(cb + i));
+            U[1] = Normalize8<YUV>(vld1q_u16(cb + i + 8));
+            V[0] = Normalize8<YUV>(vld1q_u16(cr + i));
+            V[1] = Normalize8<YUV>(vld1q_u16(cr + i + 8));
+            break;
+        case kYUVLayoutPlanarH2: {
+            const int16x8_t c0 = Normalize8<YUV>(vld1q_u16(cb + i / 2));
+            const int16x8_t c1 = Normalize8<YUV>(vld1q_u16(cr + i / 2));
+            Y[0] = Normalize8<YUV>(vld1q_u16(y + i));
+            Y[1] = Normalize8<YUV>(vld1q_u16(y + i + 8));
+            Zip8(c0, c0, U);
+            Zip8(c1, c1, V);
+        } break;
+        case kYUVLayoutSemiPlanar: {
+            const uint16x8x2_t c = vld2q_u16(u + i);
+            const int16x8_t c0 = Normalize8<YUV>(c.val[YUV::cb]);
+            const int16x8_t c1 = Normalize8<YUV>(c.val[YUV::cr]);
+            Y[0] = Normalize8<YUV>(vld1q_u16(y + i));
+            Y[1] = Normalize8<YUV>(vld1q_u16(y + i + 8));
+            Zip8(c0, c0, U);
+            Zip8(c1, c1, V);
+        } break;
+        case kYUVLayoutPacked: {
+            // 8 macro pixels, one sample position per lane
+            const uint16x8x4_t m = vld4q_u16(y + 2 * i);
+            const int16x8_t c0 = Normalize8<YUV>(m.val[YUV::cb]);
+            const int16x8_t c1 = Normalize8<YUV>(m.val[YUV::cr]);
+            Zip8(Normalize8<YUV>(m.val[YUV::y0]), Normalize8<YUV>(m.val[YUV::y1]), Y);
+            Zip8(c0, c0, U);
+            Zip8(c1, c1, V);
+        } break;
+        default:
+            break;
+    }
+}
+
+// load 16 pixels as Y'/Cb/Cr in 15 bits
+template <class YUV>
+static FORCE_INLINE void Load16(const UInt8 * y, const UInt8 * u, const UInt8 * v, UInt32 i,
+                                int16x8_t Y[2], int16x8_t U[2], int16x8_t V[2]) {
+    if (YUV::depth == 8) {
+        uint8x16_t y8, u8, v8;
+        LoadBytes16<YUV>(y, u, v, i, y8, u8, v8);
+        Widen8(y8, Y);
+        Widen8(u8, U);
+        Widen8(v8, V);
+    } else {
+        LoadWords16<YUV>(y, u, v, i, Y, U, V);
+    }
+}
+
+template <class YUV, class RGB>
+static void ColorRow_NEON(const UInt8 * y, const UInt8 * u, const UInt8 * v,
+                          UInt8 * rgba, UInt32 n, const ColorParams * p) {
+    CoeffsNEON k; LoadCoeffs(k, p);
+    UInt32 i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int16x8_t Y[2], U[2], V[2];
+        Load16<YUV>(y, u, v, i, Y, U, V);
+        YUV2RGBA16<RGB>(k, Y, U, V, rgba + i * RGB::depth / 2);
+    }
+    ColorPixels_C<YUV, RGB>(y, u, v, rgba, i, n, p);
+}
+
+#define ROW_NEON(YUV, RGB)  { (ePixelFormat)YUV, (ePixelFormat)RGB, ColorRow_NEON<YUVTraits<YUV>, RGBTraits<RGB> > },
+static const ColorRowEntry kRowsNEON[] = {
+    COLOR_PAIRS(ROW_NEON)
+    // END OF LIST
+    { kPixelFormatUnknown, kPixelFormatUnknown, Nil }
+};
+
+// 4 pixels of R/G/B -> sum in 32 bits
+static FORCE_INLINE int32x4_t Dot3(int16x4_t r, int16x4_t g, int16x4_t b, const Int16 k[3]) {
+    return vmlal_n_s16(vmlal_n_s16(vmull_n_s16(r, k[0]), g, k[1]), b, k[2]);
+}
+
+template <class RGB>
+static void RGBRow_NEON(const UInt8 * rgba, UInt8 * y, Int16 * u, Int16 * v,
+                        UInt32 n, const ColorParams * p) {
+    UInt32 i = 0;
+    if (RGB::depth == 8) {
+        const int32x4_t bias = vdupq_n_s32((p->offset << 14) + 8192);
+        for (; i + 8 <= n; i += 8) {
+            const uint8x8x4_t x = vld4_u8(rgba + 4 * i);
+            const int16x8_t r   = vreinterpretq_s16_u16(vmovl_u8(x.val[RGB::r]));
+            const int16x8_t g   = vreinterpretq_s16_u16(vmovl_u8(x.val[RGB::g]));
+            const int16x8_t b   = vreinterpretq_s16_u16(vmovl_u8(x.val[RGB::b]));
+#define DOT3(half, k)   Dot3(vget_##half##_s16(r), vget_##half##_s16(g), vget_##half##_s16(b), k)
+            const int16x8_t Y   = vcombine_s16(vqshrn_n_s32(vaddq_s32(DOT3(low, p->ky), bias), 14),
+                                               vqshrn_n_s32(vaddq_s32(DOT3(high, p->ky), bias), 14));
+            vst1_u8(y + i, vqmovun_s16(Y));
+            vst1q_s16(u + i, vcombine_s16(vshrn_n_s32(DOT3(low, p->ku), 8), vshrn_n_s32(DOT3(high, p->ku), 8)));
+            vst1q_s16(v + i, vcombine_s16(vshrn_n_s32(DOT3(low, p->kv), 8), vshrn_n_s32(DOT3(high, p->kv), 8)));
+#undef DOT3
+        }
+    }
+    RGBPixels_C<RGB>(rgba, y, u, v, i, n, p);
+}
+
+#define RGB_ROW_NEON(RGB, ...)  { (ePixelFormat)RGB, RGBRow_NEON<RGBTraits<RGB> > },
+static const RGBRowEntry kRGBRowsNEON[] = {
+    RGB_FORMATS(RGB_ROW_NEON)
+    // END OF LIST
+    { kPixelFormatUnknown, Nil }
+};
+
+// NEON is mandatory on armv8
+static Bool SupportedNEON() { return True; }
+
+const ColorKernels kColorKernelsNEON = {
+    "NEON",
+    SupportedNEON,
+    kRowsNEON,
+    kRGBRowsNEON,
+};
+
+__END_NAMESPACE_MFWK
+#endif // __ARM_NEON
@@ -0,0 +1,831 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ColorKernelsX86.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// SSE2/SSSE3/AVX2 kernels. this file is built without any -m flags, each
+// function carries its own target attribute and is selected at runtime.
+//
+
+#define LOG_TAG "ColorKernels.x86"
+#include <ABE/ABE.h>
+
+#include "ColorKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define TARGET_SSE2     __attribute__((target("sse2")))
+#define TARGET_SSSE3    __attribute__((target("ssse3")))
+#define TARGET_AVX2     __attribute__((target("avx2")))
+
+#define INLINE_SSE2     static FORCE_INLINE TARGET_SSE2
+#define INLINE_SSSE3    static FORCE_INLINE TARGET_SSSE3
+#define INLINE_AVX2     static FORCE_INLINE TARGET_AVX2
+
+__BEGIN_NAMESPACE_MFWK
+
+#pragma mark SSE2
+struct CoeffsSSE2 {
+    __m128i offset, y, rv, gu, gv, bu, c128;
+};
+
+INLINE_SSE2 void LoadCoeffs(CoeffsSSE2& k, const ColorParams * p) {
+    k.offset    = _mm_set1_epi16(p->offset << 7);
+    k.y         = _mm_set1_epi16(p->y);
+    k.rv        = _mm_set1_epi16(p->rv);
+    k.gu        = _mm_set1_epi16(p->gu);
+    k.gv        = _mm_set1_epi16(p->gv);
+    k.bu        = _mm_set1_epi16(p->bu);
+    k.c128      = _mm_set1_epi16(128 << 7);
+}
+
+// 8 pixels in 15 bits -> R/G/B in Q4
+INLINE_SSE2 void YUV2RGB8(const CoeffsSSE2& k, __m128i y, __m128i u, __m128i v,
+                          __m128i& r, __m128i& g, __m128i& b) {
+    y = _mm_mulhi_epi16(_mm_sub_epi16(y, k.offset), k.y);
+    u = _mm_sub_epi16(u, k.c128);
+    v = _mm_sub_epi16(v, k.c128);
+    r = _mm_add_epi16(y, _mm_mulhi_epi16(v, k.rv));
+    g = _mm_add_epi16(y, _mm_add_epi16(_mm_mulhi_epi16(u, k.gu), _mm_mulhi_epi16(v, k.gv)));
+    b = _mm_add_epi16(y, _mm_mulhi_epi16(u, k.bu));
+}
+
+// 16 pixels
+INLINE_SSE2 void YUV2RGB16(const CoeffsSSE2& k, const __m128i y[2], const __m128i u[2], const __m128i v[2],
+                           __m128i r[2], __m128i g[2], __m128i b[2]) {
+    YUV2RGB8(k, y[0], u[0], v[0], r[0], g[0], b[0]);
+    YUV2RGB8(k, y[1], u[1], v[1], r[1], g[1], b[1]);
+}
+
+// 16 pixels -> 64 bytes
+template <class RGB>
+INLINE_SSE2 void StoreRGBA16(UInt8 * dst, __m128i r, __m128i g, __m128i b) {
+    __m128i c[4];
+    c[RGB::r] = r;
+    c[RGB::g] = g;
+    c[RGB::b] = b;
+    c[RGB::a] = _mm_set1_epi8((Char)0xFF);
+    const __m128i lo01 = _mm_unpacklo_epi8(c[0], c[1]);
+    const __m128i hi01 = _mm_unpackhi_epi8(c[0], c[1]);
+    const __m128i lo23 = _mm_unpacklo_epi8(c[2], c[3]);
+    const __m128i hi23 = _mm_unpackhi_epi8(c[2], c[3]);
+    _mm_storeu_si128((__m128i *)(dst + 0),  _mm_unpacklo_epi16(lo01, lo23));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(lo01, lo23));
+    _mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi16(hi01, hi23));
+    _mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi16(hi01, hi23));
+}
+
+// Q4 -> 16 bits, @see ColorExpand
+INLINE_SSE2 __m128i Expand8(__m128i x) {
+    x = _mm_min_epi16(_mm_max_epi16(x, _mm_setzero_si128()), _mm_set1_epi16(255 * 16));
+    return _mm_add_epi16(_mm_slli_epi16(x, 4), _mm_srli_epi16(x, 4));
+}
+
+// 8 pixels -> 64 bytes, 16 bits per channel
+template <class RGB>
+INLINE_SSE2 void StoreRGBA8x16(UInt8 * dst, __m128i r, __m128i g, __m128i b) {
+    __m128i c[4];
+    c[RGB::r] = Expand8(r);
+    c[RGB::g] = Expand8(g);
+    c[RGB::b] = Expand8(b);
+    c[RGB::a] = _mm_set1_epi16((Int16)0xFFFF);
+    const __m128i lo01 = _mm_unpacklo_epi16(c[0], c[1]);
+    const __m128i hi01 = _mm_unpackhi_epi16(c[0], c[1]);
+    const __m128i lo23 = _mm_unpacklo_epi16(c[2], c[3]);
+    const __m128i hi23 = _mm_unpackhi_epi16(c[2], c[3]);
+    _mm_storeu_si128((__m128i *)(dst + 0),  _mm_unpacklo_epi32(lo01, lo23));
+    _mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi32(lo01, lo23));
+    _mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi32(hi01, hi23));
+    _mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi32(hi01, hi23));
+}
+
+// store 16 pixels of R/G/B in Q4 @ pixel i
+template <class RGB>
+INLINE_SSE2 void Store16(UInt8 * rgba, UInt32 i, const __m128i r[2], const __m128i g[2], const __m128i b[2]) {
+    if (RGB::depth == 8) {
+        const __m128i round = _mm_set1_epi16(8);
+#define ROUND(x)    _mm_srai_epi16(_mm_add_epi16(x, round), 4)
+        StoreRGBA16<RGB>(rgba + 4 * i,
+                         _mm_packus_epi16(ROUND(r[0]), ROUND(r[1])),
+                         _mm_packus_epi16(ROUND(g[0]), ROUND(g[1])),
+                         _mm_packus_epi16(ROUND(b[0]), ROUND(b[1])));
+#undef ROUND
+    } else {
+        StoreRGBA8x16<RGB>(rgba + 8 * i, r[0], g[0], b[0]);
+        StoreRGBA8x16<RGB>(rgba + 8 * i + 64, r[1], g[1], b[1]);
+    }
+}
+
+// 8 chroma samples -> 16 pixels
+INLINE_SSE2 __m128i Dup8(__m128i c) {
+    return _mm_unpacklo_epi8(c, c);
+}
+
+// even/odd bytes of 16 bytes -> 8 bytes in low half
+INLINE_SSE2 __m128i Even8(__m128i c) {
+    const __m128i mask = _mm_set1_epi16(0xFF);
+    return _mm_packus_epi16(_mm_and_si128(c, mask), mask);
+}
+
+INLINE_SSE2 __m128i Odd8(__m128i c) {
+    const __m128i mask = _mm_set1_epi16(0xFF);
+    return _mm_packus_epi16(_mm_srli_epi16(c, 8), mask);
+}
+
+// 16 bytes -> 2 x 8 samples in 15 bits
+INLINE_SSE2 void Widen8(__m128i x, __m128i w[2]) {
+    const __m128i zero = _mm_setzero_si128();
+    w[0] = _mm_slli_epi16(_mm_unpacklo_epi8(x, zero), 7);
+    w[1] = _mm_slli_epi16(_mm_unpackhi_epi8(x, zero), 7);
+}
+
+// even/odd samples of 2 x 8 samples in 15 bits -> 8 samples
+INLINE_SSE2 __m128i Even16(__m128i a, __m128i b) {
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                           _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+}
+
+INLINE_SSE2 __m128i Odd16(__m128i a, __m128i b) {
+    return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+
+// load 8 samples of 16 bits and normalize to 15 bits
+template <class YUV>
+INLINE_SSE2 __m128i Load8x16(const UInt16 * p) {
+    __m128i x = _mm_loadu_si128((const __m128i *)p);
+    if (YUV::shift) x = _mm_srli_epi16(x, YUV::shift);
+    if (YUV::shift + YUV::depth < 16) x = _mm_and_si128(x, _mm_set1_epi16(YUV::mask));
+    if (YUV::up)    x = _mm_slli_epi16(x, YUV::up);
+    if (YUV::down)  x = _mm_srli_epi16(x, YUV::down);
+    return x;
+}
+
+// load 16 pixels as Y'/Cb/Cr, one byte per pixel
+template <class YUV>
+INLINE_SSE2 void LoadBytes16(const UInt8 * y, const UInt8 * u, const UInt8 * v, UInt32 i,
+                             __m128i& Y, __m128i& U, __m128i& V) {
+    const UInt8 * cb = YUV::cb ? v : u;
+    const UInt8 * cr = YUV::cr ? v : u;
+    switch (YUV::layout) {
+        case kYUVLayoutPlanar:
+            Y = _mm_loadu_si128((const __m128i *)(y + i));
+            U = _mm_loadu_si128((const __m128i *)(cb + i));
+            V = _mm_loadu_si128((const __m128i *)(cr + i));
+            break;
+        case kYUVLayoutPlanarH2:
+            Y = _mm_loadu_si128((const __m128i *)(y + i));
+            U = Dup8(_mm_loadl_epi64((const __m128i *)(cb + i / 2)));
+            V = Dup8(_mm_loadl_epi64((const __m128i *)(cr + i / 2)));
+            break;
+        case kYUVLayoutSemiPlanar: {
+            const __m128i c = _mm_loadu_si128((const __m128i *)(u + i));
+            Y = _mm_loadu_si128((const __m128i *)(y + i));
+            U = Dup8(YUV::cb ? Odd8(c) : Even8(c));
+            V = Dup8(YUV::cr ? Odd8(c) : Even8(c));
+        } break;
+        case kYUVLayoutPacked: {
+            const __m128i mask = _mm_set1_epi16(0xFF);
+            const __m128i a = _mm_loadu_si128((const __m128i *)(y + 2 * i));
+            const __m128i b = _mm_loadu_si128((const __m128i *)(y + 2 * i + 16));
+            const __m128i e = _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+            const __m128i o = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+            // luma @ even or odd bytes, Cb & Cr alternate in the others
+            const __m128i c = (YUV::y0 & 1) ? e : o;
+            Y = (YUV::y0 & 1) ? o : e;
+            U = Dup8(YUV::cb < YUV::cr ? Even8(c) : Odd8(c));
+            V = Dup8(YUV::cb < YUV::cr ? Odd8(c) : Even8(c));
+        } break;
+        default:
+            break;
+    }
+}
+
+// load 16 pixels as Y'/Cb/Cr, 16 bits per sample
+template <class YUV>
+INLINE_SSE2 void LoadWords16(const UInt8 * y8, const UInt8 * u8, const UInt8 * v8, UInt32 i,
+                             __m128i Y[2], __m128i U[2], __m128i V[2]) {
+    const UInt16 * y = (const UInt16 *)y8;
+    const UInt16 * u = (const UInt16 *)u8;
+    const UInt16 * v = (const UInt16 *)v8;
+    const UInt16 * cb = YUV::cb ? v : u;
+    const UInt16 * cr = YUV::cr ? v : u;
+    __m128i c0, c1;     // 8 Cb & 8 Cr for 16 pixels
+    switch (YUV::layout) {
+        case kYUVLayoutPlanar:
+            Y[0] = Load8x16<YUV>(y + i);
+            Y[1] = Load8x16<YUV>(y + i + 8);
+            U[0] = Load8x16<YUV>(cb + i);
+            U[1] = Load8x16<YUV>(cb + i + 8);
+            V[0] = Load8x16<YUV>(cr + i);
+            V[1] = Load8x16<YUV>(cr + i + 8);
+            return;
+        case kYUVLayoutPlanarH2:
+            Y[0] = Load8x16<YUV>(y + i);
+            Y[1] = Load8x16<YUV>(y + i + 8);
+            c0 = Load8x16<YUV>(cb + i / 2);
+            c1 = Load8x16<YUV>(cr + i / 2);
+            break;
+        case kYUVLayoutSemiPlanar: {
+            const __m128i a = Load8x16<YUV>(u + i);
+            const __m128i b = Load8x16<YUV>(u + i + 8);
+            Y[0] = Load8x16<YUV>(y + i);
+            Y[1] = Load8x16<YUV>(y + i + 8);
+            c0 = YUV::cb ? Odd16(a, b) : Even16(a, b);
+            c1 = YUV::cr ? Odd16(a, b) : Even16(a, b);
+        } break;
+        case kYUVLayoutPacked: {
+            const __m128i a0 = Load8x16<YUV>(y + 2 * i);
+            const __m128i a1 = Load8x16<YUV>(y + 2 * i + 8);
+            const __m128i a2 = Load8x16<YUV>(y + 2 * i + 16);
+            const __m128i a3 = Load8x16<YUV>(y + 2 * i + 24);
+            // luma @ even or odd samples, Cb & Cr alternate in the others
+            const __m128i e0 = Even16(a0, a1), o0 = Odd16(a0, a1);
+            const __m128i e1 = Even16(a2, a3), o1 = Odd16(a2, a3);
+            const __m128i m0 = (YUV::y0 & 1) ? e0 : o0;
+            const __m128i m1 = (YUV::y0 & 1) ? e1 : o1;
+            Y[0] = (YUV::y0 & 1) ? o0 : e0;
+            Y[1] = (YUV::y0 & 1) ? o1 : e1;
+            c0 = YUV::cb < YUV::cr ? Even16(m0, m1) : Odd16(m0, m1);
+            c1 = YUV::cb < YUV::cr ? Odd16(m0, m1) : Even16(m0, m1);
+        } break;
+        default:
+            return;
+    }
+    U[0] = _mm_unpacklo_epi16(c0, c0);
+    U[1] = _mm_unpackhi_epi16(c0, c0);
+    V[0] = _mm_unpacklo_epi16(c1, c1);
+    V[1] = _mm_unpackhi_epi16(c1, c1);
+}
+
+// load 16 pixels as Y'/Cb/Cr in 15 bits
+template <class YUV>
+INLINE_SSE2 void Load16(const UInt8 * y, const UInt8 * u, const UInt8 * v, UInt32 i,
+                        __m128i Y[2], __m128i U[2], __m128i V[2]) {
+    if (YUV::depth == 8) {
+        __m128i y8, u8, v8;
+        LoadBytes16<YUV>(y, u, v, i, y8, u8, v8);
+        Widen8(y8, Y);
+        Widen8(u8, U);
+        Widen8(v8, V);
+    } else {
+        LoadWords16<YUV>(y, u, v, i, Y, U, V);
+    }
+}
+
+template <class YUV, class RGB>
+TARGET_SSE2 static void ColorPixels_SSE2(const UInt8 * y, const UInt8 * u, const UInt8 * v,
+                                         UInt8 * rgba, UInt32 i, UInt32 n, const ColorParams * p) {
+    CoeffsSSE2 k; LoadCoeffs(k, p);
+    for (; i + 16 <= n; i += 16) {
+        __m128i Y[2], U[2], V[2], r[2], g[2], b[2];
+        Load16<YUV>(y, u, v, i, Y, U, V);
+        YUV2RGB16(k, Y, U, V, r, g, b);
+        Store16<RGB>(rgba, i, r, g, b);
+    }
+    ColorPixels_C<YUV, RGB>(y, u, v, rgba, i, n, p);
+}
+
+template <class YUV, class RGB>
+TARGET_SSE2 static void ColorRow_SSE2(const UInt8 * y, const UInt8 * u, const UInt8 * v,
+                                      UInt8 * rgba, UInt32 n, const ColorParams * p) {
+    ColorPixels_SSE2<YUV, RGB>(y, u, v, rgba, 0, n, p);
+}
+
+#define ROW_SSE2(YUV, RGB)  { (ePixelFormat)YUV, (ePixelFormat)RGB, ColorRow_SSE2<YUVTraits<YUV>, RGBTraits<RGB> > },
+static const ColorRowEntry kRowsSSE2[] = {
+    COLOR_PAIRS(ROW_SSE2)
+    // END OF LIST
+    { kPixelFormatUnknown, kPixelFormatUnknown, Nil }
+};
+
+// coefficients of bytes 0 & 2 and bytes 1 & 3 of a pixel, as pmaddwd pairs
+template <class RGB>
+static FORCE_INLINE void RGBPairs(const Int16 k[3], Int32& even, Int32& odd) {
+    UInt16 c[4];
+    c[RGB::r] = k[0];
+    c[RGB::g] = k[1];
+    c[RGB::b] = k[2];
+    c[RGB::a] = 0;
+    even    = (Int32)(c[0] | ((UInt32)c[2] << 16));
+    odd     = (Int32)(c[1] | ((UInt32)c[3] << 16));
+}
+
+struct RGBCoeffsSSE2 {
+    __m128i even[3], odd[3], bias;
+};
+
+template <class RGB>
+INLINE_SSE2 void LoadRGBCoeffs(RGBCoeffsSSE2& k, const ColorParams * p) {
+    const Int16 * coeffs[3] = { p->ky, p->ku, p->kv };
+    for (UInt32 i = 0; i < 3; ++i) {
+        Int32 even, odd;
+        RGBPairs<RGB>(coeffs[i], even, odd);
+        k.even[i]   = _mm_set1_epi32(even);
+        k.odd[i]    = _mm_set1_epi32(odd);
+    }
+    k.bias  = _mm_set1_epi32((p->offset << 14) + 8192);
+}
+
+// 4 pixels -> Y'/Cb/Cr sums in 32 bits
+INLINE_SSE2 void RGB2YUV4(const RGBCoeffsSSE2& k, __m128i x, __m128i s[3]) {
+    const __m128i mask  = _mm_set1_epi32(0x00FF00FF);
+    const __m128i even  = _mm_and_si128(x, mask);
+    const __m128i odd   = _mm_and_si128(_mm_srli_epi32(x, 8), mask);
+    for (UInt32 i = 0; i < 3; ++i) {
+        s[i] = _mm_add_epi32(_mm_madd_epi16(even, k.even[i]), _mm_madd_epi16(odd, k.odd[i]));
+    }
+}
+
+template <class RGB>
+TARGET_SSE2 static void RGBRow_SSE2(const UInt8 * rgba, UInt8 * y, Int16 * u, Int16 * v,
+                                    UInt32 n, const ColorParams * p) {
+    UInt32 i = 0;
+    if (RGB::depth == 8) {
+        RGBCoeffsSSE2 k; LoadRGBCoeffs<RGB>(k, p);
+        for (; i + 16 <= n; i += 16) {
+            __m128i s[4][3];
+            for (UInt32 j = 0; j < 4; ++j) {
+                RGB2YUV4(k, _mm_loadu_si128((const __m128i *)(rgba + 4 * (i + 4 * j))), s[j]);
+            }
+#define LUMA(x)     _mm_srai_epi32(_mm_add_epi32(x, k.bias), 14)
+            const __m128i y0 = _mm_packs_epi32(LUMA(s[0][0]), LUMA(s[1][0]));
+            const __m128i y1 = _mm_packs_epi32(LUMA(s[2][0]), LUMA(s[3][0]));
+#undef LUMA
+            _mm_storeu_si128((__m128i *)(y + i), _mm_packus_epi16(y0, y1));
+#define CHROMA(j, c)    _mm_packs_epi32(_mm_srai_epi32(s[j][c], 8), _mm_srai_epi32(s[j + 1][c], 8))
+            _mm_storeu_si128((__m128i *)(u + i),     CHROMA(0, 1));
+            _mm_storeu_si128((__m128i *)(u + i + 8), CHROMA(2, 1));
+            _mm_storeu_si128((__m128i *)(v + i),     CHROMA(0, 2));
+            _mm_storeu_si128((__m128i *)(v + i + 8), CHROMA(2, 2));
+#undef CHROMA
+        }
+    }
+    RGBPixels_C<RGB>(rgba, y, u, v, i, n, p);
+}
+
+#define RGB_ROW_SSE2(RGB, ...)  { (ePixelFormat)RGB, RGBRow_SSE2<RGBTraits<RGB> > },
+static const RGBRowEntry kRGBRowsSSE2[] = {
+    RGB_FORMATS(RGB_ROW_SSE2)
+    // END OF LIST
+    { kPixelFormatUnknown, Nil }
+};
+
+static Bool SupportedSSE2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+const ColorKernels kColorKernelsSSE2 = {
+    "SSE2",
+    SupportedSSE2,
+    kRowsSSE2,
+    kRGBRowsSSE2,
+};
+
+#pragma mark SSSE3
+// pshufb deinterleaves packed 4:2:2 with a single constant mask,
+// the rest is the same as SSE2.
+template <class YUV, class RGB>
+TARGET_SSSE3 static void ColorPixels_SSSE3(const UInt8 * y, const UInt8 * u, const UInt8 * v,
+                                           UInt8 * rgba, UInt32 i, UInt32 n, const ColorParams * p) {
+    if (YUV::layout != kYUVLayoutPacked || YUV::depth != 8) {
+        ColorPixels_SSE2<YUV, RGB>(y, u, v, rgba, i, n, p);
+        return;
+    }
+
+    CoeffsSSE2 k; LoadCoeffs(k, p);
+    // 4 macro pixels -> Y'0 Y'1 ... Y'7 Cb0 .. Cb3 Cr0 .. Cr3
+    const __m128i shuffle   = _mm_setr_epi8(YUV::y0, YUV::y1, 4 + YUV::y0, 4 + YUV::y1,
+                                            8 + YUV::y0, 8 + YUV::y1, 12 + YUV::y0, 12 + YUV::y1,
+                                            YUV::cb, 4 + YUV::cb, 8 + YUV::cb, 12 + YUV::cb,
+                                            YUV::cr, 4 + YUV::cr, 8 + YUV::cr, 12 + YUV::cr);
+    const __m128i chroma    = _mm_setr_epi8(0, 1, 2, 3, 8, 9, 10, 11, 4, 5, 6, 7, 12, 13, 14, 15);
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(y + 2 * i)), shuffle);
+        const __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(y + 2 * i + 16)), shuffle);
+        // Cb0..Cb7 Cr0..Cr7
+        const __m128i c = _mm_shuffle_epi8(_mm_unpackhi_epi64(a, b), chroma);
+        __m128i Y[2], U[2], V[2], R[2], G[2], B[2];
+        Widen8(_mm_unpacklo_epi64(a, b), Y);
+        Widen8(_mm_unpacklo_epi8(c, c), U);
+        Widen8(_mm_unpackhi_epi8(c, c), V);
+        YUV2RGB16(k, Y, U, V, R, G, B);
+        Store16<RGB>(rgba, i, R, G, B);
+    }
+    ColorPixels_C<YUV, RGB>(y, u, v, rgba, i, n, p);
+}
+
+template <class YUV, class RGB>
+TARGET_SSSE3 static void ColorRow_SSSE3(const UInt8 * y, const UInt8 * u, const UInt8 * v,
+                                        UInt8 * rgba, UInt32 n, const ColorParams * p) {
+    ColorPixels_SSSE3<YUV, RGB>(y, u, v, rgba, 0, n, p);
+}
+
+#define ROW_SSSE3(YUV, RGB) { (ePixelFormat)YUV, (ePixelFormat)RGB, ColorRow_SSSE3<YUVTraits<YUV>, RGBTraits<RGB> > },
+static const ColorRowEntry kRowsSSSE3[] = {
+    COLOR_PAIRS(ROW_SSSE3)
+    // END OF LIST
+    { kPixelFormatUnknown, kPixelFormatUnknown, Nil }
+};
+
+static Bool SupportedSSSE3() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+}
+
+const ColorKernels kColorKernelsSSSE3 = {
+    "SSSE3",
+    SupportedSSSE3,
+    kRowsSSSE3,
+    kRGBRowsSSE2,   // nothing to gain from pshufb
+};
+
+#pragma mark AVX2
+struct CoeffsAVX2 {
+    __m256i offset, y, rv, gu, gv, bu, c128;
+};
+
+INLINE_AVX2 void LoadCoeffs(CoeffsAVX2& k, const ColorParams * p) {
+    k.offset    = _mm256_set1_epi16(p->offset << 7);
+    k.y         = _mm256_set1_epi16(p->y);
+    k.rv        = _mm256_set1_epi16(p->rv);
+    k.gu        = _mm256_set1_epi16(p->gu);
+    k.gv        = _mm256_set1_epi16(p->gv);
+    k.bu        = _mm256_set1_epi16(p->bu);
+    k.c128      = _mm256_set1_epi16(128 << 7);
+}
+
+// 16 pixels in 15 bits -> R/G/B in Q4
+INLINE_AVX2 void YUV2RGB16(const CoeffsAVX2& k, __m256i y, __m256i u, __m256i v,
+                           __m256i& r, __m256i& g, __m256i& b) {
+    y = _mm256_mulhi_epi16(_mm256_sub_epi16(y, k.offset), k.y);
+    u = _mm256_sub_epi16(u, k.c128);
+    v = _mm256_sub_epi16(v, k.c128);
+    r = _mm256_add_epi16(y, _mm256_mulhi_epi16(v, k.rv));
+    g = _mm256_add_epi16(y, _mm256_add_epi16(_mm256_mulhi_epi16(u, k.gu), _mm256_mulhi_epi16(v, k.gv)));
+    b = _mm256_add_epi16(y, _mm256_mulhi_epi16(u, k.bu));
+}
+
+// 32 pixels
+INLINE_AVX2 void YUV2RGB32(const CoeffsAVX2& k, const __m256i y[2], const __m256i u[2], const __m256i v[2],
+                           __m256i r[2], __m256i g[2], __m256i b[2]) {
+    YUV2RGB16(k, y[0], u[0], v[0], r[0], g[0], b[0]);
+    YUV2RGB16(k, y[1], u[1], v[1], r[1], g[1], b[1]);
+}
+
+// 32 pixels -> 128 bytes
+template <class RGB>
+INLINE_AVX2 void StoreRGBA32(UInt8 * dst, __m256i r, __m256i g, __m256i b) {
+    __m256i c[4];
+    c[RGB::r] = r;
+    c[RGB::g] = g;
+    c[RGB::b] = b;
+    c[RGB::a] = _mm256_set1_epi8((Char)0xFF);
+    const __m256i lo01 = _mm256_unpacklo_epi8(c[0], c[1]);     // 0-7, 16-23
+    const __m256i hi01 = _mm256_unpackhi_epi8(c[0], c[1]);     // 8-15, 24-31
+    const __m256i lo23 = _mm256_unpacklo_epi8(c[2], c[3]);
+    const __m256i hi23 = _mm256_unpackhi_epi8(c[2], c[3]);
+    const __m256i p0 = _mm256_unpacklo_epi16(lo01, lo23);      // 0-3, 16-19
+    const __m256i p1 = _mm256_unpackhi_epi16(lo01, lo23);      // 4-7, 20-23
+    const __m256i p2 = _mm256_unpacklo_epi16(hi01, hi23);      // 8-11, 24-27
+    const __m256i p3 = _mm256_unpackhi_epi16(hi01, hi23);      // 12-15, 28-31
+    _mm256_storeu_si256((__m256i *)(dst + 0),   _mm256_permute2x128_si256(p0, p1, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 32),  _mm256_permute2x128_si256(p2, p3, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 64),  _mm256_permute2x128_si256(p0, p1, 0x31));
+    _mm256_storeu_si256((__m256i *)(dst + 96),  _mm256_permute2x128_si256(p2, p3, 0x31));
+}
+
+// Q4 -> 16 bits, @see ColorExpand
+INLINE_AVX2 __m256i Expand16(__m256i x) {
+    x = _mm256_min_epi16(_mm256_max_epi16(x, _mm256_setzero_si256()), _mm256_set1_epi16(255 * 16));
+    return _mm256_add_epi16(_mm256_slli_epi16(x, 4), _mm256_srli_epi16(x, 4));
+}
+
+// 16 pixels -> 128 bytes, 16 bits per channel
+template <class RGB>
+INLINE_AVX2 void StoreRGBA16x16(UInt8 * dst, __m256i r, __m256i g, __m256i b) {
+    __m256i c[4];
+    c[RGB::r] = Expand16(r);
+    c[RGB::g] = Expand16(g);
+    c[RGB::b] = Expand16(b);
+    c[RGB::a] = _mm256_set1_epi16((Int16)0xFFFF);
+    const __m256i lo01 = _mm256_unpacklo_epi16(c[0], c[1]);    // 0-3, 8-11
+    const __m256i hi01 = _mm256_unpackhi_epi16(c[0], c[1]);    // 4-7, 12-15
+    const __m256i lo23 = _mm256_unpacklo_epi16(c[2], c[3]);
+    const __m256i hi23 = _mm256_unpackhi_epi16(c[2], c[3]);
+    const __m256i p0 = _mm256_unpacklo_epi32(lo01, lo23);      // 0-1, 8-9
+    const __m256i p1 = _mm256_unpackhi_epi32(lo01, lo23);      // 2-3, 10-11
+    const __m256i p2 = _mm256_unpacklo_epi32(hi01, hi23);      // 4-5, 12-13
+    const __m256i p3 = _mm256_unpackhi_epi32(hi01, hi23);      // 6-7, 14-15
+    _mm256_storeu_si256((__m256i *)(dst + 0),   _mm256_permute2x128_si256(p0, p1, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 32),  _mm256_permute2x128_si256(p2, p3, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 64),  _mm256_permute2x128_si256(p0, p1, 0x31));
+    _mm256_storeu_si256((__m256i *)(dst + 96),  _mm256_permute2x128_si256(p2, p3, 0x31));
+}
+
+// store 32 pixels of R/G/B in Q4 @ pixel i
+template <class RGB>
+INLINE_AVX2 void Store32(UInt8 * rgba, UInt32 i, const __m256i r[2], const __m256i g[2], const __m256i b[2]) {
+    if (RGB::depth == 8) {
+        const __m256i round = _mm256_set1_epi16(8);
+        // packus works in 128 bits lanes
+#define ROUND(x)    _mm256_srai_epi16(_mm256_add_epi16(x, round), 4)
+#define PACK(x)     _mm256_permute4x64_epi64(_mm256_packus_epi16(ROUND(x[0]), ROUND(x[1])), 0xD8)
+        StoreRGBA32<RGB>(rgba + 4 * i, PACK(r), PACK(g), PACK(b));
+#undef PACK
+#undef ROUND
+    } else {
+        StoreRGBA16x16<RGB>(rgba + 8 * i, r[0], g[0], b[0]);
+        StoreRGBA16x16<RGB>(rgba + 8 * i + 128, r[1], g[1], b[1]);
+    }
+}
+
+// 16 chroma samples -> 32 pixels
+INLINE_AVX2 __m256i Dup16(__m128i c) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(c, c)),
+                                   _mm_unpackhi_epi8(c, c), 1);
+}
+
+// even/odd bytes of 32 bytes in 16 bits lanes -> 16 ordered bytes
+INLINE_AVX2 __m128i Pack16(__m256i c) {
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(c, c), 0x08));
+}
+
+// 32 bytes -> 2 x 16 samples in 15 bits
+INLINE_AVX2 void Widen16(__m256i x, __m256i w[2]) {
+    w[0] = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(x)), 7);
+    w[1] = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(x, 1)), 7);
+}
+
+// even/odd samples of 2 x 16 samples in 15 bits -> 16 ordered samples
+INLINE_AVX2 __m256i Even32(__m256i a, __m256i b) {
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16),
+                                                       _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16)), 0xD8);
+}
+
+INLINE_AVX2 __m256i Odd32(__m256i a, __m256i b) {
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_srai_epi32(a, 16),
+                                                       _mm256_srai_epi32(b, 16)), 0xD8);
+}
+
+// 16 chroma samples in 16 bits -> 2 x 16 pixels
+INLINE_AVX2 void Dup32(__m256i c, __m256i w[2]) {
+    const __m256i lo = _mm256_unpacklo_epi16(c, c);            // 0-3, 8-11
+    const __m256i hi = _mm256_unpackhi_epi16(c, c);            // 4-7, 12-15
+    w[0] = _mm256_permute2x128_si256(lo, hi, 0x20);
+    w[1] = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+
+// load 16 samples of 16 bits and normalize to 15 bits
+template <class YUV>
+INLINE_AVX2 __m256i Load16x16(const UInt16 * p) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)p);
+    if (YUV::shift) x = _mm256_srli_epi16(x, YUV::shift);
+    if (YUV::shift + YUV::depth < 16) x = _mm256_and_si256(x, _mm256_set1_epi16(YUV::mask));
+    if (YUV::up)    x = _mm256_slli_epi16(x, YUV::up);
+    if (YUV::down)  x = _mm256_srli_epi16(x, YUV::down);
+    return x;
+}
+
+// load 32 pixels as Y'/Cb/Cr, one byte per pixel
+template <class YUV>
+INLINE_AVX2 void LoadBytes32(const UInt8 * y, const UInt8 * u, const UInt8 * v, UInt32 i,
+                             __m256i& Y, __m256i& U, __m256i& V) {
+    const __m256i mask = _mm256_set1_epi16(0xFF);
+    const UInt8 * cb = YUV::cb ? v : u;
+    const UInt8 * cr = YUV::cr ? v : u;
+    switch (YUV::layout) {
+        case kYUVLayoutPlanar:
+            Y = _mm256_loadu_si256((const __m256i *)(y + i));
+            U = _mm256_loadu_si256((const __m256i *)(cb + i));
+            V = _mm256_loadu_si256((const __m256i *)(cr + i));
+            break;
+        case kYUVLayoutPlanarH2:
+            Y = _mm256_loadu_si256((const __m256i *)(y + i));
+            U = Dup16(_mm_loadu_si128((const __m128i *)(cb + i / 2)));
+            V = Dup16(_mm_loadu_si128((const __m128i *)(cr + i / 2)));
+            break;
+        case kYUVLayoutSemiPlanar: {
+            const __m256i c = _mm256_loadu_si256((const __m256i *)(u + i));
+            const __m128i c0 = Pack16(_mm256_and_si256(c, mask));
+            const __m128i c1 = Pack16(_mm256_srli_epi16(c, 8));
+            Y = _mm256_loadu_si256((const __m256i *)(y + i));
+            U = Dup16(YUV::cb ? c1 : c0);
+            V = Dup16(YUV::cr ? c1 : c0);
+        } break;
+        case kYUVLayoutPacked: {
+            const __m256i a = _mm256_loadu_si256((const __m256i *)(y + 2 * i));
+            const __m256i b = _mm256_loadu_si256((const __m256i *)(y + 2 * i + 32));
+            const __m256i e = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_and_si256(a, mask),
+                                                                           _mm256_and_si256(b, mask)), 0xD8);
+            const __m256i o = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_srli_epi16(a, 8),
+                                                                           _mm256_srli_epi16(b, 8)), 0xD8);
+            const __m256i c = (YUV::y0 & 1) ? e : o;
+            const __m128i c0 = Pack16(_mm256_and_si256(c, mask));
+            const __m128i c1 = Pack16(_mm256_srli_epi16(c, 8));
+            Y = (YUV::y0 & 1) ? o : e;
+            U = Dup16(YUV::cb < YUV::cr ? c0 : c1);
+            V = Dup16(YUV::cb < YUV::cr ? c1 : c0);
+        } break;
+        default:
+            break;
+    }
+}
+
+// load 32 pixels as Y'/Cb/Cr, 16 bits per sample
+template <class YUV>
+INLINE_AVX2 void LoadWords32(const UInt8 * y8, const UInt8 * u8, const UInt8 * v8, UInt32 i,
+                             __m256i Y[2], __m256i U[2], __m256i V[2]) {
+    const UInt16 * y = (const UInt16 *)y8;
+    const UInt16 * u = (const UInt16 *)u8;
+    const UInt16 * v = (const UInt16 *)v8;
+    const UInt16 * cb = YUV::cb ? v : u;
+    const UInt16 * cr = YUV::cr ? v : u;
+    __m256i c0, c1;     // 16 Cb & 16 Cr for 32 pixels
+    switch (YUV::layout) {
+        case kYUVLayoutPlanar:
+            Y[0] = Load16x16<YUV>(y + i);
+            Y[1] = Load16x16<YUV>(y + i + 16);
+            U[0] = Load16x16<YUV>(cb + i);
+            U[1] = Load16x16<YUV>(cb + i + 16);
+            V[0] = Load16x16<YUV>(cr + i);
+            V[1] = Load16x16<YUV>(cr + i + 16);
+            return;
+        case kYUVLayoutPlanarH2:
+            Y[0] = Load16x16<YUV>(y + i);
+            Y[1] = Load16x16<YUV>(y + i + 16);
+            c0 = Load16x16<YUV>(cb + i / 2);
+            c1 = Load16x16<YUV>(cr + i / 2);
+            break;
+        case kYUVLayoutSemiPlanar: {
+            const __m256i a = Load16x16<YUV>(u + i);
+            const __m256i b = Load16x16<YUV>(u + i + 16);
+            Y[0] = Load16x16<YUV>(y + i);
+            Y[1] = Load16x16<YUV>(y + i + 16);
+            c0 = YUV::cb ? Odd32(a, b) : Even32(a, b);
+            c1 = YUV::cr ? Odd32(a, b) : Even32(a, b);
+        } break;
+        case kYUVLayoutPacked: {
+            const __m256i a0 = Load16x16<YUV>(y + 2 * i);
+            const __m256i a1 = Load16x16<YUV>(y + 2 * i + 16);
+            const __m256i a2 = Load16x16<YUV>(y + 2 * i + 32);
+            const __m256i a3 = Load16x16<YUV>(y + 2 * i + 48);
+            const __m256i e0 = Even32(a0, a1), o0 = Odd32(a0, a1);
+            const __m256i e1 = Even32(a2, a3), o1 = Odd32(a2, a3);
+            const __m256i m0 = (YUV::y0 & 1) ? e0 : o0;
+            const __m256i m1 = (YUV::y0 & 1) ? e1 : o1;
+            Y[0] = (YUV::y0 & 1) ? o0 : e0;
+            Y[1] = (YUV::y0 & 1) ? o1 : e1;
+            c0 = YUV::cb < YUV::cr ? Even32(m0, m1) : Odd32(m0, m1);
+            c1 = YUV::cb < YUV::cr ? Odd32(m0, m1) : Even32(m0, m1);
+        } break;
+        default:
+            return;
+    }
+    Dup32(c0, U);
+    Dup32(c1, V);
+}
+
+// load 32 pixels as Y'/Cb/Cr in 15 bits
+template <class YUV>
+INLINE_AVX2 void Load32(const UInt8 * y, const UInt8 * u, const UInt8 * v, UInt32 i,
+                        __m256i Y[2], __m256i U[2], __m256i V[2]) {
+    if (YUV::depth == 8) {
+        __m256i y8, u8, v8;
+        LoadBytes32<YUV>(y, u, v, i, y8, u8, v8);
+        Widen16(y8, Y);
+        Widen16(u8, U);
+        Widen16(v8, V);
+    } else {
+        LoadWords32<YUV>(y, u, v, i, Y, U, V);
+    }
+}
+
+template <class YUV, class RGB>
+TARGET_AVX2 static void ColorRow_AVX2(const UInt8 * y, const UInt8 * u, const UInt8 * v,
+                                      UInt8 * rgba, UInt32 n, const ColorParams * p) {
+    CoeffsAVX2 k; LoadCoeffs(k, p);
+    UInt32 i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i Y[2], U[2], V[2], r[2], g[2], b[2];
+        Load32<YUV>(y, u, v, i, Y, U, V);
+        YUV2RGB32(k, Y, U, V, r, g, b);
+        Store32<RGB>(rgba, i, r, g, b);
+    }
+    if (i < n) ColorPixels_SSSE3<YUV, RGB>(y, u, v, rgba, i, n, p);
+}
+
+#define ROW_AVX2(YUV, RGB)  { (ePixelFormat)YUV, (ePixelFormat)RGB, ColorRow_AVX2<YUVTraits<YUV>, RGBTraits<RGB> > },
+static const ColorRowEntry kRowsAVX2[] = {
+    COLOR_PAIRS(ROW_AVX2)
+    // END OF LIST
+    { kPixelFormatUnknown, kPixelFormatUnknown, Nil }
+};
+
+struct RGBCoeffsAVX2 {
+    __m256i even[3], odd[3], bias;
+};
+
+template <class RGB>
+INLINE_AVX2 void LoadRGBCoeffs(RGBCoeffsAVX2& k, const ColorParams * p) {
+    const Int16 * coeffs[3] = { p->ky, p->ku, p->kv };
+    for (UInt32 i = 0; i < 3; ++i) {
+        Int32 even, odd;
+        RGBPairs<RGB>(coeffs[i], even, odd);
+        k.even[i]   = _mm256_set1_epi32(even);
+        k.odd[i]    = _mm256_set1_epi32(odd);
+    }
+    k.bias  = _mm256_set1_epi32((p->offset << 14) + 8192);
+}
+
+// 8 pixels -> Y'/Cb/Cr sums in 32 bits
+INLINE_AVX2 void RGB2YUV8(const RGBCoeffsAVX2& k, __m256i x, __m256i s[3]) {
+    const __m256i mask  = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i even  = _mm256_and_si256(x, mask);
+    const __m256i odd   = _mm256_and_si256(_mm256_srli_epi32(x, 8), mask);
+    for (UInt32 i = 0; i < 3; ++i) {
+        s[i] = _mm256_add_epi32(_mm256_madd_epi16(even, k.even[i]), _mm256_madd_epi16(odd, k.odd[i]));
+    }
+}
+
+template <class RGB>
+TARGET_AVX2 static void RGBRow_AVX2(const UInt8 * rgba, UInt8 * y, Int16 * u, Int16 * v,
+                                    UInt32 n, const ColorParams * p) {
+    UInt32 i = 0;
+    if (RGB::depth == 8) {
+        RGBCoeffsAVX2 k; LoadRGBCoeffs<RGB>(k, p);
+        // packs work in 128-bit lanes
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; i + 32 <= n; i += 32) {
+            __m256i s[4][3];
+            for (UInt32 j = 0; j < 4; ++j) {
+                RGB2YUV8(k, _mm256_loadu_si256((const __m256i *)(rgba + 4 * (i + 8 * j))), s[j]);
+            }
+#define LUMA(x)     _mm256_srai_epi32(_mm256_add_epi32(x, k.bias), 14)
+            const __m256i y0 = _mm256_packs_epi32(LUMA(s[0][0]), LUMA(s[1][0]));
+            const __m256i y1 = _mm256_packs_epi32(LUMA(s[2][0]), LUMA(s[3][0]));
+#undef LUMA
+            _mm256_storeu_si256((__m256i *)(y + i),
+                                _mm256_permutevar8x32_epi32(_mm256_packus_epi16(y0, y1), order));
+#define CHROMA(j, c)    _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_srai_epi32(s[j][c], 8), \
+                                                                    _mm256_srai_epi32(s[j + 1][c], 8)), 0xD8)
+            _mm256_storeu_si256((__m256i *)(u + i),      CHROMA(0, 1));
+            _mm256_storeu_si256((__m256i *)(u + i + 16), CHROMA(2, 1));
+            _mm256_storeu_si256((__m256i *)(v + i),      CHROMA(0, 2));
+            _mm256_storeu_si256((__m256i *)(v + i + 16), CHROMA(2, 2));
+#undef CHROMA
+        }
+    }
+    if (i < n) RGBRow_SSE2<RGB>(rgba + 4 * i * (RGB::depth / 8), y + i, u + i, v + i, n - i, p);
+}
+
+#define RGB_ROW_AVX2(RGB, ...)  { (ePixelFormat)RGB, RGBRow_AVX2<RGBTraits<RGB> > },
+static const RGBRowEntry kRGBRowsAVX2[] = {
+    RGB_FORMATS(RGB_ROW_AVX2)
+    // END OF LIST
+    { kPixelFormatUnknown, Nil }
+};
+
+static Bool SupportedAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+const ColorKernels kColorKernelsAVX2 = {
+    "AVX2",
+    SupportedAVX2,
+    kRowsAVX2,
+    kRGBRowsAVX2,
+};
+
+__END_NAMESPACE_MFWK
+#endif // __x86_64__ || __i386__
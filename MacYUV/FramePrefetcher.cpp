@@ -0,0 +1,268 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    FramePrefetcher.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// the prefetch job picks the next missing frame of the current window each
+// time, so a new request redirects it without any explicit cancel, and the
+// frame being read when the window moves is the only wasted one.
+// mapped frames cost nothing to wrap, their pages are touched instead, to
+// bring them into page cache.
+//
+
+#define LOG_TAG "FramePrefetcher"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+
+#include "FramePrefetcher.h"
+#include "PixelFormats.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+#define PAGE_BYTES      (4096)
+
+struct PrefetcherImpl;
+struct PrefetchJob : public Job {
+    PrefetcherImpl *    mPrefetcher;    // prefetcher owns this job
+
+    PrefetchJob(const sp<Looper>& looper, PrefetcherImpl * prefetcher) :
+        Job(looper), mPrefetcher(prefetcher) { }
+
+    virtual void onJob();
+};
+
+struct PrefetchSlot {
+    Int64               index;
+    sp<MediaFrame>      frame;
+};
+
+// read a byte of each page, which blocks until the page is loaded
+static void TouchPages(const sp<MediaFrame>& frame) {
+    volatile UInt8 sum = 0;
+    for (UInt32 i = 0; i < frame->planes.count; ++i) {
+        const MediaBuffer& buffer = frame->planes.buffers[i];
+        for (UInt32 j = 0; j < buffer.size; j += PAGE_BYTES) {
+            sum += buffer.data[j];
+        }
+    }
+    (void)sum;
+}
+
+struct PrefetcherImpl : public FramePrefetcher {
+    sp<FrameReader>     mReader;
+    ImageFormat         mFormat;
+    Int64               mCount;
+    Int64               mAhead;
+    Int64               mBehind;
+    sp<Job>             mJob;
+
+    // shared with prefetch job
+    Mutex               mLock;
+    Condition           mWait;
+    Vector<PrefetchSlot> mSlots;        // at most window size
+    Int64               mCurrent;       // last requested frame
+    Int64               mDirection;     // +1 or -1
+    Int64               mReading;       // frame being read by job, -1 for none
+    Bool                mRunning;
+    Bool                mCancelled;
+
+    PrefetcherImpl() : FramePrefetcher(), mCount(0), mAhead(0), mBehind(0),
+        mCurrent(-1), mDirection(1), mReading(-1), mRunning(False), mCancelled(False) { }
+
+    virtual ~PrefetcherImpl() {
+        AutoLock _l(mLock);
+        mCancelled = True;
+        while (mRunning) mWait.wait(mLock);
+    }
+
+    MediaError init(const sp<FrameReader>& reader, const ImageFormat& format, const sp<Message>& options) {
+        const UInt32 bytes = GetImageBytes(format);
+        if (reader.isNil() || bytes == 0) {
+            return kMediaErrorBadParameters;
+        }
+
+        Int32 depth = kPrefetchDepthDefault;
+        if (!options.isNil() && options->contains(kKeyPrefetchDepth)) {
+            depth = options->findInt32(kKeyPrefetchDepth);
+        }
+        if (depth < 0) return kMediaErrorBadParameters;
+
+        mReader     = reader;
+        mFormat     = format;
+        mCount      = reader->length() / bytes;
+        mAhead      = depth;
+        mBehind     = depth / 2;
+        if (depth > 0) {
+            mJob    = new PrefetchJob(new Looper("frameprefetcher", kThreadBackgroud), this);
+        }
+        INFO("%s, %" PRId64 " frames, %" PRId64 " ahead, %" PRId64 " behind",
+             GetImageFormatString(format).c_str(), mCount, mAhead, mBehind);
+        return kMediaNoError;
+    }
+
+    // i-th frame of window, from current one and then ahead & behind
+    // in turn, -1 if it is out of range
+    Int64 windowFrame(Int64 i) const {
+        Int64 index;
+        if (i == 0) {
+            index = mCurrent;
+        } else if (i <= 2 * mBehind) {
+            // ahead & behind alternately, nearest first
+            index = mCurrent + (i & 1 ? (i + 1) / 2 : -i / 2) * mDirection;
+        } else {
+            index = mCurrent + (i - mBehind) * mDirection;
+        }
+        return index >= 0 && index < mCount ? index : -1;
+    }
+
+    Bool inWindow(Int64 index) const {
+        const Int64 distance = (index - mCurrent) * mDirection;
+        return distance >= -mBehind && distance <= mAhead;
+    }
+
+    Int64 findSlot(Int64 index) const {
+        for (UInt32 i = 0; i < mSlots.size(); ++i) {
+            if (mSlots[i].index == index) return i;
+        }
+        return -1;
+    }
+
+    // next frame for job, -1 if all frames in window are ready
+    Int64 nextFrame() const {
+        for (Int64 i = 1; i <= mAhead + mBehind; ++i) {
+            const Int64 index = windowFrame(i);
+            if (index >= 0 && findSlot(index) < 0) return index;
+        }
+        return -1;
+    }
+
+    void putFrame(Int64 index, const sp<MediaFrame>& frame) {
+        // drop frames out of window, which bounds the pool
+        for (UInt32 i = 0; i < mSlots.size();) {
+            if (inWindow(mSlots[i].index)) ++i;
+            else mSlots.erase(i);
+        }
+        if (!inWindow(index) || findSlot(index) >= 0) return;
+        PrefetchSlot& slot  = mSlots.push();
+        slot.index          = index;
+        slot.frame          = frame;
+    }
+
+    virtual sp<MediaFrame> readFrame(Int64 index) {
+        if (index < 0 || index >= mCount) return Nil;
+
+        sp<MediaFrame> frame;
+        {
+            AutoLock _l(mLock);
+            // learn direction from steps, keep it for jumps
+            if (mCurrent >= 0 && index != mCurrent && index - mCurrent >= -mBehind && index - mCurrent <= mAhead) {
+                mDirection  = index > mCurrent ? 1 : -1;
+            }
+            mCurrent = index;
+
+            // the job is reading it, wait rather than read it twice
+            while (mReading == index) mWait.wait(mLock);
+
+            const Int64 slot = findSlot(index);
+            if (slot >= 0) frame = mSlots[slot].frame;
+        }
+        DEBUG("frame %" PRId64 " %s", index, frame.isNil() ? "missed" : "hit");
+
+        if (frame.isNil()) {
+            frame = mReader->readFrame(mFormat, index);
+            if (frame.isNil()) return Nil;
+        }
+
+        if (!mJob.isNil()) {
+            AutoLock _l(mLock);
+            putFrame(index, frame);
+            if (!mRunning && nextFrame() >= 0) {
+                mRunning = True;
+                mJob->dispatch();
+            }
+        }
+        return frame;
+    }
+
+    void prefetch() {
+        AutoLock _l(mLock);
+        while (!mCancelled) {
+            const Int64 index = nextFrame();
+            if (index < 0) break;
+
+            mReading = index;
+            mLock.unlock();
+            sp<MediaFrame> frame = mReader->readFrame(mFormat, index);
+            if (!frame.isNil() && mReader->mapped()) TouchPages(frame);
+            mLock.lock();
+            mReading = -1;
+
+            if (frame.isNil()) {
+                ERROR("prefetch frame %" PRId64 " failed", index);
+                break;
+            }
+            putFrame(index, frame);
+            mWait.broadcast();
+        }
+        mRunning = False;
+        mWait.broadcast();
+    }
+};
+
+void PrefetchJob::onJob() {
+    mPrefetcher->prefetch();
+}
+
+sp<FramePrefetcher> CreateFramePrefetcher(const sp<FrameReader>& reader, const ImageFormat& format, const sp<Message>& options) {
+    sp<PrefetcherImpl> prefetcher = new PrefetcherImpl;
+    if (prefetcher->init(reader, format, options) == kMediaNoError) {
+        return prefetcher;
+    }
+    return Nil;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+FramePrefetcherRef FramePrefetcherCreate(const FrameReaderRef reader, const ImageFormat * format, MessageObjectRef options) {
+    sp<FramePrefetcher> prefetcher = CreateFramePrefetcher(static_cast<FrameReader *>(reader), *format,
+                                                           static_cast<Message *>(options));
+    if (prefetcher.isNil()) return Nil;
+    return prefetcher->RetainObject();
+}
+
+MediaFrameRef FramePrefetcherReadFrame(const FramePrefetcherRef ref, Int64 index) {
+    sp<FramePrefetcher> prefetcher = static_cast<FramePrefetcher *>(ref);
+    sp<MediaFrame> frame = prefetcher->readFrame(index);
+    if (frame.isNil()) return Nil;
+    return frame->RetainObject();
+}
@@ -0,0 +1,92 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    FramePrefetcher.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// read frames around the current one ahead of time on its own looper, so
+// stepping through big raw files does not wait for disk. the direction is
+// learned from requests, more frames are read in the direction of moving.
+//
+
+#ifndef MACYUV_FRAME_PREFETCHER_H
+#define MACYUV_FRAME_PREFETCHER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaFramework.h>
+
+#include "FrameReader.h"
+
+__BEGIN_DECLS
+
+#define kPrefetchDepthDefault   (4)
+
+enum {
+    kKeyPrefetchDepth   = FOURCC('pfdp'),       ///< Int32, frames read ahead, default kPrefetchDepthDefault
+};
+
+typedef SharedObjectRef         FramePrefetcherRef;
+
+/**
+ * create a prefetcher of frames in format.
+ * depth frames are kept ahead in the direction of moving, and half of
+ * them behind, with the current one. frames out of the window are dropped.
+ * @param options   kKeyPrefetchDepth, 0 to disable, can be Nil
+ */
+API_EXPORT FramePrefetcherRef   FramePrefetcherCreate(const FrameReaderRef, const ImageFormat *, MessageObjectRef);
+
+/**
+ * get the index-th frame, from prefetched frames or read it now, then
+ * prefetch around it.
+ * @return return Nil if index is out of range
+ * @note prefetching for the last request stops at the next frame when a
+ *       new request moves the window.
+ */
+API_EXPORT MediaFrameRef        FramePrefetcherReadFrame(const FramePrefetcherRef, Int64 index);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+struct FramePrefetcher : public SharedObject {
+    virtual sp<MediaFrame>  readFrame(Int64 index) = 0;
+
+    protected:
+    FramePrefetcher() : SharedObject(FOURCC('?pft')) { }
+    virtual ~FramePrefetcher() { }
+};
+
+API_EXPORT sp<FramePrefetcher> CreateFramePrefetcher(const sp<FrameReader>&, const ImageFormat&, const sp<Message>&);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_FRAME_PREFETCHER_H
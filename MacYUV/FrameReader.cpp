@@ -0,0 +1,141 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    FrameReader.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "FrameReader"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+
+#include "FrameReader.h"
+#include "MappedFile.h"
+#include "PixelFormats.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+// frames are offsets of the mapping
+struct MappedReader : public FrameReader {
+    sp<MappedFile>      mFile;
+
+    MappedReader(const sp<MappedFile>& file) : FrameReader(), mFile(file) { }
+
+    virtual Int64 length() const {
+        return mFile->length();
+    }
+
+    virtual Bool mapped() const {
+        return True;
+    }
+
+    virtual sp<MediaFrame> readFrame(const ImageFormat& format, Int64 index) {
+        const UInt32 bytes = GetImageBytes(format);
+        if (bytes == 0 || index < 0) return Nil;
+        return mFile->frame(format, index * bytes);
+    }
+};
+
+// content is not thread safe, and keeps a read position, so reads are
+// serialized and seek by distance from the current position. the next
+// frame is 0 bytes away.
+struct ContentReader : public FrameReader {
+    mutable Mutex       mLock;
+    sp<ABuffer>         mContent;
+
+    ContentReader(const sp<ABuffer>& content) : FrameReader(), mContent(content) { }
+
+    virtual Int64 length() const {
+        AutoLock _l(mLock);
+        return mContent->capacity();
+    }
+
+    virtual Bool mapped() const {
+        return False;
+    }
+
+    virtual sp<MediaFrame> readFrame(const ImageFormat& format, Int64 index) {
+        const UInt32 bytes = GetImageBytes(format);
+        if (bytes == 0 || index < 0) return Nil;
+
+        AutoLock _l(mLock);
+        const Int64 position = index * bytes;
+        if (position + bytes > mContent->capacity()) return Nil;
+
+        const Int64 distance = position - mContent->offset();
+        if (distance != 0 && mContent->skipBytes(distance) != distance) {
+            ERROR("seek to frame %" PRId64 " failed", index);
+            return Nil;
+        }
+
+        sp<Buffer> data = mContent->readBytes(bytes);
+        if (data.isNil() || data->size() < bytes) {
+            ERROR("read frame %" PRId64 " failed", index);
+            return Nil;
+        }
+        return CreateImageFrame(format, data);
+    }
+};
+
+sp<FrameReader> CreateFrameReader(const String& url) {
+    sp<MappedFile> file = OpenMappedFile(url);
+    if (!file.isNil()) {
+        return new MappedReader(file);
+    }
+
+    sp<ABuffer> content = Content::Create(url);
+    if (content.isNil()) {
+        ERROR("open %s failed", url.c_str());
+        return Nil;
+    }
+    return new ContentReader(content);
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+FrameReaderRef FrameReaderCreate(const Char * url) {
+    sp<FrameReader> reader = CreateFrameReader(url);
+    if (reader.isNil()) return Nil;
+    return reader->RetainObject();
+}
+
+Int64 FrameReaderGetLength(const FrameReaderRef ref) {
+    sp<FrameReader> reader = static_cast<FrameReader *>(ref);
+    return reader->length();
+}
+
+MediaFrameRef FrameReaderReadFrame(const FrameReaderRef ref, const ImageFormat * format, Int64 index) {
+    sp<FrameReader> reader = static_cast<FrameReader *>(ref);
+    sp<MediaFrame> frame = reader->readFrame(*format, index);
+    if (frame.isNil()) return Nil;
+    return frame->RetainObject();
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    FrameReader.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// random access to frames of a raw file by index. local files are mapped,
+// a frame is an offset into the mapping. other urls are read by content,
+// seeking from the current position instead of from the beginning.
+//
+
+#ifndef MACYUV_FRAME_READER_H
+#define MACYUV_FRAME_READER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+typedef SharedObjectRef         FrameReaderRef;
+
+/**
+ * open a raw file for reading frames
+ * @return return Nil if url can not be opened
+ */
+API_EXPORT FrameReaderRef       FrameReaderCreate(const Char * url);
+
+/**
+ * get bytes of the file
+ */
+API_EXPORT Int64                FrameReaderGetLength(const FrameReaderRef);
+
+/**
+ * read the index-th frame, GetImageFormatBytes() per frame.
+ * @return return Nil if index is out of range
+ * @note the cost is the same for any index.
+ */
+API_EXPORT MediaFrameRef        FrameReaderReadFrame(const FrameReaderRef, const ImageFormat *, Int64 index);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+struct FrameReader : public SharedObject {
+    virtual Int64           length() const = 0;
+    /**
+     * true if frames are wrapped on a mapping, which costs nothing until
+     * pages are touched.
+     */
+    virtual Bool            mapped() const = 0;
+    virtual sp<MediaFrame>  readFrame(const ImageFormat&, Int64 index) = 0;
+
+    protected:
+    FrameReader() : SharedObject(FOURCC('?frd')) { }
+    virtual ~FrameReader() { }
+};
+
+API_EXPORT sp<FrameReader> CreateFrameReader(const String& url);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_FRAME_READER_H
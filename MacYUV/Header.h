@@ -12,5 +12,21 @@
 #define LOG_TAG "mpx.swift"
 #include <ABE/ABE.h>
 #include <MediaFramework/MediaFramework.h>
+#include "ImageConverter.h"
+#include "PixelFormats.h"
+#include "ImagePlanner.h"
+#include "ImageTiler.h"
+#include "ImageSwizzler.h"
+#include "ImageRotator.h"
+#include "YUVConverter.h"
+#include "ImageDither.h"
+#include "ImageToneMap.h"
+#include "ImageStatistics.h"
+#include "ImageCompare.h"
+#include "ImageDiff.h"
+#include "ImagePlaneView.h"
+#include "MappedFile.h"
+#include "FrameReader.h"
+#include "FramePrefetcher.h"
 
 #endif /* Header_h */
@@ -0,0 +1,532 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageCompare.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// components are gathered 4 rows at a time, squared error & max diff are
+// per row, and SSIM sums of 4x4 blocks are per 4 rows, then each 8x8
+// window is 2x2 blocks of two block rows.
+//
+
+#define LOG_TAG "ImageCompare"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <math.h>
+#include <string.h>
+
+#include "ImageCompare.h"
+#include "ImageConverter.h"
+#include "ImageStatistics.h"
+#include "PixelFormats.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+__BEGIN_NAMESPACE_MFWK
+
+// SSIM constants K1 & K2
+#define SSIM_K1     (0.01)
+#define SSIM_K2     (0.03)
+
+#pragma mark Kernels
+/**
+ * squared error & max abs diff of two rows
+ * @note WIDE for 16 bits samples, whose diff is out of Int16
+ */
+template <Bool WIDE>
+static void DiffRow(const UInt16 * a, const UInt16 * b, UInt32 n, UInt64& sse, UInt32& diff) {
+    UInt32 i = 0;
+    UInt32 hi = diff;
+#if defined(__SSE2__)
+    const __m128i sign  = _mm_set1_epi16(0x8000);
+    const __m128i zero  = _mm_setzero_si128();
+    __m128i vmax        = sign;     // unsigned max by signed one
+    __m128i vsse        = zero;     // 2 x 64 bits
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        const __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        const __m128i d = _mm_or_si128(_mm_subs_epu16(x, y), _mm_subs_epu16(y, x));
+        vmax = _mm_max_epi16(vmax, _mm_xor_si128(d, sign));
+        if (WIDE) {
+            const __m128i lo = _mm_unpacklo_epi16(d, zero);
+            const __m128i hi = _mm_unpackhi_epi16(d, zero);
+            vsse = _mm_add_epi64(vsse, _mm_add_epi64(_mm_mul_epu32(lo, lo), _mm_mul_epu32(hi, hi)));
+            const __m128i lo1 = _mm_srli_epi64(lo, 32);
+            const __m128i hi1 = _mm_srli_epi64(hi, 32);
+            vsse = _mm_add_epi64(vsse, _mm_add_epi64(_mm_mul_epu32(lo1, lo1), _mm_mul_epu32(hi1, hi1)));
+        } else {
+            // d < 2^15, so pairs of squares < 2^31
+            const __m128i m = _mm_madd_epi16(d, d);
+            vsse = _mm_add_epi64(vsse, _mm_add_epi64(_mm_unpacklo_epi32(m, zero), _mm_unpackhi_epi32(m, zero)));
+        }
+    }
+    if (i) {
+        Int16 M[8];
+        UInt64 s[2];
+        _mm_storeu_si128((__m128i *)M, vmax);
+        _mm_storeu_si128((__m128i *)s, vsse);
+        for (UInt32 k = 0; k < 8; ++k) {
+            const UInt32 v = (UInt16)(M[k] ^ 0x8000);
+            if (v > hi) hi = v;
+        }
+        sse += s[0] + s[1];
+    }
+#elif defined(__aarch64__)
+    uint16x8_t vmax     = vdupq_n_u16(0);
+    uint64x2_t vsse     = vdupq_n_u64(0);
+    for (; i + 8 <= n; i += 8) {
+        const uint16x8_t d = vabdq_u16(vld1q_u16(a + i), vld1q_u16(b + i));
+        vmax = vmaxq_u16(vmax, d);
+        vsse = vpadalq_u32(vsse, vmull_u16(vget_low_u16(d), vget_low_u16(d)));
+        vsse = vpadalq_u32(vsse, vmull_u16(vget_high_u16(d), vget_high_u16(d)));
+    }
+    if (i) {
+        if (vmaxvq_u16(vmax) > hi) hi = vmaxvq_u16(vmax);
+        sse += vgetq_lane_u64(vsse, 0) + vgetq_lane_u64(vsse, 1);
+    }
+#endif
+    for (; i < n; ++i) {
+        const UInt32 d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+        if (d > hi) hi = d;
+        sse += (UInt64)d * d;
+    }
+    diff = hi;
+}
+
+// sums of a 4x4 block
+struct SsimBlock {
+    UInt64      s1;
+    UInt64      s2;
+    UInt64      ss;         // sum of squares of both
+    UInt64      s12;
+};
+
+/**
+ * sums of 4x4 blocks of 4 rows
+ * @note NARROW for samples <= 12 bits, whose sums of 4 rows fit in 32 bits
+ */
+template <Bool NARROW>
+static void SsimRows(const UInt16 * const * a, const UInt16 * const * b, UInt32 blocks, SsimBlock * out) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    if (NARROW) {
+        const __m128i ones = _mm_set1_epi16(1);
+        for (; i + 2 <= blocks; i += 2) {
+            __m128i s1  = _mm_setzero_si128();
+            __m128i s2  = _mm_setzero_si128();
+            __m128i ss  = _mm_setzero_si128();
+            __m128i s12 = _mm_setzero_si128();
+            for (UInt32 r = 0; r < 4; ++r) {
+                const __m128i x = _mm_loadu_si128((const __m128i *)(a[r] + i * 4));
+                const __m128i y = _mm_loadu_si128((const __m128i *)(b[r] + i * 4));
+                s1  = _mm_add_epi32(s1, _mm_madd_epi16(x, ones));
+                s2  = _mm_add_epi32(s2, _mm_madd_epi16(y, ones));
+                ss  = _mm_add_epi32(ss, _mm_add_epi32(_mm_madd_epi16(x, x), _mm_madd_epi16(y, y)));
+                s12 = _mm_add_epi32(s12, _mm_madd_epi16(x, y));
+            }
+            // pairs of lanes are blocks
+            UInt32 v[4][4];
+            _mm_storeu_si128((__m128i *)v[0], s1);
+            _mm_storeu_si128((__m128i *)v[1], s2);
+            _mm_storeu_si128((__m128i *)v[2], ss);
+            _mm_storeu_si128((__m128i *)v[3], s12);
+            for (UInt32 k = 0; k < 2; ++k) {
+                out[i + k].s1   = v[0][k * 2] + v[0][k * 2 + 1];
+                out[i + k].s2   = v[1][k * 2] + v[1][k * 2 + 1];
+                out[i + k].ss   = v[2][k * 2] + v[2][k * 2 + 1];
+                out[i + k].s12  = v[3][k * 2] + v[3][k * 2 + 1];
+            }
+        }
+    }
+#elif defined(__aarch64__)
+    if (NARROW) {
+        for (; i + 2 <= blocks; i += 2) {
+            uint32x4_t s1   = vdupq_n_u32(0);
+            uint32x4_t s2   = vdupq_n_u32(0);
+            uint32x4_t ss0  = vdupq_n_u32(0);
+            uint32x4_t ss1  = vdupq_n_u32(0);
+            uint32x4_t s120 = vdupq_n_u32(0);
+            uint32x4_t s121 = vdupq_n_u32(0);
+            for (UInt32 r = 0; r < 4; ++r) {
+                const uint16x8_t x = vld1q_u16(a[r] + i * 4);
+                const uint16x8_t y = vld1q_u16(b[r] + i * 4);
+                s1      = vpadalq_u16(s1, x);
+                s2      = vpadalq_u16(s2, y);
+                ss0     = vmlal_u16(vmlal_u16(ss0, vget_low_u16(x), vget_low_u16(x)), vget_low_u16(y), vget_low_u16(y));
+                ss1     = vmlal_u16(vmlal_u16(ss1, vget_high_u16(x), vget_high_u16(x)), vget_high_u16(y), vget_high_u16(y));
+                s120    = vmlal_u16(s120, vget_low_u16(x), vget_low_u16(y));
+                s121    = vmlal_u16(s121, vget_high_u16(x), vget_high_u16(y));
+            }
+            out[i].s1       = vaddv_u32(vget_low_u32(s1));
+            out[i + 1].s1   = vaddv_u32(vget_high_u32(s1));
+            out[i].s2       = vaddv_u32(vget_low_u32(s2));
+            out[i + 1].s2   = vaddv_u32(vget_high_u32(s2));
+            out[i].ss       = vaddvq_u32(ss0);
+            out[i + 1].ss   = vaddvq_u32(ss1);
+            out[i].s12      = vaddvq_u32(s120);
+            out[i + 1].s12  = vaddvq_u32(s121);
+        }
+    }
+#endif
+    for (; i < blocks; ++i) {
+        SsimBlock& s = out[i];
+        s.s1 = s.s2 = s.ss = s.s12 = 0;
+        for (UInt32 r = 0; r < 4; ++r) {
+            for (UInt32 k = i * 4; k < i * 4 + 4; ++k) {
+                const UInt64 x = a[r][k];
+                const UInt64 y = b[r][k];
+                s.s1    += x;
+                s.s2    += y;
+                s.ss    += x * x + y * y;
+                s.s12   += x * y;
+            }
+        }
+    }
+}
+
+/**
+ * SSIM of 8x8 windows of two block rows, every 4 samples
+ * @param c1 & c2 constants scaled by 64 * 64
+ */
+static Float64 SsimWindows(const SsimBlock * top, const SsimBlock * bottom, UInt32 blocks, Float64 c1, Float64 c2) {
+    Float64 ssim = 0;
+    for (UInt32 i = 0; i + 1 < blocks; ++i) {
+        const Float64 s1    = (Float64)(top[i].s1 + top[i + 1].s1 + bottom[i].s1 + bottom[i + 1].s1);
+        const Float64 s2    = (Float64)(top[i].s2 + top[i + 1].s2 + bottom[i].s2 + bottom[i + 1].s2);
+        const Float64 ss    = (Float64)(top[i].ss + top[i + 1].ss + bottom[i].ss + bottom[i + 1].ss);
+        const Float64 s12   = (Float64)(top[i].s12 + top[i + 1].s12 + bottom[i].s12 + bottom[i + 1].s12);
+        const Float64 vars  = ss * 64 - s1 * s1 - s2 * s2;
+        const Float64 covar = s12 * 64 - s1 * s2;
+        ssim += (2 * s1 * s2 + c1) * (2 * covar + c2) / ((s1 * s1 + s2 * s2 + c1) * (vars + c2));
+    }
+    return ssim;
+}
+
+#pragma mark Image Compare
+struct CompareImpl;
+struct CompareJob : public Job {
+    CompareImpl *       mCompare;       // compare owns this job
+    UInt32              mIndex;
+
+    CompareJob(const sp<Looper>& looper, CompareImpl * compare, UInt32 index) :
+        Job(looper), mCompare(compare), mIndex(index) { }
+
+    virtual void onJob();
+};
+
+// frames are taken one by one, with its own scratch rows
+struct CompareWorker {
+    UInt16 *            rows;           // 4 rows of each
+    SsimBlock *         blocks;         // 2 block rows
+    sp<Job>             job;            // Nil for the first worker, which runs on caller's thread
+
+    CompareWorker() : rows(Nil), blocks(Nil) { }
+};
+
+struct CompareImpl : public ImageCompare {
+    ImageFormat         mFormat;
+    ImageComponents     mComponents;
+    UInt32              mBytes;
+    Vector<CompareWorker>   mWorkers;
+
+    // process context, shared with jobs
+    Mutex               mLock;
+    Condition           mWait;
+    UInt32              mPending;
+    MediaError          mStatus;
+    sp<ABuffer>         mSources[2];
+    UInt32              mCount;
+    UInt32              mNext;          // next frame to read
+    ImageCompareResult *    mResults;
+
+    CompareImpl() : ImageCompare(), mBytes(0), mPending(0), mStatus(kMediaNoError),
+        mCount(0), mNext(0), mResults(Nil) { }
+
+    virtual ~CompareImpl() {
+        for (UInt32 i = 0; i < mWorkers.size(); ++i) {
+            delete [] mWorkers[i].rows;
+            delete [] mWorkers[i].blocks;
+        }
+        mWorkers.clear();
+    }
+
+    MediaError init(const ImageFormat& format, const sp<Message>& options) {
+        if (format.rect.x < 0 || format.rect.y < 0 || format.rect.w <= 0 || format.rect.h <= 0 ||
+            format.rect.x + format.rect.w > format.width || format.rect.y + format.rect.h > format.height) {
+            return kMediaErrorBadParameters;
+        }
+        if (GetImageComponents(format.format, mComponents) != kMediaNoError) {
+            return kMediaErrorNotSupported;
+        }
+        mFormat     = format;
+        mBytes      = GetImageBytes(format);
+        if (mBytes == 0) return kMediaErrorNotSupported;
+
+        UInt32 threads = GetCpuCount();
+        if (!options.isNil() && options->contains(kKeyCount)) {
+            threads = options->findInt32(kKeyCount);
+        }
+        if (threads == 0) threads = 1;
+
+        // luma has the most samples, padded for SIMD pairs of blocks
+        const UInt32 n = format.rect.w + 8;
+        for (UInt32 i = 0; i < threads; ++i) {
+            CompareWorker& worker = mWorkers.push();
+            worker.rows     = new UInt16[n * 8];
+            worker.blocks   = new SsimBlock[n / 4 * 2];
+            if (i > 0) {
+                worker.job = new CompareJob(GetWorkerLooper(i - 1), this, i);
+            }
+        }
+        INFO("%s: %u planes, %u threads", GetImageFormatString(mFormat).c_str(), mComponents.count, threads);
+        return kMediaNoError;
+    }
+
+    MediaError compareFrame(CompareWorker& worker, const MediaBufferList * a, const MediaBufferList * b,
+                            ImageCompareResult& result) {
+        UInt8 * ap[4], * bp[4];
+        UInt32 as[4], bs[4];
+        if (GetImagePlaneData(mFormat, a, False, ap, as) != kMediaNoError ||
+            GetImagePlaneData(mFormat, b, False, bp, bs) != kMediaNoError) {
+            return kMediaErrorBadParameters;
+        }
+
+        const ImageComponents& components = mComponents;
+        const Float64 peak  = components.mask;
+        const Float64 c1    = SSIM_K1 * SSIM_K1 * peak * peak * 64 * 64;
+        const Float64 c2    = SSIM_K2 * SSIM_K2 * peak * peak * 64 * 64;
+        const UInt32 bytes  = components.bytes;
+        const Int32 stride  = mFormat.rect.w + 8;
+
+        memset(&result, 0, sizeof(result));
+        result.planes = components.count;
+        for (UInt32 c = 0; c < components.count; ++c) {
+            const ImageComponent& p = components.planes[c];
+            const Int32 x0      = mFormat.rect.x / p.hss;
+            const Int32 n       = (mFormat.rect.x + mFormat.rect.w - 1) / p.hss + 1 - x0;
+            const Int32 y0      = mFormat.rect.y / p.vss;
+            const Int32 rows    = (mFormat.rect.y + mFormat.rect.h - 1) / p.vss + 1 - y0;
+            const UInt32 blocks = n / 4;
+            const UInt8 * sa    = ap[p.plane] + y0 * as[p.plane] + (x0 * p.step + p.offset) * bytes;
+            const UInt8 * sb    = bp[p.plane] + y0 * bs[p.plane] + (x0 * p.step + p.offset) * bytes;
+
+            UInt64 sse = 0;
+            UInt32 diff = 0;
+            Float64 ssim = 0;
+            UInt32 windows = 0;
+            SsimBlock * top     = worker.blocks;
+            SsimBlock * bottom  = worker.blocks + stride / 4;
+            for (Int32 y = 0; y < rows; y += 4) {
+                const UInt32 m = rows - y < 4 ? rows - y : 4;
+                const UInt16 * ra[4];
+                const UInt16 * rb[4];
+                for (UInt32 r = 0; r < m; ++r) {
+                    UInt16 * da = worker.rows + r * stride;
+                    UInt16 * db = worker.rows + (r + 4) * stride;
+                    p.gather(sa + (y + r) * as[p.plane], da, n, components.shift, components.mask);
+                    p.gather(sb + (y + r) * bs[p.plane], db, n, components.shift, components.mask);
+                    if (components.depth > 15)  DiffRow<True>(da, db, n, sse, diff);
+                    else                        DiffRow<False>(da, db, n, sse, diff);
+                    ra[r] = da;
+                    rb[r] = db;
+                }
+                // partial blocks are left out
+                if (m < 4 || blocks < 2) continue;
+
+                if (components.depth > 12)  SsimRows<False>(ra, rb, blocks, bottom);
+                else                        SsimRows<True>(ra, rb, blocks, bottom);
+                if (y > 0) {
+                    ssim    += SsimWindows(top, bottom, blocks, c1, c2);
+                    windows += blocks - 1;
+                }
+                SsimBlock * t = top; top = bottom; bottom = t;
+            }
+
+            const Float64 mse   = (Float64)sse / ((UInt64)n * rows);
+            result.diff[c]      = diff;
+            result.mse[c]       = mse;
+            result.psnr[c]      = mse > 0 ? 10 * log10(peak * peak / mse) : kComparePSNRMax;
+            if (result.psnr[c] > kComparePSNRMax) result.psnr[c] = kComparePSNRMax;
+            if (windows)    result.ssim[c] = ssim / windows;
+            else            result.ssim[c] = sse ? 0 : 1;
+        }
+        return kMediaNoError;
+    }
+
+    virtual MediaError compare(const sp<MediaFrame>& a, const sp<MediaFrame>& b, ImageCompareResult& result) {
+        return compareFrame(mWorkers[0], &a->planes, &b->planes, result);
+    }
+
+    // read next frame of both sources in order, a is Nil if no more
+    MediaError readFrame(UInt32& index, sp<MediaFrame>& a, sp<MediaFrame>& b) {
+        AutoLock _l(mLock);
+        if (mNext >= mCount || mStatus != kMediaNoError) return kMediaNoError;
+        index = mNext++;
+
+        sp<Buffer> da = mSources[0]->readBytes(mBytes);
+        sp<Buffer> db = mSources[1]->readBytes(mBytes);
+        if (da.isNil() || db.isNil() || da->size() < mBytes || db->size() < mBytes) {
+            ERROR("read frame %u failed", index);
+            return kMediaErrorBadContent;
+        }
+        a = CreateImageFrame(mFormat, da);
+        b = CreateImageFrame(mFormat, db);
+        if (a.isNil() || b.isNil()) return kMediaErrorBadContent;
+        return kMediaNoError;
+    }
+
+    MediaError processWorker(UInt32 index) {
+        CompareWorker& worker = mWorkers[index];
+        for (;;) {
+            UInt32 i;
+            sp<MediaFrame> a, b;
+            MediaError st = readFrame(i, a, b);
+            if (st == kMediaNoError && a.isNil()) break;
+            if (st == kMediaNoError) st = compareFrame(worker, &a->planes, &b->planes, mResults[i]);
+            if (st != kMediaNoError) return st;
+        }
+        return kMediaNoError;
+    }
+
+    void onWorkerDone(MediaError st) {
+        AutoLock _l(mLock);
+        if (st != kMediaNoError) mStatus = st;
+        if (--mPending == 0) mWait.signal();
+    }
+
+    virtual sp<Message> process(const sp<ABuffer>& a, const sp<ABuffer>& b) {
+        a->resetBytes();
+        b->resetBytes();
+        const UInt32 count = (a->size() < b->size() ? a->size() : b->size()) / mBytes;
+        if (count == 0) {
+            ERROR("no frames to compare");
+            return Nil;
+        }
+        sp<Buffer> results = new Buffer(count * sizeof(ImageCompareResult));
+
+        const UInt32 n = mWorkers.size() < count ? mWorkers.size() : count;
+        mSources[0]     = a;
+        mSources[1]     = b;
+        mCount          = count;
+        mNext           = 0;
+        mResults        = (ImageCompareResult *)results->base();
+        mStatus         = kMediaNoError;
+        mPending        = n - 1;
+        for (UInt32 i = 1; i < n; ++i) {
+            mWorkers[i].job->dispatch();
+        }
+
+        MediaError st = processWorker(0);
+        {
+            AutoLock _l(mLock);
+            if (st != kMediaNoError) mStatus = st;
+            while (mPending) mWait.wait(mLock);
+            st = mStatus;
+        }
+        mSources[0].clear();
+        mSources[1].clear();
+        mResults        = Nil;
+        if (st != kMediaNoError) {
+            ERROR("compare of %s failed", GetImageFormatString(mFormat).c_str());
+            return Nil;
+        }
+        results->setBytesRange(0, count * sizeof(ImageCompareResult));
+
+        // summary of all frames
+        const ImageCompareResult * frames = (const ImageCompareResult *)results->base();
+        const Float64 peak = mComponents.mask;
+        sp<Message> summary = new Message;
+        summary->setInt32(kKeyCompareFrames, count);
+        summary->setInt32(kKeyComparePlanes, mComponents.count);
+        for (UInt32 c = 0; c < mComponents.count; ++c) {
+            Float64 mse = 0, psnr = 0, ssim = 0;
+            UInt32 diff = 0;
+            for (UInt32 i = 0; i < count; ++i) {
+                mse     += frames[i].mse[c];
+                psnr    += frames[i].psnr[c];
+                ssim    += frames[i].ssim[c];
+                if (frames[i].diff[c] > diff) diff = frames[i].diff[c];
+            }
+            mse     /= count;
+            psnr    /= count;
+            ssim    /= count;
+
+            sp<Message> plane = new Message;
+            Float64 global = mse > 0 ? 10 * log10(peak * peak / mse) : kComparePSNRMax;
+            if (global > kComparePSNRMax) global = kComparePSNRMax;
+            plane->setDouble(kKeyComparePSNR, global);
+            plane->setDouble(kKeyComparePSNRMean, psnr);
+            plane->setDouble(kKeyCompareSSIM, ssim);
+            plane->setInt32(kKeyCompareDiff, diff);
+            summary->setObject(kKeyComparePlane + c, plane);
+        }
+        summary->setObject(kKeyCompareResults, results);
+        INFO("%s: %u frames compared", GetImageFormatString(mFormat).c_str(), count);
+        return summary;
+    }
+};
+
+void CompareJob::onJob() {
+    mCompare->onWorkerDone(mCompare->processWorker(mIndex));
+}
+
+sp<ImageCompare> CreateImageCompare(const ImageFormat& format, const sp<Message>& options) {
+    sp<CompareImpl> compare = new CompareImpl;
+    if (compare->init(format, options) == kMediaNoError) {
+        return compare;
+    }
+    return Nil;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+ImageCompareRef ImageCompareCreate(const ImageFormat * format, MessageObjectRef options) {
+    sp<ImageCompare> compare = CreateImageCompare(*format, static_cast<Message *>(options));
+    if (compare.isNil()) return Nil;
+    return compare->RetainObject();
+}
+
+MessageObjectRef ImageCompareProcess(ImageCompareRef ref, BufferObjectRef a, BufferObjectRef b) {
+    sp<ImageCompare> compare = static_cast<ImageCompare *>(ref);
+    sp<Message> summary = compare->process(static_cast<ABuffer *>(a), static_cast<ABuffer *>(b));
+    if (summary.isNil()) return Nil;
+    return summary->RetainObject();
+}
+
+MediaError ImageCompareFrames(ImageCompareRef ref, const MediaFrameRef a, const MediaFrameRef b, ImageCompareResult * result) {
+    sp<ImageCompare> compare = static_cast<ImageCompare *>(ref);
+    return compare->compare(static_cast<MediaFrame *>(a), static_cast<MediaFrame *>(b), *result);
+}
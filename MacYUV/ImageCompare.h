@@ -0,0 +1,113 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageCompare.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// compare two raw sequences in the same format frame by frame, e.g. an
+// encoder's decoded output against its source: PSNR, SSIM and max abs
+// diff of each plane, which are components as ImageStatistics.
+//
+
+#ifndef MACYUV_IMAGE_COMPARE_H
+#define MACYUV_IMAGE_COMPARE_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+#define kComparePSNRMax     (100.0)     ///< PSNR of identical planes
+
+enum {
+    kKeyCompareFrames   = FOURCC('cfrm'),       ///< Int32, frames compared
+    kKeyComparePlanes   = FOURCC('cpln'),       ///< Int32, number of planes
+    kKeyComparePlane    = FOURCC('cpl0'),       ///< sp<Message>, the i-th plane is kKeyComparePlane + i
+    kKeyCompareResults  = FOURCC('cres'),       ///< sp<Buffer>, ImageCompareResult of each frame
+    // keys of a plane
+    kKeyComparePSNR     = FOURCC('cpsn'),       ///< Float64, dB of MSE of all frames
+    kKeyComparePSNRMean = FOURCC('cpsm'),       ///< Float64, dB, mean of frames
+    kKeyCompareSSIM     = FOURCC('cssm'),       ///< Float64, mean of frames
+    kKeyCompareDiff     = FOURCC('cdif'),       ///< Int32, max abs diff of all frames
+};
+
+typedef struct ImageCompareResult {
+    UInt32          planes;
+    UInt32          diff[4];                    ///< max abs diff
+    Float64         mse[4];
+    Float64         psnr[4];                    ///< dB, kComparePSNRMax at most
+    Float64         ssim[4];                    ///< mean of 8x8 windows every 4 samples
+} ImageCompareResult;
+
+typedef SharedObjectRef         ImageCompareRef;
+
+/**
+ * create a compare of frames in format, only display rect is compared.
+ * frames are spread over threads.
+ * @param options   kKeyCount for threads, default cpu count
+ * @return return Nil if pixel format is not supported
+ * @note planes less than 8x8 samples has SSIM 1 if identical, otherwise 0.
+ */
+API_EXPORT ImageCompareRef      ImageCompareCreate(const ImageFormat *, MessageObjectRef);
+
+/**
+ * compare sequences from the beginning, GetImageFormatBytes() per frame,
+ * until either one ends.
+ * @return return a message with summary and kKeyCompareResults, Nil on failure
+ *         or if there is no frame.
+ */
+API_EXPORT MessageObjectRef     ImageCompareProcess(ImageCompareRef, BufferObjectRef, BufferObjectRef);
+
+/**
+ * compare two frames on caller's thread
+ * @note not to be called while ImageCompareProcess() is running.
+ */
+API_EXPORT MediaError           ImageCompareFrames(ImageCompareRef, const MediaFrameRef, const MediaFrameRef, ImageCompareResult *);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+struct ImageCompare : public SharedObject {
+    virtual MediaError  compare(const sp<MediaFrame>&, const sp<MediaFrame>&, ImageCompareResult&) = 0;
+    virtual sp<Message> process(const sp<ABuffer>&, const sp<ABuffer>&) = 0;
+
+    protected:
+    ImageCompare() : SharedObject(FOURCC('?cmp')) { }
+    virtual ~ImageCompare() { }
+};
+
+API_EXPORT sp<ImageCompare> CreateImageCompare(const ImageFormat&, const sp<Message>&);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_COMPARE_H
@@ -0,0 +1,1481 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageConverter.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "ImageConverter"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <math.h>
+#include <string.h>
+
+#include "ImageConverter.h"
+#include "PixelFormats.h"
+#include "ImageScaler.h"
+#include "ImagePlanner.h"
+#include "ImageSwizzler.h"
+#include "YUVConverter.h"
+#include "ImageDither.h"
+#include "ImageToneMap.h"
+#include "ColorKernels.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+#pragma mark Color Units
+#define FORMAT_ENTRY(FORMAT, ...)   FORMAT,
+static const UInt32 kYUVFormats[] = {
+    YUV_FORMATS(FORMAT_ENTRY)
+    kPixelFormatUnknown
+};
+
+static const UInt32 kRGBFormats[] = {
+    RGB_FORMATS(FORMAT_ENTRY)
+    kPixelFormatUnknown
+};
+
+struct ColorUnitContext {
+    const ColorKernels *    kernels;
+    const PixelDescriptor * desc;
+    ImageFormat             iformat;
+    ImageFormat             oformat;
+    UInt32                  bpp;        // bytes per output pixel
+    UInt32                  phase;      // display rect.x in chroma pair
+    ColorRow                row;
+    const ColorParams *     params;
+};
+
+static MediaUnitContext ColorUnitAlloc() {
+    ColorUnitContext * instance = new ColorUnitContext;
+    return instance;
+}
+
+static void ColorUnitDealloc(MediaUnitContext ref) {
+    ColorUnitContext * instance = static_cast<ColorUnitContext *>(ref);
+    delete instance;
+}
+
+static MediaError ColorUnitInit(MediaUnitContext ref, const ColorKernels * kernels,
+                                const MediaFormat * iformat, const MediaFormat * oformat) {
+    ColorUnitContext * instance = static_cast<ColorUnitContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    const YUVLayout * layout = GetYUVLayout(in.format);
+    if (layout == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    // no scaling
+    if (in.rect.w != out.width || in.rect.h != out.height) {
+        return kMediaErrorNotSupported;
+    }
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // output rect selects the rows to produce
+    if (out.rect.x != 0 || out.rect.w != out.width ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // any width & height, and display rect at any pixel
+    const PixelDescriptor * desc = GetImagePixelDescriptor(in.format);
+
+    const ColorRow row = GetColorRow(kernels, in.format, out.format);
+    const ColorParams * params = GetColorParams(in.matrix);
+    if (row == Nil || params == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    instance->kernels   = kernels;
+    instance->desc      = desc;
+    instance->iformat   = in;
+    instance->oformat   = out;
+    instance->bpp       = GetImagePixelDescriptor(out.format)->bpp / 8;
+    instance->phase     = layout->layout == kYUVLayoutPlanar ? 0 : (in.rect.x & 1);
+    instance->row       = row;
+    instance->params    = params;
+    DEBUG("%s: %s -> %s", kernels->name,
+          GetImageFormatString(in).c_str(),
+          GetImageFormatString(out).c_str());
+    return kMediaNoError;
+}
+
+static MediaError ColorUnitProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    ColorUnitContext * instance = static_cast<ColorUnitContext *>(ref);
+    const PixelDescriptor * desc    = instance->desc;
+    const ImageFormat& in           = instance->iformat;
+    const ImageFormat& out          = instance->oformat;
+
+    const UInt32 bytes = out.width * out.height * instance->bpp;
+    if (output->count < 1 || output->buffers[0].capacity < bytes) {
+        return kMediaErrorBadParameters;
+    }
+
+    UInt8 * planes[4];
+    UInt32 strides[4];
+    MediaError st = GetImagePlaneData(in, input, False, planes, strides);
+    if (st != kMediaNoError) return st;
+
+    // display rect starts at the 2nd pixel of a chroma pair, rows start from
+    // the pair and its 1st pixel is dropped
+    const UInt32 phase  = instance->phase;
+    const UInt32 bpp    = instance->bpp;
+    UInt32 pair[3];
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        planes[i]   += (((in.rect.x - phase) / desc->planes[i].hss) * desc->planes[i].bpp) / 8;
+        pair[i]     = ((2 / desc->planes[i].hss) * desc->planes[i].bpp) / 8;
+    }
+
+    UInt8 * dst = output->buffers[0].data;
+    for (Int32 j = out.rect.y; j < out.rect.y + out.rect.h; ++j) {
+        const Int32 row = in.rect.y + j;
+        const UInt8 * y = planes[0] + row * strides[0];
+        const UInt8 * u = planes[1] ? planes[1] + (row / desc->planes[1].vss) * strides[1] : Nil;
+        const UInt8 * v = planes[2] ? planes[2] + (row / desc->planes[2].vss) * strides[2] : Nil;
+        UInt8 * rgba    = dst + j * out.width * bpp;
+        UInt32 n        = out.width;
+        if (phase) {
+            UInt8 head[2 * 8];
+            instance->row(y, u, v, head, 2, instance->params);
+            memcpy(rgba, head + bpp, bpp);
+            if (--n == 0) continue;
+            y       += pair[0];
+            u       = u ? u + pair[1] : Nil;
+            v       = v ? v + pair[2] : Nil;
+            rgba    += bpp;
+        }
+        instance->row(y, u, v, rgba, n, instance->params);
+    }
+    output->buffers[0].size = bytes;
+    return kMediaNoError;
+}
+
+static MediaError ColorUnitReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+// one unit per kernels
+#define COLOR_UNIT(ISA)                                                                 \
+static MediaError ColorUnitInit##ISA(MediaUnitContext ref,                              \
+                                     const MediaFormat * iformat,                       \
+                                     const MediaFormat * oformat) {                     \
+    return ColorUnitInit(ref, &kColorKernels##ISA, iformat, oformat);                   \
+}                                                                                       \
+static const MediaUnit kColorUnit##ISA = {                                              \
+    "yuv2rgb." #ISA,                                                                    \
+    0,                                                                                  \
+    kYUVFormats,                                                                        \
+    kRGBFormats,                                                                        \
+    ColorUnitAlloc,                                                                     \
+    ColorUnitDealloc,                                                                   \
+    ColorUnitInit##ISA,                                                                 \
+    ColorUnitProcess,                                                                   \
+    Nil,                                                                                \
+    ColorUnitReset,                                                                     \
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+COLOR_UNIT(AVX2)
+COLOR_UNIT(SSSE3)
+COLOR_UNIT(SSE2)
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+COLOR_UNIT(NEON)
+#endif
+COLOR_UNIT(C)
+
+#pragma mark Color Scale Unit
+// crop + convert + scale in one pass.
+// each output row blends two source rows, which are resampled horizontally
+// first and cached, so only display pixels are touched, never the whole rect.
+// bilinear in Q8, then planar 4:4:4 rows go to the best color kernels.
+// high bit depth samples are scaled in 16 bits, and go to 16-bit rows.
+// 2 taps alias when downscaling by more than 2, which is left to the
+// planner, as ImageScaler widens its filters by the ratio.
+#define MAX_SCALE_DOWN  (2)
+#define SCALE_BITS      (8)
+#define SCALE_ONE       (1 << SCALE_BITS)
+
+struct ScaleTap {
+    UInt32                  x0;         // byte offset of left sample in plane row
+    UInt32                  x1;         // byte offset of right sample in plane row
+    UInt16                  f;          // weight of right sample
+};
+
+struct ScaleComponent {
+    UInt32                  plane;
+    UInt32                  offset;     // sample offset of first sample in plane row
+    UInt32                  step;       // samples to next sample of this component
+    UInt32                  bytes;      // bytes per sample
+    UInt32                  shift;      // right shift to significant bits
+    UInt32                  mask;       // significant bits
+    UInt32                  up;         // left shift to 16 bits
+    UInt32                  hss;
+    UInt32                  vss;
+    ScaleTap *              taps;       // one for each output column
+    Int32                   rows[2];    // cached source rows, by parity
+    UInt32 *                lines[2];   // horizontal resampled rows, Q8
+};
+
+struct ColorScaleContext {
+    const ColorKernels *    kernels;
+    const PixelDescriptor * desc;
+    ImageFormat             iformat;
+    ImageFormat             oformat;
+    UInt32                  bpp;        // bytes per output pixel
+    ScaleComponent          comps[3];   // Y'/Cb/Cr
+    UInt8 *                 yuv[3];     // planar 4:4:4 row for color kernels, 8 or 16 bits
+    ColorRow                row;
+    const ColorParams *     params;
+
+    ColorScaleContext() {
+        memset(comps, 0, sizeof(comps));
+        memset(yuv, 0, sizeof(yuv));
+    }
+
+    void release() {
+        for (UInt32 i = 0; i < 3; ++i) {
+            delete [] comps[i].taps;
+            delete [] comps[i].lines[0];
+            delete [] comps[i].lines[1];
+            delete [] yuv[i];
+        }
+        memset(comps, 0, sizeof(comps));
+        memset(yuv, 0, sizeof(yuv));
+    }
+
+    ~ColorScaleContext() { release(); }
+};
+
+// map output position to source sample position & weight.
+// @param o     output position
+// @param n     output length
+// @param start display start in luma samples
+// @param len   display length in luma samples
+// @param ss    subsampling
+static FORCE_INLINE void ScaleMap(Int32 o, Int32 n, Int32 start, Int32 len, UInt32 ss,
+                                  Int32& i0, Int32& i1, UInt16& f) {
+    // samples inside display rectangle
+    const Int32 first   = start / ss;
+    const Int32 last    = (start + len + ss - 1) / ss - 1;
+    const Float64 pos   = (((o + 0.5) * len) / n + start) / ss - 0.5;
+    Int32 i = (Int32)floor(pos);
+    Int32 w = (Int32)lrint((pos - i) * SCALE_ONE);
+    if (w == SCALE_ONE) { ++i; w = 0; }
+    if (i < first)      { i = first; w = 0; }
+    if (i >= last)      { i = last; w = 0; }
+    i0  = i;
+    i1  = w ? i + 1 : i;
+    f   = w;
+}
+
+static MediaUnitContext ColorScaleAlloc() {
+    ColorScaleContext * instance = new ColorScaleContext;
+    return instance;
+}
+
+static void ColorScaleDealloc(MediaUnitContext ref) {
+    ColorScaleContext * instance = static_cast<ColorScaleContext *>(ref);
+    delete instance;
+}
+
+static MediaError ColorScaleInit(MediaUnitContext ref, const MediaFormat * iformat, const MediaFormat * oformat) {
+    ColorScaleContext * instance = static_cast<ColorScaleContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    const YUVLayout * layout = GetYUVLayout(in.format);
+    if (layout == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    if (out.width <= 0 || out.height <= 0 || out.rect.x != 0 || out.rect.w != out.width ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    if (in.rect.w > MAX_SCALE_DOWN * out.width || in.rect.h > MAX_SCALE_DOWN * out.height) {
+        return kMediaErrorNotSupported;
+    }
+
+    const PixelDescriptor * desc = GetImagePixelDescriptor(in.format);
+
+    const ColorKernels * kernels = GetColorKernels();
+    const ePixelFormat planar = layout->depth > 8 ? (ePixelFormat)kPixelFormat444YpCbCr16Planar : kPixelFormat444YpCbCrPlanar;
+    const ColorRow row = GetColorRow(kernels, planar, out.format);
+    const ColorParams * params = GetColorParams(in.matrix);
+    if (row == Nil || params == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    instance->release();
+    instance->kernels   = kernels;
+    instance->row       = row;
+    instance->params    = params;
+    instance->desc      = desc;
+    instance->iformat   = in;
+    instance->oformat   = out;
+    instance->bpp       = GetImagePixelDescriptor(out.format)->bpp / 8;
+
+    // sample positions of Y'/Cb/Cr
+    ScaleComponent * comps = instance->comps;
+    switch (layout->layout) {
+        case kYUVLayoutPlanar:
+        case kYUVLayoutPlanarH2:
+            for (UInt32 i = 0; i < 3; ++i) {
+                comps[i].plane  = i == 0 ? 0 : 1 + (i == 1 ? layout->cb : layout->cr);
+                comps[i].offset = 0;
+                comps[i].step   = 1;
+                comps[i].hss    = desc->planes[comps[i].plane].hss;
+                comps[i].vss    = desc->planes[comps[i].plane].vss;
+            }
+            break;
+        case kYUVLayoutSemiPlanar:
+            comps[0].plane  = 0;
+            comps[0].offset = 0;
+            comps[0].step   = 1;
+            comps[0].hss    = 1;
+            comps[0].vss    = 1;
+            for (UInt32 i = 1; i < 3; ++i) {
+                comps[i].plane  = 1;
+                comps[i].offset = i == 1 ? layout->cb : layout->cr;
+                comps[i].step   = 2;
+                // 2 samples per CbCr pair
+                comps[i].hss    = (16 * ((layout->depth + 7) / 8) * desc->planes[1].hss) / desc->planes[1].bpp;
+                comps[i].vss    = desc->planes[1].vss;
+            }
+            break;
+        case kYUVLayoutPacked:
+            for (UInt32 i = 0; i < 3; ++i) {
+                comps[i].plane  = 0;
+                comps[i].offset = i == 0 ? layout->y0 : (i == 1 ? layout->cb : layout->cr);
+                comps[i].step   = i == 0 ? 2 : 4;
+                comps[i].hss    = i == 0 ? 1 : 2;
+                comps[i].vss    = 1;
+            }
+            break;
+        default:
+            return kMediaErrorNotSupported;
+    }
+
+    // high bit depth samples are scaled in 16 bits
+    for (UInt32 i = 0; i < 3; ++i) {
+        comps[i].bytes  = (layout->depth + 7) / 8;
+        comps[i].shift  = layout->shift;
+        comps[i].mask   = (1 << layout->depth) - 1;
+        comps[i].up     = comps[i].bytes > 1 ? 16 - layout->depth : 0;
+    }
+
+    for (UInt32 i = 0; i < 3; ++i) {
+        ScaleComponent& c = comps[i];
+        c.taps      = new ScaleTap[out.width];
+        c.lines[0]  = new UInt32[out.width];
+        c.lines[1]  = new UInt32[out.width];
+        c.rows[0]   = c.rows[1] = -1;
+        for (Int32 x = 0; x < out.width; ++x) {
+            Int32 i0, i1;
+            ScaleMap(x, out.width, in.rect.x, in.rect.w, c.hss, i0, i1, c.taps[x].f);
+            c.taps[x].x0    = (c.offset + i0 * c.step) * c.bytes;
+            c.taps[x].x1    = (c.offset + i1 * c.step) * c.bytes;
+        }
+        instance->yuv[i] = new UInt8[out.width * c.bytes];
+    }
+
+    DEBUG("%s: %s -> %s", instance->kernels->name,
+          GetImageFormatString(in).c_str(),
+          GetImageFormatString(out).c_str());
+    return kMediaNoError;
+}
+
+static void ScaleLine(const UInt8 * src, const ScaleTap * taps, UInt32 * dst, UInt32 n) {
+    for (UInt32 i = 0; i < n; ++i) {
+        dst[i] = src[taps[i].x0] * (SCALE_ONE - taps[i].f) + src[taps[i].x1] * taps[i].f;
+    }
+}
+
+static void ScaleLine16(const UInt8 * src, const ScaleTap * taps, const ScaleComponent& c, UInt32 * dst, UInt32 n) {
+    for (UInt32 i = 0; i < n; ++i) {
+        // bits above depth may be garbage in LSB aligned samples
+        const UInt32 s0 = ((*(const UInt16 *)(src + taps[i].x0) >> c.shift) & c.mask) << c.up;
+        const UInt32 s1 = ((*(const UInt16 *)(src + taps[i].x1) >> c.shift) & c.mask) << c.up;
+        dst[i] = s0 * (SCALE_ONE - taps[i].f) + s1 * taps[i].f;
+    }
+}
+
+// Q8 * Q8 of 16-bit samples fits in 32 bits
+template <typename T>
+static void BlendLines(const UInt32 * l0, const UInt32 * l1, UInt32 f, T * dst, UInt32 n) {
+    const UInt32 w0 = SCALE_ONE - f;
+    for (UInt32 i = 0; i < n; ++i) {
+        dst[i] = (l0[i] * w0 + l1[i] * f + (1 << (2 * SCALE_BITS - 1))) >> (2 * SCALE_BITS);
+    }
+}
+
+static MediaError ColorScaleProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    ColorScaleContext * instance = static_cast<ColorScaleContext *>(ref);
+    const ImageFormat& in   = instance->iformat;
+    const ImageFormat& out  = instance->oformat;
+
+    const UInt32 bytes = out.width * out.height * instance->bpp;
+    if (output->count < 1 || output->buffers[0].capacity < bytes) {
+        return kMediaErrorBadParameters;
+    }
+
+    UInt8 * planes[4];
+    UInt32 strides[4];
+    MediaError st = GetImagePlaneData(in, input, False, planes, strides);
+    if (st != kMediaNoError) return st;
+
+    // new frame, drop cached lines
+    for (UInt32 i = 0; i < 3; ++i) {
+        instance->comps[i].rows[0] = instance->comps[i].rows[1] = -1;
+    }
+
+    UInt8 * dst = output->buffers[0].data;
+    for (Int32 j = out.rect.y; j < out.rect.y + out.rect.h; ++j) {
+        for (UInt32 i = 0; i < 3; ++i) {
+            ScaleComponent& c = instance->comps[i];
+            Int32 r0, r1;
+            UInt16 f;
+            ScaleMap(j, out.height, in.rect.y, in.rect.h, c.vss, r0, r1, f);
+
+            // r0 & r1 have different parity, never share a cache slot
+            const Int32 rows[2] = { r0, r1 };
+            for (UInt32 k = 0; k < 2; ++k) {
+                const Int32 r = rows[k];
+                if (c.rows[r & 1] != r) {
+                    const UInt8 * src = planes[c.plane] + r * strides[c.plane];
+                    if (c.bytes == 1) {
+                        ScaleLine(src, c.taps, c.lines[r & 1], out.width);
+                    } else {
+                        ScaleLine16(src, c.taps, c, c.lines[r & 1], out.width);
+                    }
+                    c.rows[r & 1] = r;
+                }
+            }
+            if (c.bytes == 1) {
+                BlendLines(c.lines[r0 & 1], c.lines[r1 & 1], f, instance->yuv[i], out.width);
+            } else {
+                BlendLines(c.lines[r0 & 1], c.lines[r1 & 1], f, (UInt16 *)instance->yuv[i], out.width);
+            }
+        }
+        instance->row(instance->yuv[0], instance->yuv[1], instance->yuv[2],
+                      dst + j * out.width * instance->bpp, out.width, instance->params);
+    }
+    output->buffers[0].size = bytes;
+    return kMediaNoError;
+}
+
+static MediaError ColorScaleReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+static const MediaUnit kColorScaleUnit = {
+    "yuv2rgb.scale",
+    0,
+    kYUVFormats,
+    kRGBFormats,
+    ColorScaleAlloc,
+    ColorScaleDealloc,
+    ColorScaleInit,
+    ColorScaleProcess,
+    Nil,
+    ColorScaleReset,
+};
+
+// best unit comes first
+static const struct {
+    const MediaUnit *       unit;
+    const ColorKernels *    kernels;
+} kImageUnits[] = {
+#if defined(__x86_64__) || defined(__i386__)
+    { &kColorUnitAVX2,      &kColorKernelsAVX2  },
+    { &kColorUnitSSSE3,     &kColorKernelsSSSE3 },
+    { &kColorUnitSSE2,      &kColorKernelsSSE2  },
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    { &kColorUnitNEON,      &kColorKernelsNEON  },
+#endif
+    { &kColorUnitC,         &kColorKernelsC     },
+    // rgb -> Y'CbCr, other sitings & filters by options
+    { &kYUVUnit,            Nil                 },
+    // 16-bit rgb, other dithers by options
+    { &kDitherUnit,         Nil                 },
+    // similar formats only, no overlap with others
+    { &kSwizzleUnit,        Nil                 },
+    // after all color units, they are faster when no scaling
+    { &kColorScaleUnit,     Nil                 },
+    // END OF LIST
+    { Nil,                  Nil                 },
+};
+
+static Bool FormatMatch(const UInt32 * formats, UInt32 format) {
+    for (UInt32 i = 0; formats[i] != kPixelFormatUnknown; ++i) {
+        if (formats[i] == format) return True;
+    }
+    return False;
+}
+
+#define NELEM(x)    (sizeof(x) / sizeof(x[0]))
+
+// our units & scalers produce rows selected by output rect
+static Bool IsBandedUnit(const MediaUnit * unit) {
+    for (UInt32 i = 0; kImageUnits[i].unit != Nil; ++i) {
+        if (kImageUnits[i].unit == unit) return True;
+    }
+    const eScaleFilter filters[] = { kScaleFilterBilinear, kScaleFilterBicubic, kScaleFilterLanczos };
+    for (UInt32 i = 0; i < NELEM(filters); ++i) {
+        if (ScaleUnitFind(filters[i]) == unit) return True;
+    }
+    for (eChromaSiting siting = kChromaSitingLeft; siting <= kChromaSitingTopLeft; ++siting) {
+        if (YUVUnitFind(siting, kChromaFilterBox) == unit ||
+            YUVUnitFind(siting, kChromaFilterTriangle) == unit) return True;
+    }
+    // error diffusion carries errors down the frame, which bands would cut
+    for (eDither dither = kDitherNone; dither <= kDitherOrdered; ++dither) {
+        if (DitherUnitFind(dither) == unit) return True;
+    }
+    for (eTransfer transfer = kTransferPQ; transfer <= kTransferHLG; ++transfer) {
+        if (ToneMapUnitFind(transfer) == unit) return True;
+    }
+    return False;
+}
+
+// units other than the default one, selected by options
+static const MediaUnit * OptionUnitFind(const sp<Message>& options, UInt32 iformat, UInt32 oformat) {
+    if (options.isNil()) return Nil;
+
+    const MediaUnit * unit = Nil;
+    // chroma siting & filter select the rgb -> Y'CbCr unit
+    if (options->contains(kKeyChromaSiting) || options->contains(kKeyChromaFilter)) {
+        const eChromaSiting siting = options->contains(kKeyChromaSiting) ?
+            options->findInt32(kKeyChromaSiting) : kChromaSitingDefault;
+        const eChromaFilter filter = options->contains(kKeyChromaFilter) ?
+            options->findInt32(kKeyChromaFilter) : kChromaFilterDefault;
+        unit = YUVUnitFind(siting, filter);
+        if (unit && FormatMatch(unit->iformats, iformat) && FormatMatch(unit->oformats, oformat)) {
+            return unit;
+        }
+    }
+    // dither selects the 16-bit rgb unit
+    if (options->contains(kKeyDither)) {
+        unit = DitherUnitFind(options->findInt32(kKeyDither));
+        if (unit && FormatMatch(unit->iformats, iformat) && FormatMatch(unit->oformats, oformat)) {
+            return unit;
+        }
+    }
+    // transfer selects the tone mapping unit, SDR goes the default way
+    if (options->contains(kKeyTransfer)) {
+        unit = ToneMapUnitFind(options->findInt32(kKeyTransfer));
+        if (unit && FormatMatch(unit->iformats, iformat) && FormatMatch(unit->oformats, oformat)) {
+            return unit;
+        }
+    }
+    return Nil;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+const MediaUnit * ImageUnitFindNext(const MediaUnit * current, const ePixelFormat iformat, const ePixelFormat oformat) {
+    UInt32 i = 0;
+    if (current != Nil) {
+        while (kImageUnits[i].unit != Nil && kImageUnits[i].unit != current) ++i;
+        if (kImageUnits[i].unit == Nil) return Nil;
+        ++i;
+    }
+
+    for (; kImageUnits[i].unit != Nil; ++i) {
+        const MediaUnit * unit = kImageUnits[i].unit;
+        if (kImageUnits[i].kernels && kImageUnits[i].kernels->supported() == False) continue;
+        if (FormatMatch(unit->iformats, iformat) && FormatMatch(unit->oformats, oformat)) {
+            return unit;
+        }
+    }
+    return Nil;
+}
+
+__BEGIN_NAMESPACE_MFWK
+
+#pragma mark Worker Loopers
+// one looper per cpu but the caller's, shared by bands of all converters,
+// workers of all batches, slices of statistics & workers of compares, so
+// threads are created once per process. band & slice jobs never wait for
+// others, and batch & compare workers run in a single band, so sharing
+// loopers never deadlocks.
+static Mutex                    gLooperLock;
+static Vector<sp<Looper> >      gLoopers;
+
+UInt32 GetWorkerLooperCount() {
+    const UInt32 cpus = GetCpuCount();
+    return cpus > 1 ? cpus - 1 : 1;
+}
+
+sp<Looper> GetWorkerLooper(UInt32 index) {
+    AutoLock _l(gLooperLock);
+    if (gLoopers.empty()) {
+        const UInt32 count = GetWorkerLooperCount();
+        for (UInt32 i = 0; i < count; ++i) {
+            gLoopers.push(new Looper(String::format("imageworker.%u", i + 1)));
+        }
+    }
+    return gLoopers[index % gLoopers.size()];
+}
+
+#pragma mark Image Converter
+// less rows than this is not worth a thread
+#define MIN_BAND_ROWS   (64)
+
+// frames pushed MUST be in the input format, display rect is taken from init
+static FORCE_INLINE Bool IsInputFrame(const ImageFormat& input, const sp<MediaFrame>& frame) {
+    return frame->image.format == input.format &&
+           frame->image.width == input.width && frame->image.height == input.height;
+}
+
+struct ImageConverter;
+struct BandJob : public Job {
+    ImageConverter *    mConverter;     // converter owns this job
+    UInt32              mIndex;
+
+    BandJob(const sp<Looper>& looper, ImageConverter * cc, UInt32 index) :
+        Job(looper), mConverter(cc), mIndex(index) { }
+
+    virtual void onJob();
+};
+
+// a horizontal slice of output, with its own unit instance
+struct Band {
+    MediaUnitContext    instance;
+    Int32               y;              // first row in output
+    Int32               height;
+    sp<Job>             job;            // Nil for the first band, which runs on caller's thread
+
+    Band() : instance(Nil), y(0), height(0) { }
+};
+
+struct ImageConverter : public MediaDevice {
+    ImageFormat         mInput;
+    ImageFormat         mOutput;
+    const PixelDescriptor * mOutputDesc;
+    const MediaUnit *   mUnit;
+    Vector<Band>        mBands;
+    sp<MediaFrame>      mFrame;
+
+    // push context, shared with band jobs
+    Mutex               mLock;
+    Condition           mWait;
+    UInt32              mPending;
+    MediaError          mStatus;
+    const MediaBufferList * mInputPlanes;
+    MediaBufferList *   mOutputPlanes;
+
+    ImageConverter() : MediaDevice(), mOutputDesc(Nil), mUnit(Nil), mPending(0), mStatus(kMediaNoError),
+        mInputPlanes(Nil), mOutputPlanes(Nil) { }
+
+    virtual ~ImageConverter() {
+        clearBands();
+    }
+
+    void clearBands() {
+        for (UInt32 i = 0; i < mBands.size(); ++i) {
+            if (mBands[i].instance) mUnit->dealloc(mBands[i].instance);
+        }
+        mBands.clear();
+    }
+
+    // init band with output rect, all bands share the same unit
+    MediaError initBand(Band& band) {
+        MediaFormat ifmt, ofmt;
+        ifmt.image          = mInput;
+        ofmt.image          = mOutput;
+        ofmt.image.rect.x   = 0;
+        ofmt.image.rect.y   = band.y;
+        ofmt.image.rect.w   = mOutput.width;
+        ofmt.image.rect.h   = band.height;
+        return mUnit->init(band.instance, &ifmt, &ofmt);
+    }
+
+    MediaError initBands(const MediaUnit * unit, UInt32 count, UInt32 rows) {
+        mUnit = unit;
+        for (UInt32 i = 0; i < count; ++i) {
+            Band& band      = mBands.push();
+            band.y          = i * rows;
+            band.height     = mOutput.height - band.y;
+            if (band.height > (Int32)rows) band.height = rows;
+
+            band.instance   = unit->alloc();
+            MediaError st   = initBand(band);
+            if (st != kMediaNoError) {
+                clearBands();
+                return st;
+            }
+        }
+        return kMediaNoError;
+    }
+
+    // init with the first working image unit, or the specified unit only
+    MediaError init(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options,
+                    const MediaUnit * specified = Nil) {
+        mInput      = iformat;
+        mOutput     = oformat;
+
+        const PixelDescriptor * desc = GetImagePixelDescriptor(mInput.format);
+        mOutputDesc = GetImagePixelDescriptor(mOutput.format);
+        if (desc == Nil || mOutputDesc == Nil || mOutput.height <= 0) {
+            return kMediaErrorNotSupported;
+        }
+
+        // kKeyCount caps bands, which run on shared loopers & caller's thread
+        UInt32 threads = GetWorkerLooperCount() + 1;
+        if (!options.isNil() && options->contains(kKeyCount)) {
+            const UInt32 count = options->findInt32(kKeyCount);
+            if (count < threads) threads = count;
+        }
+
+        // band MUST be aligned to chroma rows, of input & output
+        UInt32 vss = 1;
+        for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+            if (desc->planes[i].vss > vss) vss = desc->planes[i].vss;
+        }
+        for (UInt32 i = 0; i < mOutputDesc->nb_planes; ++i) {
+            if (mOutputDesc->planes[i].vss > vss) vss = mOutputDesc->planes[i].vss;
+        }
+        UInt32 count = mOutput.height / MIN_BAND_ROWS;
+        if (count > threads) count = threads;
+        if (count == 0) count = 1;
+        UInt32 rows = (mOutput.height + count - 1) / count;
+        rows = ((rows + vss - 1) / vss) * vss;
+        count = (mOutput.height + rows - 1) / rows;
+
+        if (specified == Nil) {
+            specified = OptionUnitFind(options, mInput.format, mOutput.format);
+        }
+
+        const MediaUnit * unit = specified ? specified : ImageUnitFindNext(Nil, mInput.format, mOutput.format);
+        while (unit != Nil) {
+            // units of MediaFramework know nothing about bands
+            if (!IsBandedUnit(unit)) {
+                count   = 1;
+                rows    = mOutput.height;
+            }
+            if (initBands(unit, count, rows) == kMediaNoError) {
+                INFO("%s: %s -> %s, %u bands", unit->name,
+                     GetImageFormatString(mInput).c_str(),
+                     GetImageFormatString(mOutput).c_str(), count);
+                break;
+            }
+            unit = specified ? Nil : ImageUnitFindNext(unit, mInput.format, mOutput.format);
+        }
+        if (unit == Nil) {
+            return kMediaErrorNotSupported;
+        }
+
+        for (UInt32 i = 1; i < mBands.size(); ++i) {
+            mBands[i].job = new BandJob(GetWorkerLooper(i - 1), this, i);
+        }
+        return kMediaNoError;
+    }
+
+    // each band writes its own rows, with a private copy of output buffers
+    MediaError processBand(UInt32 index) {
+        MediaBufferList4 output;
+        output.list.count   = mOutputPlanes->count < 4 ? mOutputPlanes->count : 4;
+        for (UInt32 i = 0; i < output.list.count; ++i) {
+            output.buffers[i] = mOutputPlanes->buffers[i];
+        }
+        return mUnit->process(mBands[index].instance, mInputPlanes, &output.list);
+    }
+
+    void onBandDone(MediaError st) {
+        AutoLock _l(mLock);
+        if (st != kMediaNoError) mStatus = st;
+        if (--mPending == 0) mWait.signal();
+    }
+
+    /**
+     * reuse this converter for a new display rectangle.
+     * @return return kMediaErrorBadParameters if anything else changed.
+     */
+    MediaError reset(const ImageFormat& iformat) {
+        if (iformat.format != mInput.format || iformat.matrix != mInput.matrix ||
+            iformat.width != mInput.width || iformat.height != mInput.height ||
+            iformat.rect.w != mInput.rect.w || iformat.rect.h != mInput.rect.h) {
+            return kMediaErrorBadParameters;
+        }
+
+        mFrame.clear();
+        mInput = iformat;
+        for (UInt32 i = 0; i < mBands.size(); ++i) {
+            MediaError st = initBand(mBands[i]);
+            if (st != kMediaNoError) return st;
+        }
+        return kMediaNoError;
+    }
+
+    virtual sp<Message> formats() const {
+        sp<Message> formats = new Message;
+        formats->setInt32(kKeyFormat, mOutput.format);
+        formats->setInt32(kKeyWidth, mOutput.width);
+        formats->setInt32(kKeyHeight, mOutput.height);
+        return formats;
+    }
+
+    virtual MediaError configure(const sp<Message>& options) {
+        return kMediaErrorNotSupported;
+    }
+
+    // convert input planes to output planes in bands
+    MediaError process(const MediaBufferList * input, MediaBufferList * output) {
+        if (output->count < mOutputDesc->nb_planes && output->count != 1) {
+            return kMediaErrorBadParameters;
+        }
+
+        mInputPlanes    = input;
+        mOutputPlanes   = output;
+        mStatus         = kMediaNoError;
+        mPending        = mBands.size() - 1;
+        for (UInt32 i = 1; i < mBands.size(); ++i) {
+            mBands[i].job->dispatch();
+        }
+
+        MediaError st = processBand(0);
+        {
+            AutoLock _l(mLock);
+            while (mPending) mWait.wait(mLock);
+            if (st == kMediaNoError) st = mStatus;
+        }
+        mInputPlanes    = Nil;
+        mOutputPlanes   = Nil;
+
+        if (st != kMediaNoError) {
+            ERROR("%s process failed", mUnit->name);
+            return st;
+        }
+
+        SetImagePlaneSizes(mOutput, output);
+        return kMediaNoError;
+    }
+
+    virtual MediaError push(const sp<MediaFrame>& input) {
+        if (input.isNil()) return kMediaNoError;    // eos
+        if (!mFrame.isNil()) return kMediaErrorResourceBusy;
+        if (!IsInputFrame(mInput, input)) {
+            ERROR("bad frame %s, expect %s",
+                  GetImageFormatString(input->image).c_str(),
+                  GetImageFormatString(mInput).c_str());
+            return kMediaErrorBadFormat;
+        }
+
+        sp<MediaFrame> output = CreateImageFrame(mOutput);
+        if (output.isNil()) return kMediaErrorOutOfMemory;
+
+        MediaError st = process(&input->planes, &output->planes);
+        if (st != kMediaNoError) return st;
+
+        output->id          = input->id;
+        output->flags       = input->flags;
+        output->timecode    = input->timecode;
+        output->duration    = input->duration;
+        mFrame              = output;
+        return kMediaNoError;
+    }
+
+    virtual sp<MediaFrame> pull() {
+        sp<MediaFrame> output = mFrame;
+        mFrame.clear();
+        return output;
+    }
+
+    virtual MediaError reset() {
+        mFrame.clear();
+        MediaError st = kMediaNoError;
+        for (UInt32 i = 0; i < mBands.size(); ++i) {
+            MediaError rt = mUnit->reset(mBands[i].instance);
+            if (rt != kMediaNoError) st = rt;
+        }
+        return st;
+    }
+};
+
+void BandJob::onJob() {
+    mConverter->onBandDone(mConverter->processBand(mIndex));
+}
+
+#pragma mark Image Pipeline
+// a chain of converters planned by ImagePlanner, intermediate images
+// ping-pong between two buffers shared by all hops.
+struct ImagePipeline : public MediaDevice {
+    ImageFormat                 mInput;
+    ImageFormat                 mOutput;
+    Vector<sp<ImageConverter> > mHops;
+    Vector<MediaBufferList4>    mPlanes;        // output planes of each hop except the last
+    UInt8 *                     mBuffers[2];
+    sp<MediaFrame>              mFrame;
+
+    ImagePipeline() : MediaDevice() {
+        mBuffers[0] = mBuffers[1] = Nil;
+    }
+
+    virtual ~ImagePipeline() {
+        delete [] mBuffers[0];
+        delete [] mBuffers[1];
+    }
+
+    MediaError init(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+        mInput      = iformat;
+        mOutput     = oformat;
+
+        ImageHop hops[kImageHopsMax];
+        const UInt32 n = PlanImageHops(iformat, oformat, options, hops);
+        if (n == 0) return kMediaErrorNotSupported;
+
+        UInt32 capacity[2] = { 0, 0 };
+        for (UInt32 i = 0; i < n; ++i) {
+            sp<ImageConverter> cc = new ImageConverter;
+            MediaError st = cc->init(hops[i].iformat, hops[i].oformat, options, hops[i].unit);
+            if (st != kMediaNoError) return st;
+            mHops.push(cc);
+
+            if (i + 1 < n) {
+                const UInt32 bytes = GetImageBytes(hops[i].oformat);
+                if (bytes > capacity[i & 1]) capacity[i & 1] = bytes;
+            }
+        }
+
+        for (UInt32 i = 0; i < 2; ++i) {
+            if (capacity[i]) mBuffers[i] = new UInt8[capacity[i]];
+        }
+        for (UInt32 i = 0; i + 1 < n; ++i) {
+            MediaBufferList4& planes = mPlanes.push();
+            GetImagePlanes(hops[i].oformat, mBuffers[i & 1], planes);
+        }
+        return kMediaNoError;
+    }
+
+    virtual sp<Message> formats() const {
+        return mHops[mHops.size() - 1]->formats();
+    }
+
+    virtual MediaError configure(const sp<Message>& options) {
+        return kMediaErrorNotSupported;
+    }
+
+    MediaError process(const MediaBufferList * input, MediaBufferList * output) {
+        const MediaBufferList * planes = input;
+        for (UInt32 i = 0; i < mHops.size(); ++i) {
+            MediaBufferList * next = i + 1 < mHops.size() ? &mPlanes[i].list : output;
+            MediaError st = mHops[i]->process(planes, next);
+            if (st != kMediaNoError) return st;
+            planes = next;
+        }
+        return kMediaNoError;
+    }
+
+    virtual MediaError push(const sp<MediaFrame>& input) {
+        if (input.isNil()) return kMediaNoError;    // eos
+        if (!mFrame.isNil()) return kMediaErrorResourceBusy;
+        if (!IsInputFrame(mInput, input)) {
+            ERROR("bad frame %s, expect %s",
+                  GetImageFormatString(input->image).c_str(),
+                  GetImageFormatString(mInput).c_str());
+            return kMediaErrorBadFormat;
+        }
+
+        sp<MediaFrame> output = CreateImageFrame(mOutput);
+        if (output.isNil()) return kMediaErrorOutOfMemory;
+
+        MediaError st = process(&input->planes, &output->planes);
+        if (st != kMediaNoError) return st;
+
+        output->id          = input->id;
+        output->flags       = input->flags;
+        output->timecode    = input->timecode;
+        output->duration    = input->duration;
+        mFrame              = output;
+        return kMediaNoError;
+    }
+
+    virtual sp<MediaFrame> pull() {
+        sp<MediaFrame> output = mFrame;
+        mFrame.clear();
+        return output;
+    }
+
+    virtual MediaError reset() {
+        mFrame.clear();
+        MediaError st = kMediaNoError;
+        for (UInt32 i = 0; i < mHops.size(); ++i) {
+            MediaError rt = mHops[i]->reset();
+            if (rt != kMediaNoError) st = rt;
+        }
+        return st;
+    }
+};
+
+// MediaFramework's ColorConverter converts display rect, but never scales
+static FORCE_INLINE Bool IsSameSize(const ImageFormat& iformat, const ImageFormat& oformat) {
+    return iformat.rect.w == oformat.width && iformat.rect.h == oformat.height;
+}
+
+#pragma mark Color Converter
+// MediaFramework's ColorConverter takes tight planes only, input planes
+// padded by ImagePlaneLayout are repacked before it.
+struct TightColorConverter : public MediaDevice {
+    ImageFormat         mInput;
+    sp<MediaDevice>     mDevice;
+
+    TightColorConverter(const ImageFormat& iformat, const sp<MediaDevice>& device) :
+        MediaDevice(), mInput(iformat), mDevice(device) { }
+
+    virtual sp<Message> formats() const {
+        return mDevice->formats();
+    }
+
+    virtual MediaError configure(const sp<Message>& options) {
+        return mDevice->configure(options);
+    }
+
+    // return input itself if its planes are tight
+    sp<MediaFrame> repack(const sp<MediaFrame>& input) {
+        UInt8 * src[4], * dst[4];
+        UInt32 istrides[4], ostrides[4];
+        if (GetImagePlaneData(mInput, &input->planes, False, src, istrides) != kMediaNoError) {
+            return Nil;
+        }
+
+        const PixelDescriptor * desc = GetImagePixelDescriptor(mInput.format);
+        Bool tight = True;
+        for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+            if (istrides[i] != GetPlaneStride(desc, i, mInput.width)) tight = False;
+        }
+        if (tight) return input;
+
+        sp<MediaFrame> output = CreateImageFrame(mInput);
+        if (output.isNil() ||
+            GetImagePlaneData(mInput, &output->planes, True, dst, ostrides) != kMediaNoError) {
+            return Nil;
+        }
+        for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+            const UInt32 rows = GetPlaneRows(desc, i, mInput.height);
+            for (UInt32 j = 0; j < rows; ++j) {
+                memcpy(dst[i] + j * ostrides[i], src[i] + j * istrides[i], ostrides[i]);
+            }
+        }
+        SetImagePlaneSizes(mInput, &output->planes);
+        output->id          = input->id;
+        output->flags       = input->flags;
+        output->timecode    = input->timecode;
+        output->duration    = input->duration;
+        return output;
+    }
+
+    virtual MediaError push(const sp<MediaFrame>& input) {
+        if (input.isNil()) return mDevice->push(input);    // eos
+
+        sp<MediaFrame> frame = repack(input);
+        if (frame.isNil()) return kMediaErrorBadParameters;
+        return mDevice->push(frame);
+    }
+
+    virtual sp<MediaFrame> pull() {
+        return mDevice->pull();
+    }
+
+    virtual MediaError reset() {
+        return mDevice->reset();
+    }
+};
+
+static sp<MediaDevice> CreateTightColorConverter(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+    sp<MediaDevice> device = CreateColorConverter(iformat, oformat, options);
+    if (device.isNil()) return Nil;
+    return new TightColorConverter(iformat, device);
+}
+
+sp<MediaDevice> CreateImageConverter(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+    sp<MediaDevice> swizzler = CreateImageSwizzler(iformat, oformat, options);
+    if (!swizzler.isNil()) {
+        return swizzler;
+    }
+    sp<ImageConverter> cc = new ImageConverter;
+    if (cc->init(iformat, oformat, options) == kMediaNoError) {
+        return cc;
+    }
+    sp<ImagePipeline> pipeline = new ImagePipeline;
+    if (pipeline->init(iformat, oformat, options) == kMediaNoError) {
+        return pipeline;
+    }
+    if (!IsSameSize(iformat, oformat)) {
+        ERROR("no image unit to scale %s -> %s",
+              GetImageFormatString(iformat).c_str(),
+              GetImageFormatString(oformat).c_str());
+        return Nil;
+    }
+    INFO("no image unit for %s -> %s, fallback to color converter",
+         GetImageFormatString(iformat).c_str(),
+         GetImageFormatString(oformat).c_str());
+    return CreateTightColorConverter(iformat, oformat, options);
+}
+
+sp<MediaDevice> CreateImageDevice(const MediaUnit * unit, const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+    sp<ImageConverter> device = new ImageConverter;
+    if (device->init(iformat, oformat, options, unit) == kMediaNoError) {
+        return device;
+    }
+    return Nil;
+}
+
+#pragma mark Image Batch
+struct BatchConverter;
+struct BatchJob : public Job {
+    BatchConverter *    mBatch;         // batch owns this job
+    UInt32              mIndex;
+
+    BatchJob(const sp<Looper>& looper, BatchConverter * batch, UInt32 index) :
+        Job(looper), mBatch(batch), mIndex(index) { }
+
+    virtual void onJob();
+};
+
+// a range of frames of current call, with its own single band converter
+struct Worker {
+    sp<ImageConverter>  converter;
+    sp<ImagePipeline>   pipeline;       // when no single unit exists
+    sp<Job>             job;            // Nil for the first worker, which runs on caller's thread
+    UInt32              begin;
+    UInt32              end;
+
+    Worker() : begin(0), end(0) { }
+};
+
+struct BatchConverter : public ImageBatch {
+    ImageFormat         mInput;
+    ImageFormat         mOutput;
+    UInt32              mInputBytes;
+    UInt32              mOutputBytes;
+    Vector<Worker>      mWorkers;
+
+    // process context, shared with jobs
+    Mutex               mLock;
+    Condition           mWait;
+    UInt32              mPending;
+    MediaError          mStatus;
+    const MediaBufferList * const * mInputPlanes;
+    UInt8 *             mArena;
+
+    BatchConverter() : ImageBatch(), mInputBytes(0), mOutputBytes(0), mPending(0),
+        mStatus(kMediaNoError), mInputPlanes(Nil), mArena(Nil) { }
+
+    MediaError init(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+        mInput          = iformat;
+        mOutput         = oformat;
+        mInputBytes     = GetImageBytes(iformat);
+        mOutputBytes    = GetImageBytes(oformat);
+        if (mInputBytes == 0 || mOutputBytes == 0) return kMediaErrorNotSupported;
+
+        // kKeyCount caps workers, which run on shared loopers & caller's thread
+        UInt32 threads = GetWorkerLooperCount() + 1;
+        if (!options.isNil() && options->contains(kKeyCount)) {
+            const UInt32 count = options->findInt32(kKeyCount);
+            if (count < threads) threads = count;
+        }
+        if (threads == 0) threads = 1;
+
+        // frames are in parallel, not bands
+        sp<Message> single = options.isNil() ? new Message : options->copy();
+        single->setInt32(kKeyCount, 1);
+
+        for (UInt32 i = 0; i < threads; ++i) {
+            Worker& worker = mWorkers.push();
+            sp<ImageConverter> cc = new ImageConverter;
+            if (cc->init(iformat, oformat, single) == kMediaNoError) {
+                worker.converter = cc;
+            } else {
+                sp<ImagePipeline> pipeline = new ImagePipeline;
+                MediaError st = pipeline->init(iformat, oformat, single);
+                if (st != kMediaNoError) return st;
+                worker.pipeline = pipeline;
+            }
+
+            if (i > 0) {
+                worker.job = new BatchJob(GetWorkerLooper(i - 1), this, i);
+            }
+        }
+        INFO("%s -> %s, %u threads",
+             GetImageFormatString(mInput).c_str(),
+             GetImageFormatString(mOutput).c_str(), threads);
+        return kMediaNoError;
+    }
+
+    MediaError processWorker(UInt32 index) {
+        Worker& worker = mWorkers[index];
+        for (UInt32 i = worker.begin; i < worker.end; ++i) {
+            MediaBufferList4 output;
+            GetImagePlanes(mOutput, mArena + (UInt64)i * mOutputBytes, output);
+            MediaError st = worker.converter.isNil() ?
+                worker.pipeline->process(mInputPlanes[i], &output.list) :
+                worker.converter->process(mInputPlanes[i], &output.list);
+            if (st != kMediaNoError) return st;
+        }
+        return kMediaNoError;
+    }
+
+    void onWorkerDone(MediaError st) {
+        AutoLock _l(mLock);
+        if (st != kMediaNoError) mStatus = st;
+        if (--mPending == 0) mWait.signal();
+    }
+
+    virtual MediaError process(const MediaBufferList * const * inputs, UInt32 count, UInt8 * output) {
+        if (count == 0) return kMediaNoError;
+
+        // contiguous frames for each worker
+        UInt32 n = mWorkers.size() < count ? mWorkers.size() : count;
+        const UInt32 frames = (count + n - 1) / n;
+        n = (count + frames - 1) / frames;
+        for (UInt32 i = 0; i < n; ++i) {
+            mWorkers[i].begin   = i * frames;
+            mWorkers[i].end     = mWorkers[i].begin + frames;
+            if (mWorkers[i].end > count) mWorkers[i].end = count;
+        }
+
+        mInputPlanes    = inputs;
+        mArena          = output;
+        mStatus         = kMediaNoError;
+        mPending        = n - 1;
+        for (UInt32 i = 1; i < n; ++i) {
+            mWorkers[i].job->dispatch();
+        }
+
+        MediaError st = processWorker(0);
+        {
+            AutoLock _l(mLock);
+            while (mPending) mWait.wait(mLock);
+            if (st == kMediaNoError) st = mStatus;
+        }
+        mInputPlanes    = Nil;
+        mArena          = Nil;
+        return st;
+    }
+
+    virtual MediaError process(const UInt8 * input, UInt32 count, UInt8 * output) {
+        Vector<MediaBufferList4> planes;
+        Vector<const MediaBufferList *> inputs;
+        for (UInt32 i = 0; i < count; ++i) {
+            MediaBufferList4& frame = planes.push();
+            GetImagePlanes(mInput, (UInt8 *)input + (UInt64)i * mInputBytes, frame);
+        }
+        // planes is not going to grow anymore
+        for (UInt32 i = 0; i < count; ++i) {
+            inputs.push(&planes[i].list);
+        }
+        return process(count ? &inputs[0] : Nil, count, output);
+    }
+};
+
+void BatchJob::onJob() {
+    mBatch->onWorkerDone(mBatch->processWorker(mIndex));
+}
+
+sp<ImageBatch> CreateImageBatch(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+    sp<BatchConverter> batch = new BatchConverter;
+    if (batch->init(iformat, oformat, options) == kMediaNoError) {
+        return batch;
+    }
+    return Nil;
+}
+
+#pragma mark Converter Cache
+// converters for recent formats, most recent first
+// ImageTiler takes up to 4 of them: inner, right, bottom & corner tiles
+#define MAX_CACHED_CONVERTERS   (8)
+
+// options which select units or bands, part of the cache key
+static const UInt32 kCachedOptionKeys[] = {
+    kKeyChromaSiting,
+    kKeyChromaFilter,
+    kKeyDither,
+    kKeyTransfer,
+    kKeyScaleFilter,
+    kKeyCount,
+};
+#define CACHED_OPTIONS  (sizeof(kCachedOptionKeys) / sizeof(kCachedOptionKeys[0]))
+#define OPTION_UNSET    (0xFFFFFFFF)
+
+struct CachedConverter {
+    ImageFormat         input;
+    ImageFormat         output;
+    UInt32              options[CACHED_OPTIONS];
+    sp<MediaDevice>     device;
+    Bool                reusable;       // ImageConverter, rect can be reset
+};
+
+static void GetCachedOptions(const sp<Message>& options, UInt32 * values) {
+    for (UInt32 i = 0; i < CACHED_OPTIONS; ++i) {
+        values[i] = OPTION_UNSET;
+        if (!options.isNil() && options->contains(kCachedOptionKeys[i])) {
+            values[i] = options->findInt32(kCachedOptionKeys[i]);
+        }
+    }
+}
+
+static FORCE_INLINE Bool SameOptions(const UInt32 * a, const UInt32 * b) {
+    for (UInt32 i = 0; i < CACHED_OPTIONS; ++i) {
+        if (a[i] != b[i]) return False;
+    }
+    return True;
+}
+
+static Mutex                    gCacheLock;
+static List<CachedConverter>    gCache;
+
+static FORCE_INLINE Bool SameFormat(const ImageFormat& a, const ImageFormat& b, Bool rect) {
+    if (a.format != b.format || a.matrix != b.matrix ||
+        a.width != b.width || a.height != b.height ||
+        a.rect.w != b.rect.w || a.rect.h != b.rect.h) {
+        return False;
+    }
+    return !rect || (a.rect.x == b.rect.x && a.rect.y == b.rect.y);
+}
+
+sp<MediaDevice> ObtainImageConverter(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+    // cheaper than any lookup, never cached
+    sp<MediaDevice> swizzler = CreateImageSwizzler(iformat, oformat, options);
+    if (!swizzler.isNil()) {
+        return swizzler;
+    }
+
+    UInt32 values[CACHED_OPTIONS];
+    GetCachedOptions(options, values);
+
+    AutoLock _l(gCacheLock);
+
+    List<CachedConverter>::iterator it = gCache.begin();
+    for (; it != gCache.end(); ++it) {
+        CachedConverter& entry = *it;
+        // converter is in use by others
+        if (entry.device->IsObjectShared()) continue;
+        if (!SameOptions(entry.options, values)) continue;
+        if (!SameFormat(entry.output, oformat, True)) continue;
+        if (!SameFormat(entry.input, iformat, !entry.reusable)) continue;
+
+        if (entry.reusable && !SameFormat(entry.input, iformat, True)) {
+            sp<ImageConverter> cc = entry.device;
+            if (cc->reset(iformat) != kMediaNoError) {
+                gCache.erase(it);
+                break;
+            }
+            entry.input = iformat;
+        }
+
+        CachedConverter hit = entry;
+        gCache.erase(it);
+        gCache.insert(gCache.begin(), hit);
+        return hit.device;
+    }
+
+    CachedConverter entry;
+    entry.input     = iformat;
+    entry.output    = oformat;
+    for (UInt32 i = 0; i < CACHED_OPTIONS; ++i) entry.options[i] = values[i];
+    sp<ImageConverter> cc = new ImageConverter;
+    if (cc->init(iformat, oformat, options) == kMediaNoError) {
+        entry.device    = cc;
+        entry.reusable  = True;
+    } else {
+        sp<ImagePipeline> pipeline = new ImagePipeline;
+        if (pipeline->init(iformat, oformat, options) == kMediaNoError) {
+            entry.device    = pipeline;
+        } else if (IsSameSize(iformat, oformat)) {
+            entry.device    = CreateTightColorConverter(iformat, oformat, options);
+        }
+        entry.reusable  = False;
+        if (entry.device.isNil()) return Nil;
+    }
+
+    gCache.insert(gCache.begin(), entry);
+    while (gCache.size() > MAX_CACHED_CONVERTERS) gCache.pop_back();
+    return entry.device;
+}
+
+void FlushImageConverterCache() {
+    AutoLock _l(gCacheLock);
+    gCache.clear();
+}
+
+__END_NAMESPACE_MFWK
+
+MediaDeviceRef ImageConverterCreate(const ImageFormat * iformat, const ImageFormat * oformat, MessageObjectRef options) {
+    sp<MediaDevice> cc = CreateImageConverter(*iformat, *oformat, static_cast<Message *>(options));
+    if (cc.isNil()) return Nil;
+    return cc->RetainObject();
+}
+
+MediaDeviceRef ImageConverterObtain(const ImageFormat * iformat, const ImageFormat * oformat, MessageObjectRef options) {
+    sp<MediaDevice> cc = ObtainImageConverter(*iformat, *oformat, static_cast<Message *>(options));
+    if (cc.isNil()) return Nil;
+    return cc->RetainObject();
+}
+
+void ImageConverterCacheFlush() {
+    FlushImageConverterCache();
+}
+
+ImageBatchRef ImageBatchCreate(const ImageFormat * iformat, const ImageFormat * oformat, MessageObjectRef options) {
+    sp<ImageBatch> batch = CreateImageBatch(*iformat, *oformat, static_cast<Message *>(options));
+    if (batch.isNil()) return Nil;
+    return batch->RetainObject();
+}
+
+MediaError ImageBatchProcess(ImageBatchRef ref, const UInt8 * input, UInt32 count, UInt8 * output) {
+    sp<ImageBatch> batch = static_cast<ImageBatch *>(ref);
+    return batch->process(input, count, output);
+}
+
+MediaError ImageBatchProcessFrames(ImageBatchRef ref, const MediaFrameRef * frames, UInt32 count, UInt8 * output) {
+    sp<ImageBatch> batch = static_cast<ImageBatch *>(ref);
+    Vector<const MediaBufferList *> inputs;
+    for (UInt32 i = 0; i < count; ++i) {
+        inputs.push(&static_cast<MediaFrame *>(frames[i])->planes);
+    }
+    return batch->process(count ? &inputs[0] : Nil, count, output);
+}
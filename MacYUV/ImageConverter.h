@@ -0,0 +1,151 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageConverter.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// a color converter with SIMD units, selected at runtime by cpu features.
+// output size different from display rect is done by crop + convert + scale
+// in one pass. formats without a direct unit go through a chain of units
+// planned by ImagePlanner, then MediaFramework's ColorConverter. similar
+// formats are served by ImageSwizzler without converting. RGB -> Y'CbCr
+// units are in YUVConverter, with chroma siting & filter by options, and
+// 16-bit RGB units are in ImageDither, with dither by options. PQ & HLG
+// content is tone mapped by units in ImageToneMap, with transfer by options.
+//
+
+#ifndef MACYUV_IMAGE_CONVERTER_H
+#define MACYUV_IMAGE_CONVERTER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+#include <MediaFramework/MediaDevice.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+/**
+ * full range variants of color matrix, which MediaFramework only has for
+ * BT.601 as kColorMatrixJPEG. only handled by our units.
+ */
+enum {
+    kColorMatrixBT709Full   = FOURCC('f709'),
+    kColorMatrixBT2020Full  = FOURCC('f020'),
+};
+
+/**
+ * find next image unit for iformat -> oformat, best unit comes first.
+ * @param unit  the last unit, Nil to start from the beginning
+ * @return return Nil if no more units
+ * @note units not supported by this cpu are skipped.
+ */
+API_EXPORT const MediaUnit *    ImageUnitFindNext(const MediaUnit *, const ePixelFormat, const ePixelFormat);
+
+API_EXPORT MediaDeviceRef       ImageConverterCreate(const ImageFormat *, const ImageFormat *, MessageObjectRef);
+
+/**
+ * get a converter from process-wide cache, create one if not exists.
+ * @note converter with the same formats but different display rect will be
+ *       reset and reused. options which select units or bands, like
+ *       kKeyDither, kKeyTransfer or kKeyCount, are part of the cache key.
+ * @note converters still in use by others will never be returned.
+ */
+API_EXPORT MediaDeviceRef       ImageConverterObtain(const ImageFormat *, const ImageFormat *, MessageObjectRef);
+
+/**
+ * release all cached converters.
+ */
+API_EXPORT void                 ImageConverterCacheFlush();
+
+typedef SharedObjectRef         ImageBatchRef;
+
+/**
+ * a batch converter converts many frames per call without frame objects.
+ * frames are spread over threads, each with its own converter, and output
+ * frames are written one after another, GetImageFormatBytes(oformat) each,
+ * with planes one after another.
+ * @param options   kKeyCount for threads, default cpu count
+ * @return return Nil if no image unit or chain of units exists
+ */
+API_EXPORT ImageBatchRef        ImageBatchCreate(const ImageFormat *, const ImageFormat *, MessageObjectRef);
+
+/**
+ * convert frames in one contiguous buffer, GetImageFormatBytes(iformat) each
+ */
+API_EXPORT MediaError           ImageBatchProcess(ImageBatchRef, const UInt8 * input, UInt32 count, UInt8 * output);
+
+/**
+ * convert frames in iformat, planes may be padded, @see ImagePlaneLayout
+ */
+API_EXPORT MediaError           ImageBatchProcessFrames(ImageBatchRef, const MediaFrameRef * frames, UInt32 count, UInt8 * output);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+API_EXPORT sp<MediaDevice> CreateImageConverter(const ImageFormat&, const ImageFormat&, const sp<Message>&);
+API_EXPORT sp<MediaDevice> ObtainImageConverter(const ImageFormat&, const ImageFormat&, const sp<Message>&);
+API_EXPORT void            FlushImageConverterCache();
+
+struct ImageBatch : public SharedObject {
+    /**
+     * convert count frames into output arena
+     * @return return the first error of any frame
+     */
+    virtual MediaError process(const MediaBufferList * const * inputs, UInt32 count, UInt8 * output) = 0;
+    virtual MediaError process(const UInt8 * input, UInt32 count, UInt8 * output) = 0;
+
+    protected:
+    ImageBatch() : SharedObject(FOURCC('?ibt')) { }
+    virtual ~ImageBatch() { }
+};
+
+API_EXPORT sp<ImageBatch>  CreateImageBatch(const ImageFormat&, const ImageFormat&, const sp<Message>&);
+
+/**
+ * create a device on the specified image unit, in bands as ImageConverter.
+ * @note image units produce rows selected by output rect, and ignore the
+ *       output rect otherwise.
+ */
+API_EXPORT sp<MediaDevice> CreateImageDevice(const MediaUnit *, const ImageFormat&, const ImageFormat&, const sp<Message>&);
+
+/**
+ * loopers shared by bands & workers of all image devices, one per cpu but
+ * the caller's, created on first use.
+ * @note jobs on these loopers MUST never wait for other jobs.
+ */
+API_EXPORT UInt32          GetWorkerLooperCount();
+API_EXPORT sp<Looper>      GetWorkerLooper(UInt32 index);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_CONVERTER_H
@@ -0,0 +1,419 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageDiff.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// each output row is one pass over gathered luma rows of both frames,
+// with chroma diff of the chroma row, which is computed once for vss rows
+// and doubled horizontally for subsampled chroma.
+//
+
+#define LOG_TAG "ImageDiff"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "ImageDiff.h"
+#include "ImageStatistics.h"
+#include "ColorKernels.h"
+#include "PixelFormats.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+__BEGIN_NAMESPACE_MFWK
+
+#define FORMAT_ENTRY(FORMAT, ...)   FORMAT,
+static const UInt32 kInputFormats[] = {
+    YUV_FORMATS(FORMAT_ENTRY)
+    kPixelFormatUnknown
+};
+
+static const UInt32 kOutputFormats[] = {
+    kPixelFormatBGRA,
+    kPixelFormatUnknown
+};
+
+#pragma mark Kernels
+// d = max(|a1 - b1|, |a2 - b2|) >> shift
+static void AbsDiffMaxRow(const UInt16 * a1, const UInt16 * b1, const UInt16 * a2, const UInt16 * b2,
+                          UInt16 * d, UInt32 n, UInt32 shift) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x1 = _mm_loadu_si128((const __m128i *)(a1 + i));
+        const __m128i y1 = _mm_loadu_si128((const __m128i *)(b1 + i));
+        const __m128i x2 = _mm_loadu_si128((const __m128i *)(a2 + i));
+        const __m128i y2 = _mm_loadu_si128((const __m128i *)(b2 + i));
+        // shift first, then it fits in signed max
+        const __m128i d1 = _mm_srl_epi16(_mm_or_si128(_mm_subs_epu16(x1, y1), _mm_subs_epu16(y1, x1)), count);
+        const __m128i d2 = _mm_srl_epi16(_mm_or_si128(_mm_subs_epu16(x2, y2), _mm_subs_epu16(y2, x2)), count);
+        _mm_storeu_si128((__m128i *)(d + i), _mm_max_epi16(d1, d2));
+    }
+#elif defined(__aarch64__)
+    const int16x8_t count = vdupq_n_s16(-(Int16)shift);
+    for (; i + 8 <= n; i += 8) {
+        const uint16x8_t d1 = vabdq_u16(vld1q_u16(a1 + i), vld1q_u16(b1 + i));
+        const uint16x8_t d2 = vabdq_u16(vld1q_u16(a2 + i), vld1q_u16(b2 + i));
+        vst1q_u16(d + i, vshlq_u16(vmaxq_u16(d1, d2), count));
+    }
+#endif
+    for (; i < n; ++i) {
+        const UInt32 d1 = a1[i] > b1[i] ? a1[i] - b1[i] : b1[i] - a1[i];
+        const UInt32 d2 = a2[i] > b2[i] ? a2[i] - b2[i] : b2[i] - a2[i];
+        d[i] = (d1 > d2 ? d1 : d2) >> shift;
+    }
+}
+
+// dst[2i] = dst[2i + 1] = src[i]
+static void DoubleRow(const UInt16 * src, UInt16 * dst, UInt32 n) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i * 2), _mm_unpacklo_epi16(x, x));
+        _mm_storeu_si128((__m128i *)(dst + i * 2 + 8), _mm_unpackhi_epi16(x, x));
+    }
+#elif defined(__aarch64__)
+    for (; i + 8 <= n; i += 8) {
+        const uint16x8_t x = vld1q_u16(src + i);
+        const uint16x8x2_t xx = { { x, x } };
+        vst2q_u16(dst + i * 2, xx);
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i * 2] = dst[i * 2 + 1] = src[i];
+    }
+}
+
+/**
+ * BGRA of luma diff of ya & yb and chroma diff dc
+ * @param shift     luma diff to 8 bits
+ * @param gain      shift of gain, diff is <= 255 before it
+ */
+template <eDiffMode MODE>
+static void DiffRow(const UInt16 * ya, const UInt16 * yb, const UInt16 * dc, UInt8 * out,
+                    UInt32 n, UInt32 shift, UInt32 gain) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m128i amp   = _mm_cvtsi32_si128(gain);
+    const __m128i alpha = _mm_set1_epi8((Int8)0xFF);
+    const __m128i c255  = _mm_set1_epi16(255);
+    const __m128i c510  = _mm_set1_epi16(510);
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i *)(ya + i));
+        const __m128i y = _mm_loadu_si128((const __m128i *)(yb + i));
+        // <= 255 << 7, no sign
+        const __m128i dy = _mm_sll_epi16(_mm_srl_epi16(_mm_or_si128(_mm_subs_epu16(x, y), _mm_subs_epu16(y, x)), count), amp);
+        const __m128i du = _mm_sll_epi16(_mm_loadu_si128((const __m128i *)(dc + i)), amp);
+        __m128i r, g, b;
+        if (MODE == kDiffHeat) {
+            const __m128i m = _mm_min_epi16(_mm_max_epi16(dy, du), c255);
+            const __m128i t = _mm_add_epi16(_mm_add_epi16(m, m), m);
+            r = t;
+            g = _mm_sub_epi16(t, c255);
+            b = _mm_sub_epi16(t, c510);
+        } else {
+            r = dy;
+            g = _mm_min_epi16(dy, du);
+            b = du;
+        }
+        // saturate to 8 bits
+        const __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+        const __m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), alpha);
+        _mm_storeu_si128((__m128i *)(out + i * 4), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)(out + i * 4 + 16), _mm_unpackhi_epi16(bg, ra));
+    }
+#elif defined(__aarch64__)
+    const int16x8_t count   = vdupq_n_s16(-(Int16)shift);
+    const int16x8_t amp     = vdupq_n_s16(gain);
+    const uint16x8_t c255   = vdupq_n_u16(255);
+    const uint16x8_t c510   = vdupq_n_u16(510);
+    for (; i + 8 <= n; i += 8) {
+        const uint16x8_t dy = vshlq_u16(vshlq_u16(vabdq_u16(vld1q_u16(ya + i), vld1q_u16(yb + i)), count), amp);
+        const uint16x8_t du = vshlq_u16(vld1q_u16(dc + i), amp);
+        uint8x8x4_t px;
+        if (MODE == kDiffHeat) {
+            const uint16x8_t m = vminq_u16(vmaxq_u16(dy, du), c255);
+            const uint16x8_t t = vaddq_u16(vaddq_u16(m, m), m);
+            px.val[2] = vqmovn_u16(t);
+            px.val[1] = vqmovn_u16(vqsubq_u16(t, c255));
+            px.val[0] = vqmovn_u16(vqsubq_u16(t, c510));
+        } else {
+            px.val[2] = vqmovn_u16(dy);
+            px.val[1] = vqmovn_u16(vminq_u16(dy, du));
+            px.val[0] = vqmovn_u16(du);
+        }
+        px.val[3] = vdup_n_u8(0xFF);
+        vst4_u8(out + i * 4, px);
+    }
+#endif
+    for (; i < n; ++i) {
+        const Int32 d1 = ya[i] > yb[i] ? ya[i] - yb[i] : yb[i] - ya[i];
+        const Int32 dy = (d1 >> shift) << gain;
+        const Int32 du = dc[i] << gain;
+        Int32 r, g, b;
+        if (MODE == kDiffHeat) {
+            Int32 m = dy > du ? dy : du;
+            if (m > 255) m = 255;
+            r = m * 3;
+            g = m * 3 - 255;
+            b = m * 3 - 510;
+        } else {
+            r = dy;
+            g = dy < du ? dy : du;
+            b = du;
+        }
+        UInt8 * p = out + i * 4;
+        p[0] = b < 0 ? 0 : b > 255 ? 255 : b;
+        p[1] = g < 0 ? 0 : g > 255 ? 255 : g;
+        p[2] = r > 255 ? 255 : r;
+        p[3] = 0xFF;
+    }
+}
+
+#pragma mark Diff Unit
+struct DiffUnitContext {
+    eDiffMode               mode;
+    UInt32                  gain;
+    ImageFormat             iformat;
+    ImageFormat             oformat;
+    ImageComponents         components;
+    UInt32                  shift;      // diff to 8 bits
+    UInt16 *                rows;       // scratch rows
+    UInt16 *                luma[2];
+    UInt16 *                chroma[4];  // Cb & Cr of both
+    UInt16 *                diff;       // chroma diff, in chroma samples
+    UInt16 *                doubled;    // chroma diff, doubled horizontally
+    Int32                   chromaRow;  // chroma row of diff
+
+    DiffUnitContext() : rows(Nil) { }
+
+    ~DiffUnitContext() { delete [] rows; }
+};
+
+static MediaUnitContext DiffUnitAlloc() {
+    DiffUnitContext * instance = new DiffUnitContext;
+    return instance;
+}
+
+static void DiffUnitDealloc(MediaUnitContext ref) {
+    DiffUnitContext * instance = static_cast<DiffUnitContext *>(ref);
+    delete instance;
+}
+
+static MediaError DiffUnitInit(MediaUnitContext ref, eDiffMode mode, UInt32 gain,
+                               const MediaFormat * iformat, const MediaFormat * oformat) {
+    DiffUnitContext * instance = static_cast<DiffUnitContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    if (out.format != kPixelFormatBGRA || GetYUVLayout(in.format) == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    // no scaling
+    if (in.rect.w != out.width || in.rect.h != out.height) {
+        return kMediaErrorNotSupported;
+    }
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // output rect selects the rows to produce
+    if (out.rect.x != 0 || out.rect.w != out.width ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    ImageComponents& components = instance->components;
+    if (GetImageComponents(in.format, components) != kMediaNoError ||
+        components.planes[1].hss > 2) {
+        return kMediaErrorNotSupported;
+    }
+
+    // luma rows, 4 chroma rows, chroma diff & doubled
+    const UInt32 n = in.rect.w + 8;
+    delete [] instance->rows;
+    instance->rows      = new UInt16[n * 9];
+    instance->luma[0]   = instance->rows;
+    instance->luma[1]   = instance->rows + n;
+    for (UInt32 i = 0; i < 4; ++i) {
+        instance->chroma[i] = instance->rows + n * (2 + i);
+    }
+    instance->diff      = instance->rows + n * 6;
+    instance->doubled   = instance->rows + n * 7;
+
+    instance->mode      = mode;
+    instance->gain      = gain;
+    instance->iformat   = in;
+    instance->oformat   = out;
+    instance->shift     = components.depth - 8;
+
+    DEBUG("%s -> %s, mode %u, gain %u", GetImageFormatString(in).c_str(),
+          GetImageFormatString(out).c_str(), mode, 1 << gain);
+    return kMediaNoError;
+}
+
+// chroma diff of a chroma row, in luma samples
+static const UInt16 * ChromaDiff(DiffUnitContext * instance, UInt8 * const * ap, const UInt32 * as,
+                                 UInt8 * const * bp, const UInt32 * bs, Int32 y) {
+    const ImageFormat& in = instance->iformat;
+    const ImageComponents& components = instance->components;
+    const ImageComponent& cb = components.planes[1];
+    const ImageComponent& cr = components.planes[2];
+    const Int32 x0  = in.rect.x / cb.hss;
+    const Int32 n   = (in.rect.x + in.rect.w - 1) / cb.hss + 1 - x0;
+
+    if (y != instance->chromaRow) {
+        const UInt32 bytes = components.bytes;
+        cb.gather(ap[cb.plane] + y * as[cb.plane] + (x0 * cb.step + cb.offset) * bytes,
+                  instance->chroma[0], n, components.shift, components.mask);
+        cb.gather(bp[cb.plane] + y * bs[cb.plane] + (x0 * cb.step + cb.offset) * bytes,
+                  instance->chroma[1], n, components.shift, components.mask);
+        cr.gather(ap[cr.plane] + y * as[cr.plane] + (x0 * cr.step + cr.offset) * bytes,
+                  instance->chroma[2], n, components.shift, components.mask);
+        cr.gather(bp[cr.plane] + y * bs[cr.plane] + (x0 * cr.step + cr.offset) * bytes,
+                  instance->chroma[3], n, components.shift, components.mask);
+        AbsDiffMaxRow(instance->chroma[0], instance->chroma[1], instance->chroma[2], instance->chroma[3],
+                      instance->diff, n, instance->shift);
+        if (cb.hss == 2) DoubleRow(instance->diff, instance->doubled, n);
+        instance->chromaRow = y;
+    }
+    // odd x starts at the second half of a chroma sample
+    return cb.hss == 2 ? instance->doubled + (in.rect.x & 1) : instance->diff;
+}
+
+static MediaError DiffUnitProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    DiffUnitContext * instance = static_cast<DiffUnitContext *>(ref);
+    const ImageFormat& in   = instance->iformat;
+    const ImageFormat& out  = instance->oformat;
+    const ImageComponents& components = instance->components;
+
+    // planes of both frames
+    if (input->count < 2 || input->count > 8 || (input->count & 1)) {
+        return kMediaErrorBadParameters;
+    }
+    MediaBufferList4 a, b;
+    a.list.count = b.list.count = input->count / 2;
+    for (UInt32 i = 0; i < a.list.count; ++i) {
+        a.buffers[i] = input->buffers[i];
+        b.buffers[i] = input->buffers[a.list.count + i];
+    }
+
+    UInt8 * ap[4], * bp[4], * op[4];
+    UInt32 as[4], bs[4], os[4];
+    if (GetImagePlaneData(in, &a.list, False, ap, as) != kMediaNoError ||
+        GetImagePlaneData(in, &b.list, False, bp, bs) != kMediaNoError ||
+        GetImagePlaneData(out, output, True, op, os) != kMediaNoError) {
+        return kMediaErrorBadParameters;
+    }
+
+    const ImageComponent& luma = components.planes[0];
+    const UInt32 bytes  = components.bytes;
+    const UInt32 n      = in.rect.w;
+    instance->chromaRow = -1;
+    for (Int32 j = out.rect.y; j < out.rect.y + out.rect.h; ++j) {
+        const Int32 y = in.rect.y + j;
+        luma.gather(ap[luma.plane] + y * as[luma.plane] + (in.rect.x * luma.step + luma.offset) * bytes,
+                    instance->luma[0], n, components.shift, components.mask);
+        luma.gather(bp[luma.plane] + y * bs[luma.plane] + (in.rect.x * luma.step + luma.offset) * bytes,
+                    instance->luma[1], n, components.shift, components.mask);
+        const UInt16 * dc = ChromaDiff(instance, ap, as, bp, bs, y / components.planes[1].vss);
+
+        UInt8 * dst = op[0] + j * os[0];
+        if (instance->mode == kDiffHeat) {
+            DiffRow<kDiffHeat>(instance->luma[0], instance->luma[1], dc, dst, n, instance->shift, instance->gain);
+        } else {
+            DiffRow<kDiffSplit>(instance->luma[0], instance->luma[1], dc, dst, n, instance->shift, instance->gain);
+        }
+    }
+    return kMediaNoError;
+}
+
+static MediaError DiffUnitReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+#define DIFF_UNIT(MODE, GAIN)                                                               \
+static MediaError DiffUnitInit##MODE##GAIN(MediaUnitContext ref,                            \
+                                           const MediaFormat * iformat,                     \
+                                           const MediaFormat * oformat) {                   \
+    return DiffUnitInit(ref, kDiff##MODE, GAIN, iformat, oformat);                          \
+}                                                                                           \
+static const MediaUnit kDiffUnit##MODE##GAIN = {                                            \
+    "diff." #MODE ".x" #GAIN,                                                               \
+    0,                                                                                      \
+    kInputFormats,                                                                          \
+    kOutputFormats,                                                                         \
+    DiffUnitAlloc,                                                                          \
+    DiffUnitDealloc,                                                                        \
+    DiffUnitInit##MODE##GAIN,                                                               \
+    DiffUnitProcess,                                                                        \
+    Nil,                                                                                    \
+    DiffUnitReset,                                                                          \
+};
+
+// gain in shift
+#define DIFF_UNITS(MODE)                                                                    \
+    DIFF_UNIT(MODE, 0) DIFF_UNIT(MODE, 1) DIFF_UNIT(MODE, 2) DIFF_UNIT(MODE, 3)             \
+    DIFF_UNIT(MODE, 4) DIFF_UNIT(MODE, 5) DIFF_UNIT(MODE, 6) DIFF_UNIT(MODE, 7)
+
+DIFF_UNITS(Heat)
+DIFF_UNITS(Split)
+
+#define DIFF_UNIT_ENTRIES(MODE)                                                             \
+    { &kDiffUnit##MODE##0, &kDiffUnit##MODE##1, &kDiffUnit##MODE##2, &kDiffUnit##MODE##3,   \
+      &kDiffUnit##MODE##4, &kDiffUnit##MODE##5, &kDiffUnit##MODE##6, &kDiffUnit##MODE##7 }
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+const MediaUnit * DiffUnitFind(const eDiffMode mode, UInt32 gain) {
+    static const MediaUnit * kDiffUnits[2][8] = {
+        DIFF_UNIT_ENTRIES(Heat),
+        DIFF_UNIT_ENTRIES(Split),
+    };
+    if (mode > kDiffSplit || gain == 0 || gain > 128) {
+        return Nil;
+    }
+    UInt32 shift = 0;
+    while (gain >> (shift + 1)) ++shift;
+    return kDiffUnits[mode][shift];
+}
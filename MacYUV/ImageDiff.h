@@ -0,0 +1,69 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageDiff.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// difference map of two frames in the same Y'CbCr format, to see where
+// they differ, next to the numbers of ImageCompare.
+//
+
+#ifndef MACYUV_IMAGE_DIFF_H
+#define MACYUV_IMAGE_DIFF_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+
+__BEGIN_DECLS
+
+enum {
+    kDiffHeat,                                  ///< max of luma & chroma diff, black -> red -> yellow -> white
+    kDiffSplit,                                 ///< luma diff in red, chroma diff in blue, both in green
+    kDiffDefault            = kDiffHeat,
+};
+typedef UInt32 eDiffMode;
+
+#define kDiffGainDefault    (4)         ///< 1 - 128
+
+/**
+ * get BGRA difference map unit of mode and gain.
+ * input planes are planes of the first frame then the second frame, same
+ * number of buffers each. output is BGRA of input display rect.
+ * @param gain  multiplier of abs diff, in power of two, rounded down.
+ * @return return Nil if mode or gain is not supported
+ * @note diff of high bit depth is scaled to 8 bits before gain.
+ * @note chroma diff is the larger of Cb & Cr, nearest for subsampled chroma.
+ * @note produce rows selected by output rect, as image units.
+ */
+API_EXPORT const MediaUnit *    DiffUnitFind(const eDiffMode, UInt32 gain);
+
+__END_DECLS
+
+#endif // MACYUV_IMAGE_DIFF_H
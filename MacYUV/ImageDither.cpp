@@ -0,0 +1,613 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageDither.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// each source row is converted to 8-bit RGB first if it is Y'CbCr, then
+// quantized to 5:6:5 by dropping low bits of each channel.
+// ordered dither adds a Bayer threshold of the quantization step before
+// dropping bits, with saturation, so it is vectorized as it is.
+// error diffusion is sequential along a row, so the 3 channels of a pixel
+// are diffused together in one vector, and packed to 5:6:5 afterwards.
+//
+
+#define LOG_TAG "ImageDither"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "ImageDither.h"
+#include "ColorKernels.h"
+#include "PixelFormats.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+__BEGIN_NAMESPACE_MFWK
+
+#define FORMAT_ENTRY(FORMAT, ...)   FORMAT,
+static const UInt32 kInputFormats[] = {
+    YUV_FORMATS(FORMAT_ENTRY)
+    kPixelFormatBGRA,
+    kPixelFormatRGBA,
+    kPixelFormatARGB,
+    kPixelFormatABGR,
+    kPixelFormatUnknown
+};
+
+static const UInt32 kOutputFormats[] = {
+    kPixelFormatBGR565,
+    kPixelFormatRGB565,
+    kPixelFormatUnknown
+};
+
+// thresholds in [0, 64)
+static const UInt8 kBayer[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+// bias of 8 pixels, for truncation
+static const UInt8 kNoBias[8 * 4] = { 0 };
+
+#pragma mark Kernels
+// BGR565 is a word in little endian, RGB565 is a word in big endian
+template <Bool BE> static FORCE_INLINE void Store565(UInt8 * dst, UInt32 r, UInt32 g, UInt32 b) {
+    const UInt32 w = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    dst[BE ? 1 : 0] = w;
+    dst[BE ? 0 : 1] = w >> 8;
+}
+
+static FORCE_INLINE UInt32 AddSat(UInt32 a, UInt32 b) {
+    a += b;
+    return a > 255 ? 255 : a;
+}
+
+#if defined(__SSE2__)
+// 4 pixels in 32-bit lanes -> words sign extended, for packs_epi32
+template <class RGB, Bool BE> static FORCE_INLINE __m128i Pack565x4(__m128i p) {
+    const __m128i m5    = _mm_set1_epi32(0xF8);
+    const __m128i m6    = _mm_set1_epi32(0xFC);
+    const __m128i r     = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(p, 8 * RGB::r), m5), 8);
+    const __m128i g     = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(p, 8 * RGB::g), m6), 3);
+    const __m128i b     = _mm_srli_epi32(_mm_and_si128(_mm_srli_epi32(p, 8 * RGB::b), m5), 3);
+    __m128i w = _mm_or_si128(_mm_or_si128(r, g), b);
+    if (BE) {
+        w = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(w, _mm_set1_epi32(0xFF)), 8), _mm_srli_epi32(w, 8));
+    }
+    return _mm_srai_epi32(_mm_slli_epi32(w, 16), 16);
+}
+#endif
+
+/**
+ * add bias of (x % 8) with saturation, then drop low bits
+ * @param bias  bias of 8 pixels, in sample positions of RGB
+ * @note ORDERED scales samples by 31/32 & 63/64 before adding bias, as
+ *       5:6:5 is expanded to 8 bits by 255/31 & 255/63, so the average
+ *       of dithered pixels stays the same.
+ */
+template <class RGB, Bool BE, Bool ORDERED>
+static void PackRow(const UInt8 * rgba, UInt8 * dst, UInt32 n, const UInt8 * bias) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    const __m128i b0 = _mm_loadu_si128((const __m128i *)bias);
+    const __m128i b1 = _mm_loadu_si128((const __m128i *)(bias + 16));
+    const __m128i m5 = _mm_set1_epi32((0x07 << (8 * RGB::r)) | (0x07 << (8 * RGB::b)));
+    const __m128i m6 = _mm_set1_epi32(0x03 << (8 * RGB::g));
+    for (; i + 8 <= n; i += 8) {
+        __m128i p0 = _mm_loadu_si128((const __m128i *)(rgba + i * 4));
+        __m128i p1 = _mm_loadu_si128((const __m128i *)(rgba + i * 4 + 16));
+        if (ORDERED) {
+            p0 = _mm_subs_epu8(p0, _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p0, 5), m5),
+                                                _mm_and_si128(_mm_srli_epi16(p0, 6), m6)));
+            p1 = _mm_subs_epu8(p1, _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p1, 5), m5),
+                                                _mm_and_si128(_mm_srli_epi16(p1, 6), m6)));
+        }
+        p0 = _mm_adds_epu8(p0, b0);
+        p1 = _mm_adds_epu8(p1, b1);
+        _mm_storeu_si128((__m128i *)(dst + i * 2),
+                         _mm_packs_epi32(Pack565x4<RGB, BE>(p0), Pack565x4<RGB, BE>(p1)));
+    }
+#elif defined(__aarch64__)
+    const uint8x8x4_t b = vld4_u8(bias);
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x4_t p = vld4_u8(rgba + i * 4);
+        if (ORDERED) {
+            p.val[RGB::r]   = vsub_u8(p.val[RGB::r], vshr_n_u8(p.val[RGB::r], 5));
+            p.val[RGB::g]   = vsub_u8(p.val[RGB::g], vshr_n_u8(p.val[RGB::g], 6));
+            p.val[RGB::b]   = vsub_u8(p.val[RGB::b], vshr_n_u8(p.val[RGB::b], 5));
+        }
+        const uint8x8_t r   = vand_u8(vqadd_u8(p.val[RGB::r], b.val[RGB::r]), vdup_n_u8(0xF8));
+        const uint8x8_t g   = vand_u8(vqadd_u8(p.val[RGB::g], b.val[RGB::g]), vdup_n_u8(0xFC));
+        const uint8x8_t c   = vqadd_u8(p.val[RGB::b], b.val[RGB::b]);
+        uint16x8_t w = vorrq_u16(vorrq_u16(vshll_n_u8(r, 8), vshll_n_u8(g, 3)), vshrq_n_u16(vmovl_u8(c), 3));
+        if (BE) {
+            w = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(w)));
+        }
+        vst1q_u8(dst + i * 2, vreinterpretq_u8_u16(w));
+    }
+#endif
+    for (; i < n; ++i) {
+        const UInt8 * p = rgba + i * 4;
+        const UInt8 * t = bias + (i & 7) * 4;
+        UInt32 r = p[RGB::r], g = p[RGB::g], b = p[RGB::b];
+        if (ORDERED) {
+            r   -= r >> 5;
+            g   -= g >> 6;
+            b   -= b >> 5;
+        }
+        Store565<BE>(dst + i * 2, AddSat(r, t[RGB::r]), AddSat(g, t[RGB::g]), AddSat(b, t[RGB::b]));
+    }
+}
+
+#if defined(__SSE2__)
+// B/G/R/0 of 1 or 2 pixels in 16-bit lanes, with their errors from above
+template <class RGB> static FORCE_INLINE __m128i Unpack2(UInt32 x0, UInt32 x1, __m128i above) {
+    const UInt32 order = RGB::b | (RGB::g << 2) | (RGB::r << 4) | (RGB::a << 6);
+    __m128i p = _mm_unpacklo_epi32(_mm_cvtsi32_si128(x0), _mm_cvtsi32_si128(x1));
+    p = _mm_unpacklo_epi8(p, _mm_setzero_si128());
+    p = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, order), order);
+    return _mm_add_epi16(p, above);
+}
+
+// quantize pixels with error from the left in right, return quantized
+// pixels, and the quarters to below in e4 & the rest to the right in right
+static FORCE_INLINE __m128i Diffuse2(__m128i p, __m128i& right, __m128i& e4) {
+    const __m128i zero      = _mm_setzero_si128();
+    const __m128i mask      = _mm_setr_epi16(0xF8, 0xFC, 0xF8, 0, 0xF8, 0xFC, 0xF8, 0);
+    const __m128i low       = _mm_setr_epi16(0x07, 0x03, 0x07, 0, 0x07, 0x03, 0x07, 0);
+    const __m128i m5        = _mm_setr_epi16(-1, 0, -1, 0, -1, 0, -1, 0);
+    const __m128i m6        = _mm_setr_epi16(0, -1, 0, 0, 0, -1, 0, 0);
+    p = _mm_min_epi16(_mm_max_epi16(_mm_add_epi16(p, right), zero), _mm_set1_epi16(255));
+    // 5:6:5 is expanded to 8 bits as q | q >> 5 & q | q >> 6, so error
+    // is the dropped bits minus the replicated ones
+    const __m128i err   = _mm_sub_epi16(_mm_and_si128(p, low),
+                                        _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 5), m5),
+                                                     _mm_and_si128(_mm_srli_epi16(p, 6), m6)));
+    e4      = _mm_srai_epi16(err, 2);
+    right   = _mm_sub_epi16(err, _mm_add_epi16(e4, e4));
+    return _mm_and_si128(p, mask);
+}
+#endif
+
+/**
+ * Sierra Lite error diffusion: 2/4 to the right, 1/4 to below left & below.
+ * errors of a row are in B/G/R/0 of each pixel, from index 1, and pixels are
+ * quantized to BGRA in place of rgba or to out.
+ * @param cur   errors of this row
+ * @param next  errors of next row, index [0, n] are overwritten
+ */
+template <class RGB>
+static void DiffuseRow(const UInt8 * rgba, UInt8 * out, UInt32 n, const Int16 * cur, Int16 * next) {
+#if defined(__SSE2__)
+    __m128i right = _mm_setzero_si128();
+    __m128i below = _mm_setzero_si128();
+    for (UInt32 i = 0; i < n; ++i) {
+        UInt32 x;
+        memcpy(&x, rgba + i * 4, 4);
+        __m128i e4;
+        const __m128i p = Unpack2<RGB>(x, 0, _mm_loadl_epi64((const __m128i *)(cur + (i + 1) * 4)));
+        const __m128i q = Diffuse2(p, right, e4);
+        _mm_storel_epi64((__m128i *)(next + i * 4), _mm_add_epi16(below, e4));
+        below   = e4;
+        x       = _mm_cvtsi128_si32(_mm_packus_epi16(q, q));
+        memcpy(out + i * 4, &x, 4);
+    }
+    _mm_storel_epi64((__m128i *)(next + n * 4), below);
+#elif defined(__aarch64__)
+    static const UInt8 kOrder[8] = { RGB::b, RGB::g, RGB::r, RGB::a, RGB::b, RGB::g, RGB::r, RGB::a };
+    static const Int16 kMask[4] = { 0xF8, 0xFC, 0xF8, 0 };
+    static const Int16 kExpand[4] = { -5, -6, -5, 0 };
+    const uint8x8_t order   = vld1_u8(kOrder);
+    const int16x4_t zero    = vdup_n_s16(0);
+    const int16x4_t max     = vdup_n_s16(255);
+    const int16x4_t mask    = vld1_s16(kMask);
+    const int16x4_t expand  = vld1_s16(kExpand);
+    int16x4_t right = zero;
+    int16x4_t below = zero;
+    for (UInt32 i = 0; i < n; ++i) {
+        UInt32 x;
+        memcpy(&x, rgba + i * 4, 4);
+        const uint8x8_t c   = vtbl1_u8(vreinterpret_u8_u32(vdup_n_u32(x)), order);
+        int16x4_t p = vreinterpret_s16_u16(vget_low_u16(vmovl_u8(c)));
+        p = vadd_s16(vadd_s16(p, vld1_s16(cur + (i + 1) * 4)), right);
+        p = vmin_s16(vmax_s16(p, zero), max);
+        const int16x4_t q   = vand_s16(p, mask);
+        const int16x4_t err = vsub_s16(p, vorr_s16(q, vreinterpret_s16_u16(
+                                vshl_u16(vreinterpret_u16_s16(q), expand))));
+        const int16x4_t e4  = vshr_n_s16(err, 2);
+        vst1_s16(next + i * 4, vadd_s16(below, e4));
+        below   = e4;
+        right   = vsub_s16(err, vadd_s16(e4, e4));
+        const uint8x8_t b   = vmovn_u16(vcombine_u16(vreinterpret_u16_s16(q), vdup_n_u16(0)));
+        x       = vget_lane_u32(vreinterpret_u32_u8(b), 0);
+        memcpy(out + i * 4, &x, 4);
+    }
+    vst1_s16(next + n * 4, below);
+#else
+    static const UInt32 kPos[3]     = { RGB::b, RGB::g, RGB::r };
+    static const Int32 kMask[3]     = { 0xF8, 0xFC, 0xF8 };
+    static const UInt32 kShift[3]   = { 5, 6, 5 };
+    Int32 right[3] = { 0, 0, 0 };
+    Int32 below[3] = { 0, 0, 0 };
+    for (UInt32 i = 0; i < n; ++i) {
+        UInt8 q[4] = { 0, 0, 0, 0 };
+        for (UInt32 c = 0; c < 3; ++c) {
+            Int32 p = rgba[i * 4 + kPos[c]] + cur[(i + 1) * 4 + c] + right[c];
+            p = p < 0 ? 0 : p > 255 ? 255 : p;
+            q[c] = p & kMask[c];
+            const Int32 err = p - (q[c] | (q[c] >> kShift[c]));
+            const Int32 e4  = err >> 2;
+            next[i * 4 + c] = below[c] + e4;
+            below[c]    = e4;
+            right[c]    = err - 2 * e4;
+        }
+        next[i * 4 + 3] = 0;
+        memcpy(out + i * 4, q, 4);
+    }
+    for (UInt32 c = 0; c < 3; ++c) next[n * 4 + c] = below[c];
+    next[n * 4 + 3] = 0;
+#endif
+}
+
+/**
+ * diffuse 2 rows, @see DiffuseRow
+ * @param mid   errors of the 2nd row, may be not used
+ * @note pixels of a row depend on the left one, so the 2nd row runs 2 pixels
+ *       behind the 1st row in the same vector, as its errors from above are
+ *       ready then.
+ */
+template <class RGB>
+static void DiffuseRows(const UInt8 * rgba0, const UInt8 * rgba1, UInt8 * out0, UInt8 * out1, UInt32 n,
+                        const Int16 * cur, Int16 * mid, Int16 * next) {
+#if defined(__SSE2__)
+    __m128i right   = _mm_setzero_si128();
+    __m128i below   = _mm_setzero_si128();
+    __m128i above   = _mm_setzero_si128();  // errors of the 1st row to below, in low half
+    __m128i last    = _mm_setzero_si128();  // errors of the 1st row to below its last pixel
+    for (UInt32 i = 0; i < n + 2; ++i) {
+        UInt32 x0 = 0, x1 = 0;
+        __m128i e   = _mm_setzero_si128();
+        if (i < n) {
+            memcpy(&x0, rgba0 + i * 4, 4);
+            e   = _mm_loadl_epi64((const __m128i *)(cur + (i + 1) * 4));
+        }
+        if (i >= 2) {
+            memcpy(&x1, rgba1 + (i - 2) * 4, 4);
+        }
+        __m128i e4;
+        const __m128i p = Unpack2<RGB>(x0, x1, _mm_unpacklo_epi64(e, i == n + 1 ? last : above));
+        const __m128i q = Diffuse2(p, right, e4);
+        above   = _mm_add_epi16(below, e4);
+        below   = e4;
+        if (i == 1) {
+            // 2nd row starts from next pixel
+            right   = _mm_move_epi64(right);
+            below   = _mm_move_epi64(below);
+        }
+        if (i + 1 == n) last = below;
+
+        const __m128i b = _mm_packus_epi16(q, q);
+        if (i < n) {
+            x0  = _mm_cvtsi128_si32(b);
+            memcpy(out0 + i * 4, &x0, 4);
+        }
+        if (i >= 2) {
+            x1  = _mm_cvtsi128_si32(_mm_srli_si128(b, 4));
+            memcpy(out1 + (i - 2) * 4, &x1, 4);
+            _mm_storel_epi64((__m128i *)(next + (i - 2) * 4), _mm_unpackhi_epi64(above, above));
+        }
+    }
+    _mm_storel_epi64((__m128i *)(next + n * 4), _mm_unpackhi_epi64(below, below));
+#else
+    DiffuseRow<RGB>(rgba0, out0, n, cur, mid);
+    DiffuseRow<RGB>(rgba1, out1, n, mid, next);
+#endif
+}
+
+typedef void (*DitherPackRow)(const UInt8 * rgba, UInt8 * dst, UInt32 n, const UInt8 * bias);
+typedef void (*DitherDiffuseRow)(const UInt8 * rgba, UInt8 * out, UInt32 n, const Int16 * cur, Int16 * next);
+typedef void (*DitherDiffuseRows)(const UInt8 * rgba0, const UInt8 * rgba1, UInt8 * out0, UInt8 * out1, UInt32 n,
+                                  const Int16 * cur, Int16 * mid, Int16 * next);
+
+struct DitherRows {
+    UInt32                  format;
+    UInt8                   r, g, b;
+    DitherPackRow           pack[2];    // BGR565, RGB565
+    DitherPackRow           ordered[2];
+    DitherDiffuseRow        diffuse;
+    DitherDiffuseRows       diffuse2;
+};
+
+#define DITHER_ROWS(FORMAT)                                                                     \
+    { FORMAT, RGBTraits<FORMAT>::r, RGBTraits<FORMAT>::g, RGBTraits<FORMAT>::b,                 \
+      { PackRow<RGBTraits<FORMAT>, False, False>, PackRow<RGBTraits<FORMAT>, True, False> },    \
+      { PackRow<RGBTraits<FORMAT>, False, True>, PackRow<RGBTraits<FORMAT>, True, True> },      \
+      DiffuseRow<RGBTraits<FORMAT> >, DiffuseRows<RGBTraits<FORMAT> > },
+static const DitherRows kDitherRows[] = {
+    DITHER_ROWS(kPixelFormatBGRA)
+    DITHER_ROWS(kPixelFormatRGBA)
+    DITHER_ROWS(kPixelFormatARGB)
+    DITHER_ROWS(kPixelFormatABGR)
+};
+#undef DITHER_ROWS
+#define NELEM(x)    (sizeof(x) / sizeof(x[0]))
+
+static const DitherRows * GetDitherRows(UInt32 format) {
+    for (UInt32 i = 0; i < NELEM(kDitherRows); ++i) {
+        if (kDitherRows[i].format == format) return &kDitherRows[i];
+    }
+    return Nil;
+}
+
+#pragma mark Dither Unit
+struct DitherUnitContext {
+    eDither                 dither;
+    const PixelDescriptor * desc;
+    ImageFormat             iformat;
+    ImageFormat             oformat;
+    UInt32                  phase;      // display rect.x in chroma pair
+    ColorRow                color;      // Y'CbCr input only
+    const ColorParams *     params;
+    const DitherRows *      rows;       // of input, or BGRA from color row
+    DitherPackRow           pack;
+    DitherPackRow           packBGRA;   // after diffusion
+    UInt8                   bias[8][8 * 4];
+    UInt8 *                 rgba;       // converted & quantized rows
+    Int16 *                 errors[3];
+
+    DitherUnitContext() : rgba(Nil) {
+        memset(errors, 0, sizeof(errors));
+    }
+
+    void release() {
+        delete [] rgba;
+        for (UInt32 i = 0; i < 3; ++i) delete [] errors[i];
+        rgba = Nil;
+        memset(errors, 0, sizeof(errors));
+    }
+
+    ~DitherUnitContext() { release(); }
+};
+
+static MediaUnitContext DitherUnitAlloc() {
+    DitherUnitContext * instance = new DitherUnitContext;
+    return instance;
+}
+
+static void DitherUnitDealloc(MediaUnitContext ref) {
+    DitherUnitContext * instance = static_cast<DitherUnitContext *>(ref);
+    delete instance;
+}
+
+static MediaError DitherUnitInit(MediaUnitContext ref, eDither dither,
+                                 const MediaFormat * iformat, const MediaFormat * oformat) {
+    DitherUnitContext * instance = static_cast<DitherUnitContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    if (out.format != kPixelFormatBGR565 && out.format != kPixelFormatRGB565) {
+        return kMediaErrorNotSupported;
+    }
+
+    // no scaling
+    if (in.rect.w != out.width || in.rect.h != out.height) {
+        return kMediaErrorNotSupported;
+    }
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // output rect selects the rows to produce
+    if (out.rect.x != 0 || out.rect.w != out.width ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    const YUVLayout * layout = GetYUVLayout(in.format);
+    ColorRow color = Nil;
+    const ColorParams * params = Nil;
+    if (layout != Nil) {
+        color   = GetColorRow(GetColorKernels(), in.format, kPixelFormatBGRA);
+        params  = GetColorParams(in.matrix);
+        if (color == Nil || params == Nil) {
+            return kMediaErrorNotSupported;
+        }
+    }
+
+    const DitherRows * rows = GetDitherRows(layout ? (UInt32)kPixelFormatBGRA : in.format);
+    if (rows == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    const UInt32 be = out.format == kPixelFormatRGB565;
+
+    instance->release();
+    instance->dither    = dither;
+    instance->desc      = GetImagePixelDescriptor(in.format);
+    instance->iformat   = in;
+    instance->oformat   = out;
+    instance->phase     = (layout == Nil || layout->layout == kYUVLayoutPlanar) ? 0 : (in.rect.x & 1);
+    instance->color     = color;
+    instance->params    = params;
+    instance->rows      = rows;
+    instance->pack      = dither == kDitherOrdered ? rows->ordered[be] : rows->pack[be];
+    instance->packBGRA  = GetDitherRows(kPixelFormatBGRA)->pack[be];
+
+    // quantization step is 8 for R & B, 4 for G
+    memset(instance->bias, 0, sizeof(instance->bias));
+    for (UInt32 y = 0; y < 8; ++y) {
+        for (UInt32 x = 0; x < 8; ++x) {
+            instance->bias[y][x * 4 + rows->r]  = kBayer[y][x] >> 3;
+            instance->bias[y][x * 4 + rows->g]  = kBayer[y][x] >> 4;
+            instance->bias[y][x * 4 + rows->b]  = kBayer[y][x] >> 3;
+        }
+    }
+
+    instance->rgba      = new UInt8[2 * (out.width + 1) * 4];
+    if (dither == kDitherDiffusion) {
+        for (UInt32 i = 0; i < 3; ++i) instance->errors[i] = new Int16[(out.width + 2) * 4];
+    }
+
+    DEBUG("dither %u: %s -> %s", dither,
+          GetImageFormatString(in).c_str(),
+          GetImageFormatString(out).c_str());
+    return kMediaNoError;
+}
+
+// source row in 8-bit RGB, Y'CbCr is converted into scratch
+static FORCE_INLINE const UInt8 * SourceRow(const DitherUnitContext * instance,
+                                            UInt8 * const * planes, const UInt32 * strides,
+                                            Int32 row, UInt8 * scratch) {
+    if (instance->color == Nil) {
+        return planes[0] + row * strides[0];
+    }
+    const PixelDescriptor * desc = instance->desc;
+    const UInt8 * y = planes[0] + row * strides[0];
+    const UInt8 * u = planes[1] ? planes[1] + (row / desc->planes[1].vss) * strides[1] : Nil;
+    const UInt8 * v = planes[2] ? planes[2] + (row / desc->planes[2].vss) * strides[2] : Nil;
+    // one more pixel ahead for phase, which is dropped
+    instance->color(y, u, v, scratch, instance->oformat.width + instance->phase, instance->params);
+    return scratch + instance->phase * 4;
+}
+
+static MediaError DitherUnitProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    DitherUnitContext * instance = static_cast<DitherUnitContext *>(ref);
+    const PixelDescriptor * desc    = instance->desc;
+    const ImageFormat& in           = instance->iformat;
+    const ImageFormat& out          = instance->oformat;
+
+    UInt8 * ip[4];
+    UInt32 is[4];
+    UInt8 * op[4];
+    UInt32 os[4];
+    if (GetImagePlaneData(in, input, False, ip, is) != kMediaNoError ||
+        GetImagePlaneData(out, output, True, op, os) != kMediaNoError) {
+        return kMediaErrorBadParameters;
+    }
+
+    // display rect starts at the 2nd pixel of a chroma pair, rows start from
+    // the pair and its 1st pixel is dropped, @see ColorUnitProcess
+    const UInt32 phase  = instance->phase;
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        ip[i]   += (((in.rect.x - phase) / desc->planes[i].hss) * desc->planes[i].bpp) / 8;
+    }
+
+    const UInt32 n      = out.width;
+    const Int32 last    = out.rect.y + out.rect.h;
+    if (instance->dither == kDitherDiffusion) {
+        // errors restart at the first row, run in one band for no seams
+        Int16 * cur     = instance->errors[0];
+        Int16 * next    = instance->errors[1];
+        memset(cur, 0, (n + 2) * 4 * sizeof(Int16));
+        UInt8 * out0    = instance->rgba;
+        UInt8 * out1    = instance->rgba + (n + 1) * 4;
+        for (Int32 j = out.rect.y; j < last; j += 2) {
+            const UInt8 * rgba0 = SourceRow(instance, ip, is, in.rect.y + j, out0);
+            if (j + 1 == last) {
+                instance->rows->diffuse(rgba0, out0, n, cur, next);
+                instance->packBGRA(out0, op[0] + j * os[0], n, kNoBias);
+                break;
+            }
+            const UInt8 * rgba1 = SourceRow(instance, ip, is, in.rect.y + j + 1, out1);
+            instance->rows->diffuse2(rgba0, rgba1, out0, out1, n, cur, instance->errors[2], next);
+            instance->packBGRA(out0, op[0] + j * os[0], n, kNoBias);
+            instance->packBGRA(out1, op[0] + (j + 1) * os[0], n, kNoBias);
+            Int16 * tmp = cur;
+            cur     = next;
+            next    = tmp;
+        }
+        return kMediaNoError;
+    }
+
+    for (Int32 j = out.rect.y; j < last; ++j) {
+        const UInt8 * rgba = SourceRow(instance, ip, is, in.rect.y + j, instance->rgba);
+        // pattern by output pixel, the same for any bands
+        instance->pack(rgba, op[0] + j * os[0], n,
+                       instance->dither == kDitherOrdered ? instance->bias[j & 7] : kNoBias);
+    }
+    return kMediaNoError;
+}
+
+static MediaError DitherUnitReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+// one unit per dither
+#define DITHER_UNIT(NAME, DITHER)                                                       \
+static MediaError DitherUnitInit##DITHER(MediaUnitContext ref,                          \
+                                         const MediaFormat * iformat,                   \
+                                         const MediaFormat * oformat) {                 \
+    return DitherUnitInit(ref, kDither##DITHER, iformat, oformat);                      \
+}                                                                                       \
+const MediaUnit NAME = {                                                                \
+    "rgb565." #DITHER,                                                                  \
+    0,                                                                                  \
+    kInputFormats,                                                                      \
+    kOutputFormats,                                                                     \
+    DitherUnitAlloc,                                                                    \
+    DitherUnitDealloc,                                                                  \
+    DitherUnitInit##DITHER,                                                             \
+    DitherUnitProcess,                                                                  \
+    Nil,                                                                                \
+    DitherUnitReset,                                                                    \
+};
+
+DITHER_UNIT(kDitherUnit,            None)
+DITHER_UNIT(kDitherUnitOrdered,     Ordered)
+DITHER_UNIT(kDitherUnitDiffusion,   Diffusion)
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+const MediaUnit * DitherUnitFind(const eDither dither) {
+    static const MediaUnit * kDitherUnits[] = {
+        &kDitherUnit,
+        &kDitherUnitOrdered,
+        &kDitherUnitDiffusion,
+    };
+    if (dither > kDitherDiffusion) {
+        return Nil;
+    }
+    return kDitherUnits[dither];
+}
@@ -0,0 +1,82 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageDither.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// 16-bit RGB output with dithering, to emulate embedded displays. plain
+// truncation hides banding, ordered dither with a Bayer matrix or error
+// diffusion shows it as on the device.
+// Y'CbCr input is converted by color kernels in the same pass.
+//
+
+#ifndef MACYUV_IMAGE_DITHER_H
+#define MACYUV_IMAGE_DITHER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeyDither          = FOURCC('dith'),       ///< UInt32, @see eDither
+};
+
+enum {
+    kDitherNone,                                ///< truncate, as MediaFramework
+    kDitherOrdered,                             ///< 8x8 Bayer matrix
+    kDitherDiffusion,                           ///< Sierra Lite error diffusion
+    kDitherDefault          = kDitherNone,
+};
+typedef UInt32 eDither;
+
+/**
+ * get RGB565/BGR565 unit of dither
+ * @return return Nil if dither is not supported
+ * @note error diffusion restarts at out.rect.y, so ImageConverter runs it
+ *       in one band to avoid seams between bands.
+ */
+API_EXPORT const MediaUnit *    DitherUnitFind(const eDither);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+/**
+ * unit without dithering, which is one of image units.
+ * @note produce rows selected by output rect, as other image units.
+ */
+extern const MediaUnit kDitherUnit;
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_DITHER_H
@@ -0,0 +1,272 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImagePlaneView.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "ImagePlaneView"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "ImagePlaneView.h"
+#include "ImageStatistics.h"
+#include "ColorKernels.h"
+#include "PixelFormats.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+__BEGIN_NAMESPACE_MFWK
+
+// gathered samples to 8 bits grey, BGRA or Y800
+template <Bool BGRA>
+static void GreyRow(const UInt16 * src, UInt8 * dst, UInt32 n, UInt32 shift) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m128i alpha = _mm_set1_epi8((Int8)0xFF);
+    for (; i + 16 <= n; i += 16) {
+        const __m128i a = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(src + i)), count);
+        const __m128i b = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(src + i + 8)), count);
+        const __m128i g = _mm_packus_epi16(a, b);
+        if (BGRA) {
+            const __m128i gg0 = _mm_unpacklo_epi8(g, g);
+            const __m128i ga0 = _mm_unpacklo_epi8(g, alpha);
+            const __m128i gg1 = _mm_unpackhi_epi8(g, g);
+            const __m128i ga1 = _mm_unpackhi_epi8(g, alpha);
+            _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_unpacklo_epi16(gg0, ga0));
+            _mm_storeu_si128((__m128i *)(dst + i * 4 + 16), _mm_unpackhi_epi16(gg0, ga0));
+            _mm_storeu_si128((__m128i *)(dst + i * 4 + 32), _mm_unpacklo_epi16(gg1, ga1));
+            _mm_storeu_si128((__m128i *)(dst + i * 4 + 48), _mm_unpackhi_epi16(gg1, ga1));
+        } else {
+            _mm_storeu_si128((__m128i *)(dst + i), g);
+        }
+    }
+#elif defined(__aarch64__)
+    const int16x8_t count = vdupq_n_s16(-(Int16)shift);
+    for (; i + 8 <= n; i += 8) {
+        const uint8x8_t g = vmovn_u16(vshlq_u16(vld1q_u16(src + i), count));
+        if (BGRA) {
+            const uint8x8x4_t px = { { g, g, g, vdup_n_u8(0xFF) } };
+            vst4_u8(dst + i * 4, px);
+        } else {
+            vst1_u8(dst + i, g);
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        const UInt8 g = src[i] >> shift;
+        if (BGRA) {
+            dst[i * 4 + 0] = g;
+            dst[i * 4 + 1] = g;
+            dst[i * 4 + 2] = g;
+            dst[i * 4 + 3] = 0xFF;
+        } else {
+            dst[i] = g;
+        }
+    }
+}
+
+struct ImagePlaneView : public MediaDevice {
+    ImageFormat         mInput;
+    ePixelFormat        mFormat;
+    ImageComponents     mComponents;
+    UInt32              mPlane;
+    UInt16 *            mRow;
+    sp<MediaFrame>      mSource;        // the last pushed frame
+    Bool                mReady;         // source not pulled in current plane yet
+
+    ImagePlaneView() : MediaDevice(), mFormat(kPixelFormatUnknown), mPlane(0), mRow(Nil), mReady(False) { }
+
+    virtual ~ImagePlaneView() {
+        delete [] mRow;
+    }
+
+    MediaError init(const ImageFormat& iformat, const ePixelFormat format, const sp<Message>& options) {
+        mInput      = iformat;
+        mFormat     = format;
+        if (format != kPixelFormatBGRA && format != kPixelFormatY800) {
+            return kMediaErrorNotSupported;
+        }
+        if (GetYUVLayout(iformat.format) == Nil ||
+            GetImageComponents(iformat.format, mComponents) != kMediaNoError) {
+            return kMediaErrorNotSupported;
+        }
+        if (iformat.width <= 0 || iformat.height <= 0) {
+            return kMediaErrorBadParameters;
+        }
+
+        if (!options.isNil() && options->contains(kKeyViewPlane)) {
+            mPlane = options->findInt32(kKeyViewPlane);
+        }
+        if (mPlane >= mComponents.count) return kMediaErrorBadParameters;
+
+        mRow        = new UInt16[iformat.width];
+        INFO("%s -> %.4s, plane %u", GetImageFormatString(mInput).c_str(), (const Char *)&mFormat, mPlane);
+        return kMediaNoError;
+    }
+
+    // view of current plane of source, Nil on failure
+    sp<MediaFrame> prepare() {
+        const ImageFormat& image    = mSource->image;
+        const ImageComponent& p     = mComponents.planes[mPlane];
+        const Int32 x0      = image.rect.x / p.hss;
+        const Int32 n       = (image.rect.x + image.rect.w - 1) / p.hss + 1 - x0;
+        const Int32 y0      = image.rect.y / p.vss;
+        const Int32 rows    = (image.rect.y + image.rect.h - 1) / p.vss + 1 - y0;
+
+        UInt8 * planes[4];
+        UInt32 strides[4];
+        if (GetImagePlaneData(image, &mSource->planes, False, planes, strides) != kMediaNoError) {
+            return Nil;
+        }
+
+        ImageFormat oformat;
+        memset(&oformat, 0, sizeof(oformat));
+        oformat.format      = mFormat;
+        oformat.matrix      = image.matrix;
+
+        sp<MediaFrame> output;
+        if (mFormat == kPixelFormatY800 && mComponents.bytes == 1 && p.step == 1 && p.offset == 0) {
+            // zero copy, padded plane keeps its stride
+            const PixelDescriptor * desc = GetImagePixelDescriptor(image.format);
+            oformat.width       = (image.width + p.hss - 1) / p.hss;
+            oformat.height      = GetPlaneRows(desc, p.plane, image.height);
+            oformat.rect.x      = x0;
+            oformat.rect.y      = y0;
+            oformat.rect.w      = n;
+            oformat.rect.h      = rows;
+
+            MediaBufferList4 grey;
+            grey.list.count             = 1;
+            grey.buffers[0].data        = planes[p.plane];
+            grey.buffers[0].capacity    = strides[p.plane] * oformat.height;
+            grey.buffers[0].size        = grey.buffers[0].capacity;
+            output = CreateImageFrame(oformat, grey.list, mSource);
+            if (output.isNil()) return Nil;
+        } else {
+            oformat.width       = oformat.rect.w = n;
+            oformat.height      = oformat.rect.h = rows;
+            output = CreateImageFrame(oformat);
+            if (output.isNil()) return Nil;
+
+            const UInt32 bytes  = mComponents.bytes;
+            const UInt32 shift  = mComponents.depth - 8;
+            const UInt32 bpp    = mFormat == kPixelFormatBGRA ? 4 : 1;
+            UInt8 * dst         = output->planes.buffers[0].data;
+            for (Int32 y = 0; y < rows; ++y) {
+                p.gather(planes[p.plane] + (y0 + y) * strides[p.plane] + (x0 * p.step + p.offset) * bytes,
+                         mRow, n, mComponents.shift, mComponents.mask);
+                if (bpp == 4)   GreyRow<True>(mRow, dst + y * n * bpp, n, shift);
+                else            GreyRow<False>(mRow, dst + y * n * bpp, n, shift);
+            }
+        }
+
+        output->id          = mSource->id;
+        output->flags       = mSource->flags;
+        output->timecode    = mSource->timecode;
+        output->duration    = mSource->duration;
+        return output;
+    }
+
+    virtual sp<Message> formats() const {
+        sp<Message> formats = new Message;
+        formats->setInt32(kKeyFormat, mFormat);
+        formats->setInt32(kKeyViewPlane, mPlane);
+        return formats;
+    }
+
+    virtual MediaError configure(const sp<Message>& options) {
+        if (options->contains(kKeyViewPlane)) {
+            const UInt32 plane = options->findInt32(kKeyViewPlane);
+            if (plane >= mComponents.count) return kMediaErrorBadParameters;
+            mPlane  = plane;
+            // pull the same frame again in this plane
+            mReady  = !mSource.isNil();
+            return kMediaNoError;
+        }
+        return kMediaErrorNotSupported;
+    }
+
+    virtual MediaError push(const sp<MediaFrame>& input) {
+        if (input.isNil()) return kMediaNoError;    // eos
+
+        const ImageFormat& image = input->image;
+        if (image.format != mInput.format || image.width != mInput.width || image.height != mInput.height) {
+            return kMediaErrorBadParameters;
+        }
+        if (image.rect.x < 0 || image.rect.y < 0 || image.rect.w <= 0 || image.rect.h <= 0 ||
+            image.rect.x + image.rect.w > image.width || image.rect.y + image.rect.h > image.height) {
+            return kMediaErrorBadParameters;
+        }
+
+        // replace the last one, pulled or not
+        mSource = input;
+        mReady  = True;
+        return kMediaNoError;
+    }
+
+    // the view is built here, so planes switched before pull cost nothing
+    virtual sp<MediaFrame> pull() {
+        if (!mReady) return Nil;
+        mReady = False;
+        return prepare();
+    }
+
+    virtual MediaError reset() {
+        mReady = False;
+        mSource.clear();
+        return kMediaNoError;
+    }
+};
+
+sp<MediaDevice> CreateImagePlaneView(const ImageFormat& iformat, const ePixelFormat format, const sp<Message>& options) {
+    sp<ImagePlaneView> view = new ImagePlaneView;
+    if (view->init(iformat, format, options) == kMediaNoError) {
+        return view;
+    }
+    ERROR("no plane view for %s -> %.4s", GetImageFormatString(iformat).c_str(), (const Char *)&format);
+    return Nil;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+MediaDeviceRef ImagePlaneViewCreate(const ImageFormat * iformat, const ePixelFormat format, MessageObjectRef options) {
+    sp<MediaDevice> view = CreateImagePlaneView(*iformat, format, static_cast<Message *>(options));
+    if (view.isNil()) return Nil;
+    return view->RetainObject();
+}
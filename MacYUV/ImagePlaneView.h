@@ -0,0 +1,76 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImagePlaneView.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// view one component of a Y'CbCr frame as a grey image, to see whether a
+// problem is in luma or chroma. the pushed frame is kept, so switching
+// components does not need the frame again.
+//
+
+#ifndef MACYUV_IMAGE_PLANE_VIEW_H
+#define MACYUV_IMAGE_PLANE_VIEW_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaDevice.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeyViewPlane       = FOURCC('vpln'),       ///< UInt32, component to view, 0 - Y', 1 - Cb, 2 - Cr
+};
+
+/**
+ * create a plane view for frames in iformat, output in BGRA or Y800
+ * @param options   kKeyViewPlane, default Y', can be Nil
+ * @note output is the samples of the component in display rect, so
+ *       subsampled chroma is smaller than luma.
+ * @note Y800 of 8-bit component in a plane of its own, e.g. luma of
+ *       planar & semi-planar, is on source planes without copy, with
+ *       display rect as its rect.
+ * @note push keeps the frame and replaces the last one, the view is built
+ *       by pull. configure kKeyViewPlane after push or pull to view
+ *       another component of the same frame, then pull again.
+ */
+API_EXPORT MediaDeviceRef       ImagePlaneViewCreate(const ImageFormat *, const ePixelFormat, MessageObjectRef);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+API_EXPORT sp<MediaDevice> CreateImagePlaneView(const ImageFormat&, const ePixelFormat, const sp<Message>&);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_PLANE_VIEW_H
@@ -0,0 +1,359 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImagePlanner.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// Dijkstra on (pixel format, geometry) states:
+//  source geometry:    input with display rect, crop & scale pending
+//  output geometry:    full frame in output size
+// units & scalers may cross from source to output geometry. only units
+// linked into the app are planned, MediaFramework exports no units.
+// weight of an edge = cost per byte * bytes read & written, where cost per
+// byte is a fixed weight of the unit class, so plans are deterministic.
+// recent plans are cached by formats & geometry.
+//
+
+#define LOG_TAG "ImagePlanner"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "ImagePlanner.h"
+#include "ImageConverter.h"
+#include "ImageScaler.h"
+#include "PixelFormats.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+// all formats may be nodes of a plan
+static const UInt32 kPlanFormats[] = {
+    kPixelFormat420YpCbCrPlanar,
+    kPixelFormat420YpCrCbPlanar,
+    kPixelFormat420YpCbCrSemiPlanar,
+    kPixelFormat420YpCrCbSemiPlanar,
+    kPixelFormat422YpCbCrPlanar,
+    kPixelFormat422YpCrCbPlanar,
+    kPixelFormat422YpCbCr,
+    kPixelFormat422YpCrCb,
+    kPixelFormat422YpCbCrWO,
+    kPixelFormat422YpCrCbWO,
+    kPixelFormat444YpCbCrPlanar,
+    kPixelFormat444YpCrCbPlanar,
+    kPixelFormat444YpCbCr,
+    kPixelFormat420YpCbCr10Planar,
+    kPixelFormatRGB565,
+    kPixelFormatBGR565,
+    kPixelFormatRGB,
+    kPixelFormatBGR,
+    kPixelFormatARGB,
+    kPixelFormatBGRA,
+    kPixelFormatRGBA,
+    kPixelFormatABGR,
+    kPixelFormat420YpCbCr10SemiPlanar,
+    kPixelFormat420YpCbCr16SemiPlanar,
+    kPixelFormat420YpCbCr10PlanarLE,
+    kPixelFormat422YpCbCr10PlanarLE,
+    kPixelFormat444YpCbCr10PlanarLE,
+    kPixelFormat422YpCbCr10,
+    kPixelFormatRGBA64,
+};
+#define NELEM(x)        (sizeof(x) / sizeof(x[0]))
+#define NB_FORMATS      NELEM(kPlanFormats)
+
+// units for one edge
+#define MAX_UNITS       (8)
+
+// cost per byte of unit classes
+#define COST_LOCAL      (1.0)       // SIMD & banded
+#define COST_SCALE      (2.0)       // multi taps per sample
+
+// recent plans, most recent first
+#define MAX_CACHED_PLANS    (16)
+
+static MediaError UnitInit(const MediaUnit * unit, MediaUnitContext instance,
+                           const ImageFormat& in, const ImageFormat& out) {
+    MediaFormat ifmt, ofmt;
+    memset(&ifmt, 0, sizeof(ifmt));
+    memset(&ofmt, 0, sizeof(ofmt));
+    ifmt.image  = in;
+    ofmt.image  = out;
+    return unit->init(instance, &ifmt, &ofmt);
+}
+
+static Bool UnitWorks(const MediaUnit * unit, const ImageFormat& in, const ImageFormat& out) {
+    MediaUnitContext instance = unit->alloc();
+    const MediaError st = UnitInit(unit, instance, in, out);
+    unit->dealloc(instance);
+    return st == kMediaNoError;
+}
+
+struct EdgeUnit {
+    const MediaUnit *   unit;
+    Float64             cost;       // per byte
+};
+
+// find all units for iformat -> oformat
+static UInt32 FindUnits(UInt32 iformat, UInt32 oformat, eScaleFilter filter, EdgeUnit units[MAX_UNITS]) {
+    UInt32 n = 0;
+    if (iformat == oformat) {
+        const MediaUnit * unit = ScaleUnitFind(filter);
+        if (unit) {
+            units[n].unit   = unit;
+            units[n].cost   = COST_SCALE;
+            ++n;
+        }
+        return n;
+    }
+
+    const MediaUnit * unit = ImageUnitFindNext(Nil, (ePixelFormat)iformat, (ePixelFormat)oformat);
+    for (; unit != Nil && n < MAX_UNITS; unit = ImageUnitFindNext(unit, (ePixelFormat)iformat, (ePixelFormat)oformat)) {
+        units[n].unit   = unit;
+        units[n].cost   = COST_LOCAL;
+        ++n;
+    }
+    return n;
+}
+
+struct PlanState {
+    Float64             cost;       // < 0 if not reached
+    Int32               prev;       // previous state
+    const MediaUnit *   unit;       // unit from previous state
+    Bool                done;
+};
+
+// state = format index * 2 + geometry
+#define STATE(i, g)     ((i) * 2 + (g))
+#define SOURCE          (0)
+#define OUTPUT          (1)
+
+struct Planner {
+    ImageFormat         mInput;
+    ImageFormat         mOutput;
+    eScaleFilter        mFilter;
+    Float64             mSource;    // pixels of display rect
+    Float64             mPixels;    // pixels of output
+    PlanState           mStates[NB_FORMATS * 2];
+
+    Planner(const ImageFormat& iformat, const ImageFormat& oformat, eScaleFilter filter) :
+        mInput(iformat), mOutput(oformat), mFilter(filter) {
+        mSource = (Float64)iformat.rect.w * iformat.rect.h;
+        mPixels = (Float64)oformat.width * oformat.height;
+        for (UInt32 i = 0; i < NB_FORMATS * 2; ++i) {
+            mStates[i].cost = -1;
+            mStates[i].prev = -1;
+            mStates[i].unit = Nil;
+            mStates[i].done = False;
+        }
+    }
+
+    // image of a state
+    ImageFormat image(Int32 state) const {
+        if (state % 2 == SOURCE) return mInput;
+
+        const UInt32 format = kPlanFormats[state / 2];
+        ImageFormat image   = mOutput;
+        image.rect.x        = 0;
+        image.rect.y        = 0;
+        image.rect.w        = mOutput.width;
+        image.rect.h        = mOutput.height;
+        if (format != mOutput.format) {
+            image.format    = (ePixelFormat)format;
+            image.matrix    = mInput.matrix;
+        }
+        return image;
+    }
+
+    // cheapest unit for state i -> state j, return its cost or < 0
+    Float64 edge(Int32 i, Int32 j, const MediaUnit *& best) const {
+        const UInt32 iformat = kPlanFormats[i / 2];
+        const UInt32 oformat = kPlanFormats[j / 2];
+        const PixelDescriptor * idesc = GetImagePixelDescriptor((ePixelFormat)iformat);
+        const PixelDescriptor * odesc = GetImagePixelDescriptor((ePixelFormat)oformat);
+        if (idesc == Nil || odesc == Nil) return -1;
+
+        // bytes read & written
+        const Float64 bytes = ((i % 2 == SOURCE ? mSource : mPixels) * idesc->bpp + mPixels * odesc->bpp) / 8;
+
+        const ImageFormat in    = image(i);
+        const ImageFormat out   = image(j);
+        EdgeUnit units[MAX_UNITS];
+        const UInt32 n = FindUnits(iformat, oformat, mFilter, units);
+
+        // units of a class are in order of preference, the first one wins
+        Float64 cost = -1;
+        for (UInt32 k = 0; k < n; ++k) {
+            if (cost >= 0 && units[k].cost * bytes >= cost) continue;
+            if (!UnitWorks(units[k].unit, in, out)) continue;
+            cost    = units[k].cost * bytes;
+            best    = units[k].unit;
+        }
+        return cost;
+    }
+
+    UInt32 plan(ImageHop hops[kImageHopsMax]) {
+        Int32 start = -1, target = -1;
+        for (UInt32 i = 0; i < NB_FORMATS; ++i) {
+            if (kPlanFormats[i] == (UInt32)mInput.format)  start  = i;
+            if (kPlanFormats[i] == (UInt32)mOutput.format) target = i;
+        }
+        if (start < 0 || target < 0) return 0;
+
+        // no crop & scale, start from output geometry
+        const Bool same = mInput.rect.x == 0 && mInput.rect.y == 0 &&
+                          mInput.rect.w == mInput.width && mInput.rect.h == mInput.height &&
+                          mInput.width == mOutput.width && mInput.height == mOutput.height;
+        start   = STATE(start, same ? OUTPUT : SOURCE);
+        target  = STATE(target, OUTPUT);
+        mStates[start].cost = 0;
+
+        for (;;) {
+            Int32 i = -1;
+            for (UInt32 k = 0; k < NB_FORMATS * 2; ++k) {
+                if (mStates[k].done || mStates[k].cost < 0) continue;
+                if (i < 0 || mStates[k].cost < mStates[i].cost) i = k;
+            }
+            if (i < 0 || i == target) break;
+            mStates[i].done = True;
+
+            // source geometry only as start state
+            for (UInt32 k = 0; k < NB_FORMATS; ++k) {
+                const Int32 j = STATE(k, OUTPUT);
+                if (mStates[j].done || j == i) continue;
+
+                const MediaUnit * unit = Nil;
+                const Float64 cost = edge(i, j, unit);
+                if (cost < 0) continue;
+                if (mStates[j].cost < 0 || mStates[i].cost + cost < mStates[j].cost) {
+                    mStates[j].cost = mStates[i].cost + cost;
+                    mStates[j].prev = i;
+                    mStates[j].unit = unit;
+                }
+            }
+        }
+        if (mStates[target].cost < 0) return 0;
+
+        // walk back from target
+        Int32 chain[NB_FORMATS * 2];
+        UInt32 n = 0;
+        for (Int32 j = target; j != start; j = mStates[j].prev) chain[n++] = j;
+        if (n > kImageHopsMax) return 0;
+
+        for (UInt32 k = 0; k < n; ++k) {
+            const Int32 j   = chain[n - 1 - k];
+            hops[k].unit    = mStates[j].unit;
+            hops[k].iformat = image(mStates[j].prev);
+            hops[k].oformat = image(j);
+        }
+        return n;
+    }
+};
+
+struct CachedPlan {
+    ImageFormat         input;
+    ImageFormat         output;
+    eScaleFilter        filter;
+    UInt32              count;      // 0 if no chain exists
+    ImageHop            hops[kImageHopsMax];
+};
+
+static Mutex            gPlanLock;
+static List<CachedPlan> gPlans;
+
+static FORCE_INLINE Bool SameImage(const ImageFormat& a, const ImageFormat& b) {
+    return a.format == b.format && a.matrix == b.matrix &&
+        a.width == b.width && a.height == b.height &&
+        a.rect.x == b.rect.x && a.rect.y == b.rect.y &&
+        a.rect.w == b.rect.w && a.rect.h == b.rect.h;
+}
+
+static Bool FindCachedPlan(const ImageFormat& iformat, const ImageFormat& oformat, eScaleFilter filter,
+                           ImageHop hops[kImageHopsMax], UInt32& count) {
+    AutoLock _l(gPlanLock);
+    List<CachedPlan>::iterator it = gPlans.begin();
+    for (; it != gPlans.end(); ++it) {
+        const CachedPlan& entry = *it;
+        if (entry.filter != filter) continue;
+        if (!SameImage(entry.input, iformat) || !SameImage(entry.output, oformat)) continue;
+
+        count = entry.count;
+        for (UInt32 i = 0; i < count; ++i) hops[i] = entry.hops[i];
+        CachedPlan hit = entry;
+        gPlans.erase(it);
+        gPlans.insert(gPlans.begin(), hit);
+        return True;
+    }
+    return False;
+}
+
+static void CachePlan(const ImageFormat& iformat, const ImageFormat& oformat, eScaleFilter filter,
+                      const ImageHop hops[kImageHopsMax], UInt32 count) {
+    CachedPlan entry;
+    entry.input     = iformat;
+    entry.output    = oformat;
+    entry.filter    = filter;
+    entry.count     = count;
+    for (UInt32 i = 0; i < count; ++i) entry.hops[i] = hops[i];
+
+    AutoLock _l(gPlanLock);
+    gPlans.insert(gPlans.begin(), entry);
+    while (gPlans.size() > MAX_CACHED_PLANS) gPlans.pop_back();
+}
+
+UInt32 PlanImageHops(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options,
+                     ImageHop hops[kImageHopsMax]) {
+    eScaleFilter filter = kScaleFilterDefault;
+    if (!options.isNil() && options->contains(kKeyScaleFilter)) {
+        filter = options->findInt32(kKeyScaleFilter);
+    }
+
+    UInt32 n = 0;
+    if (FindCachedPlan(iformat, oformat, filter, hops, n)) {
+        return n;
+    }
+
+    Planner planner(iformat, oformat, filter);
+    n = planner.plan(hops);
+    CachePlan(iformat, oformat, filter, hops, n);
+    for (UInt32 i = 0; i < n; ++i) {
+        INFO("hop %u: %s, %s -> %s", i, hops[i].unit->name,
+             GetImageFormatString(hops[i].iformat).c_str(),
+             GetImageFormatString(hops[i].oformat).c_str());
+    }
+    return n;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+UInt32 ImagePlannerFind(const ImageFormat * iformat, const ImageFormat * oformat, MessageObjectRef options, ImageHop * hops) {
+    return PlanImageHops(*iformat, *oformat, static_cast<Message *>(options), hops);
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImagePlanner.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// plan a chain of image units for formats without a direct unit. pixel
+// formats are nodes of a graph and every unit is an edge, weighted by bytes
+// it moves and a fixed cost per byte of its class. the cheapest chain wins,
+// and recent chains are cached.
+//
+
+#ifndef MACYUV_IMAGE_PLANNER_H
+#define MACYUV_IMAGE_PLANNER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+#define kImageHopsMax   (4)
+
+/**
+ * one step of a chain, a unit and its formats
+ */
+typedef struct ImageHop {
+    const MediaUnit *   unit;
+    ImageFormat         iformat;
+    ImageFormat         oformat;
+} ImageHop;
+
+/**
+ * plan the cheapest chain of image units for iformat -> oformat
+ * @param options   kKeyScaleFilter, can be Nil
+ * @param hops      at least kImageHopsMax entries
+ * @return return number of hops, 0 if no chain exists
+ * @note crop & scale happen in the first hop, the others work on output size.
+ */
+API_EXPORT UInt32   ImagePlannerFind(const ImageFormat *, const ImageFormat *, MessageObjectRef, ImageHop *);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+API_EXPORT UInt32   PlanImageHops(const ImageFormat&, const ImageFormat&, const sp<Message>&, ImageHop hops[kImageHopsMax]);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_PLANNER_H
@@ -0,0 +1,668 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+
+// File:    ImageRotator.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "ImageRotator"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "ImageRotator.h"
+#include "ImageConverter.h"
+#include "PixelFormats.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+__BEGIN_NAMESPACE_MFWK
+
+// output columns of a strip, their source rows stay in cache
+#define STRIP_SAMPLES   (64)
+// output rows rotated ahead of fused conversion, aligned to any subsampling
+#define CHUNK_ROWS      (16)
+
+static const UInt32 kRotateFormats[] = {
+    kPixelFormat420YpCbCrPlanar,
+    kPixelFormat420YpCrCbPlanar,
+    kPixelFormat422YpCbCrPlanar,
+    kPixelFormat422YpCrCbPlanar,
+    kPixelFormat444YpCbCrPlanar,
+    kPixelFormat444YpCrCbPlanar,
+    kPixelFormat420YpCbCrSemiPlanar,
+    kPixelFormat420YpCrCbSemiPlanar,
+    kPixelFormat420YpCbCr10SemiPlanar,
+    kPixelFormat420YpCbCr16SemiPlanar,
+    kPixelFormat420YpCbCr10PlanarLE,
+    kPixelFormat422YpCbCr10PlanarLE,
+    kPixelFormat444YpCbCr10PlanarLE,
+    kPixelFormatBGRA,
+    kPixelFormatRGBA,
+    kPixelFormatARGB,
+    kPixelFormatABGR,
+    kPixelFormatRGBA64,
+    kPixelFormatUnknown
+};
+
+#pragma mark Kernels
+#if defined(__SSE2__)
+#define ROTATE_SIMD
+typedef __m128i V128;
+
+static FORCE_INLINE V128 Load128(const UInt8 * p)   { return _mm_loadu_si128((const __m128i *)p);    }
+static FORCE_INLINE V128 Load64(const UInt8 * p)    { return _mm_loadl_epi64((const __m128i *)p);    }
+static FORCE_INLINE void Store128(UInt8 * p, V128 v){ _mm_storeu_si128((__m128i *)p, v);             }
+static FORCE_INLINE void Store64(UInt8 * p, V128 v) { _mm_storel_epi64((__m128i *)p, v);             }
+static FORCE_INLINE V128 High64(V128 a)             { return _mm_unpackhi_epi64(a, a);                }
+
+static FORCE_INLINE V128 ZipLo8(V128 a, V128 b)     { return _mm_unpacklo_epi8(a, b);                 }
+static FORCE_INLINE V128 ZipLo16(V128 a, V128 b)    { return _mm_unpacklo_epi16(a, b);                }
+static FORCE_INLINE V128 ZipHi16(V128 a, V128 b)    { return _mm_unpackhi_epi16(a, b);                }
+static FORCE_INLINE V128 ZipLo32(V128 a, V128 b)    { return _mm_unpacklo_epi32(a, b);                }
+static FORCE_INLINE V128 ZipHi32(V128 a, V128 b)    { return _mm_unpackhi_epi32(a, b);                }
+static FORCE_INLINE V128 ZipLo64(V128 a, V128 b)    { return _mm_unpacklo_epi64(a, b);                }
+static FORCE_INLINE V128 ZipHi64(V128 a, V128 b)    { return _mm_unpackhi_epi64(a, b);                }
+
+static FORCE_INLINE V128 Reverse64(V128 a)          { return _mm_shuffle_epi32(a, 0x4E);              }
+static FORCE_INLINE V128 Reverse32(V128 a)          { return _mm_shuffle_epi32(a, 0x1B);              }
+static FORCE_INLINE V128 Reverse16(V128 a) {
+    return Reverse64(_mm_shufflehi_epi16(_mm_shufflelo_epi16(a, 0x1B), 0x1B));
+}
+static FORCE_INLINE V128 Reverse8(V128 a) {
+    a = Reverse16(a);
+    return _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+}
+#elif defined(__aarch64__)
+#define ROTATE_SIMD
+typedef uint8x16_t V128;
+
+#define U16(x)  vreinterpretq_u16_u8(x)
+#define U32(x)  vreinterpretq_u32_u8(x)
+#define U64(x)  vreinterpretq_u64_u8(x)
+
+static FORCE_INLINE V128 Load128(const UInt8 * p)   { return vld1q_u8(p);                                     }
+static FORCE_INLINE V128 Load64(const UInt8 * p)    { return vcombine_u8(vld1_u8(p), vdup_n_u8(0));           }
+static FORCE_INLINE void Store128(UInt8 * p, V128 v){ vst1q_u8(p, v);                                         }
+static FORCE_INLINE void Store64(UInt8 * p, V128 v) { vst1_u8(p, vget_low_u8(v));                             }
+static FORCE_INLINE V128 High64(V128 a)             { return vextq_u8(a, a, 8);                               }
+
+static FORCE_INLINE V128 ZipLo8(V128 a, V128 b)     { return vzip1q_u8(a, b);                                 }
+static FORCE_INLINE V128 ZipLo16(V128 a, V128 b)    { return vreinterpretq_u8_u16(vzip1q_u16(U16(a), U16(b))); }
+static FORCE_INLINE V128 ZipHi16(V128 a, V128 b)    { return vreinterpretq_u8_u16(vzip2q_u16(U16(a), U16(b))); }
+static FORCE_INLINE V128 ZipLo32(V128 a, V128 b)    { return vreinterpretq_u8_u32(vzip1q_u32(U32(a), U32(b))); }
+static FORCE_INLINE V128 ZipHi32(V128 a, V128 b)    { return vreinterpretq_u8_u32(vzip2q_u32(U32(a), U32(b))); }
+static FORCE_INLINE V128 ZipLo64(V128 a, V128 b)    { return vreinterpretq_u8_u64(vzip1q_u64(U64(a), U64(b))); }
+static FORCE_INLINE V128 ZipHi64(V128 a, V128 b)    { return vreinterpretq_u8_u64(vzip2q_u64(U64(a), U64(b))); }
+
+static FORCE_INLINE V128 Reverse64(V128 a)          { return vextq_u8(a, a, 8);                               }
+static FORCE_INLINE V128 Reverse32(V128 a)          { return Reverse64(vreinterpretq_u8_u32(vrev64q_u32(U32(a)))); }
+static FORCE_INLINE V128 Reverse16(V128 a)          { return Reverse64(vreinterpretq_u8_u16(vrev64q_u16(U16(a)))); }
+static FORCE_INLINE V128 Reverse8(V128 a)           { return Reverse64(vrev64q_u8(a));                        }
+#endif
+
+template <UInt32 E> struct Sample;
+template <> struct Sample<1> { typedef UInt8    type; };
+template <> struct Sample<2> { typedef UInt16   type; };
+template <> struct Sample<4> { typedef UInt32   type; };
+template <> struct Sample<8> { typedef UInt64   type; };
+
+template <UInt32 E> static FORCE_INLINE void CopySample(UInt8 * dst, const UInt8 * src) {
+    typedef typename Sample<E>::type T;
+    *(T *)dst = *(const T *)src;
+}
+
+#ifdef ROTATE_SIMD
+template <UInt32 E> static FORCE_INLINE V128 Reverse(V128 a);
+template <> FORCE_INLINE V128 Reverse<1>(V128 a) { return Reverse8(a);  }
+template <> FORCE_INLINE V128 Reverse<2>(V128 a) { return Reverse16(a); }
+template <> FORCE_INLINE V128 Reverse<4>(V128 a) { return Reverse32(a); }
+template <> FORCE_INLINE V128 Reverse<8>(V128 a) { return Reverse64(a); }
+
+// samples in a square block, 8 bytes per row for 8-bit, otherwise 16 bytes
+template <UInt32 E> struct Block { enum { K = E == 1 ? 8 : 16 / E }; };
+
+// transpose K rows of K samples, outs[k] = column k
+template <UInt32 E> static FORCE_INLINE void TransposeBlock(const UInt8 * const ins[], UInt8 * const outs[]);
+
+template <> FORCE_INLINE void TransposeBlock<1>(const UInt8 * const ins[], UInt8 * const outs[]) {
+    const V128 t0 = ZipLo8(Load64(ins[0]), Load64(ins[1]));
+    const V128 t1 = ZipLo8(Load64(ins[2]), Load64(ins[3]));
+    const V128 t2 = ZipLo8(Load64(ins[4]), Load64(ins[5]));
+    const V128 t3 = ZipLo8(Load64(ins[6]), Load64(ins[7]));
+    // 4 rows of column 0-3 & 4-7
+    const V128 u0 = ZipLo16(t0, t1);
+    const V128 u1 = ZipHi16(t0, t1);
+    const V128 u2 = ZipLo16(t2, t3);
+    const V128 u3 = ZipHi16(t2, t3);
+    // 8 rows of 2 columns
+    const V128 v0 = ZipLo32(u0, u2);
+    const V128 v1 = ZipHi32(u0, u2);
+    const V128 v2 = ZipLo32(u1, u3);
+    const V128 v3 = ZipHi32(u1, u3);
+    Store64(outs[0], v0);   Store64(outs[1], High64(v0));
+    Store64(outs[2], v1);   Store64(outs[3], High64(v1));
+    Store64(outs[4], v2);   Store64(outs[5], High64(v2));
+    Store64(outs[6], v3);   Store64(outs[7], High64(v3));
+}
+
+template <> FORCE_INLINE void TransposeBlock<2>(const UInt8 * const ins[], UInt8 * const outs[]) {
+    const V128 r0 = Load128(ins[0]), r1 = Load128(ins[1]), r2 = Load128(ins[2]), r3 = Load128(ins[3]);
+    const V128 r4 = Load128(ins[4]), r5 = Load128(ins[5]), r6 = Load128(ins[6]), r7 = Load128(ins[7]);
+    // 2 rows of column 0-3 & 4-7
+    const V128 t0 = ZipLo16(r0, r1), t1 = ZipHi16(r0, r1);
+    const V128 t2 = ZipLo16(r2, r3), t3 = ZipHi16(r2, r3);
+    const V128 t4 = ZipLo16(r4, r5), t5 = ZipHi16(r4, r5);
+    const V128 t6 = ZipLo16(r6, r7), t7 = ZipHi16(r6, r7);
+    // 4 rows of 2 columns
+    const V128 u0 = ZipLo32(t0, t2), u1 = ZipHi32(t0, t2);
+    const V128 u2 = ZipLo32(t1, t3), u3 = ZipHi32(t1, t3);
+    const V128 u4 = ZipLo32(t4, t6), u5 = ZipHi32(t4, t6);
+    const V128 u6 = ZipLo32(t5, t7), u7 = ZipHi32(t5, t7);
+    Store128(outs[0], ZipLo64(u0, u4));     Store128(outs[1], ZipHi64(u0, u4));
+    Store128(outs[2], ZipLo64(u1, u5));     Store128(outs[3], ZipHi64(u1, u5));
+    Store128(outs[4], ZipLo64(u2, u6));     Store128(outs[5], ZipHi64(u2, u6));
+    Store128(outs[6], ZipLo64(u3, u7));     Store128(outs[7], ZipHi64(u3, u7));
+}
+
+template <> FORCE_INLINE void TransposeBlock<4>(const UInt8 * const ins[], UInt8 * const outs[]) {
+    const V128 r0 = Load128(ins[0]), r1 = Load128(ins[1]), r2 = Load128(ins[2]), r3 = Load128(ins[3]);
+    const V128 t0 = ZipLo32(r0, r1), t1 = ZipHi32(r0, r1);
+    const V128 t2 = ZipLo32(r2, r3), t3 = ZipHi32(r2, r3);
+    Store128(outs[0], ZipLo64(t0, t2));     Store128(outs[1], ZipHi64(t0, t2));
+    Store128(outs[2], ZipLo64(t1, t3));     Store128(outs[3], ZipHi64(t1, t3));
+}
+
+template <> FORCE_INLINE void TransposeBlock<8>(const UInt8 * const ins[], UInt8 * const outs[]) {
+    const V128 r0 = Load128(ins[0]), r1 = Load128(ins[1]);
+    Store128(outs[0], ZipLo64(r0, r1));     Store128(outs[1], ZipHi64(r0, r1));
+}
+#endif // ROTATE_SIMD
+
+// dst = src in reverse order of n samples
+template <UInt32 E> static void ReverseRow(const UInt8 * src, UInt8 * dst, UInt32 n) {
+    const UInt32 bytes = n * E;
+    UInt32 i = 0;
+#ifdef ROTATE_SIMD
+    for (; i + 16 <= bytes; i += 16) {
+        Store128(dst + i, Reverse<E>(Load128(src + bytes - i - 16)));
+    }
+#endif
+    for (; i < bytes; i += E) {
+        CopySample<E>(dst + i, src + bytes - i - E);
+    }
+}
+
+/**
+ * out(x, y) = origin[x * dx + y * dy], with dx = ±stride & dy = ±E.
+ * write rows [first, last), dst points to row first.
+ */
+template <UInt32 E> static void TransposeRows(const UInt8 * origin, Int64 dx, Int64 dy,
+                                              UInt8 * dst, UInt32 dstride, UInt32 width,
+                                              UInt32 first, UInt32 last) {
+    for (UInt32 sx = 0; sx < width; sx += STRIP_SAMPLES) {
+        const UInt32 ex = sx + STRIP_SAMPLES < width ? sx + STRIP_SAMPLES : width;
+        UInt32 y = first;
+#ifdef ROTATE_SIMD
+        const UInt32 K = Block<E>::K;
+        for (; y + K <= last; y += K) {
+            // K samples of an output column are contiguous in input, in
+            // reverse order if dy < 0
+            const Int64 y0 = dy > 0 ? y : y + K - 1;
+            UInt8 * rows[Block<E>::K];
+            for (UInt32 k = 0; k < K; ++k) {
+                rows[k] = dst + ((dy > 0 ? y + k : y + K - 1 - k) - first) * dstride;
+            }
+
+            UInt32 x = sx;
+            for (; x + K <= ex; x += K) {
+                const UInt8 * ins[Block<E>::K];
+                UInt8 * outs[Block<E>::K];
+                for (UInt32 k = 0; k < K; ++k) {
+                    ins[k]  = origin + (x + k) * dx + y0 * dy;
+                    outs[k] = rows[k] + x * E;
+                }
+                TransposeBlock<E>(ins, outs);
+            }
+            for (; x < ex; ++x) {
+                for (UInt32 k = y; k < y + K; ++k) {
+                    CopySample<E>(dst + (k - first) * dstride + x * E, origin + x * dx + k * dy);
+                }
+            }
+        }
+#endif
+        for (; y < last; ++y) {
+            for (UInt32 x = sx; x < ex; ++x) {
+                CopySample<E>(dst + (y - first) * dstride + x * E, origin + x * dx + y * dy);
+            }
+        }
+    }
+}
+
+// out(x, y) = origin[x * dx + y * dy], any dx & dy in ±E or ±stride
+template <UInt32 E> static void TransformRows(const UInt8 * origin, Int64 dx, Int64 dy,
+                                              UInt8 * dst, UInt32 dstride, UInt32 width,
+                                              UInt32 first, UInt32 last) {
+    if (dx == E || dx == -(Int64)E) {
+        for (UInt32 y = first; y < last; ++y) {
+            const UInt8 * src = origin + y * dy;
+            UInt8 * out = dst + (y - first) * dstride;
+            if (dx > 0) {
+                memcpy(out, src, width * E);
+            } else {
+                ReverseRow<E>(src - (width - 1) * E, out, width);
+            }
+        }
+    } else {
+        TransposeRows<E>(origin, dx, dy, dst, dstride, width, first, last);
+    }
+}
+
+#pragma mark Rotate Unit
+struct RotateUnitContext {
+    eRotate             rotate;
+    eFlip               flip;
+    const PixelDescriptor * desc;
+    ImageFormat         iformat;
+    ImageFormat         oformat;
+
+    // fused conversion, rotated chunks in scratch
+    const MediaUnit *   unit;
+    MediaUnitContext    instances[2];   // full chunk & the last chunk of band
+    MediaBufferList4    chunks[2];
+    UInt8 *             scratch;
+
+    RotateUnitContext() : desc(Nil), unit(Nil), scratch(Nil) {
+        instances[0] = instances[1] = Nil;
+    }
+
+    ~RotateUnitContext() { clear(); }
+
+    void clear() {
+        for (UInt32 i = 0; i < 2; ++i) {
+            if (instances[i]) unit->dealloc(instances[i]);
+            instances[i] = Nil;
+        }
+        delete [] scratch;
+        scratch = Nil;
+        unit    = Nil;
+    }
+};
+
+static MediaUnitContext RotateUnitAlloc() {
+    RotateUnitContext * instance = new RotateUnitContext;
+    return instance;
+}
+
+static void RotateUnitDealloc(MediaUnitContext ref) {
+    RotateUnitContext * instance = static_cast<RotateUnitContext *>(ref);
+    delete instance;
+}
+
+static FORCE_INLINE Bool IsTransposed(eRotate rotate) {
+    return rotate == kRotate90 || rotate == kRotate270;
+}
+
+// scratch image of rows output rows
+static FORCE_INLINE ImageFormat ChunkFormat(const ImageFormat& image, ePixelFormat format, UInt32 rows) {
+    ImageFormat chunk   = image;
+    chunk.format        = format;
+    chunk.height        = rows;
+    chunk.rect.x        = 0;
+    chunk.rect.y        = 0;
+    chunk.rect.w        = chunk.width;
+    chunk.rect.h        = rows;
+    return chunk;
+}
+
+static MediaError InitFusedUnit(RotateUnitContext * instance, const MediaUnit * unit) {
+    const ImageFormat& out  = instance->oformat;
+    const ePixelFormat iformat = instance->iformat.format;
+    const UInt32 rows[2]    = { CHUNK_ROWS, (UInt32)out.rect.h % CHUNK_ROWS };
+
+    instance->unit          = unit;
+    instance->scratch       = new UInt8[GetImageBytes(ChunkFormat(out, iformat, CHUNK_ROWS))];
+    for (UInt32 i = 0; i < 2; ++i) {
+        if (rows[i] == 0 || (i == 0 && out.rect.h < CHUNK_ROWS)) continue;
+
+        MediaFormat ifmt, ofmt;
+        ifmt.image  = ChunkFormat(out, iformat, rows[i]);
+        ofmt.image  = ChunkFormat(out, out.format, rows[i]);
+        GetImagePlanes(ifmt.image, instance->scratch, instance->chunks[i]);
+
+        instance->instances[i] = unit->alloc();
+        MediaError st = unit->init(instance->instances[i], &ifmt, &ofmt);
+        if (st != kMediaNoError) return st;
+    }
+    return kMediaNoError;
+}
+
+static MediaError RotateUnitInit(MediaUnitContext ref, eRotate rotate, eFlip flip,
+                                 const MediaFormat * iformat, const MediaFormat * oformat) {
+    RotateUnitContext * instance = static_cast<RotateUnitContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+    instance->clear();
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // no scaling, output rect selects the rows to produce
+    const Bool transposed = IsTransposed(rotate);
+    if (out.width != (transposed ? in.rect.h : in.rect.w) ||
+        out.height != (transposed ? in.rect.w : in.rect.h) ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    const PixelDescriptor * desc = GetImagePixelDescriptor(in.format);
+    if (desc == Nil || desc->nb_planes > 3) {
+        return kMediaErrorNotSupported;
+    }
+    // macro pixels can not be split
+    if (desc->color == kColorYpCbCr && desc->nb_planes == 1) {
+        return kMediaErrorNotSupported;
+    }
+
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        const UInt32 hss = desc->planes[i].hss;
+        const UInt32 vss = desc->planes[i].vss;
+        if (desc->planes[i].bpp % 8 || desc->planes[i].bpp > 64) {
+            return kMediaErrorNotSupported;
+        }
+        // 4:2:2 becomes 4:4:0 when transposed
+        if (transposed && hss != vss) {
+            return kMediaErrorNotSupported;
+        }
+        if (in.rect.x % hss || in.rect.y % vss || out.rect.y % vss) {
+            return kMediaErrorNotSupported;
+        }
+    }
+
+    instance->rotate    = rotate;
+    instance->flip      = flip;
+    instance->desc      = desc;
+    instance->iformat   = in;
+    instance->oformat   = out;
+
+    if (in.format != out.format) {
+        const MediaUnit * unit = ImageUnitFindNext(Nil, in.format, out.format);
+        for (; unit != Nil; unit = ImageUnitFindNext(unit, in.format, out.format)) {
+            if (InitFusedUnit(instance, unit) == kMediaNoError) break;
+            instance->clear();
+        }
+        if (unit == Nil) {
+            return kMediaErrorNotSupported;
+        }
+    }
+
+    DEBUG("%s -> %s, rotate %#x, flip %u, %s",
+          GetImageFormatString(in).c_str(),
+          GetImageFormatString(out).c_str(),
+          rotate, flip,
+          instance->unit ? instance->unit->name : "no conversion");
+    return kMediaNoError;
+}
+
+// rows [first, last) of rotated plane i
+static void RotatePlane(const RotateUnitContext * instance, UInt32 i, const UInt8 * src, UInt32 istride,
+                        UInt8 * dst, UInt32 dstride, UInt32 first, UInt32 last) {
+    const PixelDescriptor * desc    = instance->desc;
+    const ImageFormat& in           = instance->iformat;
+    const UInt32 E                  = desc->planes[i].bpp / 8;
+    const Int32 hss                 = desc->planes[i].hss;
+    const Int32 vss                 = desc->planes[i].vss;
+
+    // display rect in samples
+    const Int32 x0  = in.rect.x / hss;
+    const Int32 y0  = in.rect.y / vss;
+    const Int32 w   = (in.rect.x + in.rect.w + hss - 1) / hss - x0;
+    const Int32 h   = (in.rect.y + in.rect.h + vss - 1) / vss - y0;
+
+    // flip in input space first
+    const UInt8 * origin = src + y0 * istride + x0 * E;
+    Int64 ex = E, ey = istride;
+    if (instance->flip & kFlipHorizontal) {
+        origin += (w - 1) * ex;
+        ex = -ex;
+    }
+    if (instance->flip & kFlipVertical) {
+        origin += (h - 1) * ey;
+        ey = -ey;
+    }
+
+    // then clockwise rotation
+    Int64 dx = ex, dy = ey;
+    switch (instance->rotate) {
+        case kRotate90:
+            origin += (h - 1) * ey;
+            dx = -ey;
+            dy = ex;
+            break;
+        case kRotate180:
+            origin += (w - 1) * ex + (h - 1) * ey;
+            dx = -ex;
+            dy = -ey;
+            break;
+        case kRotate270:
+            origin += (w - 1) * ex;
+            dx = ey;
+            dy = -ex;
+            break;
+        default:
+            break;
+    }
+
+    const UInt32 width = IsTransposed(instance->rotate) ? h : w;
+    switch (E) {
+        case 1: TransformRows<1>(origin, dx, dy, dst, dstride, width, first, last); break;
+        case 2: TransformRows<2>(origin, dx, dy, dst, dstride, width, first, last); break;
+        case 4: TransformRows<4>(origin, dx, dy, dst, dstride, width, first, last); break;
+        case 8: TransformRows<8>(origin, dx, dy, dst, dstride, width, first, last); break;
+        default: break;
+    }
+}
+
+// plane rows of output rows [y, y + n)
+static FORCE_INLINE void PlaneRows(const PixelDescriptor * desc, UInt32 i, const ImageFormat& out,
+                                   UInt32 y, UInt32 n, UInt32& first, UInt32& last) {
+    const UInt32 vss    = desc->planes[i].vss;
+    const UInt32 rows   = GetPlaneRows(desc, i, out.height);
+    first   = y / vss;
+    last    = (y + n + vss - 1) / vss;
+    if (last > rows) last = rows;
+}
+
+static MediaError RotateUnitProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    RotateUnitContext * instance = static_cast<RotateUnitContext *>(ref);
+    const PixelDescriptor * desc    = instance->desc;
+    const ImageFormat& in           = instance->iformat;
+    const ImageFormat& out          = instance->oformat;
+
+    UInt8 * src[4], * dst[4];
+    UInt32 istrides[4], ostrides[4];
+    if (GetImagePlaneData(in, input, False, src, istrides) != kMediaNoError ||
+        GetImagePlaneData(out, output, True, dst, ostrides) != kMediaNoError) {
+        return kMediaErrorBadParameters;
+    }
+
+    if (instance->unit == Nil) {
+        for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+            UInt32 first, last;
+            PlaneRows(desc, i, out, out.rect.y, out.rect.h, first, last);
+            RotatePlane(instance, i, src[i], istrides[i],
+                        dst[i] + first * ostrides[i], ostrides[i], first, last);
+        }
+        SetImagePlaneSizes(out, output);
+        return kMediaNoError;
+    }
+
+    // rotate a chunk into scratch, then convert it into output rows
+    const PixelDescriptor * odesc = GetImagePixelDescriptor(out.format);
+    const UInt32 end = out.rect.y + out.rect.h;
+    for (UInt32 y = out.rect.y; y < end; y += CHUNK_ROWS) {
+        const UInt32 n = end - y < CHUNK_ROWS ? end - y : CHUNK_ROWS;
+        const UInt32 k = n == CHUNK_ROWS ? 0 : 1;
+        MediaBufferList4& chunk = instance->chunks[k];
+
+        for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+            UInt32 first, last;
+            PlaneRows(desc, i, out, y, n, first, last);
+            RotatePlane(instance, i, src[i], istrides[i], chunk.buffers[i].data,
+                        GetPlaneStride(desc, i, out.width), first, last);
+        }
+
+        MediaBufferList4 rows;
+        rows.list.count = odesc->nb_planes;
+        for (UInt32 i = 0; i < odesc->nb_planes; ++i) {
+            UInt32 first, last;
+            PlaneRows(odesc, i, out, y, n, first, last);
+            rows.buffers[i].data        = dst[i] + first * ostrides[i];
+            rows.buffers[i].capacity    = (last - first) * ostrides[i];
+            rows.buffers[i].size        = 0;
+        }
+
+        MediaError st = instance->unit->process(instance->instances[k], &chunk.list, &rows.list);
+        if (st != kMediaNoError) return st;
+    }
+    SetImagePlaneSizes(out, output);
+    return kMediaNoError;
+}
+
+static MediaError RotateUnitReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+// one unit per distinct transform, flip is applied before rotation
+#define ROTATE_UNIT(NAME, ROTATE, FLIP)                                                 \
+static MediaError RotateUnitInit##NAME(MediaUnitContext ref,                            \
+                                       const MediaFormat * iformat,                     \
+                                       const MediaFormat * oformat) {                   \
+    return RotateUnitInit(ref, ROTATE, FLIP, iformat, oformat);                         \
+}                                                                                       \
+static const MediaUnit kRotateUnit##NAME = {                                            \
+    "rotate." #NAME,                                                                    \
+    0,                                                                                  \
+    kRotateFormats,                                                                     \
+    kRotateFormats,                                                                     \
+    RotateUnitAlloc,                                                                    \
+    RotateUnitDealloc,                                                                  \
+    RotateUnitInit##NAME,                                                               \
+    RotateUnitProcess,                                                                  \
+    Nil,                                                                                \
+    RotateUnitReset,                                                                    \
+};
+
+ROTATE_UNIT(R90,        kRotate90,  kFlipNone)
+ROTATE_UNIT(R180,       kRotate180, kFlipNone)
+ROTATE_UNIT(R270,       kRotate270, kFlipNone)
+ROTATE_UNIT(FlipH,      kRotate0,   kFlipHorizontal)
+ROTATE_UNIT(FlipV,      kRotate0,   kFlipVertical)
+ROTATE_UNIT(Transpose,  kRotate90,  kFlipVertical)      // out(x, y) = in(y, x)
+ROTATE_UNIT(Transverse, kRotate90,  kFlipHorizontal)
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+const MediaUnit * RotateUnitFind(const eRotate rotate, const eFlip flip) {
+    // quarter turns, a flip in both directions is a half turn
+    UInt32 turns;
+    switch (rotate) {
+        case kRotate0:      turns = 0; break;
+        case kRotate90:     turns = 1; break;
+        case kRotate180:    turns = 2; break;
+        case kRotate270:    turns = 3; break;
+        default:            return Nil;
+    }
+    if (flip & ~(kFlipHorizontal | kFlipVertical)) return Nil;
+
+    eFlip mirror = flip;
+    if (mirror == (kFlipHorizontal | kFlipVertical)) {
+        mirror = kFlipNone;
+        turns += 2;
+    }
+    // a half turn after a flip is the other flip
+    if (mirror != kFlipNone && turns >= 2) {
+        mirror = mirror == kFlipHorizontal ? kFlipVertical : kFlipHorizontal;
+        turns -= 2;
+    }
+
+    switch (turns % 4) {
+        case 0:
+            if (mirror == kFlipHorizontal)  return &kRotateUnitFlipH;
+            if (mirror == kFlipVertical)    return &kRotateUnitFlipV;
+            return Nil;
+        case 1:
+            if (mirror == kFlipHorizontal)  return &kRotateUnitTransverse;
+            if (mirror == kFlipVertical)    return &kRotateUnitTranspose;
+            return &kRotateUnitR90;
+        case 2:
+            return &kRotateUnitR180;
+        default:
+            return &kRotateUnitR270;
+    }
+}
+
+__BEGIN_NAMESPACE_MFWK
+
+sp<MediaDevice> CreateImageRotator(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+    eRotate rotate  = kRotate0;
+    eFlip flip      = kFlipNone;
+    if (!options.isNil()) {
+        if (options->contains(kKeyRotate))  rotate = options->findInt32(kKeyRotate);
+        if (options->contains(kKeyFlip))    flip = options->findInt32(kKeyFlip);
+    }
+
+    const MediaUnit * unit = RotateUnitFind(rotate, flip);
+    if (unit == Nil) {
+        if (rotate == kRotate0 && flip == kFlipNone) {
+            return CreateImageConverter(iformat, oformat, options);
+        }
+        ERROR("rotate %#x flip %u is not supported", rotate, flip);
+        return Nil;
+    }
+    return CreateImageDevice(unit, iformat, oformat, options);
+}
+
+__END_NAMESPACE_MFWK
+
+MediaDeviceRef ImageRotatorCreate(const ImageFormat * iformat, const ImageFormat * oformat, MessageObjectRef options) {
+    sp<MediaDevice> rotator = CreateImageRotator(*iformat, *oformat, static_cast<Message *>(options));
+    if (rotator.isNil()) return Nil;
+    return rotator->RetainObject();
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+
+// File:    ImageRotator.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// rotate & flip images plane by plane, with blocked transposes. conversion
+// to another pixel format is fused, rotated rows are converted while they
+// are still in cache.
+//
+
+#ifndef MACYUV_IMAGE_ROTATOR_H
+#define MACYUV_IMAGE_ROTATOR_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+#include <MediaFramework/MediaDevice.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeyFlip            = FOURCC('flip'),       ///< UInt32, @see eFlip
+};
+
+enum {
+    kFlipNone           = 0,
+    kFlipHorizontal     = (1<<0),               ///< mirror left & right
+    kFlipVertical       = (1<<1),               ///< mirror top & bottom
+};
+typedef UInt32 eFlip;
+
+/**
+ * get rotate unit, flip is applied before clockwise rotation.
+ * @return return Nil if nothing to do or parameters are bad
+ * @note input display rect is rotated to output of the same or any pixel
+ *       format there is an image unit for. 4:2:2 & packed Y'CbCr can not
+ *       be transposed.
+ */
+API_EXPORT const MediaUnit *    RotateUnitFind(const eRotate, const eFlip);
+
+/**
+ * create an image rotator
+ * @param options   kKeyRotate & kKeyFlip & kKeyCount(threads)
+ * @note output size MUST be display rect rotated, no scaling.
+ */
+API_EXPORT MediaDeviceRef       ImageRotatorCreate(const ImageFormat *, const ImageFormat *, MessageObjectRef);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+API_EXPORT sp<MediaDevice> CreateImageRotator(const ImageFormat&, const ImageFormat&, const sp<Message>&);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_ROTATOR_H
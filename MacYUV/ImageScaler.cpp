@@ -0,0 +1,604 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageScaler.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// separable filters with precomputed coefficients for each output column
+// and row. source rows are filtered horizontally once into a ring of Q6
+// lines, and each output row is a vertical filter over the ring:
+//  H   = (sum(src * Kh) + 128) >> 8            // Q14 coefficients -> Q6
+//  out = (sum(H * Kv) + (1 << 19)) >> 20       // Q6 * Q14 -> Q0
+// both passes are SIMD (pmaddwd/vmlal) and bit-exact with C, the
+// horizontal one for planes of 1 & 4 channels.
+//
+
+#define LOG_TAG "ImageScaler"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <math.h>
+#include <string.h>
+
+#include "ImageScaler.h"
+#include "ImageConverter.h"
+#include "PixelFormats.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+__BEGIN_NAMESPACE_MFWK
+
+#define COEFF_BITS      (14)
+#define COEFF_ONE       (1 << COEFF_BITS)
+#define LINE_SHIFT      (8)                         // Q14 -> Q6
+#define OUT_SHIFT       (2 * COEFF_BITS - LINE_SHIFT)
+
+static const UInt32 kScaleFormats[] = {
+    kPixelFormat420YpCbCrPlanar,
+    kPixelFormat420YpCrCbPlanar,
+    kPixelFormat422YpCbCrPlanar,
+    kPixelFormat422YpCrCbPlanar,
+    kPixelFormat444YpCbCrPlanar,
+    kPixelFormat444YpCrCbPlanar,
+    kPixelFormat420YpCbCrSemiPlanar,
+    kPixelFormat420YpCrCbSemiPlanar,
+    kPixelFormatBGRA,
+    kPixelFormatRGBA,
+    kPixelFormatARGB,
+    kPixelFormatABGR,
+    kPixelFormatRGB,
+    kPixelFormatBGR,
+    kPixelFormatUnknown
+};
+
+#pragma mark Filters
+static Float64 Sinc(Float64 x) {
+    if (x == 0) return 1.0;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static Float64 FilterRadius(eScaleFilter filter) {
+    switch (filter) {
+        case kScaleFilterBilinear:  return 1.0;
+        case kScaleFilterBicubic:   return 2.0;
+        case kScaleFilterLanczos:   return 3.0;
+        default:                    return 0;
+    }
+}
+
+static Float64 FilterWeight(eScaleFilter filter, Float64 x) {
+    x = fabs(x);
+    switch (filter) {
+        case kScaleFilterBilinear:
+            return x < 1.0 ? 1.0 - x : 0;
+        case kScaleFilterBicubic:
+            // Catmull-Rom, a = -0.5
+            if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+            if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+            return 0;
+        case kScaleFilterLanczos:
+            return x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0;
+        default:
+            return 0;
+    }
+}
+
+// coefficients in one direction
+struct ScaleFilter {
+    Int32               taps;
+    Int32 *             starts;     // first source sample of each output
+    Int16 *             coeffs;     // taps coefficients of each output, Q14
+
+    ScaleFilter() : taps(0), starts(Nil), coeffs(Nil) { }
+    ~ScaleFilter() { clear(); }
+
+    void clear() {
+        delete [] starts;
+        delete [] coeffs;
+        starts  = Nil;
+        coeffs  = Nil;
+        taps    = 0;
+    }
+};
+
+/**
+ * build filter for n outputs from source display range [start, start + length)
+ * @param first     first source sample can be used
+ * @param last      last source sample can be used
+ */
+static void InitScaleFilter(ScaleFilter& s, eScaleFilter filter, Int32 n,
+                            Float64 start, Float64 length, Int32 first, Int32 last) {
+    s.clear();
+
+    const Float64 scale     = length / n;
+    const Float64 stretch   = scale > 1.0 ? scale : 1.0;    // widen filter when downscaling
+    const Float64 support   = FilterRadius(filter) * stretch;
+    Int32 taps = (Int32)ceil(support) * 2;
+    if (taps > last - first + 1) taps = last - first + 1;
+
+    s.taps      = taps;
+    s.starts    = new Int32[n];
+    s.coeffs    = new Int16[n * taps];
+
+    Float64 * weights = new Float64[taps];
+    for (Int32 i = 0; i < n; ++i) {
+        const Float64 center = start + (i + 0.5) * scale - 0.5;
+        const Int32 left = (Int32)floor(center - support) + 1;
+
+        // fold samples outside [first, last] to the edges
+        Int32 pos = left;
+        if (pos + taps - 1 > last) pos = last - taps + 1;
+        if (pos < first) pos = first;
+
+        for (Int32 k = 0; k < taps; ++k) weights[k] = 0;
+        Float64 sum = 0;
+        for (Int32 k = 0; k < (Int32)ceil(support) * 2; ++k) {
+            const Int32 x = left + k;
+            const Float64 w = FilterWeight(filter, (x - center) / stretch);
+            const Int32 j = (x < first ? first : (x > last ? last : x)) - pos;
+            weights[j] += w;
+            sum += w;
+        }
+
+        // normalize to Q14, put rounding error on the largest tap
+        Int16 * coeffs = s.coeffs + i * taps;
+        Int32 total = 0, largest = 0;
+        for (Int32 k = 0; k < taps; ++k) {
+            coeffs[k] = (Int16)lrint(weights[k] / sum * COEFF_ONE);
+            total += coeffs[k];
+            if (coeffs[k] > coeffs[largest]) largest = k;
+        }
+        coeffs[largest] += COEFF_ONE - total;
+        s.starts[i] = pos;
+    }
+    delete [] weights;
+}
+
+#pragma mark Row Kernels
+// outputs [i, n) of source row -> Q6 line, channels interleaved samples
+static void ScaleLine_C(const UInt8 * src, Int16 * dst, UInt32 channels, const ScaleFilter& s, UInt32 i, UInt32 n) {
+    const Int32 taps = s.taps;
+    for (; i < n; ++i) {
+        const UInt8 * p     = src + s.starts[i] * channels;
+        const Int16 * c     = s.coeffs + i * taps;
+        for (UInt32 ch = 0; ch < channels; ++ch) {
+            Int32 acc = 0;
+            for (Int32 k = 0; k < taps; ++k) {
+                acc += p[k * channels + ch] * c[k];
+            }
+            dst[i * channels + ch] = (acc + (1 << (LINE_SHIFT - 1))) >> LINE_SHIFT;
+        }
+    }
+}
+
+// SIMD for planes of 1 & 4 channels, Y'/Cb/Cr & RGBA, bit-exact with C.
+// Q6 lines never overflow Int16, so saturating packs are exact.
+// reads never go past the last tap, which may be the end of the row.
+#if defined(__SSE2__)
+// 4 outputs at a time, pmaddwd on two taps of each output
+static UInt32 ScaleLine1_SSE2(const UInt8 * src, Int16 * dst, const ScaleFilter& s, UInt32 n) {
+    const Int32 taps = s.taps;
+    const __m128i round = _mm_set1_epi32(1 << (LINE_SHIFT - 1));
+    UInt32 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const UInt8 * p[4];
+        const Int16 * c[4];
+        for (UInt32 j = 0; j < 4; ++j) {
+            p[j] = src + s.starts[i + j];
+            c[j] = s.coeffs + (i + j) * taps;
+        }
+        __m128i acc = round;
+        Int32 k = 0;
+        for (; k + 2 <= taps; k += 2) {
+            const __m128i a = _mm_set_epi32(p[3][k] | (p[3][k + 1] << 16), p[2][k] | (p[2][k + 1] << 16),
+                                            p[1][k] | (p[1][k + 1] << 16), p[0][k] | (p[0][k + 1] << 16));
+            const __m128i b = _mm_set_epi16(c[3][k + 1], c[3][k], c[2][k + 1], c[2][k],
+                                            c[1][k + 1], c[1][k], c[0][k + 1], c[0][k]);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(a, b));
+        }
+        if (k < taps) {
+            const __m128i a = _mm_set_epi32(p[3][k], p[2][k], p[1][k], p[0][k]);
+            const __m128i b = _mm_set_epi32((UInt16)c[3][k], (UInt16)c[2][k], (UInt16)c[1][k], (UInt16)c[0][k]);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(a, b));
+        }
+        acc = _mm_srai_epi32(acc, LINE_SHIFT);
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packs_epi32(acc, acc));
+    }
+    return i;
+}
+
+// one pixel at a time, pmaddwd on two taps of each channel
+static UInt32 ScaleLine4_SSE2(const UInt8 * src, Int16 * dst, const ScaleFilter& s, UInt32 n) {
+    const Int32 taps = s.taps;
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (LINE_SHIFT - 1));
+    for (UInt32 i = 0; i < n; ++i) {
+        const UInt8 * p = src + s.starts[i] * 4;
+        const Int16 * c = s.coeffs + i * taps;
+        __m128i acc = round;
+        Int32 k = 0;
+        for (; k + 2 <= taps; k += 2) {
+            // rgba rgba -> rr gg bb aa
+            const __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p + k * 4)), zero);
+            const __m128i b = _mm_unpacklo_epi16(a, _mm_srli_si128(a, 8));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(b, _mm_set1_epi32((UInt16)c[k] | ((UInt32)(UInt16)c[k + 1] << 16))));
+        }
+        if (k < taps) {
+            UInt32 v;
+            memcpy(&v, p + k * 4, 4);
+            const __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero);
+            const __m128i b = _mm_unpacklo_epi16(a, zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(b, _mm_set1_epi32((UInt16)c[k])));
+        }
+        acc = _mm_srai_epi32(acc, LINE_SHIFT);
+        _mm_storel_epi64((__m128i *)(dst + i * 4), _mm_packs_epi32(acc, acc));
+    }
+    return n;
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+// 4 outputs at a time, vmlal on one tap of each output
+static UInt32 ScaleLine1_NEON(const UInt8 * src, Int16 * dst, const ScaleFilter& s, UInt32 n) {
+    const Int32 taps = s.taps;
+    UInt32 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const UInt8 * p[4];
+        const Int16 * c[4];
+        for (UInt32 j = 0; j < 4; ++j) {
+            p[j] = src + s.starts[i + j];
+            c[j] = s.coeffs + (i + j) * taps;
+        }
+        int32x4_t acc = vdupq_n_s32(1 << (LINE_SHIFT - 1));
+        for (Int32 k = 0; k < taps; ++k) {
+            const Int16 a[4] = { p[0][k], p[1][k], p[2][k], p[3][k] };
+            const Int16 b[4] = { c[0][k], c[1][k], c[2][k], c[3][k] };
+            acc = vmlal_s16(acc, vld1_s16(a), vld1_s16(b));
+        }
+        vst1_s16(dst + i, vqmovn_s32(vshrq_n_s32(acc, LINE_SHIFT)));
+    }
+    return i;
+}
+
+// one pixel at a time, vmlal on one tap of all channels
+static UInt32 ScaleLine4_NEON(const UInt8 * src, Int16 * dst, const ScaleFilter& s, UInt32 n) {
+    const Int32 taps = s.taps;
+    for (UInt32 i = 0; i < n; ++i) {
+        const UInt8 * p = src + s.starts[i] * 4;
+        const Int16 * c = s.coeffs + i * taps;
+        int32x4_t acc = vdupq_n_s32(1 << (LINE_SHIFT - 1));
+        for (Int32 k = 0; k < taps; ++k) {
+            UInt32 v;
+            memcpy(&v, p + k * 4, 4);
+            const int16x4_t a = vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(v)))));
+            acc = vmlal_n_s16(acc, a, c[k]);
+        }
+        vst1_s16(dst + i * 4, vqmovn_s32(vshrq_n_s32(acc, LINE_SHIFT)));
+    }
+    return n;
+}
+#endif
+
+// source row -> Q6 line of n outputs
+static void ScaleLine(const UInt8 * src, Int16 * dst, UInt32 channels, const ScaleFilter& s, UInt32 n) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    if (channels == 1)      i = ScaleLine1_SSE2(src, dst, s, n);
+    else if (channels == 4) i = ScaleLine4_SSE2(src, dst, s, n);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    if (channels == 1)      i = ScaleLine1_NEON(src, dst, s, n);
+    else if (channels == 4) i = ScaleLine4_NEON(src, dst, s, n);
+#endif
+    if (i < n) ScaleLine_C(src, dst, channels, s, i, n);
+}
+
+static FORCE_INLINE UInt8 ScaleClamp(Int32 x) {
+    return x < 0 ? 0 : (x > 255 ? 255 : x);
+}
+
+// samples [i, n) of lines
+static void FilterRows_C(const Int16 * const lines[], const Int16 * coeffs, Int32 taps, UInt8 * dst, UInt32 i, UInt32 n) {
+    for (; i < n; ++i) {
+        Int32 acc = 0;
+        for (Int32 k = 0; k < taps; ++k) {
+            acc += lines[k][i] * coeffs[k];
+        }
+        dst[i] = ScaleClamp((acc + (1 << (OUT_SHIFT - 1))) >> OUT_SHIFT);
+    }
+}
+
+// vertical filter over taps lines -> n samples
+static void FilterRows(const Int16 * const lines[], const Int16 * coeffs, Int32 taps, UInt8 * dst, UInt32 n) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    const __m128i round = _mm_set1_epi32(1 << (OUT_SHIFT - 1));
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo = round, hi = round;
+        for (Int32 k = 0; k < taps; k += 2) {
+            // two lines at a time with pmaddwd, the odd tap pairs with zero
+            const __m128i a = _mm_loadu_si128((const __m128i *)(lines[k] + i));
+            const __m128i b = k + 1 < taps ? _mm_loadu_si128((const __m128i *)(lines[k + 1] + i)) : _mm_setzero_si128();
+            const __m128i c = _mm_set1_epi32((UInt16)coeffs[k] | ((k + 1 < taps ? (UInt32)(UInt16)coeffs[k + 1] : 0) << 16));
+            lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), c));
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), c));
+        }
+        lo = _mm_srai_epi32(lo, OUT_SHIFT);
+        hi = _mm_srai_epi32(hi, OUT_SHIFT);
+        const __m128i v = _mm_packs_epi32(lo, hi);
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(v, v));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; i + 8 <= n; i += 8) {
+        int32x4_t lo = vdupq_n_s32(1 << (OUT_SHIFT - 1));
+        int32x4_t hi = lo;
+        for (Int32 k = 0; k < taps; ++k) {
+            const int16x8_t a = vld1q_s16(lines[k] + i);
+            lo = vmlal_n_s16(lo, vget_low_s16(a), coeffs[k]);
+            hi = vmlal_n_s16(hi, vget_high_s16(a), coeffs[k]);
+        }
+        const int16x8_t v = vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, OUT_SHIFT)),
+                                         vqmovn_s32(vshrq_n_s32(hi, OUT_SHIFT)));
+        vst1_u8(dst + i, vqmovun_s16(v));
+    }
+#endif
+    if (i < n) FilterRows_C(lines, coeffs, taps, dst, i, n);
+}
+
+#pragma mark Scale Unit
+struct ScalePlane {
+    UInt32              channels;   // interleaved samples, CbCr = 2, RGBA = 4
+    UInt32              hss;        // in samples
+    UInt32              vss;
+    UInt32              istride;
+    UInt32              ostride;
+    Int32               width;      // output samples per row
+    ScaleFilter         h;
+    ScaleFilter         v;
+    Int16 *             ring;       // v.taps lines, width * channels each
+    Int32 *             rows;       // source row of each line
+    const Int16 **      lines;      // lines of current output row
+
+    ScalePlane() : ring(Nil), rows(Nil), lines(Nil) { }
+    ~ScalePlane() { clear(); }
+
+    void clear() {
+        h.clear();
+        v.clear();
+        delete [] ring;
+        delete [] rows;
+        delete [] lines;
+        ring    = Nil;
+        rows    = Nil;
+        lines   = Nil;
+    }
+};
+
+struct ScaleUnitContext {
+    eScaleFilter        filter;
+    const PixelDescriptor * desc;
+    ImageFormat         iformat;
+    ImageFormat         oformat;
+    ScalePlane          planes[3];
+};
+
+static MediaUnitContext ScaleUnitAlloc() {
+    ScaleUnitContext * instance = new ScaleUnitContext;
+    return instance;
+}
+
+static void ScaleUnitDealloc(MediaUnitContext ref) {
+    ScaleUnitContext * instance = static_cast<ScaleUnitContext *>(ref);
+    delete instance;
+}
+
+static MediaError ScaleUnitInit(MediaUnitContext ref, eScaleFilter filter,
+                                const MediaFormat * iformat, const MediaFormat * oformat) {
+    ScaleUnitContext * instance = static_cast<ScaleUnitContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    if (in.format != out.format) {
+        return kMediaErrorNotSupported;
+    }
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // output rect selects the rows to produce
+    if (out.width <= 0 || out.height <= 0 || out.rect.x != 0 || out.rect.w != out.width ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    const PixelDescriptor * desc = GetImagePixelDescriptor(in.format);
+    if (desc == Nil || desc->nb_planes > 3) {
+        return kMediaErrorNotSupported;
+    }
+
+    // any width & height, but bands MUST be aligned to chroma rows
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        if ((out.rect.y % desc->planes[i].vss) || (desc->planes[i].bpp % 8)) {
+            return kMediaErrorNotSupported;
+        }
+    }
+
+    instance->filter    = filter;
+    instance->desc      = desc;
+    instance->iformat   = in;
+    instance->oformat   = out;
+
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        ScalePlane& p   = instance->planes[i];
+        p.clear();
+        // samples are bytes, CbCr pair of semi-planar is 2 channels of one sample
+        p.channels      = desc->planes[i].bpp / 8;
+        p.hss           = desc->planes[i].hss;
+        p.vss           = desc->planes[i].vss;
+        p.istride       = GetPlaneStride(desc, i, in.width);
+        p.ostride       = GetPlaneStride(desc, i, out.width);
+        p.width         = p.ostride / p.channels;
+
+        const Int32 iw  = p.istride / p.channels;
+        const Int32 ih  = GetPlaneRows(desc, i, in.height);
+        const Int32 x0  = in.rect.x / p.hss;
+        const Int32 x1  = (in.rect.x + in.rect.w + p.hss - 1) / p.hss - 1;
+        const Int32 y0  = in.rect.y / p.vss;
+        const Int32 y1  = (in.rect.y + in.rect.h + p.vss - 1) / p.vss - 1;
+        // lengths in samples the plane holds, so identity passes through
+        // odd size subsampled planes unchanged
+        InitScaleFilter(p.h, filter, p.width,
+                        x0, x1 - x0 + 1,
+                        x0, x1 < iw ? x1 : iw - 1);
+        InitScaleFilter(p.v, filter, GetPlaneRows(desc, i, out.height),
+                        y0, y1 - y0 + 1,
+                        y0, y1 < ih ? y1 : ih - 1);
+
+        p.ring          = new Int16[p.v.taps * p.width * p.channels];
+        p.rows          = new Int32[p.v.taps];
+        p.lines         = new const Int16 * [p.v.taps];
+    }
+
+    DEBUG("%s -> %s, taps %d x %d",
+          GetImageFormatString(in).c_str(),
+          GetImageFormatString(out).c_str(),
+          instance->planes[0].h.taps, instance->planes[0].v.taps);
+    return kMediaNoError;
+}
+
+static MediaError ScaleUnitProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    ScaleUnitContext * instance = static_cast<ScaleUnitContext *>(ref);
+    const PixelDescriptor * desc    = instance->desc;
+    const ImageFormat& in           = instance->iformat;
+    const ImageFormat& out          = instance->oformat;
+
+    UInt8 * src[4], * dst[4];
+    UInt32 istrides[4], ostrides[4];
+    if (GetImagePlaneData(in, input, False, src, istrides) != kMediaNoError ||
+        GetImagePlaneData(out, output, True, dst, ostrides) != kMediaNoError) {
+        return kMediaErrorBadParameters;
+    }
+
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        ScalePlane& p = instance->planes[i];
+
+        // new frame, drop cached lines
+        for (Int32 k = 0; k < p.v.taps; ++k) p.rows[k] = -1;
+
+        const UInt32 first  = out.rect.y / p.vss;
+        const UInt32 last   = (out.rect.y + out.rect.h + p.vss - 1) / p.vss;
+        for (UInt32 j = first; j < last; ++j) {
+            const Int32 start   = p.v.starts[j];
+            for (Int32 k = 0; k < p.v.taps; ++k) {
+                // consecutive source rows never share a slot
+                const Int32 row     = start + k;
+                const Int32 slot    = row % p.v.taps;
+                Int16 * line        = p.ring + slot * p.width * p.channels;
+                if (p.rows[slot] != row) {
+                    ScaleLine(src[i] + row * istrides[i], line, p.channels, p.h, p.width);
+                    p.rows[slot] = row;
+                }
+                p.lines[k] = line;
+            }
+            FilterRows(p.lines, p.v.coeffs + j * p.v.taps, p.v.taps,
+                       dst[i] + j * ostrides[i], p.width * p.channels);
+        }
+    }
+    SetImagePlaneSizes(out, output);
+    return kMediaNoError;
+}
+
+static MediaError ScaleUnitReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+// one unit per filter
+#define SCALE_UNIT(FILTER)                                                              \
+static MediaError ScaleUnitInit##FILTER(MediaUnitContext ref,                           \
+                                        const MediaFormat * iformat,                    \
+                                        const MediaFormat * oformat) {                  \
+    return ScaleUnitInit(ref, kScaleFilter##FILTER, iformat, oformat);                  \
+}                                                                                       \
+static const MediaUnit kScaleUnit##FILTER = {                                           \
+    "scale." #FILTER,                                                                   \
+    0,                                                                                  \
+    kScaleFormats,                                                                      \
+    kScaleFormats,                                                                      \
+    ScaleUnitAlloc,                                                                     \
+    ScaleUnitDealloc,                                                                   \
+    ScaleUnitInit##FILTER,                                                              \
+    ScaleUnitProcess,                                                                   \
+    Nil,                                                                                \
+    ScaleUnitReset,                                                                     \
+};
+
+SCALE_UNIT(Bilinear)
+SCALE_UNIT(Bicubic)
+SCALE_UNIT(Lanczos)
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+const MediaUnit * ScaleUnitFind(const eScaleFilter filter) {
+    switch (filter) {
+        case kScaleFilterBilinear:  return &kScaleUnitBilinear;
+        case kScaleFilterBicubic:   return &kScaleUnitBicubic;
+        case kScaleFilterLanczos:   return &kScaleUnitLanczos;
+        default:                    return Nil;
+    }
+}
+
+__BEGIN_NAMESPACE_MFWK
+
+sp<MediaDevice> CreateImageScaler(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+    eScaleFilter filter = kScaleFilterDefault;
+    if (!options.isNil() && options->contains(kKeyScaleFilter)) {
+        filter = options->findInt32(kKeyScaleFilter);
+    }
+
+    const MediaUnit * unit = ScaleUnitFind(filter);
+    if (unit == Nil) {
+        ERROR("scale filter %u is not supported", filter);
+        return Nil;
+    }
+    return CreateImageDevice(unit, iformat, oformat, options);
+}
+
+__END_NAMESPACE_MFWK
+
+MediaDeviceRef ImageScalerCreate(const ImageFormat * iformat, const ImageFormat * oformat, MessageObjectRef options) {
+    sp<MediaDevice> scaler = CreateImageScaler(*iformat, *oformat, static_cast<Message *>(options));
+    if (scaler.isNil()) return Nil;
+    return scaler->RetainObject();
+}
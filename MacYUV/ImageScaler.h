@@ -0,0 +1,83 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageScaler.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// an image scaler with separable filters, works on each plane of planar &
+// semi-planar Y'CbCr and 32-bit RGB, so chroma is scaled at its own size.
+//
+
+#ifndef MACYUV_IMAGE_SCALER_H
+#define MACYUV_IMAGE_SCALER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+#include <MediaFramework/MediaDevice.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeyScaleFilter     = FOURCC('sflt'),       ///< UInt32, @see eScaleFilter
+};
+
+enum {
+    kScaleFilterBilinear,                       ///< 2x2 taps when upscaling
+    kScaleFilterBicubic,                        ///< Catmull-Rom, 4x4 taps when upscaling
+    kScaleFilterLanczos,                        ///< Lanczos3, 6x6 taps when upscaling
+    kScaleFilterDefault     = kScaleFilterBicubic,
+};
+typedef UInt32 eScaleFilter;
+
+/**
+ * get scale unit of filter
+ * @return return Nil if filter is not supported
+ */
+API_EXPORT const MediaUnit *    ScaleUnitFind(const eScaleFilter);
+
+/**
+ * create an image scaler
+ * @param options   kKeyScaleFilter & kKeyCount(threads), can be Nil
+ * @note input & output MUST be in the same pixel format
+ */
+API_EXPORT MediaDeviceRef       ImageScalerCreate(const ImageFormat *, const ImageFormat *, MessageObjectRef);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+API_EXPORT sp<MediaDevice> CreateImageScaler(const ImageFormat&, const ImageFormat&, const sp<Message>&);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_SCALER_H
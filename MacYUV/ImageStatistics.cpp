@@ -0,0 +1,686 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageStatistics.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// samples of a plane row are gathered into 16 bits first, which is SIMD
+// for common layouts, then min, max, sum & sum of squares are SIMD, and
+// histogram is counted into 4 tables to hide the latency of increments.
+//
+
+#define LOG_TAG "ImageStatistics"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "ImageStatistics.h"
+#include "ImageConverter.h"
+#include "ColorKernels.h"
+#include "PixelFormats.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+__BEGIN_NAMESPACE_MFWK
+
+// less rows than this is not worth a thread
+#define MIN_SLICE_ROWS      (64)
+// samples summed in 32 bits before widen
+#define CHUNK_SAMPLES       (8192)
+
+#define FORMAT_ENTRY(FORMAT, ...)   FORMAT,
+static const UInt32 kStatsFormats[] = {
+    YUV_FORMATS(FORMAT_ENTRY)
+    RGB_FORMATS(FORMAT_ENTRY)
+    kPixelFormatUnknown
+};
+
+#define RGB_LAYOUT(FORMAT, R, G, B, A, DEPTH, ...)  { FORMAT, { R, G, B, A }, DEPTH },
+static const struct {
+    UInt32          format;
+    UInt8           pos[4];
+    UInt8           depth;
+} kRGBLayouts[] = {
+    RGB_FORMATS(RGB_LAYOUT)
+};
+#undef RGB_LAYOUT
+#define NELEM(x)    (sizeof(x) / sizeof(x[0]))
+
+#pragma mark Kernels
+// every STEP samples of 8 bits
+template <UInt32 STEP>
+static void GatherRow8(const UInt8 * src, UInt16 * dst, UInt32 n, UInt32 shift, UInt16 mask) {
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    if (STEP == 1) {
+        for (; i + 16 <= n; i += 16) {
+            const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi8(x, zero));
+            _mm_storeu_si128((__m128i *)(dst + i + 8), _mm_unpackhi_epi8(x, zero));
+        }
+    } else if (STEP == 2) {
+        // loads end 1 byte after the last sample, which is in next sample
+        for (; i + 9 <= n; i += 8) {
+            const __m128i x = _mm_loadu_si128((const __m128i *)(src + i * 2));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(x, _mm_set1_epi16(0xFF)));
+        }
+    } else if (STEP == 4) {
+        for (; i + 9 <= n; i += 8) {
+            const __m128i a = _mm_loadu_si128((const __m128i *)(src + i * 4));
+            const __m128i b = _mm_loadu_si128((const __m128i *)(src + i * 4 + 16));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(_mm_and_si128(a, _mm_set1_epi32(0xFF)),
+                                                                   _mm_and_si128(b, _mm_set1_epi32(0xFF))));
+        }
+    }
+#elif defined(__aarch64__)
+    if (STEP == 1) {
+        for (; i + 16 <= n; i += 16) {
+            const uint8x16_t x = vld1q_u8(src + i);
+            vst1q_u16(dst + i, vmovl_u8(vget_low_u8(x)));
+            vst1q_u16(dst + i + 8, vmovl_u8(vget_high_u8(x)));
+        }
+    } else if (STEP == 2) {
+        for (; i + 9 <= n; i += 8) {
+            vst1q_u16(dst + i, vmovl_u8(vld2_u8(src + i * 2).val[0]));
+        }
+    } else if (STEP == 4) {
+        for (; i + 9 <= n; i += 8) {
+            vst1q_u16(dst + i, vmovl_u8(vld4_u8(src + i * 4).val[0]));
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = src[i * STEP];
+    }
+}
+
+// every STEP samples of 16 bits, significant bits from shift
+template <UInt32 STEP>
+static void GatherRow16(const UInt8 * src, UInt16 * dst, UInt32 n, UInt32 shift, UInt16 mask) {
+    const UInt16 * s = (const UInt16 *)src;
+    UInt32 i = 0;
+#if defined(__SSE2__)
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    if (STEP == 1) {
+        const __m128i m = _mm_set1_epi16(mask);
+        for (; i + 8 <= n; i += 8) {
+            const __m128i x = _mm_srl_epi16(_mm_loadu_si128((const __m128i *)(s + i)), count);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(x, m));
+        }
+    } else if (STEP == 2) {
+        const __m128i m = _mm_set1_epi32(mask);
+        for (; i + 9 <= n; i += 8) {
+            __m128i a = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(s + i * 2)), count), m);
+            __m128i b = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(s + i * 2 + 8)), count), m);
+            // sign extend, so packs keeps all 16 bits
+            a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+            b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(a, b));
+        }
+    }
+#elif defined(__aarch64__)
+    const int16x8_t count = vdupq_n_s16(-(Int16)shift);
+    const uint16x8_t m = vdupq_n_u16(mask);
+    if (STEP == 1) {
+        for (; i + 8 <= n; i += 8) {
+            vst1q_u16(dst + i, vandq_u16(vshlq_u16(vld1q_u16(s + i), count), m));
+        }
+    } else if (STEP == 2) {
+        for (; i + 9 <= n; i += 8) {
+            vst1q_u16(dst + i, vandq_u16(vshlq_u16(vld2q_u16(s + i * 2).val[0], count), m));
+        }
+    } else if (STEP == 4) {
+        for (; i + 9 <= n; i += 8) {
+            vst1q_u16(dst + i, vandq_u16(vshlq_u16(vld4q_u16(s + i * 4).val[0], count), m));
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] = (s[i * STEP] >> shift) & mask;
+    }
+}
+
+static GatherRow GetGatherRow(UInt32 bytes, UInt32 step) {
+    switch (step) {
+        case 1: return bytes == 1 ? GatherRow8<1> : GatherRow16<1>;
+        case 2: return bytes == 1 ? GatherRow8<2> : GatherRow16<2>;
+        case 4: return bytes == 1 ? GatherRow8<4> : GatherRow16<4>;
+        default: return Nil;
+    }
+}
+
+struct StatsSums {
+    UInt64          sum;
+    UInt64          squares;
+    UInt32          min;
+    UInt32          max;
+};
+
+/**
+ * min, max, sum & sum of squares of a row
+ * @note n <= CHUNK_SAMPLES
+ */
+static void SumRow(const UInt16 * p, UInt32 n, StatsSums& s) {
+    UInt32 i = 0;
+    UInt32 lo = s.min;
+    UInt32 hi = s.max;
+#if defined(__SSE2__)
+    // unsigned min & max by signed ones
+    const __m128i sign  = _mm_set1_epi16(0x8000);
+    const __m128i zero  = _mm_setzero_si128();
+    __m128i vmin        = _mm_set1_epi16(0x7FFF);
+    __m128i vmax        = sign;
+    __m128i vsum        = zero;     // 4 x 32 bits
+    __m128i vsq         = zero;     // 2 x 64 bits
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x     = _mm_loadu_si128((const __m128i *)(p + i));
+        const __m128i xs    = _mm_xor_si128(x, sign);
+        vmin    = _mm_min_epi16(vmin, xs);
+        vmax    = _mm_max_epi16(vmax, xs);
+        const __m128i a     = _mm_unpacklo_epi16(x, zero);
+        const __m128i b     = _mm_unpackhi_epi16(x, zero);
+        vsum    = _mm_add_epi32(vsum, _mm_add_epi32(a, b));
+        // squares of 16 bits in 64 bits
+        vsq     = _mm_add_epi64(vsq, _mm_add_epi64(_mm_mul_epu32(a, a), _mm_mul_epu32(b, b)));
+        const __m128i c     = _mm_srli_epi64(a, 32);
+        const __m128i d     = _mm_srli_epi64(b, 32);
+        vsq     = _mm_add_epi64(vsq, _mm_add_epi64(_mm_mul_epu32(c, c), _mm_mul_epu32(d, d)));
+    }
+    if (i) {
+        Int16 m[8], M[8];
+        UInt32 sum[4];
+        UInt64 sq[2];
+        _mm_storeu_si128((__m128i *)m, vmin);
+        _mm_storeu_si128((__m128i *)M, vmax);
+        _mm_storeu_si128((__m128i *)sum, vsum);
+        _mm_storeu_si128((__m128i *)sq, vsq);
+        for (UInt32 k = 0; k < 8; ++k) {
+            const UInt32 a = (UInt16)(m[k] ^ 0x8000);
+            const UInt32 b = (UInt16)(M[k] ^ 0x8000);
+            if (a < lo) lo = a;
+            if (b > hi) hi = b;
+        }
+        s.sum       += (UInt64)sum[0] + sum[1] + sum[2] + sum[3];
+        s.squares   += sq[0] + sq[1];
+    }
+#elif defined(__aarch64__)
+    uint16x8_t vmin     = vdupq_n_u16(0xFFFF);
+    uint16x8_t vmax     = vdupq_n_u16(0);
+    uint32x4_t vsum     = vdupq_n_u32(0);
+    uint64x2_t vsq      = vdupq_n_u64(0);
+    for (; i + 8 <= n; i += 8) {
+        const uint16x8_t x  = vld1q_u16(p + i);
+        vmin    = vminq_u16(vmin, x);
+        vmax    = vmaxq_u16(vmax, x);
+        vsum    = vpadalq_u16(vsum, x);
+        vsq     = vpadalq_u32(vsq, vmull_u16(vget_low_u16(x), vget_low_u16(x)));
+        vsq     = vpadalq_u32(vsq, vmull_u16(vget_high_u16(x), vget_high_u16(x)));
+    }
+    if (i) {
+        if (vminvq_u16(vmin) < lo) lo = vminvq_u16(vmin);
+        if (vmaxvq_u16(vmax) > hi) hi = vmaxvq_u16(vmax);
+        s.sum       += vaddlvq_u32(vsum);
+        s.squares   += vgetq_lane_u64(vsq, 0) + vgetq_lane_u64(vsq, 1);
+    }
+#endif
+    for (; i < n; ++i) {
+        const UInt32 x = p[i];
+        if (x < lo) lo = x;
+        if (x > hi) hi = x;
+        s.sum       += x;
+        s.squares   += x * x;
+    }
+    s.min   = lo;
+    s.max   = hi;
+}
+
+// 4 tables of kStatsBinsMax, so successive samples of the same value are
+// not waiting for each other
+static void HistogramRow(const UInt16 * p, UInt32 n, UInt32 shift, UInt32 * tables) {
+    UInt32 * h0 = tables;
+    UInt32 * h1 = tables + kStatsBinsMax;
+    UInt32 * h2 = tables + kStatsBinsMax * 2;
+    UInt32 * h3 = tables + kStatsBinsMax * 3;
+    UInt32 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        ++h0[p[i + 0] >> shift];
+        ++h1[p[i + 1] >> shift];
+        ++h2[p[i + 2] >> shift];
+        ++h3[p[i + 3] >> shift];
+    }
+    for (; i < n; ++i) {
+        ++h0[p[i] >> shift];
+    }
+}
+
+#pragma mark Components
+static void SetComponent(ImageComponent& p, UInt32 plane, UInt32 offset, UInt32 step, UInt32 hss, UInt32 vss) {
+    p.plane     = plane;
+    p.offset    = offset;
+    p.step      = step;
+    p.hss       = hss;
+    p.vss       = vss;
+    p.gather    = Nil;
+}
+
+MediaError GetImageComponents(ePixelFormat format, ImageComponents& components) {
+    const PixelDescriptor * desc = GetImagePixelDescriptor(format);
+    if (desc == Nil) return kMediaErrorNotSupported;
+
+    ImageComponent * planes = components.planes;
+    const YUVLayout * layout = GetYUVLayout(format);
+    if (layout != Nil) {
+        components.count    = 3;
+        components.depth    = layout->depth;
+        components.shift    = layout->shift;
+        switch (layout->layout) {
+            case kYUVLayoutPlanar:
+            case kYUVLayoutPlanarH2:
+                SetComponent(planes[0], 0, 0, 1, 1, 1);
+                SetComponent(planes[1], 1 + layout->cb, 0, 1,
+                             desc->planes[1 + layout->cb].hss, desc->planes[1 + layout->cb].vss);
+                SetComponent(planes[2], 1 + layout->cr, 0, 1,
+                             desc->planes[1 + layout->cr].hss, desc->planes[1 + layout->cr].vss);
+                break;
+            case kYUVLayoutSemiPlanar:
+                SetComponent(planes[0], 0, 0, 1, 1, 1);
+                SetComponent(planes[1], 1, layout->cb, 2, desc->planes[1].hss, desc->planes[1].vss);
+                SetComponent(planes[2], 1, layout->cr, 2, desc->planes[1].hss, desc->planes[1].vss);
+                break;
+            case kYUVLayoutPacked:
+                SetComponent(planes[0], 0, layout->y0, 2, 1, 1);
+                SetComponent(planes[1], 0, layout->cb, 4, 2, 1);
+                SetComponent(planes[2], 0, layout->cr, 4, 2, 1);
+                break;
+            default:
+                return kMediaErrorNotSupported;
+        }
+    } else {
+        UInt32 i = 0;
+        while (i < NELEM(kRGBLayouts) && kRGBLayouts[i].format != format) ++i;
+        if (i == NELEM(kRGBLayouts)) return kMediaErrorNotSupported;
+
+        // R/G/B/A
+        components.count    = 4;
+        components.depth    = kRGBLayouts[i].depth;
+        components.shift    = 0;
+        for (UInt32 k = 0; k < 4; ++k) {
+            SetComponent(planes[k], 0, kRGBLayouts[i].pos[k], 4, 1, 1);
+        }
+    }
+
+    components.bytes    = components.depth > 8 ? 2 : 1;
+    components.mask     = (1 << components.depth) - 1;
+    for (UInt32 i = 0; i < components.count; ++i) {
+        planes[i].gather = GetGatherRow(components.bytes, planes[i].step);
+    }
+    return kMediaNoError;
+}
+
+#pragma mark Statistics Unit
+struct StatsUnitContext {
+    ImageFormat             iformat;
+    ImageFormat             oformat;
+    ImageComponents         components;
+    UInt32                  hshift;     // sample to bin
+    UInt16 *                samples;    // row of a plane
+    UInt32 *                tables;
+
+    StatsUnitContext() : samples(Nil), tables(Nil) { }
+
+    void release() {
+        delete [] samples;
+        delete [] tables;
+        samples = Nil;
+        tables  = Nil;
+    }
+
+    ~StatsUnitContext() { release(); }
+};
+
+static MediaUnitContext StatsUnitAlloc() {
+    StatsUnitContext * instance = new StatsUnitContext;
+    return instance;
+}
+
+static void StatsUnitDealloc(MediaUnitContext ref) {
+    StatsUnitContext * instance = static_cast<StatsUnitContext *>(ref);
+    delete instance;
+}
+
+static MediaError StatsUnitInit(MediaUnitContext ref, const MediaFormat * iformat, const MediaFormat * oformat) {
+    StatsUnitContext * instance = static_cast<StatsUnitContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // output rect selects the rows of display rect
+    if (out.format != in.format || out.height != in.rect.h ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    ImageComponents& components = instance->components;
+    if (GetImageComponents(in.format, components) != kMediaNoError) {
+        return kMediaErrorNotSupported;
+    }
+    instance->hshift    = components.depth > 10 ? components.depth - 10 : 0;
+
+    instance->release();
+    instance->iformat   = in;
+    instance->oformat   = out;
+    instance->samples   = new UInt16[in.rect.w];
+    instance->tables    = new UInt32[kStatsBinsMax * 4];
+
+    DEBUG("%s: %u planes, rows %d + %d", GetImageFormatString(in).c_str(),
+          components.count, out.rect.y, out.rect.h);
+    return kMediaNoError;
+}
+
+static MediaError StatsUnitProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    StatsUnitContext * instance = static_cast<StatsUnitContext *>(ref);
+    const ImageFormat& in   = instance->iformat;
+    const ImageFormat& out  = instance->oformat;
+
+    if (output->count < 1 || output->buffers[0].capacity < sizeof(ImageStatisticsBlock)) {
+        return kMediaErrorBadParameters;
+    }
+
+    UInt8 * ip[4];
+    UInt32 is[4];
+    if (GetImagePlaneData(in, input, False, ip, is) != kMediaNoError) {
+        return kMediaErrorBadParameters;
+    }
+
+    ImageStatisticsBlock * block = (ImageStatisticsBlock *)output->buffers[0].data;
+    memset(block, 0, sizeof(ImageStatisticsBlock));
+
+    const ImageComponents& components = instance->components;
+    const UInt32 bins   = 1 << (components.depth - instance->hshift);
+    for (UInt32 c = 0; c < components.count; ++c) {
+        const ImageComponent& p = components.planes[c];
+        // samples covered by display rect, and rows of this slice: a
+        // subsampled row belongs to the slice with its first luma row
+        const Int32 x0      = in.rect.x / p.hss;
+        const Int32 n       = (in.rect.x + in.rect.w - 1) / p.hss + 1 - x0;
+        const Int32 first   = in.rect.y + out.rect.y;
+        const Int32 last    = first + out.rect.h;
+        const Int32 y0      = out.rect.y == 0 ? in.rect.y / p.vss : (first + p.vss - 1) / p.vss;
+        const Int32 y1      = last == in.rect.y + in.rect.h ?
+            (last - 1) / p.vss + 1 : (last + p.vss - 1) / p.vss;
+
+        StatsSums sums = { 0, 0, components.mask, 0 };
+        memset(instance->tables, 0, kStatsBinsMax * 4 * sizeof(UInt32));
+        for (Int32 y = y0; y < y1; ++y) {
+            const UInt8 * src = ip[p.plane] + y * is[p.plane] + (x0 * p.step + p.offset) * components.bytes;
+            for (Int32 x = 0; x < n; x += CHUNK_SAMPLES) {
+                const UInt32 m = n - x < CHUNK_SAMPLES ? n - x : CHUNK_SAMPLES;
+                p.gather(src + x * p.step * components.bytes, instance->samples, m, components.shift, components.mask);
+                SumRow(instance->samples, m, sums);
+                HistogramRow(instance->samples, m, instance->hshift, instance->tables);
+            }
+        }
+
+        if (y1 <= y0) continue;
+        block->planes[c].samples    = (UInt64)n * (y1 - y0);
+        block->planes[c].sum        = sums.sum;
+        block->planes[c].squares    = sums.squares;
+        block->planes[c].min        = sums.min;
+        block->planes[c].max        = sums.max;
+        for (UInt32 i = 0; i < bins; ++i) {
+            block->planes[c].histogram[i] = instance->tables[i] + instance->tables[kStatsBinsMax + i] +
+                instance->tables[kStatsBinsMax * 2 + i] + instance->tables[kStatsBinsMax * 3 + i];
+        }
+    }
+    output->buffers[0].size = sizeof(ImageStatisticsBlock);
+    return kMediaNoError;
+}
+
+static MediaError StatsUnitReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+const MediaUnit kStatisticsUnit = {
+    "statistics",
+    0,
+    kStatsFormats,
+    kStatsFormats,
+    StatsUnitAlloc,
+    StatsUnitDealloc,
+    StatsUnitInit,
+    StatsUnitProcess,
+    Nil,
+    StatsUnitReset,
+};
+
+#pragma mark Image Statistics
+struct StatisticsImpl;
+struct SliceJob : public Job {
+    StatisticsImpl *    mStatistics;    // statistics owns this job
+    UInt32              mIndex;
+
+    SliceJob(const sp<Looper>& looper, StatisticsImpl * statistics, UInt32 index) :
+        Job(looper), mStatistics(statistics), mIndex(index) { }
+
+    virtual void onJob();
+};
+
+// rows of display rect, with its own unit instance
+struct Slice {
+    MediaUnitContext        instance;
+    ImageStatisticsBlock    block;
+    sp<Job>                 job;        // Nil for the first slice, which runs on caller's thread
+
+    Slice() : instance(Nil) { }
+};
+
+struct StatisticsImpl : public ImageStatistics {
+    ImageFormat         mFormat;
+    UInt32              mBins;
+    Vector<Slice *>     mSlices;
+
+    // process context, shared with jobs
+    Mutex               mLock;
+    Condition           mWait;
+    UInt32              mPending;
+    MediaError          mStatus;
+    const MediaBufferList * mPlanes;
+
+    StatisticsImpl() : ImageStatistics(), mBins(0), mPending(0), mStatus(kMediaNoError), mPlanes(Nil) { }
+
+    virtual ~StatisticsImpl() {
+        for (UInt32 i = 0; i < mSlices.size(); ++i) {
+            if (mSlices[i]->instance) kStatisticsUnit.dealloc(mSlices[i]->instance);
+            delete mSlices[i];
+        }
+        mSlices.clear();
+    }
+
+    MediaError init(const ImageFormat& format, const sp<Message>& options) {
+        mFormat     = format;
+
+        UInt32 threads = GetCpuCount();
+        if (!options.isNil() && options->contains(kKeyCount)) {
+            threads = options->findInt32(kKeyCount);
+        }
+        if (threads == 0) threads = 1;
+
+        UInt32 count = format.rect.h / MIN_SLICE_ROWS;
+        if (count > threads) count = threads;
+        if (count == 0) count = 1;
+        const UInt32 rows = (format.rect.h + count - 1) / count;
+        count = (format.rect.h + rows - 1) / rows;
+
+        for (UInt32 i = 0; i < count; ++i) {
+            Slice * slice = new Slice;
+            mSlices.push(slice);
+
+            MediaFormat ifmt, ofmt;
+            ifmt.image          = format;
+            ofmt.image          = format;
+            ofmt.image.width    = format.rect.w;
+            ofmt.image.height   = format.rect.h;
+            ofmt.image.rect.x   = 0;
+            ofmt.image.rect.w   = format.rect.w;
+            ofmt.image.rect.y   = i * rows;
+            ofmt.image.rect.h   = i + 1 < count ? rows : format.rect.h - i * rows;
+            slice->instance     = kStatisticsUnit.alloc();
+            MediaError st = kStatisticsUnit.init(slice->instance, &ifmt, &ofmt);
+            if (st != kMediaNoError) return st;
+
+            if (i > 0) {
+                slice->job = new SliceJob(GetWorkerLooper(i - 1), this, i);
+            }
+        }
+
+        // 1024 bins at most, 256 bins if asked
+        const StatsUnitContext * first = static_cast<StatsUnitContext *>(mSlices[0]->instance);
+        mBins = 1 << (first->components.depth - first->hshift);
+        if (!options.isNil() && options->findInt32(kKeyStatsBins) == 256 && mBins > 256) {
+            mBins = 256;
+        }
+        INFO("%s: %u slices, %u bins", GetImageFormatString(mFormat).c_str(), count, mBins);
+        return kMediaNoError;
+    }
+
+    MediaError processSlice(UInt32 index) {
+        MediaBufferList4 output;
+        output.list.count           = 1;
+        output.buffers[0].data      = (UInt8 *)&mSlices[index]->block;
+        output.buffers[0].capacity  = sizeof(ImageStatisticsBlock);
+        output.buffers[0].size      = 0;
+        return kStatisticsUnit.process(mSlices[index]->instance, mPlanes, &output.list);
+    }
+
+    void onSliceDone(MediaError st) {
+        AutoLock _l(mLock);
+        if (st != kMediaNoError) mStatus = st;
+        if (--mPending == 0) mWait.signal();
+    }
+
+    virtual sp<Message> process(const MediaBufferList * planes) {
+        mPlanes     = planes;
+        mStatus     = kMediaNoError;
+        mPending    = mSlices.size() - 1;
+        for (UInt32 i = 1; i < mSlices.size(); ++i) {
+            mSlices[i]->job->dispatch();
+        }
+
+        MediaError st = processSlice(0);
+        {
+            AutoLock _l(mLock);
+            while (mPending) mWait.wait(mLock);
+            if (st == kMediaNoError) st = mStatus;
+        }
+        mPlanes     = Nil;
+        if (st != kMediaNoError) {
+            ERROR("statistics of %s failed", GetImageFormatString(mFormat).c_str());
+            return Nil;
+        }
+
+        const StatsUnitContext * first = static_cast<StatsUnitContext *>(mSlices[0]->instance);
+        const UInt32 bins   = 1 << (first->components.depth - first->hshift);
+        const UInt32 merge  = bins / mBins;
+
+        sp<Message> result = new Message;
+        result->setInt32(kKeyStatsPlanes, first->components.count);
+        for (UInt32 c = 0; c < first->components.count; ++c) {
+            UInt64 samples = 0, sum = 0, squares = 0;
+            UInt32 lo = 0xFFFFFFFF, hi = 0;
+            sp<Buffer> histogram = new Buffer(mBins * sizeof(UInt32));
+            UInt32 * h = (UInt32 *)histogram->base();
+            memset(h, 0, mBins * sizeof(UInt32));
+            for (UInt32 i = 0; i < mSlices.size(); ++i) {
+                const ImageStatisticsBlock& block = mSlices[i]->block;
+                if (block.planes[c].samples == 0) continue;
+                samples     += block.planes[c].samples;
+                sum         += block.planes[c].sum;
+                squares     += block.planes[c].squares;
+                if (block.planes[c].min < lo) lo = block.planes[c].min;
+                if (block.planes[c].max > hi) hi = block.planes[c].max;
+                for (UInt32 k = 0; k < bins; ++k) {
+                    h[k / merge] += block.planes[c].histogram[k];
+                }
+            }
+            histogram->setBytesRange(0, mBins * sizeof(UInt32));
+
+            const Float64 mean = samples ? (Float64)sum / samples : 0;
+            sp<Message> plane = new Message;
+            plane->setInt32(kKeyStatsDepth, first->components.depth);
+            plane->setInt32(kKeyStatsBins, mBins);
+            plane->setInt64(kKeyStatsSamples, samples);
+            plane->setInt32(kKeyStatsMin, samples ? lo : 0);
+            plane->setInt32(kKeyStatsMax, hi);
+            plane->setDouble(kKeyStatsMean, mean);
+            plane->setDouble(kKeyStatsVariance, samples ? (Float64)squares / samples - mean * mean : 0);
+            plane->setObject(kKeyStatsHistogram, histogram);
+            result->setObject(kKeyStatsPlane + c, plane);
+        }
+        return result;
+    }
+};
+
+void SliceJob::onJob() {
+    mStatistics->onSliceDone(mStatistics->processSlice(mIndex));
+}
+
+sp<ImageStatistics> CreateImageStatistics(const ImageFormat& format, const sp<Message>& options) {
+    sp<StatisticsImpl> statistics = new StatisticsImpl;
+    if (statistics->init(format, options) == kMediaNoError) {
+        return statistics;
+    }
+    return Nil;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+ImageStatisticsRef ImageStatisticsCreate(const ImageFormat * format, MessageObjectRef options) {
+    sp<ImageStatistics> statistics = CreateImageStatistics(*format, static_cast<Message *>(options));
+    if (statistics.isNil()) return Nil;
+    return statistics->RetainObject();
+}
+
+MessageObjectRef ImageStatisticsProcess(ImageStatisticsRef ref, const MediaFrameRef frame) {
+    sp<ImageStatistics> statistics = static_cast<ImageStatistics *>(ref);
+    sp<Message> result = statistics->process(&static_cast<MediaFrame *>(frame)->planes);
+    if (result.isNil()) return Nil;
+    return result->RetainObject();
+}
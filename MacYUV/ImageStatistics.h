@@ -0,0 +1,157 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageStatistics.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// per-plane statistics of an image: histogram, min, max, mean & variance,
+// e.g. to see whether luma is clipped or in video range.
+// planes are components here, Y'/Cb/Cr or R/G/B/A, so interleaved
+// chroma & packed pixels are counted separately.
+//
+
+#ifndef MACYUV_IMAGE_STATISTICS_H
+#define MACYUV_IMAGE_STATISTICS_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeyStatsBins       = FOURCC('sbin'),       ///< Int32, histogram bins, 256 or 1024, default by depth
+    kKeyStatsPlanes     = FOURCC('spln'),       ///< Int32, number of planes
+    kKeyStatsPlane      = FOURCC('spl0'),       ///< sp<Message>, the i-th plane is kKeyStatsPlane + i
+    // keys of a plane
+    kKeyStatsDepth      = FOURCC('sdep'),       ///< Int32, significant bits of a sample
+    kKeyStatsSamples    = FOURCC('snum'),       ///< Int64, samples in display rect
+    kKeyStatsMin        = FOURCC('smin'),       ///< Int32
+    kKeyStatsMax        = FOURCC('smax'),       ///< Int32
+    kKeyStatsMean       = FOURCC('smea'),       ///< Float64
+    kKeyStatsVariance   = FOURCC('svar'),       ///< Float64, of population
+    kKeyStatsHistogram  = FOURCC('shis'),       ///< sp<Buffer>, UInt32 count of each bin
+};
+
+typedef SharedObjectRef         ImageStatisticsRef;
+
+/**
+ * create statistics of images in iformat, only display rect is counted.
+ * rows are split into slices over threads.
+ * @param options   kKeyStatsBins, and kKeyCount for threads, default cpu count
+ * @return return Nil if pixel format is not supported
+ */
+API_EXPORT ImageStatisticsRef   ImageStatisticsCreate(const ImageFormat *, MessageObjectRef);
+
+/**
+ * @return return a message with kKeyStatsPlanes & kKeyStatsPlane + i, Nil on failure
+ */
+API_EXPORT MessageObjectRef     ImageStatisticsProcess(ImageStatisticsRef, const MediaFrameRef);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+#define kStatsPlanesMax     (4)
+#define kStatsBinsMax       (1024)
+
+/**
+ * gather n samples of a component row into 16 bits
+ * @param src   first sample, every step samples
+ * @param shift & mask  significant bits of a sample
+ */
+typedef void (*GatherRow)(const UInt8 * src, UInt16 * dst, UInt32 n, UInt32 shift, UInt16 mask);
+
+/**
+ * a component in data planes, the first sample of row y is at
+ * plane data + y * stride + offset * bytes, and next one is step samples later.
+ */
+struct ImageComponent {
+    UInt32          plane;              ///< index of data plane
+    UInt32          offset;             ///< in samples
+    UInt32          step;               ///< in samples
+    UInt32          hss;
+    UInt32          vss;
+    GatherRow       gather;
+};
+
+struct ImageComponents {
+    UInt32          count;
+    UInt32          depth;              ///< significant bits
+    UInt32          shift;              ///< lsb of significant bits
+    UInt32          bytes;              ///< bytes per sample
+    UInt16          mask;
+    ImageComponent  planes[kStatsPlanesMax];
+};
+
+/**
+ * get components of a pixel format, Y'/Cb/Cr or R/G/B/A
+ * @return return kMediaErrorNotSupported if format is not in ColorKernels
+ */
+API_EXPORT MediaError GetImageComponents(ePixelFormat, ImageComponents&);
+
+/**
+ * sums of a slice, which are merged by adding up except min & max
+ */
+struct ImageStatisticsBlock {
+    struct {
+        UInt64      samples;
+        UInt64      sum;
+        UInt64      squares;            ///< sum of squares
+        UInt32      min;
+        UInt32      max;
+        UInt32      histogram[kStatsBinsMax];
+    } planes[kStatsPlanesMax];
+};
+
+/**
+ * statistics unit, which counts the rows selected by output rect, and
+ * writes an ImageStatisticsBlock to the output buffer.
+ * @note output width & height are input display rect, and output rect
+ *       selects the rows of this slice.
+ * @note histogram has 1 << depth bins, 1024 at most.
+ */
+extern const MediaUnit kStatisticsUnit;
+
+struct ImageStatistics : public SharedObject {
+    virtual sp<Message> process(const MediaBufferList *) = 0;
+
+    protected:
+    ImageStatistics() : SharedObject(FOURCC('?ist')) { }
+    virtual ~ImageStatistics() { }
+};
+
+API_EXPORT sp<ImageStatistics> CreateImageStatistics(const ImageFormat&, const sp<Message>&);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_STATISTICS_H
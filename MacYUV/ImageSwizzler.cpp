@@ -0,0 +1,474 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+
+// File:    ImageSwizzler.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "ImageSwizzler"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "ImageSwizzler.h"
+#include "ColorKernels.h"
+#include "PixelFormats.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TARGET_SSSE3    __attribute__((target("ssse3")))
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+__BEGIN_NAMESPACE_MFWK
+
+// Y'CbCr formats which may have a similar one, 8-bit only
+static const UInt32 kSwizzleFormats[] = {
+    kPixelFormat420YpCbCrPlanar,
+    kPixelFormat420YpCrCbPlanar,
+    kPixelFormat422YpCbCrPlanar,
+    kPixelFormat422YpCrCbPlanar,
+    kPixelFormat444YpCbCrPlanar,
+    kPixelFormat444YpCrCbPlanar,
+    kPixelFormat420YpCbCrSemiPlanar,
+    kPixelFormat420YpCrCbSemiPlanar,
+    kPixelFormat422YpCbCr,
+    kPixelFormat422YpCrCb,
+    kPixelFormat422YpCbCrWO,
+    kPixelFormat422YpCrCbWO,
+    // END OF LIST
+    kPixelFormatUnknown
+};
+
+#pragma mark Kernels
+// dst[k] = src[perm[k]] for each 4 bytes, src & dst may be the same
+typedef void (*SwizzleRow)(const UInt8 *, UInt8 *, UInt32, const UInt8 *);
+
+static void SwizzleRow_C(const UInt8 * src, UInt8 * dst, UInt32 n, const UInt8 * perm) {
+    UInt32 i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const UInt8 m[4] = { src[i], src[i + 1], src[i + 2], src[i + 3] };
+        dst[i]      = m[perm[0]];
+        dst[i + 1]  = m[perm[1]];
+        dst[i + 2]  = m[perm[2]];
+        dst[i + 3]  = m[perm[3]];
+    }
+    // semi-planar rows may end with one Cb & Cr pair
+    if (i + 2 <= n) {
+        const UInt8 m[2] = { src[i], src[i + 1] };
+        dst[i]      = m[perm[0]];
+        dst[i + 1]  = m[perm[1]];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+TARGET_SSSE3 static void SwizzleRow_SSSE3(const UInt8 * src, UInt8 * dst, UInt32 n, const UInt8 * perm) {
+    const __m128i mask = _mm_setr_epi8(perm[0],      perm[1],      perm[2],      perm[3],
+                                       perm[0] + 4,  perm[1] + 4,  perm[2] + 4,  perm[3] + 4,
+                                       perm[0] + 8,  perm[1] + 8,  perm[2] + 8,  perm[3] + 8,
+                                       perm[0] + 12, perm[1] + 12, perm[2] + 12, perm[3] + 12);
+    UInt32 i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(x, mask));
+    }
+    SwizzleRow_C(src + i, dst + i, n - i, perm);
+}
+#elif defined(__aarch64__)
+static void SwizzleRow_NEON(const UInt8 * src, UInt8 * dst, UInt32 n, const UInt8 * perm) {
+    const UInt8 table[16] = {
+        perm[0],      perm[1],      perm[2],      perm[3],
+        (UInt8)(perm[0] + 4),  (UInt8)(perm[1] + 4),  (UInt8)(perm[2] + 4),  (UInt8)(perm[3] + 4),
+        (UInt8)(perm[0] + 8),  (UInt8)(perm[1] + 8),  (UInt8)(perm[2] + 8),  (UInt8)(perm[3] + 8),
+        (UInt8)(perm[0] + 12), (UInt8)(perm[1] + 12), (UInt8)(perm[2] + 12), (UInt8)(perm[3] + 12),
+    };
+    const uint8x16_t mask = vld1q_u8(table);
+    UInt32 i = 0;
+    for (; i + 16 <= n; i += 16) {
+        vst1q_u8(dst + i, vqtbl1q_u8(vld1q_u8(src + i), mask));
+    }
+    SwizzleRow_C(src + i, dst + i, n - i, perm);
+}
+#endif
+
+static SwizzleRow GetSwizzleRow() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3")) return SwizzleRow_SSSE3;
+#elif defined(__aarch64__)
+    return SwizzleRow_NEON;
+#endif
+    return SwizzleRow_C;
+}
+
+// planar chroma in place, exchange rows of two planes
+static void SwapRows(UInt8 * a, UInt8 * b, UInt32 n) {
+    UInt8 tmp[256];
+    while (n) {
+        const UInt32 m = n < sizeof(tmp) ? n : sizeof(tmp);
+        memcpy(tmp, a, m);
+        memcpy(a, b, m);
+        memcpy(b, tmp, m);
+        a += m; b += m; n -= m;
+    }
+}
+
+#pragma mark Swizzle Unit
+// how output planes come from input planes
+struct Swizzle {
+    UInt32              order[4];       // input plane of each output plane
+    UInt8               perm[4];        // byte order of interleaved planes
+    UInt32              plane;          // interleaved plane to swizzle
+};
+
+static Bool GetSwizzle(ePixelFormat iformat, ePixelFormat oformat, Swizzle& sw) {
+    if (iformat == oformat) return False;
+    const YUVLayout * i = GetYUVLayout(iformat);
+    const YUVLayout * o = GetYUVLayout(oformat);
+    if (i == Nil || o == Nil) return False;
+    if (i->layout != o->layout || i->depth != 8 || o->depth != 8) return False;
+
+    const PixelDescriptor * idesc = GetImagePixelDescriptor(iformat);
+    const PixelDescriptor * odesc = GetImagePixelDescriptor(oformat);
+    if (idesc == Nil || odesc == Nil || idesc->nb_planes != odesc->nb_planes) return False;
+    // 4:2:0 & 4:2:2 share the same layout
+    for (UInt32 k = 0; k < idesc->nb_planes; ++k) {
+        if (idesc->planes[k].hss != odesc->planes[k].hss ||
+            idesc->planes[k].vss != odesc->planes[k].vss) return False;
+    }
+
+    for (UInt32 k = 0; k < 4; ++k) {
+        sw.order[k] = k;
+        sw.perm[k]  = k;
+    }
+    sw.plane = 4;
+    switch (i->layout) {
+        case kYUVLayoutPlanar:
+        case kYUVLayoutPlanarH2:
+            sw.order[1 + o->cb] = 1 + i->cb;
+            sw.order[1 + o->cr] = 1 + i->cr;
+            break;
+        case kYUVLayoutSemiPlanar:
+            // Cb & Cr pairs, twice in 4 bytes
+            sw.perm[o->cb]      = i->cb;
+            sw.perm[o->cr]      = i->cr;
+            sw.perm[2 + o->cb]  = 2 + i->cb;
+            sw.perm[2 + o->cr]  = 2 + i->cr;
+            sw.plane            = 1;
+            break;
+        case kYUVLayoutPacked:
+            sw.perm[o->y0]      = i->y0;
+            sw.perm[o->cb]      = i->cb;
+            sw.perm[o->y1]      = i->y1;
+            sw.perm[o->cr]      = i->cr;
+            sw.plane            = 0;
+            break;
+        default:
+            return False;
+    }
+    return True;
+}
+
+struct SwizzleContext {
+    ImageFormat             input;
+    ImageFormat             output;
+    const PixelDescriptor * desc;
+    Swizzle                 swizzle;
+    SwizzleRow              row;
+};
+
+static MediaUnitContext SwizzleAlloc() {
+    SwizzleContext * instance = new SwizzleContext;
+    return instance;
+}
+
+static void SwizzleDealloc(MediaUnitContext ref) {
+    SwizzleContext * instance = static_cast<SwizzleContext *>(ref);
+    delete instance;
+}
+
+static MediaError SwizzleInit(MediaUnitContext ref, const MediaFormat * iformat, const MediaFormat * oformat) {
+    SwizzleContext * instance = static_cast<SwizzleContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    if (!GetSwizzle(in.format, out.format, instance->swizzle)) {
+        return kMediaErrorNotSupported;
+    }
+    // no scaling, output is the display rect
+    if (out.width != in.rect.w || out.height != in.rect.h) {
+        return kMediaErrorNotSupported;
+    }
+
+    // crop on whole chroma samples
+    const PixelDescriptor * desc = GetImagePixelDescriptor(in.format);
+    UInt32 hss = GetYUVLayout(in.format)->layout == kYUVLayoutPlanar ? 1 : 2;
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        if (in.rect.x % hss || in.rect.y % desc->planes[i].vss) {
+            return kMediaErrorNotSupported;
+        }
+    }
+
+    instance->input     = in;
+    instance->output    = out;
+    instance->desc      = desc;
+    instance->row       = GetSwizzleRow();
+    return kMediaNoError;
+}
+
+static MediaError SwizzleProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    SwizzleContext * instance = static_cast<SwizzleContext *>(ref);
+    const ImageFormat& in   = instance->input;
+    const ImageFormat& out  = instance->output;
+    const PixelDescriptor * desc = instance->desc;
+    const Swizzle& sw       = instance->swizzle;
+
+    UInt8 * ip[4];
+    UInt32 is[4];
+    UInt8 * op[4];
+    UInt32 os[4];
+    if (GetImagePlaneData(in, input, False, ip, is) != kMediaNoError ||
+        GetImagePlaneData(out, output, True, op, os) != kMediaNoError) {
+        return kMediaErrorBadParameters;
+    }
+
+    // in place only works without crop
+    const Bool inplace = ip[0] == op[0];
+    if (inplace && (in.rect.x || in.rect.y || in.width != out.width || in.height != out.height)) {
+        return kMediaErrorNotSupported;
+    }
+
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        const UInt32 j      = sw.order[i];
+        const UInt32 vss    = desc->planes[i].vss;
+        const UInt32 start  = out.rect.y / vss;
+        UInt32 end          = (out.rect.y + out.rect.h + vss - 1) / vss;
+        const UInt32 rows   = GetPlaneRows(desc, i, out.height);
+        if (end > rows) end = rows;
+        const UInt32 bytes  = GetPlaneStride(desc, i, out.width);
+        const UInt32 x      = GetPlaneStride(desc, j, in.rect.x);
+        const UInt32 y      = in.rect.y / vss;
+
+        for (UInt32 r = start; r < end; ++r) {
+            const UInt8 * src   = ip[j] + (y + r) * is[j] + x;
+            UInt8 * dst         = op[i] + r * os[i];
+            if (i == sw.plane) {
+                instance->row(src, dst, bytes, sw.perm);
+            } else if (inplace && j != i) {
+                // exchange two chroma planes once
+                if (i < j) SwapRows(dst, op[j] + r * os[j], bytes);
+            } else if (src != dst) {
+                memcpy(dst, src, bytes);
+            }
+        }
+    }
+    return kMediaNoError;
+}
+
+static MediaError SwizzleReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+const MediaUnit kSwizzleUnit = {
+    "yuv.swizzle",
+    kMediaUnitProcessInplace,
+    kSwizzleFormats,
+    kSwizzleFormats,
+    SwizzleAlloc,
+    SwizzleDealloc,
+    SwizzleInit,
+    SwizzleProcess,
+    Nil,
+    SwizzleReset,
+};
+
+#pragma mark Image Swizzler
+// output frame holds input frame if planes are reordered or swizzled in
+// place, otherwise interleaved planes are swizzled into a new frame.
+struct ImageSwizzler : public MediaDevice {
+    ImageFormat         mInput;
+    ImageFormat         mOutput;
+    const PixelDescriptor * mDesc;
+    Swizzle             mSwizzle;
+    Bool                mInplace;
+    MediaUnitContext    mInstance;
+    sp<MediaFrame>      mFrame;
+
+    ImageSwizzler() : MediaDevice(), mDesc(Nil), mInplace(False), mInstance(Nil) { }
+
+    virtual ~ImageSwizzler() {
+        if (mInstance) kSwizzleUnit.dealloc(mInstance);
+    }
+
+    MediaError init(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+        if (!GetSwizzle(iformat.format, oformat.format, mSwizzle)) {
+            return kMediaErrorNotSupported;
+        }
+        if (iformat.width != oformat.width || iformat.height != oformat.height ||
+            iformat.rect.x != oformat.rect.x || iformat.rect.y != oformat.rect.y ||
+            iformat.rect.w != oformat.rect.w || iformat.rect.h != oformat.rect.h) {
+            return kMediaErrorNotSupported;
+        }
+
+        mInput      = iformat;
+        mOutput     = oformat;
+        mDesc       = GetImagePixelDescriptor(iformat.format);
+        if (!options.isNil() && options->contains(kKeySwizzleInplace)) {
+            mInplace    = options->findInt32(kKeySwizzleInplace) != 0;
+        }
+
+        // pixels are touched only by interleaved formats
+        if (mSwizzle.plane < mDesc->nb_planes) {
+            MediaFormat ifmt, ofmt;
+            ifmt.image          = mInput;
+            ifmt.image.rect.x   = 0;
+            ifmt.image.rect.y   = 0;
+            ifmt.image.rect.w   = mInput.width;
+            ifmt.image.rect.h   = mInput.height;
+            ofmt.image          = ifmt.image;
+            ofmt.image.format   = mOutput.format;
+            mInstance = kSwizzleUnit.alloc();
+            MediaError st = kSwizzleUnit.init(mInstance, &ifmt, &ofmt);
+            if (st != kMediaNoError) return st;
+        }
+        INFO("%s -> %s, %s", mDesc->name, GetImagePixelDescriptor(oformat.format)->name,
+             mInstance ? (mInplace ? "in place" : "copy") : "zero copy");
+        return kMediaNoError;
+    }
+
+    virtual sp<Message> formats() const {
+        sp<Message> formats = new Message;
+        formats->setInt32(kKeyFormat, mOutput.format);
+        formats->setInt32(kKeyWidth, mOutput.width);
+        formats->setInt32(kKeyHeight, mOutput.height);
+        return formats;
+    }
+
+    virtual MediaError configure(const sp<Message>& options) {
+        return kMediaErrorNotSupported;
+    }
+
+    virtual MediaError push(const sp<MediaFrame>& input) {
+        if (input.isNil()) return kMediaNoError;    // eos
+        if (!mFrame.isNil()) return kMediaErrorResourceBusy;
+
+        // input frame may be shared, e.g. prefetched or on a mapping
+        if (mInstance && !mInplace) return copy(input);
+
+        // one buffer per plane, which keeps input strides
+        UInt8 * data[4];
+        UInt32 strides[4];
+        MediaError st = GetImagePlaneData(mInput, &input->planes, False, data, strides);
+        if (st != kMediaNoError) return st;
+
+        MediaBufferList4 planes;
+        planes.list.count = mDesc->nb_planes;
+        for (UInt32 i = 0; i < mDesc->nb_planes; ++i) {
+            const UInt32 bytes          = strides[i] * GetPlaneRows(mDesc, i, mInput.height);
+            planes.buffers[i].data      = data[i];
+            planes.buffers[i].capacity  = bytes;
+            planes.buffers[i].size      = bytes;
+        }
+
+        if (mInstance) {
+            st = kSwizzleUnit.process(mInstance, &planes.list, &planes.list);
+            if (st != kMediaNoError) return st;
+        }
+
+        MediaBufferList4 reordered;
+        reordered.list.count = planes.list.count;
+        for (UInt32 i = 0; i < planes.list.count; ++i) {
+            reordered.buffers[i] = planes.buffers[mSwizzle.order[i]];
+        }
+
+        sp<MediaFrame> output = CreateImageFrame(mOutput, reordered.list, input);
+        if (output.isNil()) return kMediaErrorOutOfMemory;
+
+        output->id          = input->id;
+        output->flags       = input->flags;
+        output->timecode    = input->timecode;
+        output->duration    = input->duration;
+        mFrame              = output;
+        return kMediaNoError;
+    }
+
+    MediaError copy(const sp<MediaFrame>& input) {
+        sp<MediaFrame> output = CreateImageFrame(mOutput);
+        if (output.isNil()) return kMediaErrorOutOfMemory;
+
+        // the unit reorders planes as well
+        MediaError st = kSwizzleUnit.process(mInstance, &input->planes, &output->planes);
+        if (st != kMediaNoError) return st;
+        SetImagePlaneSizes(mOutput, &output->planes);
+
+        output->id          = input->id;
+        output->flags       = input->flags;
+        output->timecode    = input->timecode;
+        output->duration    = input->duration;
+        mFrame              = output;
+        return kMediaNoError;
+    }
+
+    virtual sp<MediaFrame> pull() {
+        sp<MediaFrame> output = mFrame;
+        mFrame.clear();
+        return output;
+    }
+
+    virtual MediaError reset() {
+        mFrame.clear();
+        return kMediaNoError;
+    }
+};
+
+sp<MediaDevice> CreateImageSwizzler(const ImageFormat& iformat, const ImageFormat& oformat, const sp<Message>& options) {
+    sp<ImageSwizzler> swizzler = new ImageSwizzler;
+    if (swizzler->init(iformat, oformat, options) == kMediaNoError) {
+        return swizzler;
+    }
+    return Nil;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+Bool IsSimilarPixelFormat(const ePixelFormat a, const ePixelFormat b) {
+    Swizzle sw;
+    return GetSwizzle(a, b, sw);
+}
+
+MediaDeviceRef ImageSwizzlerCreate(const ImageFormat * iformat, const ImageFormat * oformat, MessageObjectRef options) {
+    sp<MediaDevice> swizzler = CreateImageSwizzler(*iformat, *oformat, static_cast<Message *>(options));
+    if (swizzler.isNil()) return Nil;
+    return swizzler->RetainObject();
+}
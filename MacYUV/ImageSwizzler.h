@@ -0,0 +1,88 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+
+// File:    ImageSwizzler.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// conversion between similar formats, which differ only in order of chroma
+// planes or bytes, e.g. I420/YV12, NV12/NV21 and YUY2/YVYU/VYUY/UYVY.
+// planar formats swap plane pointers without touching pixels, others are
+// swizzled into a new frame, or in place if the caller owns the input.
+//
+
+#ifndef MACYUV_IMAGE_SWIZZLER_H
+#define MACYUV_IMAGE_SWIZZLER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+#include <MediaFramework/MediaDevice.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeySwizzleInplace  = FOURCC('swip'),       ///< Int32, swizzle input frame in place, default 0
+};
+
+/**
+ * is one pixel format a reinterpretation of the other
+ * @note same format is not similar to itself.
+ */
+API_EXPORT Bool                 IsSimilarPixelFormat(const ePixelFormat, const ePixelFormat);
+
+/**
+ * create a swizzler between similar formats, no crop & no scale
+ * @param options   kKeySwizzleInplace, can be Nil
+ * @return return Nil if formats are not similar or geometry differs
+ * @note planar output frame shares memory with input frame. semi-planar &
+ *       packed input frames are swizzled into a new frame, or in place
+ *       with kKeySwizzleInplace, which changes the input frame.
+ */
+API_EXPORT MediaDeviceRef       ImageSwizzlerCreate(const ImageFormat *, const ImageFormat *, MessageObjectRef);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+/**
+ * swizzle unit, kMediaUnitProcessInplace. input & output may be the same
+ * buffers, otherwise pixels are copied in the new order.
+ * @note produce rows selected by output rect, as other image units.
+ */
+extern const MediaUnit kSwizzleUnit;
+
+API_EXPORT sp<MediaDevice> CreateImageSwizzler(const ImageFormat&, const ImageFormat&, const sp<Message>&);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_SWIZZLER_H
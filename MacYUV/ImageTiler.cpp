@@ -0,0 +1,246 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageTiler.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "ImageTiler"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "ImageTiler.h"
+#include "ImageConverter.h"
+#include "PixelFormats.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+#define DEFAULT_TILE_SIZE   (256)
+// tiles aligned to any chroma subsampling
+#define TILE_ALIGN          (16)
+// 16MB of BGRA tiles in default size
+#define MAX_CACHED_TILES    (64)
+
+struct Tile {
+    Int64               index;          // frame index
+    Int32               x;              // tile origin in input
+    Int32               y;
+    sp<MediaFrame>      frame;
+};
+
+struct ImageTiler : public MediaDevice {
+    ImageFormat         mInput;
+    ePixelFormat        mFormat;
+    const PixelDescriptor * mDesc;
+    Int32               mTileSize;
+    sp<Message>         mOptions;
+    Int64               mIndex;
+    List<Tile>          mTiles;         // most recent first
+    sp<MediaFrame>      mFrame;
+
+    ImageTiler() : MediaDevice(), mFormat(kPixelFormatUnknown), mDesc(Nil),
+        mTileSize(DEFAULT_TILE_SIZE), mIndex(0) { }
+
+    MediaError init(const ImageFormat& iformat, const ePixelFormat format, const sp<Message>& options) {
+        mInput      = iformat;
+        mFormat     = format;
+        mOptions    = options;
+        mDesc       = GetImagePixelDescriptor(format);
+        // tiles are copied into viewport row by row
+        if (mDesc == Nil || mDesc->nb_planes != 1 || mDesc->bpp % 8) {
+            return kMediaErrorNotSupported;
+        }
+        if (GetImagePixelDescriptor(iformat.format) == Nil || iformat.width <= 0 || iformat.height <= 0) {
+            return kMediaErrorNotSupported;
+        }
+
+        if (!options.isNil() && options->contains(kKeyTileSize)) {
+            mTileSize = options->findInt32(kKeyTileSize);
+        }
+        mTileSize = ((mTileSize + TILE_ALIGN - 1) / TILE_ALIGN) * TILE_ALIGN;
+        if (mTileSize <= 0) return kMediaErrorBadParameters;
+
+        INFO("%s -> %.4s, tile %d", GetImageFormatString(mInput).c_str(),
+             (const Char *)&mFormat, mTileSize);
+        return kMediaNoError;
+    }
+
+    // get tile from cache, or convert it from input
+    sp<MediaFrame> getTile(const sp<MediaFrame>& input, Int32 x, Int32 y) {
+        List<Tile>::iterator it = mTiles.begin();
+        for (; it != mTiles.end(); ++it) {
+            Tile& tile = *it;
+            if (tile.index != mIndex || tile.x != x || tile.y != y) continue;
+
+            Tile hit = tile;
+            mTiles.erase(it);
+            mTiles.insert(mTiles.begin(), hit);
+            return hit.frame;
+        }
+
+        ImageFormat iformat = mInput;
+        iformat.rect.x      = x;
+        iformat.rect.y      = y;
+        iformat.rect.w      = mInput.width - x;
+        iformat.rect.h      = mInput.height - y;
+        if (iformat.rect.w > mTileSize) iformat.rect.w = mTileSize;
+        if (iformat.rect.h > mTileSize) iformat.rect.h = mTileSize;
+
+        ImageFormat oformat;
+        memset(&oformat, 0, sizeof(oformat));
+        oformat.format      = mFormat;
+        oformat.matrix      = mInput.matrix;
+        oformat.width       = oformat.rect.w = iformat.rect.w;
+        oformat.height      = oformat.rect.h = iformat.rect.h;
+
+        // only edge tiles differ in size, cached converters will be reset for each tile
+        sp<MediaDevice> cc = ObtainImageConverter(iformat, oformat, mOptions);
+        if (cc.isNil() || cc->push(input) != kMediaNoError) {
+            ERROR("convert tile @ (%d, %d) failed", x, y);
+            return Nil;
+        }
+
+        Tile tile;
+        tile.index  = mIndex;
+        tile.x      = x;
+        tile.y      = y;
+        tile.frame  = cc->pull();
+        if (tile.frame.isNil()) return Nil;
+        DEBUG("tile %" PRId64 " @ (%d, %d)", mIndex, x, y);
+
+        mTiles.insert(mTiles.begin(), tile);
+        while (mTiles.size() > MAX_CACHED_TILES) mTiles.pop_back();
+        return tile.frame;
+    }
+
+    virtual sp<Message> formats() const {
+        sp<Message> formats = new Message;
+        formats->setInt32(kKeyFormat, mFormat);
+        formats->setInt32(kKeyTileSize, mTileSize);
+        return formats;
+    }
+
+    virtual MediaError configure(const sp<Message>& options) {
+        if (options->contains(kKeyTileFrame)) {
+            mIndex = options->findInt64(kKeyTileFrame);
+            return kMediaNoError;
+        }
+        return kMediaErrorNotSupported;
+    }
+
+    virtual MediaError push(const sp<MediaFrame>& input) {
+        if (input.isNil()) return kMediaNoError;    // eos
+        if (!mFrame.isNil()) return kMediaErrorResourceBusy;
+
+        const ImageFormat& image = input->image;
+        if (image.format != mInput.format || image.width != mInput.width || image.height != mInput.height) {
+            return kMediaErrorBadParameters;
+        }
+        if (image.rect.x < 0 || image.rect.y < 0 || image.rect.w <= 0 || image.rect.h <= 0 ||
+            image.rect.x + image.rect.w > image.width || image.rect.y + image.rect.h > image.height) {
+            return kMediaErrorBadParameters;
+        }
+
+        ImageFormat oformat;
+        memset(&oformat, 0, sizeof(oformat));
+        oformat.format      = mFormat;
+        oformat.matrix      = mInput.matrix;
+        oformat.width       = oformat.rect.w = image.rect.w;
+        oformat.height      = oformat.rect.h = image.rect.h;
+        sp<MediaFrame> output = CreateImageFrame(oformat);
+        if (output.isNil()) return kMediaErrorOutOfMemory;
+
+        // copy visible part of each tile into viewport
+        const UInt32 bpp    = mDesc->bpp / 8;
+        const Int32 x0      = (image.rect.x / mTileSize) * mTileSize;
+        const Int32 y0      = (image.rect.y / mTileSize) * mTileSize;
+        UInt8 * dst         = output->planes.buffers[0].data;
+        for (Int32 ty = y0; ty < image.rect.y + image.rect.h; ty += mTileSize) {
+            for (Int32 tx = x0; tx < image.rect.x + image.rect.w; tx += mTileSize) {
+                sp<MediaFrame> tile = getTile(input, tx, ty);
+                if (tile.isNil()) return kMediaErrorUnknown;
+
+                const Int32 tw      = tile->image.width;
+                const Int32 left    = tx > image.rect.x ? tx : image.rect.x;
+                const Int32 top     = ty > image.rect.y ? ty : image.rect.y;
+                Int32 right         = tx + tw;
+                Int32 bottom        = ty + tile->image.height;
+                if (right > image.rect.x + image.rect.w)    right = image.rect.x + image.rect.w;
+                if (bottom > image.rect.y + image.rect.h)   bottom = image.rect.y + image.rect.h;
+
+                const UInt8 * src = tile->planes.buffers[0].data;
+                for (Int32 y = top; y < bottom; ++y) {
+                    memcpy(dst + ((y - image.rect.y) * oformat.width + (left - image.rect.x)) * bpp,
+                           src + ((y - ty) * tw + (left - tx)) * bpp,
+                           (right - left) * bpp);
+                }
+            }
+        }
+
+        output->id          = input->id;
+        output->flags       = input->flags;
+        output->timecode    = input->timecode;
+        output->duration    = input->duration;
+        mFrame              = output;
+        return kMediaNoError;
+    }
+
+    virtual sp<MediaFrame> pull() {
+        sp<MediaFrame> output = mFrame;
+        mFrame.clear();
+        return output;
+    }
+
+    virtual MediaError reset() {
+        mFrame.clear();
+        mTiles.clear();
+        return kMediaNoError;
+    }
+};
+
+sp<MediaDevice> CreateImageTiler(const ImageFormat& iformat, const ePixelFormat format, const sp<Message>& options) {
+    sp<ImageTiler> tiler = new ImageTiler;
+    if (tiler->init(iformat, format, options) == kMediaNoError) {
+        return tiler;
+    }
+    ERROR("no tiler for %s -> %.4s", GetImageFormatString(iformat).c_str(), (const Char *)&format);
+    return Nil;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+MediaDeviceRef ImageTilerCreate(const ImageFormat * iformat, const ePixelFormat format, MessageObjectRef options) {
+    sp<MediaDevice> tiler = CreateImageTiler(*iformat, format, static_cast<Message *>(options));
+    if (tiler.isNil()) return Nil;
+    return tiler->RetainObject();
+}
@@ -0,0 +1,73 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageTiler.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// convert only the visible part of a frame. a frame is split into fixed size
+// tiles, which are converted on request and cached per frame index, so
+// panning a zoomed image converts only the tiles just shown.
+//
+
+#ifndef MACYUV_IMAGE_TILER_H
+#define MACYUV_IMAGE_TILER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaDevice.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeyTileSize        = FOURCC('tsiz'),       ///< UInt32, tile width & height, default 256
+    kKeyTileFrame       = FOURCC('tfrm'),       ///< Int64, frame index of frames pushed next
+};
+
+/**
+ * create a tiler for frames in iformat, output in pixel format
+ * @param options   kKeyTileSize & options for converters, can be Nil
+ * @note push a frame with display rect as viewport, and pull the viewport
+ *       in output pixel format without scaling.
+ * @note configure kKeyTileFrame before push a different frame, tiles of
+ *       other frames are kept in cache.
+ */
+API_EXPORT MediaDeviceRef       ImageTilerCreate(const ImageFormat *, const ePixelFormat, MessageObjectRef);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+API_EXPORT sp<MediaDevice> CreateImageTiler(const ImageFormat&, const ePixelFormat, const sp<Message>&);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_IMAGE_TILER_H
@@ -0,0 +1,323 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageToneMap.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// Y'CbCr rows are converted to 16-bit R'G'B' by color kernels, which have
+// 12 significant bits, then each channel is mapped to 8 bits by a table
+// built once for each transfer. the whole curve is in the table, so the
+// cost per pixel is 3 loads, whatever the curve is.
+//
+
+#define LOG_TAG "ImageToneMap"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <math.h>
+#include <string.h>
+
+#include "ImageToneMap.h"
+#include "ColorKernels.h"
+#include "PixelFormats.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+#define FORMAT_ENTRY(FORMAT, ...)   FORMAT,
+static const UInt32 kInputFormats[] = {
+    YUV_FORMATS(FORMAT_ENTRY)
+    kPixelFormatUnknown
+};
+
+static const UInt32 kOutputFormats[] = {
+    kPixelFormatBGRA,
+    kPixelFormatRGBA,
+    kPixelFormatARGB,
+    kPixelFormatABGR,
+    kPixelFormatUnknown
+};
+
+#define LUT_BITS        (12)
+#define LUT_SIZE        (1 << LUT_BITS)
+
+// nits
+#define REFERENCE_WHITE (203.0)         // BT.2408, graphics white of HDR
+#define DISPLAY_PEAK    (1000.0)        // mastering display & HLG nominal peak
+
+#pragma mark Curves
+// SMPTE ST 2084 EOTF, E' in [0, 1] -> nits
+static Float64 PQToNits(Float64 e) {
+    const Float64 m1    = 2610.0 / 16384;
+    const Float64 m2    = 2523.0 / 4096 * 128;
+    const Float64 c1    = 3424.0 / 4096;
+    const Float64 c2    = 2413.0 / 4096 * 32;
+    const Float64 c3    = 2392.0 / 4096 * 32;
+    const Float64 p     = pow(e, 1 / m2);
+    const Float64 n     = p - c1 > 0 ? p - c1 : 0;
+    return 10000 * pow(n / (c2 - c3 * p), 1 / m1);
+}
+
+// ARIB STD-B67 inverse OETF & OOTF, E' in [0, 1] -> nits
+// OOTF scales by luminance of the pixel, which is not known by a channel,
+// so the system gamma is applied to each channel instead.
+static Float64 HLGToNits(Float64 e) {
+    const Float64 a     = 0.17883277;
+    const Float64 b     = 1 - 4 * a;
+    const Float64 c     = 0.5 - a * log(4 * a);
+    const Float64 gamma = 1.2;          // for 1000 nits display
+    const Float64 s     = e <= 0.5 ? e * e / 3 : (exp((e - c) / a) + b) / 12;
+    return DISPLAY_PEAK * pow(s, gamma);
+}
+
+// extended Reinhard, DISPLAY_PEAK -> SDR peak, relative to reference white
+static Float64 ToneMap(Float64 nits) {
+    const Float64 l     = nits / REFERENCE_WHITE;
+    const Float64 w     = DISPLAY_PEAK / REFERENCE_WHITE;
+    const Float64 d     = l * (1 + l / (w * w)) / (1 + l);
+    return d > 1 ? 1 : d;
+}
+
+// code value of 12 bits -> 8-bit display value
+static UInt8 sLUT[kTransferHLG + 1][LUT_SIZE];
+
+static Bool InitToneMapOnce() {
+    for (UInt32 i = 0; i < LUT_SIZE; ++i) {
+        const Float64 e = (Float64)i / (LUT_SIZE - 1);
+        sLUT[kTransferPQ][i]    = lrint(pow(ToneMap(PQToNits(e)), 1 / 2.4) * 255);
+        sLUT[kTransferHLG][i]   = lrint(pow(ToneMap(HLGToNits(e)), 1 / 2.4) * 255);
+    }
+    return True;
+}
+
+static const UInt8 * GetToneMapLUT(eTransfer transfer) {
+    // thread safe since c++11
+    static const Bool once = InitToneMapOnce();
+    (void)once;
+    if (transfer != kTransferPQ && transfer != kTransferHLG) return Nil;
+    return sLUT[transfer];
+}
+
+#pragma mark Kernels
+// 16-bit R'G'B' -> 8-bit RGB by table of the 12 MSBs
+template <class RGB>
+static void ToneRow(const UInt8 * rgba64, UInt8 * dst, UInt32 n, const UInt8 * lut) {
+    typedef RGBTraits<kPixelFormatRGBA64> SRC;
+    const UInt16 * src = (const UInt16 *)rgba64;
+    for (UInt32 i = 0; i < n; ++i) {
+        const UInt16 * p    = src + i * 4;
+        UInt8 * q           = dst + i * 4;
+        q[RGB::r]   = lut[p[SRC::r] >> (16 - LUT_BITS)];
+        q[RGB::g]   = lut[p[SRC::g] >> (16 - LUT_BITS)];
+        q[RGB::b]   = lut[p[SRC::b] >> (16 - LUT_BITS)];
+        q[RGB::a]   = 0xFF;
+    }
+}
+
+typedef void (*ToneMapRow)(const UInt8 * rgba64, UInt8 * dst, UInt32 n, const UInt8 * lut);
+
+#define TONE_ROW(FORMAT)    { FORMAT, ToneRow<RGBTraits<FORMAT> > },
+static const struct {
+    UInt32          format;
+    ToneMapRow      row;
+} kToneRows[] = {
+    TONE_ROW(kPixelFormatBGRA)
+    TONE_ROW(kPixelFormatRGBA)
+    TONE_ROW(kPixelFormatARGB)
+    TONE_ROW(kPixelFormatABGR)
+};
+#undef TONE_ROW
+#define NELEM(x)    (sizeof(x) / sizeof(x[0]))
+
+static ToneMapRow GetToneMapRow(UInt32 format) {
+    for (UInt32 i = 0; i < NELEM(kToneRows); ++i) {
+        if (kToneRows[i].format == format) return kToneRows[i].row;
+    }
+    return Nil;
+}
+
+#pragma mark Tone Map Unit
+struct ToneMapUnitContext {
+    const PixelDescriptor * desc;
+    ImageFormat             iformat;
+    ImageFormat             oformat;
+    UInt32                  phase;      // display rect.x in chroma pair
+    ColorRow                color;
+    const ColorParams *     params;
+    ToneMapRow              row;
+    const UInt8 *           lut;
+    UInt8 *                 rgba64;     // converted row
+
+    ToneMapUnitContext() : rgba64(Nil) { }
+
+    void release() {
+        delete [] rgba64;
+        rgba64 = Nil;
+    }
+
+    ~ToneMapUnitContext() { release(); }
+};
+
+static MediaUnitContext ToneMapUnitAlloc() {
+    ToneMapUnitContext * instance = new ToneMapUnitContext;
+    return instance;
+}
+
+static void ToneMapUnitDealloc(MediaUnitContext ref) {
+    ToneMapUnitContext * instance = static_cast<ToneMapUnitContext *>(ref);
+    delete instance;
+}
+
+static MediaError ToneMapUnitInit(MediaUnitContext ref, eTransfer transfer,
+                                  const MediaFormat * iformat, const MediaFormat * oformat) {
+    ToneMapUnitContext * instance = static_cast<ToneMapUnitContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    const ToneMapRow row = GetToneMapRow(out.format);
+    if (row == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    // no scaling
+    if (in.rect.w != out.width || in.rect.h != out.height) {
+        return kMediaErrorNotSupported;
+    }
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // output rect selects the rows to produce
+    if (out.rect.x != 0 || out.rect.w != out.width ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    const YUVLayout * layout = GetYUVLayout(in.format);
+    if (layout == Nil) {
+        return kMediaErrorNotSupported;
+    }
+    const ColorRow color        = GetColorRow(GetColorKernels(), in.format, kPixelFormatRGBA64);
+    const ColorParams * params  = GetColorParams(in.matrix);
+    const UInt8 * lut           = GetToneMapLUT(transfer);
+    if (color == Nil || params == Nil || lut == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    instance->release();
+    instance->desc      = GetImagePixelDescriptor(in.format);
+    instance->iformat   = in;
+    instance->oformat   = out;
+    instance->phase     = layout->layout == kYUVLayoutPlanar ? 0 : (in.rect.x & 1);
+    instance->color     = color;
+    instance->params    = params;
+    instance->row       = row;
+    instance->lut       = lut;
+    instance->rgba64    = new UInt8[(out.width + 1) * 8];
+
+    DEBUG("transfer %u: %s -> %s", transfer,
+          GetImageFormatString(in).c_str(),
+          GetImageFormatString(out).c_str());
+    return kMediaNoError;
+}
+
+static MediaError ToneMapUnitProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    ToneMapUnitContext * instance = static_cast<ToneMapUnitContext *>(ref);
+    const PixelDescriptor * desc    = instance->desc;
+    const ImageFormat& in           = instance->iformat;
+    const ImageFormat& out          = instance->oformat;
+
+    UInt8 * ip[4];
+    UInt32 is[4];
+    UInt8 * op[4];
+    UInt32 os[4];
+    if (GetImagePlaneData(in, input, False, ip, is) != kMediaNoError ||
+        GetImagePlaneData(out, output, True, op, os) != kMediaNoError) {
+        return kMediaErrorBadParameters;
+    }
+
+    // display rect starts at the 2nd pixel of a chroma pair, rows start from
+    // the pair and its 1st pixel is dropped, @see ColorUnitProcess
+    const UInt32 phase  = instance->phase;
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        ip[i]   += (((in.rect.x - phase) / desc->planes[i].hss) * desc->planes[i].bpp) / 8;
+    }
+
+    const UInt32 n      = out.width;
+    const Int32 last    = out.rect.y + out.rect.h;
+    for (Int32 j = out.rect.y; j < last; ++j) {
+        const Int32 row = in.rect.y + j;
+        const UInt8 * y = ip[0] + row * is[0];
+        const UInt8 * u = ip[1] ? ip[1] + (row / desc->planes[1].vss) * is[1] : Nil;
+        const UInt8 * v = ip[2] ? ip[2] + (row / desc->planes[2].vss) * is[2] : Nil;
+        instance->color(y, u, v, instance->rgba64, n + phase, instance->params);
+        instance->row(instance->rgba64 + phase * 8, op[0] + j * os[0], n, instance->lut);
+    }
+    return kMediaNoError;
+}
+
+static MediaError ToneMapUnitReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+// one unit per transfer
+#define TONE_MAP_UNIT(NAME, TRANSFER)                                                   \
+static MediaError ToneMapUnitInit##TRANSFER(MediaUnitContext ref,                       \
+                                            const MediaFormat * iformat,                \
+                                            const MediaFormat * oformat) {              \
+    return ToneMapUnitInit(ref, kTransfer##TRANSFER, iformat, oformat);                 \
+}                                                                                       \
+static const MediaUnit NAME = {                                                         \
+    "tonemap." #TRANSFER,                                                               \
+    0,                                                                                  \
+    kInputFormats,                                                                      \
+    kOutputFormats,                                                                     \
+    ToneMapUnitAlloc,                                                                   \
+    ToneMapUnitDealloc,                                                                 \
+    ToneMapUnitInit##TRANSFER,                                                          \
+    ToneMapUnitProcess,                                                                 \
+    Nil,                                                                                \
+    ToneMapUnitReset,                                                                   \
+};
+
+TONE_MAP_UNIT(kToneMapUnitPQ,       PQ)
+TONE_MAP_UNIT(kToneMapUnitHLG,      HLG)
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+const MediaUnit * ToneMapUnitFind(const eTransfer transfer) {
+    switch (transfer) {
+        case kTransferPQ:   return &kToneMapUnitPQ;
+        case kTransferHLG:  return &kToneMapUnitHLG;
+        default:            return Nil;
+    }
+}
@@ -0,0 +1,76 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    ImageToneMap.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// PQ (SMPTE ST 2084) & HLG (ARIB STD-B67) Y'CbCr -> SDR RGB. the color
+// matrix only gives non-linear R'G'B', without the transfer curve HDR
+// content looks washed out on a SDR display.
+// ImageConverter & ImageBatch pick them up by kKeyTransfer in options.
+//
+
+#ifndef MACYUV_IMAGE_TONE_MAP_H
+#define MACYUV_IMAGE_TONE_MAP_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeyTransfer        = FOURCC('xfer'),       ///< UInt32, @see eTransfer
+};
+
+/**
+ * transfer function of R'G'B'
+ */
+enum {
+    kTransferSDR,                               ///< BT.709 & BT.601, no tone mapping
+    kTransferPQ,                                ///< SMPTE ST 2084, absolute up to 10000 nits
+    kTransferHLG,                               ///< ARIB STD-B67, relative, 1000 nits display
+    kTransferDefault        = kTransferSDR,
+};
+typedef UInt32 eTransfer;
+
+/**
+ * get tone mapping unit of transfer, output 8-bit RGB.
+ * each channel goes through a 4096 entries lookup table of its 12-bit
+ * R' value: EOTF -> nits relative to 203 nits reference white ->
+ * extended Reinhard with 1000 nits peak -> BT.1886 gamma 2.4.
+ * @return return Nil for kTransferSDR or unknown transfer
+ * @note channels are mapped independently, so highlights desaturate a
+ *       little, and BT.2020 primaries are shown as BT.709 ones.
+ */
+API_EXPORT const MediaUnit *    ToneMapUnitFind(const eTransfer);
+
+__END_DECLS
+
+#endif // MACYUV_IMAGE_TONE_MAP_H
@@ -114,9 +114,31 @@ class ImageView: NSImageView {
         }
         
         let imageFormat : UnsafeMutablePointer<ImageFormat> = MediaFrameGetImageFormat(frame)
-        let descriptor : UnsafePointer<PixelDescriptor> = GetPixelFormatDescriptor(imageFormat.pointee.format)
+        let descriptor : UnsafePointer<PixelDescriptor> = GetImagePixelDescriptor(imageFormat.pointee.format)
         
         var data = MediaFrameGetPlaneData(frame, 0)
+        
+        // grey plane, which may be padded and cropped by its rect
+        if imageFormat.pointee.format == kPixelFormatY800 {
+            let height = Swift.Int(imageFormat.pointee.height)
+            let stride = Swift.Int(MediaFrameGetPlaneSize(frame, 0)) / max(1, height)
+            let rect = imageFormat.pointee.rect
+            let greyContext = CGContext.init(data: data,
+                                             width: Swift.Int(imageFormat.pointee.width),
+                                             height: height,
+                                             bitsPerComponent: 8,
+                                             bytesPerRow: stride,
+                                             space: CGColorSpaceCreateDeviceGray(),
+                                             bitmapInfo: CGImageAlphaInfo.none.rawValue)
+            let greyImage = greyContext?.makeImage()?.cropping(to: CGRect.init(x: Swift.Int(rect.x), y: Swift.Int(rect.y),
+                                                                               width: Swift.Int(rect.w), height: Swift.Int(rect.h)))
+            guard greyImage != nil else {
+                self.image = nil
+                return "create cgImage failed."
+            }
+            self.image = NSImage.init(cgImage: greyImage!, size: NSMakeSize(CGFloat(rect.w), CGFloat(rect.h)))
+            return ""
+        }
 //        let bitmap = NSBitmapImageRep.init(bitmapDataPlanes: &data,
 //                                           pixelsWide: Int(imageFormat.pointee.width),
 //                                           pixelsHigh: Int(imageFormat.pointee.height),
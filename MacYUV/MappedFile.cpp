@@ -0,0 +1,148 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    MappedFile.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "MappedFile"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "MappedFile.h"
+#include "PixelFormats.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+struct MappedFileImpl : public MappedFile {
+    UInt8 *             mData;
+    Int64               mLength;
+
+    MappedFileImpl() : MappedFile(), mData(Nil), mLength(0) { }
+
+    virtual ~MappedFileImpl() {
+        if (mData) munmap(mData, mLength);
+    }
+
+    MediaError init(const String& url) {
+        const Char * path = url.c_str();
+        if (strncmp(path, "file://", 7) == 0) {
+            path += 7;
+        } else if (strstr(path, "://") != Nil) {
+            return kMediaErrorNotSupported;
+        }
+
+        Int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            ERROR("open %s failed, %s", path, strerror(errno));
+            return kMediaErrorBadContent;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+            (UInt64)st.st_size > (size_t)-1) {
+            close(fd);
+            return kMediaErrorNotSupported;
+        }
+
+        // private, so units writing to frames inplace get their own pages
+        void * data = mmap(Nil, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        // the mapping keeps the file
+        close(fd);
+        if (data == MAP_FAILED) {
+            ERROR("mmap %s failed, %s", path, strerror(errno));
+            return kMediaErrorNotSupported;
+        }
+
+        mData   = (UInt8 *)data;
+        mLength = st.st_size;
+        INFO("%s mapped, %" PRId64 " bytes", path, mLength);
+        return kMediaNoError;
+    }
+
+    virtual const UInt8 * data() const {
+        return mData;
+    }
+
+    virtual Int64 length() const {
+        return mLength;
+    }
+
+    virtual sp<MediaFrame> frame(const ImageFormat& format, Int64 offset) {
+        const UInt32 bytes = GetImageBytes(format);
+        if (bytes == 0 || offset < 0 || offset + bytes > mLength) {
+            return Nil;
+        }
+
+        // all planes in one buffer
+        MediaBufferList4 planes;
+        planes.list.count           = 1;
+        planes.buffers[0].data      = mData + offset;
+        planes.buffers[0].capacity  = bytes;
+        planes.buffers[0].size      = bytes;
+        return CreateImageFrame(format, planes.list, this);
+    }
+};
+
+sp<MappedFile> OpenMappedFile(const String& url) {
+    sp<MappedFileImpl> file = new MappedFileImpl;
+    if (file->init(url) == kMediaNoError) {
+        return file;
+    }
+    return Nil;
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+MappedFileRef MappedFileOpen(const Char * url) {
+    sp<MappedFile> file = OpenMappedFile(url);
+    if (file.isNil()) return Nil;
+    return file->RetainObject();
+}
+
+Int64 MappedFileGetLength(const MappedFileRef ref) {
+    sp<MappedFile> file = static_cast<MappedFile *>(ref);
+    return file->length();
+}
+
+MediaFrameRef MappedFileCreateFrame(const MappedFileRef ref, const ImageFormat * format, Int64 offset) {
+    sp<MappedFile> file = static_cast<MappedFile *>(ref);
+    sp<MediaFrame> frame = file->frame(*format, offset);
+    if (frame.isNil()) return Nil;
+    return frame->RetainObject();
+}
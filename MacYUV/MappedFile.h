@@ -0,0 +1,85 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    MappedFile.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// local raw files mapped into memory, frames are wrapped on the mapping
+// without copy. pages are loaded by the kernel on access and live in page
+// cache, so big files open at once, and only frames in use take memory.
+//
+
+#ifndef MACYUV_MAPPED_FILE_H
+#define MACYUV_MAPPED_FILE_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+typedef SharedObjectRef         MappedFileRef;
+
+/**
+ * map a local file, path or file:// url
+ * @return return Nil if it is not a local file or can not be mapped
+ */
+API_EXPORT MappedFileRef        MappedFileOpen(const Char * url);
+
+API_EXPORT Int64                MappedFileGetLength(const MappedFileRef);
+
+/**
+ * wrap a frame at offset of file, GetImageFormatBytes() of format
+ * @return return Nil if the file has not enough bytes
+ * @note the frame keeps the mapping alive. pages are private copy on
+ *       write, so writes to the frame never reach the file.
+ */
+API_EXPORT MediaFrameRef        MappedFileCreateFrame(const MappedFileRef, const ImageFormat *, Int64 offset);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+struct MappedFile : public SharedObject {
+    virtual const UInt8 *   data() const = 0;
+    virtual Int64           length() const = 0;
+    virtual sp<MediaFrame>  frame(const ImageFormat&, Int64 offset) = 0;
+
+    protected:
+    MappedFile() : SharedObject(FOURCC('?mmf')) { }
+    virtual ~MappedFile() { }
+};
+
+API_EXPORT sp<MappedFile> OpenMappedFile(const String& url);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_MAPPED_FILE_H
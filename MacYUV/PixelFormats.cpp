@@ -0,0 +1,344 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+
+// File:    PixelFormats.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+
+#define LOG_TAG "PixelFormats"
+#include <ABE/ABE.h>
+
+#include "PixelFormats.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+static const PixelDescriptor kPixelDescriptors[] = {
+    // MediaFramework knows YV24, but has no descriptor for it
+    {
+        "yv24",
+        kPixelFormat444YpCrCbPlanar,
+        { kPixelFormatUnknown, kPixelFormat444YpCbCrPlanar, kPixelFormatUnknown },
+        kColorYpCbCr, 24, 3,
+        { { 8, 1, 1 }, { 8, 1, 1 }, { 8, 1, 1 }, { 0, 0, 0 } }
+    },
+    {
+        "p010",
+        kPixelFormat420YpCbCr10SemiPlanar,
+        { kPixelFormatUnknown, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorYpCbCr, 24, 2,
+        { { 16, 1, 1 }, { 32, 2, 2 }, { 0, 0, 0 }, { 0, 0, 0 } }
+    },
+    {
+        "p016",
+        kPixelFormat420YpCbCr16SemiPlanar,
+        { kPixelFormatUnknown, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorYpCbCr, 24, 2,
+        { { 16, 1, 1 }, { 32, 2, 2 }, { 0, 0, 0 }, { 0, 0, 0 } }
+    },
+    {
+        "i010",
+        kPixelFormat420YpCbCr10PlanarLE,
+        { kPixelFormat420YpCbCr10SemiPlanar, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorYpCbCr, 24, 3,
+        { { 16, 1, 1 }, { 16, 2, 2 }, { 16, 2, 2 }, { 0, 0, 0 } }
+    },
+    {
+        "i210",
+        kPixelFormat422YpCbCr10PlanarLE,
+        { kPixelFormat422YpCbCr10, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorYpCbCr, 32, 3,
+        { { 16, 1, 1 }, { 16, 2, 1 }, { 16, 2, 1 }, { 0, 0, 0 } }
+    },
+    {
+        "i410",
+        kPixelFormat444YpCbCr10PlanarLE,
+        { kPixelFormatUnknown, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorYpCbCr, 48, 3,
+        { { 16, 1, 1 }, { 16, 1, 1 }, { 16, 1, 1 }, { 0, 0, 0 } }
+    },
+    {
+        "i416",
+        kPixelFormat444YpCbCr16Planar,
+        { kPixelFormatUnknown, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorYpCbCr, 48, 3,
+        { { 16, 1, 1 }, { 16, 1, 1 }, { 16, 1, 1 }, { 0, 0, 0 } }
+    },
+    {
+        "y210",
+        kPixelFormat422YpCbCr10,
+        { kPixelFormat422YpCbCr10PlanarLE, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorYpCbCr, 32, 1,
+        { { 32, 1, 1 }, { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } }
+    },
+    {
+        "rgba64",
+        kPixelFormatRGBA64,
+        { kPixelFormatUnknown, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorRGB, 64, 1,
+        { { 64, 1, 1 }, { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } }
+    },
+    {
+        "y800",
+        kPixelFormatY800,
+        { kPixelFormatUnknown, kPixelFormatUnknown, kPixelFormatUnknown },
+        kColorYpCbCr, 8, 1,
+        { { 8, 1, 1 }, { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } }
+    },
+};
+#define NELEM(x)    (sizeof(x) / sizeof(x[0]))
+
+static const PixelDescriptor * FindPixelDescriptor(ePixelFormat format) {
+    for (UInt32 i = 0; i < NELEM(kPixelDescriptors); ++i) {
+        if (kPixelDescriptors[i].format == format) return &kPixelDescriptors[i];
+    }
+    return Nil;
+}
+
+// packed 4:2:2 has 2 pixels in a macro pixel. descriptors of packed formats
+// have no subsampling, so look at chroma of its planar similar format.
+static FORCE_INLINE Bool IsMacroPixel(const PixelDescriptor * desc) {
+    if (desc->color != kColorYpCbCr || desc->nb_planes != 1) return False;
+    const PixelDescriptor * planar = GetImagePixelDescriptor(desc->similar[kPlanar]);
+    return planar != Nil && planar->nb_planes > 1 &&
+           planar->planes[1].hss == 2 && planar->planes[1].vss == 1;
+}
+
+UInt32 GetPlaneStride(const PixelDescriptor * desc, UInt32 plane, Int32 width) {
+    const UInt32 hss = desc->planes[plane].hss;
+    if (IsMacroPixel(desc)) width = (width + 1) & ~1;
+    return (((width + hss - 1) / hss) * desc->planes[plane].bpp) / 8;
+}
+
+UInt32 GetPlaneRows(const PixelDescriptor * desc, UInt32 plane, Int32 height) {
+    const UInt32 vss = desc->planes[plane].vss;
+    return (height + vss - 1) / vss;
+}
+
+static FORCE_INLINE UInt32 GetPlaneBytes(const PixelDescriptor * desc, const ImageFormat& image, UInt32 i) {
+    return GetPlaneStride(desc, i, image.width) * GetPlaneRows(desc, i, image.height);
+}
+
+// MediaFramework's frames split planes with width & height aligned to subsampling
+static Bool IsAligned(const PixelDescriptor * desc, const ImageFormat& image) {
+    if (IsMacroPixel(desc) && (image.width & 1)) return False;
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        if ((image.width % desc->planes[i].hss) || (image.height % desc->planes[i].vss)) {
+            return False;
+        }
+    }
+    return True;
+}
+
+sp<MediaFrame> CreateImageFrame(const ImageFormat& image, const sp<Buffer>& buffer) {
+    const PixelDescriptor * desc = FindPixelDescriptor(image.format);
+    if (desc == Nil) {
+        // MediaFramework's
+        desc = GetPixelFormatDescriptor(image.format);
+        if (desc == Nil || IsAligned(desc, image)) {
+            sp<Buffer> data = buffer;
+            return data.isNil() ? MediaFrame::Create(image) : MediaFrame::Create(image, data);
+        }
+    }
+
+    const UInt32 bytes = GetImageBytes(image);
+    sp<MediaFrame> frame;
+    if (buffer.isNil()) {
+        frame = MediaFrame::Create(bytes);
+    } else {
+        if (buffer->size() < bytes) {
+            ERROR("not enough data for %s, %u/%u", desc->name, (UInt32)buffer->size(), bytes);
+            return Nil;
+        }
+        sp<Buffer> data = buffer;
+        frame = MediaFrame::Create(data);
+    }
+    if (frame.isNil()) return Nil;
+
+    // all planes in one buffer
+    frame->image                    = image;
+    frame->planes.buffers[0].size   = bytes;
+    return frame;
+}
+
+// planes point into memory of owner, storage of planes.buffers follows
+// MediaFrame as its flexible array
+struct PlanesFrame : public MediaFrame {
+    MediaBuffer         mStorage[4];
+    sp<SharedObject>    mOwner;
+
+    PlanesFrame(const sp<SharedObject>& owner) : MediaFrame(), mOwner(owner) {
+        CHECK_TRUE(&planes.buffers[0] == &mStorage[0]);
+    }
+};
+
+sp<MediaFrame> CreateImageFrame(const ImageFormat& image, const ImagePlaneLayout& layout, const sp<Buffer>& buffer) {
+    const PixelDescriptor * desc = GetImagePixelDescriptor(image.format);
+    if (desc == Nil || desc->nb_planes > 4 || buffer.isNil()) return Nil;
+
+    UInt8 * data = (UInt8 *)buffer->data();
+    sp<PlanesFrame> frame = new PlanesFrame(buffer);
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        const UInt32 rows = GetPlaneRows(desc, i, image.height);
+        const UInt32 bytes = layout.stride[i] * rows;
+        if (layout.stride[i] < GetPlaneStride(desc, i, image.width) ||
+            layout.offset[i] + bytes > buffer->size()) {
+            ERROR("bad layout of %s plane %u, stride %u, offset %u",
+                  desc->name, i, layout.stride[i], layout.offset[i]);
+            return Nil;
+        }
+        frame->mStorage[i].data     = data + layout.offset[i];
+        frame->mStorage[i].capacity = bytes;
+        frame->mStorage[i].size     = bytes;
+    }
+    frame->planes.count = desc->nb_planes;
+    frame->image        = image;
+    return frame;
+}
+
+sp<MediaFrame> CreateImageFrame(const ImageFormat& image, const MediaBufferList& planes, const sp<SharedObject>& owner) {
+    const PixelDescriptor * desc = GetImagePixelDescriptor(image.format);
+    if (desc == Nil || planes.count > 4 || owner.isNil()) return Nil;
+    if (planes.count != desc->nb_planes && planes.count != 1) return Nil;
+
+    sp<PlanesFrame> frame = new PlanesFrame(owner);
+    for (UInt32 i = 0; i < planes.count; ++i) {
+        frame->mStorage[i] = planes.buffers[i];
+    }
+    frame->planes.count = planes.count;
+    frame->image        = image;
+    return frame;
+}
+
+UInt32 GetImageBytes(const ImageFormat& image) {
+    const PixelDescriptor * desc = GetImagePixelDescriptor(image.format);
+    if (desc == Nil) return 0;
+
+    UInt32 bytes = 0;
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        bytes += GetPlaneBytes(desc, image, i);
+    }
+    return bytes;
+}
+
+UInt32 GetImagePlanes(const ImageFormat& image, UInt8 * data, MediaBufferList4& planes) {
+    const PixelDescriptor * desc = GetImagePixelDescriptor(image.format);
+    planes.list.count = 0;
+    if (desc == Nil || desc->nb_planes > 4) return 0;
+
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        const UInt32 bytes          = GetPlaneBytes(desc, image, i);
+        planes.buffers[i].data      = data;
+        planes.buffers[i].capacity  = bytes;
+        planes.buffers[i].size      = bytes;
+        data += bytes;
+    }
+    planes.list.count = desc->nb_planes;
+    return desc->nb_planes;
+}
+
+MediaError GetImagePlaneData(const ImageFormat& image, const MediaBufferList * buffers, Bool output,
+                             UInt8 * planes[4], UInt32 strides[4]) {
+    const PixelDescriptor * desc = GetImagePixelDescriptor(image.format);
+    if (desc == Nil || desc->nb_planes > 4) return kMediaErrorNotSupported;
+
+    const Bool contiguous = buffers->count == 1 && desc->nb_planes > 1;
+    if (buffers->count < desc->nb_planes && !contiguous) {
+        return kMediaErrorBadParameters;
+    }
+
+    for (UInt32 i = 0; i < 4; ++i) {
+        planes[i]   = Nil;
+        strides[i]  = 0;
+    }
+
+    UInt32 offset = 0;
+    for (UInt32 i = 0; i < desc->nb_planes; ++i) {
+        const MediaBuffer& buffer = buffers->buffers[contiguous ? 0 : i];
+        const UInt32 rows   = GetPlaneRows(desc, i, image.height);
+        UInt32 stride       = GetPlaneStride(desc, i, image.width);
+        // plane is tight, or padded by ImagePlaneLayout which holds exactly
+        // its rows, any other size is ambiguous
+        if (!output && !contiguous && buffer.size != stride * rows) {
+            if (buffer.size < stride * rows || buffer.size % rows) {
+                return kMediaErrorBadParameters;
+            }
+            stride          = buffer.size / rows;
+        }
+        const UInt32 bytes  = stride * rows;
+        const UInt32 start  = contiguous ? offset : 0;
+        if ((output ? buffer.capacity : buffer.size) < start + bytes) {
+            return kMediaErrorBadParameters;
+        }
+        planes[i]           = buffer.data + start;
+        strides[i]          = stride;
+        offset              += bytes;
+    }
+    return kMediaNoError;
+}
+
+void SetImagePlaneSizes(const ImageFormat& image, MediaBufferList * buffers) {
+    const PixelDescriptor * desc = GetImagePixelDescriptor(image.format);
+    if (desc == Nil) return;
+
+    if (buffers->count == 1 && desc->nb_planes > 1) {
+        buffers->buffers[0].size = GetImageBytes(image);
+        return;
+    }
+    for (UInt32 i = 0; i < desc->nb_planes && i < buffers->count; ++i) {
+        buffers->buffers[i].size = GetPlaneBytes(desc, image, i);
+    }
+}
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+const PixelDescriptor * GetImagePixelDescriptor(ePixelFormat format) {
+    const PixelDescriptor * desc = FindPixelDescriptor(format);
+    if (desc) return desc;
+    return GetPixelFormatDescriptor(format);
+}
+
+MediaFrameRef ImageFrameCreate(const ImageFormat * image, BufferObjectRef buffer) {
+    sp<MediaFrame> frame = CreateImageFrame(*image, static_cast<Buffer *>(buffer));
+    if (frame.isNil()) return Nil;
+    return frame->RetainObject();
+}
+
+MediaFrameRef ImageFrameCreateWithLayout(const ImageFormat * image, const ImagePlaneLayout * layout, BufferObjectRef buffer) {
+    sp<MediaFrame> frame = CreateImageFrame(*image, *layout, static_cast<Buffer *>(buffer));
+    if (frame.isNil()) return Nil;
+    return frame->RetainObject();
+}
+
+UInt32 GetImageFormatBytes(const ImageFormat * image) {
+    return GetImageBytes(*image);
+}
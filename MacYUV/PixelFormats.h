@@ -0,0 +1,164 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+
+// File:    PixelFormats.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// pixel formats not in MediaFramework's table, high bit depth mostly.
+// MediaFrame of these formats holds all planes in one buffer, which our
+// image units split by descriptor.
+//
+
+#ifndef MACYUV_PIXEL_FORMATS_H
+#define MACYUV_PIXEL_FORMATS_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaFrame.h>
+#include <MediaFramework/MediaFramework.h>
+
+__BEGIN_DECLS
+
+/**
+ * 16 bits samples are in little endian, with significant bits in LSBs or
+ * MSBs as noted.
+ */
+enum {
+    /** Y'CbCr high bit depth family **/
+    kPixelFormat420YpCbCr10SemiPlanar   = FOURCC('P010'),   ///< Planar Y'CbCr 10-bit 4:2:0, 24bpp, 2 planes: Y'/Cb&Cr(interleaved), MSBs
+    kPixelFormat420YpCbCr16SemiPlanar   = FOURCC('P016'),   ///< Planar Y'CbCr 16-bit 4:2:0, 24bpp, 2 planes: Y'/Cb&Cr(interleaved)
+    kPixelFormat420YpCbCr10PlanarLE     = FOURCC('I010'),   ///< Planar Y'CbCr 10-bit 4:2:0, 24bpp, 3 planes: Y'/Cb/Cr, LSBs
+    kPixelFormat422YpCbCr10PlanarLE     = FOURCC('I210'),   ///< Planar Y'CbCr 10-bit 4:2:2, 32bpp, 3 planes: Y'/Cb/Cr, LSBs
+    kPixelFormat444YpCbCr10PlanarLE     = FOURCC('I410'),   ///< Planar Y'CbCr 10-bit 4:4:4, 48bpp, 3 planes: Y'/Cb/Cr, LSBs
+    kPixelFormat444YpCbCr16Planar       = FOURCC('I416'),   ///< Planar Y'CbCr 16-bit 4:4:4, 48bpp, 3 planes: Y'/Cb/Cr
+    kPixelFormat422YpCbCr10             = FOURCC('Y210'),   ///< Packed Y'CbCr 10-bit 4:2:2, 32bpp, Y'0 Cb Y'1 Cr, MSBs
+
+    /** RGB high bit depth family **/
+    kPixelFormatRGBA64                  = FOURCC('RG64'),   ///< packed RGBA, 64 bpp, 16-bit RRGGBBAA, RGBA in sample-order
+
+    /** grey **/
+    kPixelFormatY800                    = FOURCC('Y800'),   ///< Y' only 8-bit, 8bpp, 1 plane, aka grey
+};
+
+/**
+ * get descriptor of pixel format, ours first, then MediaFramework's
+ * @return return Nil if pixel format is unknown
+ */
+API_EXPORT const PixelDescriptor *  GetImagePixelDescriptor(ePixelFormat);
+
+/**
+ * create an image frame for any pixel format known by GetImagePixelDescriptor
+ * @param buffer    image data, Nil to allocate a new one
+ */
+API_EXPORT MediaFrameRef            ImageFrameCreate(const ImageFormat *, BufferObjectRef buffer);
+
+/**
+ * layout of planes in a buffer, for frames with row or plane padding, e.g.
+ * 1920x1080 NV12 with 2048 bytes per row and chroma starts at row 1088.
+ */
+typedef struct ImagePlaneLayout {
+    UInt32              offset[4];      ///< start of each plane in buffer
+    UInt32              stride[4];      ///< bytes per row of each plane
+} ImagePlaneLayout;
+
+/**
+ * wrap a buffer with padded planes as an image frame, without copy.
+ * @note each plane buffer holds exactly its rows, stride = size / rows,
+ *       which is respected by all our units.
+ */
+API_EXPORT MediaFrameRef            ImageFrameCreateWithLayout(const ImageFormat *, const ImagePlaneLayout *, BufferObjectRef buffer);
+
+/**
+ * get bytes of all planes of an image, any width & height
+ * @return return 0 if pixel format is unknown
+ */
+API_EXPORT UInt32                   GetImageFormatBytes(const ImageFormat *);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+API_EXPORT sp<MediaFrame> CreateImageFrame(const ImageFormat&, const sp<Buffer>& = Nil);
+API_EXPORT sp<MediaFrame> CreateImageFrame(const ImageFormat&, const ImagePlaneLayout&, const sp<Buffer>&);
+
+/**
+ * create a frame on planes of another object, without copy
+ * @param owner keeps memory of planes alive, e.g. the frame planes come from
+ */
+API_EXPORT sp<MediaFrame> CreateImageFrame(const ImageFormat&, const MediaBufferList&, const sp<SharedObject>& owner);
+
+// MediaBufferList with storage for all planes
+struct MediaBufferList4 {
+    MediaBufferList     list;
+    MediaBuffer         buffers[4];
+};
+
+/**
+ * bytes per row & rows of a plane. subsampled planes round up for odd
+ * width & height, and packed Y'CbCr rounds up to whole macro pixels.
+ */
+API_EXPORT UInt32 GetPlaneStride(const PixelDescriptor *, UInt32 plane, Int32 width);
+API_EXPORT UInt32 GetPlaneRows(const PixelDescriptor *, UInt32 plane, Int32 height);
+
+/**
+ * get bytes of all planes of an image
+ * @return return 0 if pixel format is unknown
+ */
+API_EXPORT UInt32 GetImageBytes(const ImageFormat&);
+
+/**
+ * split image memory into planes, one after another
+ * @param data  at least GetImageBytes() bytes
+ * @return return number of planes, with sizes set to full plane
+ */
+API_EXPORT UInt32 GetImagePlanes(const ImageFormat&, UInt8 * data, MediaBufferList4&);
+
+/**
+ * get planes & strides of an image in buffers, one buffer per plane or all
+ * planes in one buffer one after another, @see CreateImageFrame
+ * @param output    check buffer capacity instead of data size
+ * @note input planes in their own buffers are tight, or padded by
+ *       ImagePlaneLayout with exactly stride * rows bytes each
+ * @return return kMediaErrorBadParameters if buffers are too small, or input
+ *         planes are neither tight nor stride * rows
+ */
+API_EXPORT MediaError GetImagePlaneData(const ImageFormat&, const MediaBufferList *, Bool output,
+                                        UInt8 * planes[4], UInt32 strides[4]);
+
+/**
+ * set data size of all planes after an image is written
+ */
+API_EXPORT void SetImagePlaneSizes(const ImageFormat&, MediaBufferList *);
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_PIXEL_FORMATS_H
@@ -29,7 +29,30 @@ class ViewController: NSViewController {
     @IBOutlet weak var frameSlider: NSSlider!
     @IBOutlet weak var frameNumberText: NSTextField!
     
-    var imageBuffer : BufferObjectRef?
+    var reader : FrameReaderRef?
+    // frames carry format, so a new prefetcher for any change of it but
+    // display rect, which is set on each frame read
+    var prefetcher : FramePrefetcherRef?
+    var prefetcherFormat = ImageFormat.init()
+    var tiler : MediaDeviceRef?
+    var tilerFormat = ImageFormat.init()
+    // clockwise, 'r' to rotate by 90 degrees
+    var rotation = eRotate(kRotate0)
+    var rotator : MediaDeviceRef?
+    var rotatorFormat = ImageFormat.init()
+    var rotatorRotation = eRotate(kRotate0)
+    // 's' to show statistics of luma or green
+    var isStatsEnabled = false
+    var statistics : ImageStatisticsRef?
+    var statisticsFormat = ImageFormat.init()
+    var statisticsText = ""
+    // 't' to tone map PQ or HLG content
+    var transfer = eTransfer(kTransferSDR)
+    // 'p' to view Y', Cb or Cr as grey, -1 for all
+    var viewPlane : Int32 = -1
+    var planeView : MediaDeviceRef?
+    var planeViewFormat = ImageFormat.init()
+    var planeViewIndex : Int32 = -1
     
     var isRectEnabled : Swift.Bool {
         get {
@@ -57,6 +80,13 @@ class ViewController: NSViewController {
         kPixelFormat422YpCrCb,
         kPixelFormat422YpCbCrWO,
         kPixelFormat422YpCrCbWO,
+        // high bit depth pixels
+        ePixelFormat(rawValue: UInt32(kPixelFormat420YpCbCr10SemiPlanar)),
+        ePixelFormat(rawValue: UInt32(kPixelFormat420YpCbCr16SemiPlanar)),
+        ePixelFormat(rawValue: UInt32(kPixelFormat420YpCbCr10PlanarLE)),
+        ePixelFormat(rawValue: UInt32(kPixelFormat422YpCbCr10PlanarLE)),
+        ePixelFormat(rawValue: UInt32(kPixelFormat444YpCbCr10PlanarLE)),
+        ePixelFormat(rawValue: UInt32(kPixelFormat422YpCbCr10)),
     ]
     
     var isYUV : Swift.Bool {
@@ -93,6 +123,8 @@ class ViewController: NSViewController {
         (kColorMatrixBT709,     "BT709"),
         (kColorMatrixBT2020,    "BT2020"),
         (kColorMatrixJPEG,      "JPEG"),
+        (eColorMatrix(rawValue: UInt32(kColorMatrixBT709Full)),    "BT709 Full"),
+        (eColorMatrix(rawValue: UInt32(kColorMatrixBT2020Full)),   "BT2020 Full"),
     ]
     
     var colorMatrix : eColorMatrix {
@@ -254,7 +286,7 @@ class ViewController: NSViewController {
         
         yuvItems.removeAllItems()
         for yuv in YUVs {
-            let desc = GetPixelFormatDescriptor(yuv)
+            let desc = GetImagePixelDescriptor(yuv)
             yuvItems.addItem(withTitle: String.init(cString: desc!.pointee.name))
         }
         
@@ -265,7 +297,7 @@ class ViewController: NSViewController {
         
         rgbItems.removeAllItems()
         for rgb in RGBs {
-            let desc = GetPixelFormatDescriptor(rgb)
+            let desc = GetImagePixelDescriptor(rgb)
             rgbItems.addItem(withTitle: String.init(cString: desc!.pointee.name))
         }
         
@@ -316,18 +348,19 @@ class ViewController: NSViewController {
     
     var imageBytes : Int32 {
         get {
-            let descriptor = GetPixelFormatDescriptor(imageFormat.format)
-            return (imageFormat.width * imageFormat.height * Int32(descriptor!.pointee.bpp)) / 8
+            // subsampled planes round up for odd sizes
+            var format = imageFormat
+            return Int32(GetImageFormatBytes(&format))
         }
     }
     
     var numFrames : Int64 {
         get {
-            guard imageBuffer != nil else {
+            guard reader != nil else {
                 // no files opened
                 return 1
             }
-            let dataLength = BufferObjectGetCapacity(imageBuffer)
+            let dataLength = FrameReaderGetLength(reader)
             guard dataLength >= imageBytes else {
                 return 1
             }
@@ -335,48 +368,123 @@ class ViewController: NSViewController {
         }
     }
     
+    // display rect size, scaled down to view pixels if it is larger
+    func displaySize() -> (Int32, Int32) {
+        let w = imageFormat.rect.w
+        let h = imageFormat.rect.h
+        let scale = self.view.window?.backingScaleFactor ?? 1.0
+        let pixels = Int32(imageView.bounds.width * scale)
+        if pixels <= 0 || pixels >= w {
+            return (w, h)
+        }
+        return (pixels, max(1, (h * pixels) / w))
+    }
+    
     func prepareImage(index: Int32) -> (MediaFrameRef?, String) {
 //        if imageFormat.width != imageFormat.rect.x + imageFormat.rect.w ||
 //            imageFormat.height != imageFormat.rect.y + imageFormat.rect.h {
 //            return (nil, "bad image display values")
 //        }
         
-        BufferObjectResetBytes(imageBuffer)
-        if (index > 0) {
-            BufferObjectSkipBytes(imageBuffer, Int64(imageBytes * index))
+        // switch plane of the frame in plane view, without read it again
+        if viewPlane >= 0 && planeView != nil && planeViewIndex == index && samePlaneViewFormat() {
+            let outputImage = preparePlane(image: nil)
+            if outputImage != nil {
+                return (outputImage, "")
+            }
         }
-        let imageData = BufferObjectReadBytes(imageBuffer, UInt32(imageBytes))
-        guard imageData != nil else {
-            return (nil, "read image data failed. bad file?")
+        
+        if prefetcher == nil || !isSameFormat(prefetcherFormat, imageFormat) {
+            releasePrefetcher()
+            prefetcher = FramePrefetcherCreate(reader, &imageFormat, nil)
+            prefetcherFormat = imageFormat
+        }
+        guard prefetcher != nil else {
+            return (nil, "bad image format")
         }
         
-        let bytes = BufferObjectGetDataLength(imageData)
-        guard bytes == imageBytes  else {
-            SharedObjectRelease(imageData)
-            return (nil, "not enough data, " + String(bytes) + "/" + String(imageBytes))
+        // neighbours are read ahead in background
+        let originImage = FramePrefetcherReadFrame(prefetcher, Int64(index))
+        guard originImage != nil else {
+            return (nil, "read frame " + String(index + 1) + " failed. bad file?")
+        }
+        MediaFrameGetImageFormat(originImage)!.pointee.rect = imageFormat.rect
+        return prepareFrame(originImage: originImage, index: index)
+    }
+    
+    // statistics, plane view, rotate, tone map or convert
+    func prepareFrame(originImage: MediaFrameRef?, index: Int32) -> (MediaFrameRef?, String) {
+        statisticsText = isStatsEnabled ? prepareStatistics(image: originImage!) : ""
+        
+        if viewPlane >= 0 {
+            let outputImage = preparePlane(image: originImage!)
+            SharedObjectRelease(originImage)
+            planeViewIndex = outputImage != nil ? index : -1
+            
+            guard outputImage != nil else {
+                return (nil, "plane view failed.")
+            }
+            return (outputImage, "")
         }
         
-        //var format = imageFormat
-        let originImage = MediaFrameCreateWithImageBuffer(&imageFormat, imageData)
-        SharedObjectRelease(imageData)
+        // rotate & convert in one pass
+        if rotation != eRotate(kRotate0) {
+            let outputImage = prepareRotated(image: originImage!)
+            SharedObjectRelease(originImage)
+            
+            guard outputImage != nil else {
+                return (nil, "rotate failed.")
+            }
+            return (outputImage, "")
+        }
         
-        guard originImage != nil else {
-            return (nil, "prepare image failed, bad format?")
+        // HDR in display rect, scaled by the view
+        if transfer != eTransfer(kTransferSDR) {
+            let outputImage = prepareToneMapped(image: originImage!)
+            if outputImage != nil {
+                SharedObjectRelease(originImage)
+                return (outputImage, "")
+            }
         }
         
-        // do color convert or crop
+        // never convert more pixels than the view can show
+        let display = displaySize()
+        
+        // zoomed in, convert visible tiles only
+        if imageFormat.format != imageView.pixelFormat &&
+            display.0 == imageFormat.rect.w && display.1 == imageFormat.rect.h &&
+            (imageFormat.rect.w != imageFormat.width || imageFormat.rect.h != imageFormat.height) {
+            let outputImage = prepareTiles(image: originImage!, index: index)
+            SharedObjectRelease(originImage)
+            
+            guard outputImage != nil else {
+                return (nil, "tile convert failed.")
+            }
+            return (outputImage, "")
+        }
+        
+        // do color convert, crop or scale
         if imageFormat.format != imageView.pixelFormat ||
-            imageFormat.rect.x != 0 || imageFormat.rect.y != 0 {
+            imageFormat.rect.x != 0 || imageFormat.rect.y != 0 ||
+            display.0 != imageFormat.rect.w || display.1 != imageFormat.rect.h {
             var outputFormat = ImageFormat.init()
             outputFormat.format     = imageView.pixelFormat
-            outputFormat.width      = imageFormat.rect.w
-            outputFormat.height     = imageFormat.rect.h
+            outputFormat.width      = display.0
+            outputFormat.height     = display.1
             outputFormat.rect.x     = 0
             outputFormat.rect.y     = 0
             outputFormat.rect.w     = outputFormat.width
             outputFormat.rect.h     = outputFormat.height
             
-            let cc : MediaDeviceRef? = ColorConverterCreate(&imageFormat, &outputFormat, nil)
+            var cc : MediaDeviceRef? = ImageConverterObtain(&imageFormat, &outputFormat, nil)
+            if cc == nil && (display.0 != imageFormat.rect.w || display.1 != imageFormat.rect.h) {
+                // no unit can scale this format, convert display rect & scale by the view
+                outputFormat.width  = imageFormat.rect.w
+                outputFormat.height = imageFormat.rect.h
+                outputFormat.rect.w = outputFormat.width
+                outputFormat.rect.h = outputFormat.height
+                cc = ImageConverterObtain(&imageFormat, &outputFormat, nil)
+            }
             guard cc != nil else {
                 return (nil, "create color converter failed.")
             }
@@ -396,6 +504,202 @@ class ViewController: NSViewController {
         }
     }
     
+    // tiles are cached per frame index, until frame geometry changed
+    func prepareTiles(image: MediaFrameRef, index: Int32) -> MediaFrameRef? {
+        if tiler == nil || tilerFormat.format != imageFormat.format ||
+            tilerFormat.matrix != imageFormat.matrix ||
+            tilerFormat.width != imageFormat.width || tilerFormat.height != imageFormat.height {
+            releaseTiler()
+            tiler = ImageTilerCreate(&imageFormat, imageView.pixelFormat, nil)
+            tilerFormat = imageFormat
+        }
+        guard tiler != nil else {
+            return nil
+        }
+        
+        let options = MessageObjectCreate()
+        MessageObjectPutInt64(options, UInt32(kKeyTileFrame), Int64(index))
+        MediaDeviceConfigure(tiler, options)
+        SharedObjectRelease(options)
+        
+        guard MediaDevicePush(tiler, image) == MediaError(kMediaNoError) else {
+            return nil
+        }
+        return MediaDevicePull(tiler)
+    }
+    
+    // rotator is kept until frame format, display rect or rotation changed
+    func prepareRotated(image: MediaFrameRef) -> MediaFrameRef? {
+        if rotator == nil || rotatorRotation != rotation ||
+            !isSameFormat(rotatorFormat, imageFormat) || !isSameRect(rotatorFormat, imageFormat) {
+            releaseRotator()
+            let transposed = rotation == eRotate(kRotate90) || rotation == eRotate(kRotate270)
+            var outputFormat = ImageFormat.init()
+            outputFormat.format     = imageView.pixelFormat
+            outputFormat.width      = transposed ? imageFormat.rect.h : imageFormat.rect.w
+            outputFormat.height     = transposed ? imageFormat.rect.w : imageFormat.rect.h
+            outputFormat.rect.x     = 0
+            outputFormat.rect.y     = 0
+            outputFormat.rect.w     = outputFormat.width
+            outputFormat.rect.h     = outputFormat.height
+            
+            let options = MessageObjectCreate()
+            MessageObjectPutInt32(options, UInt32(kKeyRotate), Int32(bitPattern: rotation))
+            rotator = ImageRotatorCreate(&imageFormat, &outputFormat, options)
+            SharedObjectRelease(options)
+            rotatorFormat = imageFormat
+            rotatorRotation = rotation
+        }
+        guard rotator != nil else {
+            return nil
+        }
+        
+        guard MediaDevicePush(rotator, image) == MediaError(kMediaNoError) else {
+            return nil
+        }
+        return MediaDevicePull(rotator)
+    }
+    
+    func releaseRotator() {
+        if (rotator != nil) {
+            SharedObjectRelease(rotator)
+            rotator = nil
+        }
+    }
+    
+    // nil if not Y'CbCr, then it is shown as SDR
+    func prepareToneMapped(image: MediaFrameRef) -> MediaFrameRef? {
+        var outputFormat = ImageFormat.init()
+        outputFormat.format     = imageView.pixelFormat
+        outputFormat.width      = imageFormat.rect.w
+        outputFormat.height     = imageFormat.rect.h
+        outputFormat.rect.x     = 0
+        outputFormat.rect.y     = 0
+        outputFormat.rect.w     = outputFormat.width
+        outputFormat.rect.h     = outputFormat.height
+        
+        // transfer is part of the cache key, no new converter per frame
+        let options = MessageObjectCreate()
+        MessageObjectPutInt32(options, UInt32(kKeyTransfer), Int32(bitPattern: transfer))
+        let cc = ImageConverterObtain(&imageFormat, &outputFormat, options)
+        SharedObjectRelease(options)
+        guard cc != nil else {
+            return nil
+        }
+        
+        var outputImage : MediaFrameRef? = nil
+        if MediaDevicePush(cc, image) == MediaError(kMediaNoError) {
+            outputImage = MediaDevicePull(cc)
+        }
+        SharedObjectRelease(cc)
+        return outputImage
+    }
+    
+    // frame geometry, display rect excluded
+    func isSameFormat(_ a: ImageFormat, _ b: ImageFormat) -> Swift.Bool {
+        return a.format == b.format && a.matrix == b.matrix &&
+            a.width == b.width && a.height == b.height
+    }
+    
+    func isSameRect(_ a: ImageFormat, _ b: ImageFormat) -> Swift.Bool {
+        return a.rect.x == b.rect.x && a.rect.y == b.rect.y &&
+            a.rect.w == b.rect.w && a.rect.h == b.rect.h
+    }
+    
+    func samePlaneViewFormat() -> Swift.Bool {
+        return isSameFormat(planeViewFormat, imageFormat) && isSameRect(planeViewFormat, imageFormat)
+    }
+    
+    func releasePrefetcher() {
+        if (prefetcher != nil) {
+            SharedObjectRelease(prefetcher)
+            prefetcher = nil
+        }
+    }
+    
+    // grey image of viewPlane, nil image to view the last pushed frame again
+    func preparePlane(image: MediaFrameRef?) -> MediaFrameRef? {
+        if planeView == nil || !samePlaneViewFormat() {
+            releasePlaneView()
+            // luma of planar & semi-planar is shown without copy in grey
+            planeView = ImagePlaneViewCreate(&imageFormat, kPixelFormatY800, nil)
+            planeViewFormat = imageFormat
+        }
+        guard planeView != nil else {
+            return nil
+        }
+        
+        let options = MessageObjectCreate()
+        MessageObjectPutInt32(options, UInt32(kKeyViewPlane), viewPlane)
+        let st = MediaDeviceConfigure(planeView, options)
+        SharedObjectRelease(options)
+        guard st == MediaError(kMediaNoError) else {
+            return nil
+        }
+        
+        if image != nil {
+            guard MediaDevicePush(planeView, image) == MediaError(kMediaNoError) else {
+                return nil
+            }
+        }
+        return MediaDevicePull(planeView)
+    }
+    
+    func releasePlaneView() {
+        if (planeView != nil) {
+            SharedObjectRelease(planeView)
+            planeView = nil
+        }
+        planeViewIndex = -1
+    }
+    
+    // statistics of display rect, first plane is Y' or R, so G for RGB
+    func prepareStatistics(image: MediaFrameRef) -> String {
+        if statistics == nil || statisticsFormat.format != imageFormat.format ||
+            statisticsFormat.width != imageFormat.width || statisticsFormat.height != imageFormat.height ||
+            statisticsFormat.rect.x != imageFormat.rect.x || statisticsFormat.rect.y != imageFormat.rect.y ||
+            statisticsFormat.rect.w != imageFormat.rect.w || statisticsFormat.rect.h != imageFormat.rect.h {
+            releaseStatistics()
+            statistics = ImageStatisticsCreate(&imageFormat, nil)
+            statisticsFormat = imageFormat
+        }
+        guard statistics != nil else {
+            return "statistics n/a"
+        }
+        
+        let result = ImageStatisticsProcess(statistics, image)
+        guard result != nil else {
+            return "statistics failed"
+        }
+        let planes = MessageObjectGetInt32(result, UInt32(kKeyStatsPlanes), 0)
+        let plane = MessageObjectGetObject(result, UInt32(kKeyStatsPlane) + (planes > 3 ? 1 : 0), nil)
+        var line = ""
+        if plane != nil {
+            let min = MessageObjectGetInt32(plane, UInt32(kKeyStatsMin), 0)
+            let max = MessageObjectGetInt32(plane, UInt32(kKeyStatsMax), 0)
+            let mean = MessageObjectGetDouble(plane, UInt32(kKeyStatsMean), 0)
+            let variance = MessageObjectGetDouble(plane, UInt32(kKeyStatsVariance), 0)
+            line = (planes > 3 ? "G " : "Y' ") + String(min) + "-" + String(max) +
+                String(format: " mean %.1f sd %.1f", mean, variance.squareRoot())
+        }
+        SharedObjectRelease(result)
+        return line
+    }
+    
+    func releaseStatistics() {
+        if (statistics != nil) {
+            SharedObjectRelease(statistics)
+            statistics = nil
+        }
+    }
+    
+    func releaseTiler() {
+        if (tiler != nil) {
+            SharedObjectRelease(tiler)
+            tiler = nil
+        }
+    }
+    
     func drawImage(index: Int32) {
         let image = prepareImage(index: index)
         
@@ -413,7 +717,10 @@ class ViewController: NSViewController {
         if self.view.isInFullScreenMode == false {
             let frame = self.view.window?.frame
             if frame != nil {
-                let ratio = CGFloat(format.pointee.height) / CGFloat(format.pointee.width)
+                // grey planes are cropped by rect, @see ImageView.drawFrame
+                let grey = format.pointee.format == kPixelFormatY800
+                let ratio = grey ? CGFloat(format.pointee.rect.h) / CGFloat(format.pointee.rect.w) :
+                    CGFloat(format.pointee.height) / CGFloat(format.pointee.width)
                 // keep width, change height
                 let size = NSSize.init(width: frame!.width, height: frame!.width * ratio)
                 // set aspectRatio will NOT take effect immediately, so setFrame first
@@ -425,6 +732,9 @@ class ViewController: NSViewController {
         
         statusText = imageView.drawFrame(frame: image.0!)
         SharedObjectRelease(image.0)
+        if statisticsText != "" {
+            statusText = statusText == "" ? statisticsText : statusText + ", " + statisticsText
+        }
         
         // show frame number
         showFrameNumber(num: index + 1, den: Int32(numFrames))
@@ -456,14 +766,14 @@ class ViewController: NSViewController {
         
         isUIHidden = false
         
-        imageBuffer = BufferObjectCreateWithUrl(url)
+        reader = FrameReaderCreate(url)
         
-        guard imageBuffer != nil else {
+        guard reader != nil else {
             statusText = "open \(url) failed"
             return
         }
     
-        let lucky = luckyGuess(size: BufferObjectGetDataLength(imageBuffer))
+        let lucky = luckyGuess(size: FrameReaderGetLength(reader))
         if (lucky != nil) {
             print("lucky => ", lucky!)
             
@@ -483,10 +793,16 @@ class ViewController: NSViewController {
     }
     
     func closeFile() {
-        if (imageBuffer != nil) {
-            SharedObjectRelease(imageBuffer)
-            imageBuffer = nil
+        releasePrefetcher()
+        if (reader != nil) {
+            SharedObjectRelease(reader)
+            reader = nil
         }
+        releaseTiler()
+        releaseRotator()
+        releaseStatistics()
+        releasePlaneView()
+        ImageConverterCacheFlush()
         statusText = ""
     }
     
@@ -620,7 +936,6 @@ class ViewController: NSViewController {
         var w = Int32(CGFloat(format.width) / scale)
         if w > format.width { w = format.width }
         else if w < 32 { w = 32 }   // CGImage min pixels
-        else { w = (w / 16) * 16 }  // color converter require row align 16 bytes
         
         // always keep aspect ratio
         let h = (format.height * w) / format.width
@@ -686,6 +1001,30 @@ class ViewController: NSViewController {
             }
             frameSlider.intValue = index
             drawImage(index: index)
+        } else if event.charactersIgnoringModifiers == "r" {
+            let next : [eRotate : eRotate] = [
+                eRotate(kRotate0)   : eRotate(kRotate90),
+                eRotate(kRotate90)  : eRotate(kRotate180),
+                eRotate(kRotate180) : eRotate(kRotate270),
+                eRotate(kRotate270) : eRotate(kRotate0),
+            ]
+            rotation = next[rotation] ?? eRotate(kRotate0)
+            drawImage(index: frameSlider.intValue)
+        } else if event.charactersIgnoringModifiers == "s" {
+            isStatsEnabled = !isStatsEnabled
+            drawImage(index: frameSlider.intValue)
+        } else if event.charactersIgnoringModifiers == "p" {
+            // all -> Y' -> Cb -> Cr -> all
+            viewPlane = viewPlane >= 2 ? -1 : viewPlane + 1
+            drawImage(index: frameSlider.intValue)
+        } else if event.charactersIgnoringModifiers == "t" {
+            let next : [eTransfer : eTransfer] = [
+                eTransfer(kTransferSDR) : eTransfer(kTransferPQ),
+                eTransfer(kTransferPQ)  : eTransfer(kTransferHLG),
+                eTransfer(kTransferHLG) : eTransfer(kTransferSDR),
+            ]
+            transfer = next[transfer] ?? eTransfer(kTransferSDR)
+            drawImage(index: frameSlider.intValue)
         }
     }
 }
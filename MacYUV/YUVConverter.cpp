@@ -0,0 +1,407 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    YUVConverter.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// each source row is converted once by the row kernels into Y' and full
+// width Cb/Cr in Q6, which are kept in a ring of rows. chroma rows sum the
+// ring rows vertically, then are filtered & decimated horizontally, so
+// output is rounded only once.
+//
+
+#define LOG_TAG "YUVConverter"
+//#define LOG_NDEBUG 0
+#include <ABE/ABE.h>
+#include <string.h>
+
+#include "YUVConverter.h"
+#include "ColorKernels.h"
+#include "PixelFormats.h"
+
+__BEGIN_NAMESPACE_MFWK
+
+#define FORMAT_ENTRY(FORMAT, ...)   FORMAT,
+static const UInt32 kRGBFormats[] = {
+    RGB_FORMATS(FORMAT_ENTRY)
+    kPixelFormatUnknown
+};
+
+// 8-bit planar & semi-planar only
+static const UInt32 kYUVFormats[] = {
+    kPixelFormat420YpCbCrPlanar,
+    kPixelFormat420YpCrCbPlanar,
+    kPixelFormat422YpCbCrPlanar,
+    kPixelFormat422YpCrCbPlanar,
+    kPixelFormat444YpCbCrPlanar,
+    kPixelFormat444YpCrCbPlanar,
+    kPixelFormat420YpCbCrSemiPlanar,
+    kPixelFormat420YpCrCbSemiPlanar,
+    kPixelFormatUnknown
+};
+
+#define MAX_TAPS    (5)
+#define RING_ROWS   (MAX_TAPS)      // rows of all taps of one chroma row
+
+// chroma filters, @see eChromaFilter. weights are compile-time constants,
+// so rows are plain adds & shifts, which compilers vectorize.
+// chroma sample i takes source samples [i * ss + start, i * ss + start + n)
+#define CHROMA_FILTER(NAME, N, START, SHIFT, SUM)                                       \
+struct NAME {                                                                           \
+    static const UInt32 n       = N;                                                    \
+    static const Int32  start   = START;                                                \
+    static const UInt32 shift   = SHIFT;    /* log2 of sum of weights */                \
+    template <class T> static FORCE_INLINE Int32 sum(const T& s) { return SUM; }        \
+};
+CHROMA_FILTER(FilterNone,       1,  0, 0, s(0))
+CHROMA_FILTER(CenterBox,        2,  0, 1, s(0) + s(1))
+CHROMA_FILTER(CenterTriangle,   4, -1, 3, s(0) + 3 * (s(1) + s(2)) + s(3))
+CHROMA_FILTER(CositedBox,       3, -1, 2, s(0) + 2 * s(1) + s(2))
+CHROMA_FILTER(CositedTriangle,  5, -2, 4, s(0) + 4 * (s(1) + s(3)) + 6 * s(2) + s(4))
+#undef CHROMA_FILTER
+
+// tap i of vertical filter is row i
+struct RowTaps {
+    const Int16 * const *   rows;
+    UInt32                  x;
+    RowTaps(const Int16 * const * r, UInt32 i) : rows(r), x(i) { }
+    FORCE_INLINE Int32 operator()(UInt32 i) const { return rows[i][x]; }
+};
+
+// tap i of horizontal filter is sample i
+struct SampleTaps {
+    const Int32 *           samples;
+    SampleTaps(const Int32 * p) : samples(p) { }
+    FORCE_INLINE Int32 operator()(UInt32 i) const { return samples[i]; }
+};
+
+static FORCE_INLINE Int32 Clamp(Int32 x, Int32 n) {
+    return x < 0 ? 0 : (x >= n ? n - 1 : x);
+}
+
+// sum Cb or Cr of rows of all taps
+typedef void (*VerticalRow)(const Int16 * const * rows, Int32 * sum, UInt32 n);
+
+template <class F>
+static void VerticalRow_C(const Int16 * const * rows, Int32 * sum, UInt32 n) {
+    const Int16 * r[MAX_TAPS];
+    for (UInt32 t = 0; t < F::n; ++t) r[t] = rows[t];
+    for (UInt32 x = 0; x < n; ++x) {
+        sum[x] = F::sum(RowTaps(r, x));
+    }
+}
+
+// filter & decimate summed row, with edge samples repeated
+typedef void (*HorizontalRow)(const Int32 * sum, Int32 n, UInt32 shift, UInt8 * dst);
+
+template <class F, Int32 SS>
+static FORCE_INLINE Int32 EdgeSample(const Int32 * sum, Int32 i, Int32 n) {
+    Int32 edge[MAX_TAPS];
+    for (UInt32 t = 0; t < F::n; ++t) {
+        edge[t] = sum[Clamp(i * SS + F::start + (Int32)t, n)];
+    }
+    return F::sum(SampleTaps(edge));
+}
+
+template <class F, Int32 SS, UInt32 STEP>
+static void HorizontalRow_C(const Int32 * sum, Int32 n, UInt32 shift, UInt8 * dst) {
+    const Int32 round   = (1 << shift) >> 1;
+    const Int32 count   = (n + SS - 1) / SS;
+    // samples with all taps inside the row
+    Int32 end           = n < (Int32)F::n + F::start ? 0 : (n - (Int32)F::n - F::start) / SS + 1;
+    if (end > count) end = count;
+    Int32 begin         = (SS - 1 - F::start) / SS;
+    if (begin > end) begin = end;
+
+#define STORE(i, acc)   dst[(i) * STEP] = ColorClamp((((acc) + round) >> shift) + 128)
+    Int32 i = 0;
+    for (; i < begin; ++i) STORE(i, (EdgeSample<F, SS>(sum, i, n)));
+    for (; i < end; ++i) STORE(i, F::sum(SampleTaps(sum + i * SS + F::start)));
+    for (; i < count; ++i) STORE(i, (EdgeSample<F, SS>(sum, i, n)));
+#undef STORE
+}
+
+// 4:4:4, Q6 -> 8 bits without any filter
+static void PackRow(const Int16 * c, UInt8 * dst, UInt32 n) {
+    for (UInt32 x = 0; x < n; ++x) {
+        dst[x] = ColorClamp(((c[x] + 32) >> 6) + 128);
+    }
+}
+
+struct ChromaFilter {
+    UInt32                  n;
+    Int32                   start;
+    UInt32                  shift;
+    VerticalRow             vertical;
+    HorizontalRow           horizontal[2];      // by step of Cb/Cr samples
+};
+
+#define FILTER_ENTRY(F, SS) { F::n, F::start, F::shift, VerticalRow_C<F>,               \
+    { HorizontalRow_C<F, SS, 1>, HorizontalRow_C<F, SS, 2> } }
+static const ChromaFilter kFilterNone       = FILTER_ENTRY(FilterNone,      1);
+static const ChromaFilter kCenterBox        = FILTER_ENTRY(CenterBox,       2);
+static const ChromaFilter kCenterTriangle   = FILTER_ENTRY(CenterTriangle,  2);
+static const ChromaFilter kCositedBox       = FILTER_ENTRY(CositedBox,      2);
+static const ChromaFilter kCositedTriangle  = FILTER_ENTRY(CositedTriangle, 2);
+#undef FILTER_ENTRY
+
+static const ChromaFilter * GetChromaFilter(UInt32 ss, Bool cosited, eChromaFilter filter) {
+    if (ss == 1) return &kFilterNone;
+    if (cosited) return filter == kChromaFilterBox ? &kCositedBox : &kCositedTriangle;
+    return filter == kChromaFilterBox ? &kCenterBox : &kCenterTriangle;
+}
+
+struct YUVUnitContext {
+    const ColorKernels *    kernels;
+    const YUVLayout *       layout;
+    ImageFormat             iformat;
+    ImageFormat             oformat;
+    UInt32                  bpp;        // bytes per input pixel
+    UInt32                  hss;
+    UInt32                  vss;
+    const ChromaFilter *    hf;
+    const ChromaFilter *    vf;
+    RGBRow                  row;
+    const ColorParams *     params;
+    UInt8 *                 luma;       // Y' of source rows out of output rect
+    Int16 *                 chroma[RING_ROWS][2];   // Cb/Cr of source rows, by row % RING_ROWS
+    Int32                   rows[RING_ROWS];
+    Int32 *                 sums[2];    // Cb/Cr summed vertically
+
+    YUVUnitContext() : luma(Nil) {
+        memset(chroma, 0, sizeof(chroma));
+        memset(sums, 0, sizeof(sums));
+    }
+
+    void release() {
+        delete [] luma;
+        for (UInt32 i = 0; i < RING_ROWS; ++i) {
+            delete [] chroma[i][0];
+            delete [] chroma[i][1];
+        }
+        delete [] sums[0];
+        delete [] sums[1];
+        luma = Nil;
+        memset(chroma, 0, sizeof(chroma));
+        memset(sums, 0, sizeof(sums));
+    }
+
+    ~YUVUnitContext() { release(); }
+};
+
+static MediaUnitContext YUVUnitAlloc() {
+    YUVUnitContext * instance = new YUVUnitContext;
+    return instance;
+}
+
+static void YUVUnitDealloc(MediaUnitContext ref) {
+    YUVUnitContext * instance = static_cast<YUVUnitContext *>(ref);
+    delete instance;
+}
+
+static MediaError YUVUnitInit(MediaUnitContext ref, eChromaSiting siting, eChromaFilter filter,
+                              const MediaFormat * iformat, const MediaFormat * oformat) {
+    YUVUnitContext * instance = static_cast<YUVUnitContext *>(ref);
+    const ImageFormat& in   = iformat->image;
+    const ImageFormat& out  = oformat->image;
+
+    const YUVLayout * layout = GetYUVLayout(out.format);
+    if (layout == Nil || layout->depth != 8 || layout->layout == kYUVLayoutPacked) {
+        return kMediaErrorNotSupported;
+    }
+
+    // no scaling
+    if (in.rect.w != out.width || in.rect.h != out.height) {
+        return kMediaErrorNotSupported;
+    }
+
+    if (in.rect.x < 0 || in.rect.y < 0 || in.rect.w <= 0 || in.rect.h <= 0 ||
+        in.rect.x + in.rect.w > in.width || in.rect.y + in.rect.h > in.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    // output rect selects the rows to produce, on whole chroma rows
+    const PixelDescriptor * desc = GetImagePixelDescriptor(out.format);
+    const UInt32 vss = desc->planes[1].vss;
+    if (out.rect.x != 0 || out.rect.w != out.width || out.rect.y % vss ||
+        out.rect.y < 0 || out.rect.h <= 0 || out.rect.y + out.rect.h > out.height) {
+        return kMediaErrorBadParameters;
+    }
+
+    const ColorKernels * kernels = GetColorKernels();
+    const RGBRow row = GetRGBRow(kernels, in.format);
+    const ColorParams * params = GetColorParams(out.matrix);
+    if (row == Nil || params == Nil) {
+        return kMediaErrorNotSupported;
+    }
+
+    instance->release();
+    instance->kernels   = kernels;
+    instance->layout    = layout;
+    instance->iformat   = in;
+    instance->oformat   = out;
+    instance->bpp       = GetImagePixelDescriptor(in.format)->bpp / 8;
+    instance->hss       = layout->layout == kYUVLayoutPlanar ? 1 : 2;
+    instance->vss       = vss;
+    instance->hf        = GetChromaFilter(instance->hss, siting != kChromaSitingCenter, filter);
+    instance->vf        = GetChromaFilter(instance->vss, siting == kChromaSitingTopLeft, filter);
+    instance->row       = row;
+    instance->params    = params;
+
+    instance->luma      = new UInt8[out.width];
+    for (UInt32 i = 0; i < RING_ROWS; ++i) {
+        instance->chroma[i][0]  = new Int16[out.width];
+        instance->chroma[i][1]  = new Int16[out.width];
+    }
+    instance->sums[0]   = new Int32[out.width];
+    instance->sums[1]   = new Int32[out.width];
+
+    DEBUG("%s: %s -> %s, %u/%u taps", kernels->name,
+          GetImageFormatString(in).c_str(),
+          GetImageFormatString(out).c_str(),
+          instance->hf->n, instance->vf->n);
+    return kMediaNoError;
+}
+
+static MediaError YUVUnitProcess(MediaUnitContext ref, const MediaBufferList * input, MediaBufferList * output) {
+    YUVUnitContext * instance = static_cast<YUVUnitContext *>(ref);
+    const ImageFormat& in   = instance->iformat;
+    const ImageFormat& out  = instance->oformat;
+    const YUVLayout * layout = instance->layout;
+
+    UInt8 * ip[4];
+    UInt32 is[4];
+    UInt8 * op[4];
+    UInt32 os[4];
+    if (GetImagePlaneData(in, input, False, ip, is) != kMediaNoError ||
+        GetImagePlaneData(out, output, True, op, os) != kMediaNoError) {
+        return kMediaErrorBadParameters;
+    }
+
+    // Cb/Cr destination
+    UInt8 * cb, * cr;
+    if (layout->layout == kYUVLayoutSemiPlanar) {
+        cb      = op[1] + layout->cb;
+        cr      = op[1] + layout->cr;
+    } else {
+        cb      = op[1 + layout->cb];
+        cr      = op[1 + layout->cr];
+    }
+    const UInt32 cs = os[1];
+    const HorizontalRow horizontal = instance->hf->horizontal[layout->layout == kYUVLayoutSemiPlanar];
+
+    const UInt8 * src   = ip[0] + in.rect.y * is[0] + in.rect.x * instance->bpp;
+    const Int32 width   = out.width;
+    const Int32 height  = out.height;
+    const Int32 first   = out.rect.y;
+    const Int32 last    = out.rect.y + out.rect.h;
+    const Int32 vss     = instance->vss;
+    const ChromaFilter * vf = instance->vf;
+    const UInt32 shift  = 6 + instance->hf->shift + vf->shift;
+
+    // input changes each call
+    for (UInt32 i = 0; i < RING_ROWS; ++i) instance->rows[i] = -1;
+
+    for (Int32 j = first / vss; j < (last + vss - 1) / vss; ++j) {
+        const Int16 * u[MAX_TAPS];
+        const Int16 * v[MAX_TAPS];
+        for (UInt32 t = 0; t < vf->n; ++t) {
+            const Int32 r   = Clamp(j * vss + vf->start + (Int32)t, height);
+            const UInt32 k  = r % RING_ROWS;
+            if (instance->rows[k] != r) {
+                // rows of other bands are converted for chroma only
+                UInt8 * y = (r >= first && r < last) ? op[0] + r * os[0] : instance->luma;
+                instance->row(src + r * is[0], y, instance->chroma[k][0], instance->chroma[k][1],
+                              width, instance->params);
+                instance->rows[k] = r;
+            }
+            u[t]    = instance->chroma[k][0];
+            v[t]    = instance->chroma[k][1];
+        }
+        if (vf == &kFilterNone && instance->hf == &kFilterNone) {
+            PackRow(u[0], cb + j * cs, width);
+            PackRow(v[0], cr + j * cs, width);
+            continue;
+        }
+        vf->vertical(u, instance->sums[0], width);
+        vf->vertical(v, instance->sums[1], width);
+        horizontal(instance->sums[0], width, shift, cb + j * cs);
+        horizontal(instance->sums[1], width, shift, cr + j * cs);
+    }
+    return kMediaNoError;
+}
+
+static MediaError YUVUnitReset(MediaUnitContext ref) {
+    return kMediaNoError;
+}
+
+// one unit per siting & filter
+#define YUV_UNIT(NAME, SITING, FILTER)                                                  \
+static MediaError YUVUnitInit##SITING##FILTER(MediaUnitContext ref,                     \
+                                              const MediaFormat * iformat,              \
+                                              const MediaFormat * oformat) {            \
+    return YUVUnitInit(ref, kChromaSiting##SITING, kChromaFilter##FILTER,               \
+                       iformat, oformat);                                               \
+}                                                                                       \
+const MediaUnit NAME = {                                                                \
+    "rgb2yuv." #SITING "." #FILTER,                                                     \
+    0,                                                                                  \
+    kRGBFormats,                                                                        \
+    kYUVFormats,                                                                        \
+    YUVUnitAlloc,                                                                       \
+    YUVUnitDealloc,                                                                     \
+    YUVUnitInit##SITING##FILTER,                                                        \
+    YUVUnitProcess,                                                                     \
+    Nil,                                                                                \
+    YUVUnitReset,                                                                       \
+};
+
+YUV_UNIT(kYUVUnit,                  Left,       Box)
+YUV_UNIT(kYUVUnitLeftTriangle,      Left,       Triangle)
+YUV_UNIT(kYUVUnitCenterBox,         Center,     Box)
+YUV_UNIT(kYUVUnitCenterTriangle,    Center,     Triangle)
+YUV_UNIT(kYUVUnitTopLeftBox,        TopLeft,    Box)
+YUV_UNIT(kYUVUnitTopLeftTriangle,   TopLeft,    Triangle)
+
+__END_NAMESPACE_MFWK
+
+USING_NAMESPACE_MFWK
+
+const MediaUnit * YUVUnitFind(const eChromaSiting siting, const eChromaFilter filter) {
+    static const MediaUnit * kYUVUnits[][2] = {
+        { &kYUVUnit,                &kYUVUnitLeftTriangle       },
+        { &kYUVUnitCenterBox,       &kYUVUnitCenterTriangle     },
+        { &kYUVUnitTopLeftBox,      &kYUVUnitTopLeftTriangle    },
+    };
+    if (siting > kChromaSitingTopLeft || filter > kChromaFilterTriangle) {
+        return Nil;
+    }
+    return kYUVUnits[siting][filter];
+}
@@ -0,0 +1,100 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    YUVConverter.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// RGB -> Y'CbCr units for all color matrices, e.g. for writing test
+// vectors. chroma is computed for every pixel, then downsampled to the
+// selected chroma siting with a box or triangle filter.
+// ImageConverter & ImageBatch pick them up by kKeyChromaSiting and
+// kKeyChromaFilter in options.
+//
+
+#ifndef MACYUV_YUV_CONVERTER_H
+#define MACYUV_YUV_CONVERTER_H
+
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+
+__BEGIN_DECLS
+
+enum {
+    kKeyChromaSiting    = FOURCC('csit'),       ///< UInt32, @see eChromaSiting
+    kKeyChromaFilter    = FOURCC('cflt'),       ///< UInt32, @see eChromaFilter
+};
+
+/**
+ * position of a subsampled chroma sample relative to its luma samples
+ */
+enum {
+    kChromaSitingLeft,                          ///< MPEG-2, H.264 & BT.709, co-sited horizontally
+    kChromaSitingCenter,                        ///< MPEG-1 & JPEG, center of 2x2 luma
+    kChromaSitingTopLeft,                       ///< BT.2020 & HEVC, co-sited both ways
+    kChromaSitingDefault    = kChromaSitingLeft,
+};
+typedef UInt32 eChromaSiting;
+
+/**
+ * chroma downsampling filter, taps of each direction:
+ *  center:     box [1 1] / 2,      triangle [1 3 3 1] / 8
+ *  co-sited:   box [1 2 1] / 4,    triangle [1 4 6 4 1] / 16
+ * box averages the area of a chroma sample, triangle is smoother with
+ * less aliasing.
+ */
+enum {
+    kChromaFilterBox,
+    kChromaFilterTriangle,
+    kChromaFilterDefault    = kChromaFilterBox,
+};
+typedef UInt32 eChromaFilter;
+
+/**
+ * get RGB -> Y'CbCr unit of chroma siting & filter
+ * @return return Nil if siting or filter is not supported
+ * @note 4:4:4 output is the same for all of them.
+ */
+API_EXPORT const MediaUnit *    YUVUnitFind(const eChromaSiting, const eChromaFilter);
+
+__END_DECLS
+
+#ifdef __cplusplus
+__BEGIN_NAMESPACE_MFWK
+
+/**
+ * unit of default siting & filter, which is one of image units.
+ * @note produce rows selected by output rect, as other image units.
+ */
+extern const MediaUnit kYUVUnit;
+
+__END_NAMESPACE_MFWK
+#endif // __cplusplus
+
+#endif // MACYUV_YUV_CONVERTER_H
@@ -0,0 +1,387 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    DeviceTests.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// standalone tests of devices & objects over image units, which run jobs on
+// the worker loopers of the frameworks:
+//  planner:    hops chain from input to output, through linked units only
+//  converter:  cache returns idle converters of the same key only
+//  scaler:     frames scaled in bands are the scale unit's
+//  statistics: slices merge into stats of the whole frame
+//  compare:    identical frames are at peak PSNR, a changed sample is its diff
+//  files:      mapped files, readers & prefetchers give frames of the file
+// build & run by `make test` in this directory.
+//
+
+#include <unistd.h>
+
+#include "FramePrefetcher.h"
+#include "FrameReader.h"
+#include "ImageCompare.h"
+#include "ImageConverter.h"
+#include "ImageDither.h"
+#include "ImagePlanner.h"
+#include "ImageScaler.h"
+#include "ImageStatistics.h"
+#include "MappedFile.h"
+#include "PixelFormats.h"
+#include "TestUtils.h"
+
+static Bool IsSameGeometry(const ImageFormat& a, const ImageFormat& b) {
+    return a.format == b.format && a.width == b.width && a.height == b.height;
+}
+
+// frames hold planes tight in one buffer or one buffer per plane
+static Bool IsFrameOf(const sp<MediaFrame>& frame, const UInt8 * data, UInt32 bytes) {
+    if (frame.isNil()) return False;
+    UInt32 offset = 0;
+    for (UInt32 i = 0; i < frame->planes.count; ++i) {
+        const MediaBuffer& buffer = frame->planes.buffers[i];
+        if (offset + buffer.size > bytes || memcmp(buffer.data, data + offset, buffer.size)) {
+            return False;
+        }
+        offset += buffer.size;
+    }
+    return offset == bytes;
+}
+
+static sp<MediaFrame> CreateRandomFrame(const ImageFormat& image) {
+    sp<MediaFrame> frame = CreateImageFrame(image);
+    for (UInt32 i = 0; !frame.isNil() && i < frame->planes.count; ++i) {
+        Randomize(frame->planes.buffers[i].data, frame->planes.buffers[i].size);
+    }
+    return frame;
+}
+
+#pragma mark Planner
+static void TestPlanner() {
+    static const ePixelFormat kOutputs[] = {
+        kPixelFormatBGRA,
+        kPixelFormatRGB565,
+        kPixelFormat420YpCbCrPlanar,
+    };
+    const ImageFormat in = Image(kPixelFormat420YpCbCrSemiPlanar, 71, 47);
+    for (UInt32 i = 0; i < NELEM(kOutputs); ++i) {
+        const ImageFormat out = Image(kOutputs[i], 35, 23);
+        ImageHop hops[kImageHopsMax];
+        const UInt32 n = PlanImageHops(in, out, Nil, hops);
+        EXPECT(n > 0 && n <= kImageHopsMax, "%.4s -> %.4s: %u hops", (const Char *)&in.format,
+               (const Char *)&out.format, n);
+        if (n == 0 || n > kImageHopsMax) continue;
+
+        EXPECT(IsSameGeometry(hops[0].iformat, in), "%.4s -> %.4s: plan starts from %.4s %dx%d",
+               (const Char *)&in.format, (const Char *)&out.format, (const Char *)&hops[0].iformat.format,
+               hops[0].iformat.width, hops[0].iformat.height);
+        EXPECT(IsSameGeometry(hops[n - 1].oformat, out), "%.4s -> %.4s: plan ends at %.4s %dx%d",
+               (const Char *)&in.format, (const Char *)&out.format, (const Char *)&hops[n - 1].oformat.format,
+               hops[n - 1].oformat.width, hops[n - 1].oformat.height);
+        for (UInt32 k = 0; k < n; ++k) {
+            EXPECT(hops[k].unit != Nil, "%.4s -> %.4s: hop %u has no unit", (const Char *)&in.format,
+                   (const Char *)&out.format, k);
+            EXPECT(k == 0 || IsSameGeometry(hops[k - 1].oformat, hops[k].iformat),
+                   "%.4s -> %.4s: hop %u is not linked", (const Char *)&in.format, (const Char *)&out.format, k);
+        }
+
+        // cached plans are the same plan
+        ImageHop again[kImageHopsMax];
+        EXPECT(PlanImageHops(in, out, Nil, again) == n && again[0].unit == hops[0].unit,
+               "%.4s -> %.4s: cached plan differs", (const Char *)&in.format, (const Char *)&out.format);
+    }
+
+    ImageHop hops[kImageHopsMax];
+    EXPECT(PlanImageHops(in, Image(kPixelFormatUnknown, 35, 23), Nil, hops) == 0, "plan to unknown format");
+}
+
+#pragma mark Converter Cache
+static void TestConverterCache() {
+    const ImageFormat in    = Image(kPixelFormat420YpCbCrPlanar, 71, 47);
+    const ImageFormat out   = Image(kPixelFormatBGRA, 71, 47);
+    FlushImageConverterCache();
+
+    // idle converter of the same key is returned
+    sp<MediaDevice> a = ObtainImageConverter(in, out, Nil);
+    EXPECT(!a.isNil(), "no converter");
+    if (a.isNil()) return;
+    const MediaDevice * first = a.get();
+    a.clear();
+    sp<MediaDevice> b = ObtainImageConverter(in, out, Nil);
+    EXPECT(b.get() == first, "idle converter is not reused");
+
+    // converter in use is never shared
+    sp<MediaDevice> c = ObtainImageConverter(in, out, Nil);
+    EXPECT(!c.isNil() && c.get() != b.get(), "converter in use is returned");
+
+    // options are part of the key
+    b.clear();
+    c.clear();
+    sp<Message> options = new Message;
+    options->setInt32(kKeyDither, kDitherOrdered);
+    sp<MediaDevice> d = ObtainImageConverter(in, out, options);
+    EXPECT(!d.isNil() && d.get() != first, "converter of other options is returned");
+
+    // cached converter still converts
+    d.clear();
+    sp<MediaDevice> e = ObtainImageConverter(in, out, Nil);
+    EXPECT(!e.isNil() && e->push(CreateRandomFrame(in)) == kMediaNoError && !e->pull().isNil(),
+           "cached converter failed");
+    e.clear();
+    FlushImageConverterCache();
+}
+
+#pragma mark Scaler
+// device in bands is the scale unit on the whole frame, frames of other
+// formats are rejected
+static void TestScaler() {
+    const ImageFormat in    = Image(kPixelFormat420YpCbCrPlanar, 71, 47);
+    const ImageFormat out   = Image(kPixelFormat420YpCbCrPlanar, 101, 61);
+    const UInt32 ibytes = GetImageBytes(in);
+    const UInt32 obytes = GetImageBytes(out);
+    UInt8 * origin  = new UInt8[ibytes];
+    UInt8 * scaled  = new UInt8[obytes];
+    Randomize(origin, ibytes);
+
+    sp<Message> options = new Message;
+    options->setInt32(kKeyScaleFilter, kScaleFilterLanczos);
+    options->setInt32(kKeyCount, 4);
+    sp<MediaDevice> scaler = CreateImageScaler(in, out, options);
+    EXPECT(!scaler.isNil(), "no scaler");
+    if (!scaler.isNil()) {
+        sp<MediaFrame> frame = CreateImageFrame(in);
+        MediaBufferList4 planes;
+        GetImagePlanes(in, origin, planes);
+        for (UInt32 i = 0, offset = 0; i < frame->planes.count; ++i) {
+            memcpy(frame->planes.buffers[i].data, origin + offset, frame->planes.buffers[i].size);
+            offset += frame->planes.buffers[i].size;
+        }
+
+        MediaError st = scaler->push(frame);
+        sp<MediaFrame> output = scaler->pull();
+        EXPECT(st == kMediaNoError && !output.isNil(), "scale failed");
+        if (st == kMediaNoError) st = RunUnit(ScaleUnitFind(kScaleFilterLanczos), in, out, origin, scaled);
+        EXPECT(st != kMediaNoError || IsFrameOf(output, scaled, obytes), "bands differ from the unit");
+
+        EXPECT(scaler->push(CreateImageFrame(out)) == kMediaErrorBadFormat, "frame of other format is taken");
+    }
+    delete [] origin;
+    delete [] scaled;
+}
+
+#pragma mark Statistics
+// luma rows of values of their index, flat chroma, in slices
+static void TestStatisticsSlices() {
+    const ImageFormat image = Image(kPixelFormat420YpCbCrPlanar, 64, 512);
+    UInt8 * data = new UInt8[GetImageBytes(image)];
+    MediaBufferList4 planes;
+    GetImagePlanes(image, data, planes);
+    for (Int32 y = 0; y < image.height; ++y) {
+        memset(planes.buffers[0].data + y * image.width, y & 0xFF, image.width);
+    }
+    memset(planes.buffers[1].data, 128, planes.buffers[1].size);
+    memset(planes.buffers[2].data, 128, planes.buffers[2].size);
+
+    sp<Message> options = new Message;
+    options->setInt32(kKeyCount, 4);
+    sp<ImageStatistics> statistics = CreateImageStatistics(image, options);
+    sp<Message> result = statistics.isNil() ? Nil : statistics->process(&planes.list);
+    delete [] data;
+    EXPECT(!result.isNil() && result->findInt32(kKeyStatsPlanes) == 3, "statistics failed");
+    if (result.isNil()) return;
+
+    for (UInt32 c = 0; c < 3; ++c) {
+        sp<Message> plane = static_cast<Message *>(result->findObject(kKeyStatsPlane + c));
+        EXPECT(!plane.isNil(), "no plane %u", c);
+        if (plane.isNil()) continue;
+
+        const Int64 samples = plane->findInt64(kKeyStatsSamples);
+        sp<Buffer> histogram = static_cast<Buffer *>(plane->findObject(kKeyStatsHistogram));
+        const UInt32 * h = histogram.isNil() ? Nil : (const UInt32 *)histogram->data();
+        EXPECT(h != Nil && plane->findInt32(kKeyStatsBins) == 256, "plane %u: no histogram", c);
+        if (h == Nil) continue;
+
+        if (c == 0) {
+            // each value on 2 rows
+            EXPECT(samples == 64 * 512, "plane %u: %" PRId64 " samples", c, samples);
+            EXPECT(plane->findInt32(kKeyStatsMin) == 0 && plane->findInt32(kKeyStatsMax) == 255,
+                   "plane %u: bad range", c);
+            EXPECT(plane->findDouble(kKeyStatsMean) == 127.5, "plane %u: mean %.3f", c,
+                   plane->findDouble(kKeyStatsMean));
+            UInt32 k = 0;
+            while (k < 256 && h[k] == 64 * 2) ++k;
+            EXPECT(k == 256, "plane %u: bin %u is %u", c, k, k < 256 ? h[k] : 0);
+        } else {
+            EXPECT(samples == 32 * 256, "plane %u: %" PRId64 " samples", c, samples);
+            EXPECT(plane->findInt32(kKeyStatsMin) == 128 && plane->findInt32(kKeyStatsMax) == 128 &&
+                   plane->findDouble(kKeyStatsMean) == 128 && plane->findDouble(kKeyStatsVariance) == 0,
+                   "plane %u: flat plane is not flat", c);
+            EXPECT(h[128] == samples, "plane %u: bin 128 is %u", c, h[128]);
+        }
+    }
+}
+
+#pragma mark Compare
+static void TestCompare() {
+    const ImageFormat image = Image(kPixelFormat420YpCbCrPlanar, 71, 47);
+    const UInt32 bytes  = GetImageBytes(image);
+    const UInt32 frames = 3;
+    sp<Buffer> a = new Buffer(bytes * frames);
+    sp<Buffer> b = new Buffer(bytes * frames);
+    Randomize((UInt8 *)a->base(), bytes * frames);
+    memcpy(b->base(), a->base(), bytes * frames);
+    // a luma sample of the 2nd frame
+    UInt8 * sample = (UInt8 *)b->base() + bytes + 13 * image.width + 7;
+    *sample = *sample < 128 ? *sample + 5 : *sample - 5;
+    a->setBytesRange(0, bytes * frames);
+    b->setBytesRange(0, bytes * frames);
+
+    sp<Message> options = new Message;
+    options->setInt32(kKeyCount, 2);
+    sp<ImageCompare> compare = CreateImageCompare(image, options);
+    EXPECT(!compare.isNil(), "no compare");
+    if (compare.isNil()) return;
+
+    sp<MediaFrame> frame = CreateRandomFrame(image);
+    ImageCompareResult same;
+    EXPECT(compare->compare(frame, frame, same) == kMediaNoError && same.planes == 3, "compare failed");
+    for (UInt32 c = 0; c < 3; ++c) {
+        EXPECT(same.diff[c] == 0 && same.mse[c] == 0 && same.psnr[c] == kComparePSNRMax && same.ssim[c] > 0.9999,
+               "plane %u: identical planes differ", c);
+    }
+
+    sp<Message> summary = compare->process(a, b);
+    EXPECT(!summary.isNil() && summary->findInt32(kKeyCompareFrames) == (Int32)frames &&
+           summary->findInt32(kKeyComparePlanes) == 3, "compare of %u frames failed", frames);
+    if (summary.isNil()) return;
+
+    for (UInt32 c = 0; c < 3; ++c) {
+        sp<Message> plane = static_cast<Message *>(summary->findObject(kKeyComparePlane + c));
+        EXPECT(!plane.isNil(), "no plane %u", c);
+        if (plane.isNil()) continue;
+        const Int32 diff = plane->findInt32(kKeyCompareDiff);
+        const Float64 psnr = plane->findDouble(kKeyComparePSNR);
+        EXPECT(diff == (c == 0 ? 5 : 0), "plane %u: diff %d", c, diff);
+        EXPECT(c == 0 ? psnr < kComparePSNRMax : psnr == kComparePSNRMax, "plane %u: PSNR %.3f", c, psnr);
+    }
+
+    sp<Buffer> results = static_cast<Buffer *>(summary->findObject(kKeyCompareResults));
+    EXPECT(!results.isNil() && results->size() == frames * sizeof(ImageCompareResult), "no results");
+    if (results.isNil()) return;
+    const ImageCompareResult * r = (const ImageCompareResult *)results->data();
+    for (UInt32 i = 0; i < frames; ++i) {
+        EXPECT(r[i].diff[0] == (i == 1 ? 5 : 0), "frame %u: diff %u", i, r[i].diff[0]);
+    }
+}
+
+#pragma mark Files
+#define FILE_FRAMES     (5)
+
+// frames of random bytes, the last one is short
+static String WriteFrames(const ImageFormat& image, UInt8 * data, UInt32 bytes) {
+    Char path[] = "/tmp/DeviceTests.XXXXXX";
+    Int fd = mkstemp(path);
+    if (fd < 0) return String();
+    Randomize(data, bytes * FILE_FRAMES);
+    const Int64 length = bytes * FILE_FRAMES - bytes / 2;
+    const Bool ok = write(fd, data, length) == length;
+    close(fd);
+    if (!ok) {
+        unlink(path);
+        return String();
+    }
+    return String(path);
+}
+
+static void TestFiles() {
+    const ImageFormat image = Image(kPixelFormat420YpCbCrPlanar, 71, 47);
+    const UInt32 bytes = GetImageBytes(image);
+    UInt8 * data = new UInt8[bytes * FILE_FRAMES];
+    const String path = WriteFrames(image, data, bytes);
+    EXPECT(path.size() > 0, "write frames failed");
+    if (path.size() == 0) {
+        delete [] data;
+        return;
+    }
+    const Int64 length = bytes * FILE_FRAMES - bytes / 2;
+
+    // mapped file, frames at any offset
+    sp<MappedFile> file = OpenMappedFile(path);
+    EXPECT(!file.isNil() && file->length() == length, "mapped file failed");
+    if (!file.isNil()) {
+        EXPECT(memcmp(file->data(), data, length) == 0, "mapped data differ");
+        EXPECT(IsFrameOf(file->frame(image, 7), data + 7, bytes), "frame at offset 7 differs");
+        EXPECT(file->frame(image, length - bytes + 1).isNil(), "frame beyond end");
+        EXPECT(file->frame(image, -1).isNil(), "frame before start");
+    }
+    EXPECT(OpenMappedFile("http://localhost/frames.yuv").isNil(), "network url is mapped");
+
+    // reader, whole frames only
+    sp<FrameReader> reader = CreateFrameReader(String("file://") + path);
+    EXPECT(!reader.isNil() && reader->mapped() && reader->length() == length, "reader failed");
+    if (!reader.isNil()) {
+        for (Int64 i = 0; i < FILE_FRAMES - 1; ++i) {
+            EXPECT(IsFrameOf(reader->readFrame(image, i), data + i * bytes, bytes), "frame %" PRId64 " differs", i);
+        }
+        EXPECT(reader->readFrame(image, FILE_FRAMES - 1).isNil(), "short frame is read");
+        EXPECT(reader->readFrame(image, -1).isNil(), "frame -1 is read");
+    }
+
+    // prefetcher, the reader's frames in any order, with or without prefetch
+    static const Int32 kDepths[] = { 0, 2 };
+    static const Int64 kOrder[] = { 0, 1, 2, 3, 2, 1, 0, 3, 0 };
+    for (UInt32 k = 0; !reader.isNil() && k < NELEM(kDepths); ++k) {
+        sp<Message> options = new Message;
+        options->setInt32(kKeyPrefetchDepth, kDepths[k]);
+        sp<FramePrefetcher> prefetcher = CreateFramePrefetcher(reader, image, options);
+        EXPECT(!prefetcher.isNil(), "no prefetcher of depth %d", kDepths[k]);
+        if (prefetcher.isNil()) continue;
+
+        for (UInt32 i = 0; i < NELEM(kOrder); ++i) {
+            EXPECT(IsFrameOf(prefetcher->readFrame(kOrder[i]), data + kOrder[i] * bytes, bytes),
+                   "depth %d: frame %" PRId64 " differs", kDepths[k], kOrder[i]);
+        }
+        EXPECT(prefetcher->readFrame(FILE_FRAMES - 1).isNil(), "depth %d: short frame is read", kDepths[k]);
+        EXPECT(prefetcher->readFrame(-1).isNil(), "depth %d: frame -1 is read", kDepths[k]);
+    }
+
+    unlink(path.c_str());
+    delete [] data;
+}
+
+int main() {
+    srand(1);
+    TestPlanner();
+    TestConverterCache();
+    TestScaler();
+    TestStatisticsSlices();
+    TestCompare();
+    TestFiles();
+    return TestResult();
+}
@@ -0,0 +1,703 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    KernelTests.cpp
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// standalone tests of image kernels, without the app:
+//  rows:       SIMD color rows are bit-exact with C rows, on random samples
+//              with garbage above depth for high bit depth formats
+//  accuracy:   color rows are within 1 LSB of float math, 1/4 LSB of 8-bit
+//              for 16-bit output
+//  rotate:     rotations & flips undone by their inverse are identity
+//  swizzle:    similar formats swizzled there and back are identity
+//  scale:      odd size images scaled to the same size are identity, high
+//              bit depth color scale at same size is the color unit, flat
+//              images stay flat at any size
+//  dither:     no dither truncates, dithers mix the 2 nearest levels
+//  statistics: sums, extremes & histograms of planes as counted one by one
+//  diff:       identical frames are black, a changed sample lights its pixel
+//  tone map:   black stays black, peak white is white, gray ramps are monotone
+// build & run by `make test` in this directory.
+//
+
+#include <math.h>
+
+#include "ImageConverter.h"
+#include "ImageDiff.h"
+#include "ImageDither.h"
+#include "ImageRotator.h"
+#include "ImageScaler.h"
+#include "ImageStatistics.h"
+#include "ImageSwizzler.h"
+#include "ImageToneMap.h"
+#include "ColorKernels.h"
+#include "PixelFormats.h"
+#include "TestUtils.h"
+
+#define MAX_PIXELS      (600)
+#define ROUNDS          (50)
+
+#pragma mark Rows
+static const eColorMatrix kMatrices[] = {
+    kColorMatrixBT601,
+    kColorMatrixBT709,
+    kColorMatrixBT2020,
+    kColorMatrixJPEG,
+};
+
+static void TestColorRows(const ColorKernels * kernels) {
+    // 16-bit samples & 16-bit channels of 4 pixels at most
+    static UInt8 y[MAX_PIXELS * 4], u[MAX_PIXELS * 4], v[MAX_PIXELS * 4];
+    static UInt8 a[MAX_PIXELS * 8], b[MAX_PIXELS * 8];
+
+    for (UInt32 i = 0; kernels->rows[i].iformat != kPixelFormatUnknown; ++i) {
+        const ColorRowEntry& entry = kernels->rows[i];
+        const ColorRow row = GetColorRow(&kColorKernelsC, entry.iformat, entry.oformat);
+        EXPECT(row != Nil, "%s: no C row for %.4s -> %.4s", kernels->name,
+               (const Char *)&entry.iformat, (const Char *)&entry.oformat);
+        if (row == Nil) continue;
+
+        for (UInt32 k = 0; k < ROUNDS; ++k) {
+            // odd widths too, last chroma pair holds one pixel
+            const UInt32 n = 1 + rand() % MAX_PIXELS;
+            const ColorParams * params = GetColorParams(kMatrices[k % NELEM(kMatrices)]);
+            Randomize(y, sizeof(y));
+            Randomize(u, sizeof(u));
+            Randomize(v, sizeof(v));
+            memset(a, 0, sizeof(a));
+            memset(b, 0, sizeof(b));
+            row(y, u, v, a, n, params);
+            entry.row(y, u, v, b, n, params);
+            EXPECT(memcmp(a, b, sizeof(a)) == 0, "%s: %.4s -> %.4s, %u pixels", kernels->name,
+                   (const Char *)&entry.iformat, (const Char *)&entry.oformat, n);
+        }
+    }
+}
+
+static void TestRGBRows(const ColorKernels * kernels) {
+    static UInt8 rgba[MAX_PIXELS * 8];
+    static UInt8 y[2][MAX_PIXELS];
+    static Int16 u[2][MAX_PIXELS], v[2][MAX_PIXELS];
+
+    for (UInt32 i = 0; kernels->rgbs && kernels->rgbs[i].format != kPixelFormatUnknown; ++i) {
+        const RGBRowEntry& entry = kernels->rgbs[i];
+        const RGBRow row = GetRGBRow(&kColorKernelsC, entry.format);
+        EXPECT(row != Nil, "%s: no C row for %.4s", kernels->name, (const Char *)&entry.format);
+        if (row == Nil) continue;
+
+        for (UInt32 k = 0; k < ROUNDS; ++k) {
+            const UInt32 n = 1 + rand() % MAX_PIXELS;
+            const ColorParams * params = GetColorParams(kMatrices[k % NELEM(kMatrices)]);
+            Randomize(rgba, sizeof(rgba));
+            memset(y, 0, sizeof(y));
+            memset(u, 0, sizeof(u));
+            memset(v, 0, sizeof(v));
+            row(rgba, y[0], u[0], v[0], n, params);
+            entry.row(rgba, y[1], u[1], v[1], n, params);
+            EXPECT(memcmp(y[0], y[1], sizeof(y[0])) == 0 &&
+                   memcmp(u[0], u[1], sizeof(u[0])) == 0 &&
+                   memcmp(v[0], v[1], sizeof(v[0])) == 0,
+                   "%s: %.4s, %u pixels", kernels->name, (const Char *)&entry.format, n);
+        }
+    }
+}
+
+static void TestRows() {
+    static const ColorKernels * kKernels[] = {
+#if defined(__x86_64__) || defined(__i386__)
+        &kColorKernelsSSE2,
+        &kColorKernelsSSSE3,
+        &kColorKernelsAVX2,
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        &kColorKernelsNEON,
+#endif
+    };
+    for (UInt32 i = 0; i < NELEM(kKernels); ++i) {
+        if (kKernels[i]->supported() == False) {
+            printf("skip %s, not supported by this cpu\n", kKernels[i]->name);
+            continue;
+        }
+        TestColorRows(kKernels[i]);
+        TestRGBRows(kKernels[i]);
+    }
+}
+
+#pragma mark Accuracy
+// Kr & Kb of matrices, @see MediaTypes.h
+static const struct {
+    eColorMatrix    matrix;
+    Float64         kr, kb;
+    Bool            full;
+} kMatrixCoeffs[] = {
+    { kColorMatrixJPEG,         0.299,      0.114,      True    },
+    { kColorMatrixBT601,        0.299,      0.114,      False   },
+    { kColorMatrixBT709,        0.2126,     0.0722,     False   },
+    { kColorMatrixBT709Full,    0.2126,     0.0722,     True    },
+    { kColorMatrixBT2020,       0.2627,     0.0593,     False   },
+    { kColorMatrixBT2020Full,   0.2627,     0.0593,     True    },
+};
+
+// Y'CbCr in 8-bit scale -> RGB in 8-bit scale, clamped
+static void ColorFloat(UInt32 m, Float64 y, Float64 u, Float64 v, Float64 rgb[3]) {
+    const Float64 kr    = kMatrixCoeffs[m].kr;
+    const Float64 kb    = kMatrixCoeffs[m].kb;
+    const Float64 kg    = 1 - kr - kb;
+    const Bool full     = kMatrixCoeffs[m].full;
+    const Float64 yp    = (y - (full ? 0 : 16)) * (full ? 1 : 255.0 / 219);
+    const Float64 cb    = (u - 128) * (full ? 1 : 255.0 / 224);
+    const Float64 cr    = (v - 128) * (full ? 1 : 255.0 / 224);
+    rgb[0] = yp + 2 * (1 - kr) * cr;
+    rgb[1] = yp - 2 * (1 - kb) * kb / kg * cb - 2 * (1 - kr) * kr / kg * cr;
+    rgb[2] = yp + 2 * (1 - kb) * cb;
+    for (UInt32 k = 0; k < 3; ++k) {
+        if (rgb[k] < 0)     rgb[k] = 0;
+        if (rgb[k] > 255)   rgb[k] = 255;
+    }
+}
+
+// 8-bit I444 & 16-bit P016 to 8-bit RGBA & 16-bit RGBA64, samples of 16-bit
+// input are taken as 8-bit samples with 8 fraction bits
+static void TestAccuracy(const ColorKernels * kernels) {
+    static const struct {
+        ePixelFormat    iformat;
+        ePixelFormat    oformat;
+        Float64         tolerance;      // in LSB of 8-bit
+    } kCases[] = {
+        { kPixelFormat444YpCbCrPlanar,                      kPixelFormatRGBA,                   1.0     },
+        { kPixelFormat444YpCbCrPlanar,                      (ePixelFormat)kPixelFormatRGBA64,   0.25    },
+        { (ePixelFormat)kPixelFormat420YpCbCr16SemiPlanar,  kPixelFormatRGBA,                   1.0     },
+        { (ePixelFormat)kPixelFormat420YpCbCr16SemiPlanar,  (ePixelFormat)kPixelFormatRGBA64,   0.25    },
+    };
+    static UInt8 y[MAX_PIXELS * 2], u[MAX_PIXELS * 2], v[MAX_PIXELS * 2];
+    static UInt8 rgba[MAX_PIXELS * 8];
+
+    for (UInt32 i = 0; i < NELEM(kCases); ++i) {
+        const ColorRow row = GetColorRow(kernels, kCases[i].iformat, kCases[i].oformat);
+        EXPECT(row != Nil, "%s: no row for %.4s -> %.4s", kernels->name,
+               (const Char *)&kCases[i].iformat, (const Char *)&kCases[i].oformat);
+        if (row == Nil) continue;
+
+        const Bool wide     = kCases[i].iformat != kPixelFormat444YpCbCrPlanar;
+        const Bool deep     = kCases[i].oformat == (ePixelFormat)kPixelFormatRGBA64;
+        const UInt16 * y16  = (const UInt16 *)y;
+        const UInt16 * uv16 = (const UInt16 *)u;
+        const UInt16 * o16  = (const UInt16 *)rgba;
+        Float64 error = 0;
+        for (UInt32 m = 0; m < NELEM(kMatrixCoeffs); ++m) {
+            const ColorParams * params = GetColorParams(kMatrixCoeffs[m].matrix);
+            for (UInt32 k = 0; k < ROUNDS; ++k) {
+                Randomize(y, sizeof(y));
+                Randomize(u, sizeof(u));
+                Randomize(v, sizeof(v));
+                row(y, u, wide ? Nil : v, rgba, MAX_PIXELS, params);
+
+                for (UInt32 x = 0; x < MAX_PIXELS; ++x) {
+                    Float64 rgb[3];
+                    if (wide)   ColorFloat(m, y16[x] / 256.0, uv16[x & ~1] / 256.0, uv16[x | 1] / 256.0, rgb);
+                    else        ColorFloat(m, y[x], u[x], v[x], rgb);
+                    for (UInt32 c = 0; c < 3; ++c) {
+                        // 8-bit output is rounded, 16-bit output is not
+                        const Float64 ref = deep ? rgb[c] : floor(rgb[c] + 0.5);
+                        const Float64 out = deep ? o16[x * 4 + c] / 257.0 : rgba[x * 4 + c];
+                        if (fabs(out - ref) > error) error = fabs(out - ref);
+                    }
+                }
+            }
+        }
+        EXPECT(error <= kCases[i].tolerance, "%s: %.4s -> %.4s, max error %.3f LSB", kernels->name,
+               (const Char *)&kCases[i].iformat, (const Char *)&kCases[i].oformat, error);
+    }
+}
+
+#pragma mark Rotate
+// odd display rect, aligned to chroma
+#define IMAGE_WIDTH     (70)
+#define IMAGE_HEIGHT    (46)
+
+static const ePixelFormat kRotateFormats[] = {
+    kPixelFormat420YpCbCrPlanar,
+    kPixelFormat444YpCbCrPlanar,
+    kPixelFormat420YpCbCrSemiPlanar,
+    kPixelFormat420YpCbCr10PlanarLE,
+    kPixelFormatBGRA,
+    kPixelFormatRGBA64,
+};
+
+static const struct {
+    eRotate     rotate;
+    eFlip       flip;
+    eRotate     inverse;
+    eFlip       undo;
+} kRotations[] = {
+    { kRotate90,    kFlipNone,          kRotate270, kFlipNone           },
+    { kRotate180,   kFlipNone,          kRotate180, kFlipNone           },
+    { kRotate270,   kFlipNone,          kRotate90,  kFlipNone           },
+    { kRotate0,     kFlipHorizontal,    kRotate0,   kFlipHorizontal     },
+    { kRotate0,     kFlipVertical,      kRotate0,   kFlipVertical       },
+    { kRotate90,    kFlipVertical,      kRotate90,  kFlipVertical       },   // transpose
+};
+
+static Bool IsTransposed(eRotate rotate) {
+    return rotate == kRotate90 || rotate == kRotate270;
+}
+
+static void TestRotate() {
+    for (UInt32 i = 0; i < NELEM(kRotateFormats); ++i) {
+        const ImageFormat image = Image(kRotateFormats[i], IMAGE_WIDTH, IMAGE_HEIGHT);
+        const UInt32 bytes = GetImageBytes(image);
+        UInt8 * origin  = new UInt8[bytes];
+        UInt8 * rotated = new UInt8[bytes];
+        UInt8 * back    = new UInt8[bytes];
+        Randomize(origin, bytes);
+
+        for (UInt32 k = 0; k < NELEM(kRotations); ++k) {
+            const ImageFormat turned = IsTransposed(kRotations[k].rotate) ?
+                Image(image.format, image.height, image.width) : image;
+            const MediaUnit * forward = RotateUnitFind(kRotations[k].rotate, kRotations[k].flip);
+            const MediaUnit * inverse = RotateUnitFind(kRotations[k].inverse, kRotations[k].undo);
+            EXPECT(forward != Nil && inverse != Nil, "%.4s: no rotate unit %u", (const Char *)&image.format, k);
+            if (forward == Nil || inverse == Nil) continue;
+
+            memset(back, 0, bytes);
+            MediaError st = RunUnit(forward, image, turned, origin, rotated);
+            if (st == kMediaNoError) st = RunUnit(inverse, turned, image, rotated, back);
+            EXPECT(st == kMediaNoError, "%.4s: %s failed", (const Char *)&image.format, forward->name);
+            EXPECT(st != kMediaNoError || memcmp(origin, back, bytes) == 0,
+                   "%.4s: %s & %s is not identity", (const Char *)&image.format, forward->name, inverse->name);
+        }
+        delete [] origin;
+        delete [] rotated;
+        delete [] back;
+    }
+}
+
+#pragma mark Swizzle
+static const ePixelFormat kSwizzlePairs[][2] = {
+    { kPixelFormat420YpCbCrPlanar,      kPixelFormat420YpCrCbPlanar     },
+    { kPixelFormat444YpCbCrPlanar,      kPixelFormat444YpCrCbPlanar     },
+    { kPixelFormat420YpCbCrSemiPlanar,  kPixelFormat420YpCrCbSemiPlanar },
+    { kPixelFormat422YpCbCr,            kPixelFormat422YpCrCbWO         },
+    { kPixelFormat422YpCbCr,            kPixelFormat422YpCrCb           },
+    { kPixelFormat422YpCbCrPlanar,      kPixelFormat422YpCrCbPlanar     },
+    { kPixelFormat422YpCbCrWO,          kPixelFormat422YpCrCbWO         },
+};
+
+static void TestSwizzle() {
+    for (UInt32 i = 0; i < NELEM(kSwizzlePairs); ++i) {
+        const ImageFormat a = Image(kSwizzlePairs[i][0], IMAGE_WIDTH, IMAGE_HEIGHT);
+        const ImageFormat b = Image(kSwizzlePairs[i][1], IMAGE_WIDTH, IMAGE_HEIGHT);
+        EXPECT(IsSimilarPixelFormat(a.format, b.format), "%.4s -> %.4s is not similar",
+               (const Char *)&a.format, (const Char *)&b.format);
+        if (!IsSimilarPixelFormat(a.format, b.format)) continue;
+
+        const UInt32 bytes = GetImageBytes(a);
+        UInt8 * origin  = new UInt8[bytes];
+        UInt8 * swapped = new UInt8[bytes];
+        UInt8 * back    = new UInt8[bytes];
+        Randomize(origin, bytes);
+        memset(back, 0, bytes);
+
+        MediaError st = RunUnit(&kSwizzleUnit, a, b, origin, swapped);
+        if (st == kMediaNoError) st = RunUnit(&kSwizzleUnit, b, a, swapped, back);
+        EXPECT(st == kMediaNoError, "%.4s <-> %.4s failed", (const Char *)&a.format, (const Char *)&b.format);
+        EXPECT(st != kMediaNoError || memcmp(swapped, origin, bytes) != 0,
+               "%.4s -> %.4s changed nothing", (const Char *)&a.format, (const Char *)&b.format);
+        EXPECT(st != kMediaNoError || memcmp(origin, back, bytes) == 0,
+               "%.4s <-> %.4s is not identity", (const Char *)&a.format, (const Char *)&b.format);
+
+        delete [] origin;
+        delete [] swapped;
+        delete [] back;
+    }
+}
+
+#pragma mark Scale
+static const ePixelFormat kScaleFormats[] = {
+    kPixelFormat420YpCbCrPlanar,
+    kPixelFormat422YpCbCrPlanar,
+    kPixelFormat444YpCbCrPlanar,
+    kPixelFormat420YpCbCrSemiPlanar,
+    kPixelFormatBGRA,
+    kPixelFormatRGB,
+};
+
+static const eScaleFilter kScaleFilters[] = {
+    kScaleFilterBilinear,
+    kScaleFilterBicubic,
+    kScaleFilterLanczos,
+};
+
+static void TestScaleIdentity() {
+    // odd width & height, chroma planes hold a half sample
+    static const Int32 kSizes[][2] = { { 71, 47 }, { 33, 1 }, { 1, 17 } };
+    for (UInt32 i = 0; i < NELEM(kScaleFormats); ++i) {
+        for (UInt32 j = 0; j < NELEM(kSizes); ++j) {
+            const ImageFormat image = Image(kScaleFormats[i], kSizes[j][0], kSizes[j][1]);
+            const UInt32 bytes = GetImageBytes(image);
+            UInt8 * origin  = new UInt8[bytes];
+            UInt8 * scaled  = new UInt8[bytes];
+            Randomize(origin, bytes);
+
+            for (UInt32 k = 0; k < NELEM(kScaleFilters); ++k) {
+                const MediaUnit * unit = ScaleUnitFind(kScaleFilters[k]);
+                EXPECT(unit != Nil, "no scale unit of filter %u", kScaleFilters[k]);
+                if (unit == Nil) continue;
+
+                memset(scaled, 0, bytes);
+                const MediaError st = RunUnit(unit, image, image, origin, scaled);
+                EXPECT(st == kMediaNoError, "%.4s %dx%d: %s failed", (const Char *)&image.format,
+                       image.width, image.height, unit->name);
+                EXPECT(st != kMediaNoError || memcmp(origin, scaled, bytes) == 0,
+                       "%.4s %dx%d: %s is not identity", (const Char *)&image.format,
+                       image.width, image.height, unit->name);
+            }
+            delete [] origin;
+            delete [] scaled;
+        }
+    }
+}
+
+// flat image scaled down & up keeps its samples, as filter weights sum to 1
+static void TestScaleFlat() {
+    static const Int32 kSizes[][2] = { { 35, 23 }, { 101, 61 } };
+    const ImageFormat in = Image(kPixelFormat420YpCbCrPlanar, IMAGE_WIDTH + 1, IMAGE_HEIGHT + 1);
+    const UInt32 ibytes = GetImageBytes(in);
+    UInt8 * origin = new UInt8[ibytes];
+    MediaBufferList4 planes;
+    GetImagePlanes(in, origin, planes);
+    memset(planes.buffers[0].data, 77, planes.buffers[0].size);
+    memset(planes.buffers[1].data, 99, planes.buffers[1].size);
+    memset(planes.buffers[2].data, 150, planes.buffers[2].size);
+
+    for (UInt32 j = 0; j < NELEM(kSizes); ++j) {
+        const ImageFormat out = Image(in.format, kSizes[j][0], kSizes[j][1]);
+        const UInt32 obytes = GetImageBytes(out);
+        UInt8 * scaled = new UInt8[obytes];
+        for (UInt32 k = 0; k < NELEM(kScaleFilters); ++k) {
+            const MediaUnit * unit = ScaleUnitFind(kScaleFilters[k]);
+            if (unit == Nil) continue;
+
+            memset(scaled, 0, obytes);
+            const MediaError st = RunUnit(unit, in, out, origin, scaled);
+            EXPECT(st == kMediaNoError, "%s to %dx%d failed", unit->name, out.width, out.height);
+            if (st != kMediaNoError) continue;
+
+            MediaBufferList4 result;
+            GetImagePlanes(out, scaled, result);
+            for (UInt32 p = 0; p < 3; ++p) {
+                const UInt8 value = planes.buffers[p].data[0];
+                UInt32 i = 0;
+                while (i < result.buffers[p].size && result.buffers[p].data[i] == value) ++i;
+                EXPECT(i == result.buffers[p].size, "%s to %dx%d: plane %u sample %u is %u, not %u",
+                       unit->name, out.width, out.height, p, i, result.buffers[p].data[i], value);
+            }
+        }
+        delete [] scaled;
+    }
+    delete [] origin;
+}
+
+// same size color scale of 10-bit 4:4:4 keeps all bits, as the color unit
+static void TestColorScaleDepth() {
+    const ImageFormat in    = Image((ePixelFormat)kPixelFormat444YpCbCr10PlanarLE, IMAGE_WIDTH + 1, IMAGE_HEIGHT + 1);
+    const ImageFormat out   = Image((ePixelFormat)kPixelFormatRGBA64, IMAGE_WIDTH + 1, IMAGE_HEIGHT + 1);
+    const MediaUnit * color = Nil, * scale = Nil;
+    for (const MediaUnit * unit = ImageUnitFindNext(Nil, in.format, out.format); unit != Nil;
+         unit = ImageUnitFindNext(unit, in.format, out.format)) {
+        if (strstr(unit->name, ".scale"))   scale = scale ? scale : unit;
+        else                                color = color ? color : unit;
+    }
+    EXPECT(color != Nil && scale != Nil, "no color or scale unit for %.4s -> %.4s",
+           (const Char *)&in.format, (const Char *)&out.format);
+    if (color == Nil || scale == Nil) return;
+
+    const UInt32 ibytes = GetImageBytes(in);
+    const UInt32 obytes = GetImageBytes(out);
+    UInt8 * origin  = new UInt8[ibytes];
+    UInt8 * a       = new UInt8[obytes];
+    UInt8 * b       = new UInt8[obytes];
+    Randomize(origin, ibytes);
+    memset(a, 0, obytes);
+    memset(b, 0xFF, obytes);
+
+    MediaError st = RunUnit(color, in, out, origin, a);
+    if (st == kMediaNoError) st = RunUnit(scale, in, out, origin, b);
+    EXPECT(st == kMediaNoError, "%s or %s failed", color->name, scale->name);
+    EXPECT(st != kMediaNoError || memcmp(a, b, obytes) == 0, "%s differs from %s", scale->name, color->name);
+
+    delete [] origin;
+    delete [] a;
+    delete [] b;
+}
+
+#pragma mark Dither
+// BGR565 is a word in little endian
+static UInt32 Level565(const UInt8 * p, UInt32 c) {
+    const UInt32 w = p[0] | (p[1] << 8);
+    return c == 0 ? w >> 11 : c == 1 ? (w >> 5) & 0x3F : w & 0x1F;
+}
+
+// gray between levels: truncated without dither, the 2 nearest levels mixed
+// by dithers with the mean of both in between
+static void TestDither() {
+    static const eDither kDithers[] = { kDitherNone, kDitherOrdered, kDitherDiffusion };
+    static const UInt8 kGray = 83;          // 10.375 of 5 bits, 20.75 of 6 bits
+    const ImageFormat in    = Image(kPixelFormatBGRA, 64, 64);
+    const ImageFormat out   = Image(kPixelFormatBGR565, 64, 64);
+    const UInt32 ibytes = GetImageBytes(in);
+    const UInt32 obytes = GetImageBytes(out);
+    UInt8 * origin  = new UInt8[ibytes];
+    UInt8 * packed  = new UInt8[obytes];
+    memset(origin, kGray, ibytes);
+
+    for (UInt32 k = 0; k < NELEM(kDithers); ++k) {
+        const MediaUnit * unit = DitherUnitFind(kDithers[k]);
+        EXPECT(unit != Nil, "no dither unit %u", kDithers[k]);
+        if (unit == Nil) continue;
+
+        const MediaError st = RunUnit(unit, in, out, origin, packed);
+        EXPECT(st == kMediaNoError, "%s failed", unit->name);
+        if (st != kMediaNoError) continue;
+
+        for (UInt32 c = 0; c < 3; ++c) {
+            const UInt32 bits   = c == 1 ? 6 : 5;
+            const UInt32 low    = kGray >> (8 - bits);
+            UInt32 sum = 0, others = 0;
+            for (UInt32 i = 0; i < obytes; i += 2) {
+                const UInt32 level = Level565(packed + i, c);
+                if (level != low && level != low + 1) ++others;
+                sum += level;
+            }
+            const Float64 mean = (Float64)sum / (obytes / 2);
+            EXPECT(others == 0, "%s: channel %u, %u pixels off the nearest levels", unit->name, c, others);
+            if (kDithers[k] == kDitherNone) {
+                EXPECT(mean == low, "%s: channel %u, mean %.3f is not truncated %u", unit->name, c, mean, low);
+            } else {
+                EXPECT(mean > low && mean < low + 1, "%s: channel %u, mean %.3f is not mixed", unit->name, c, mean);
+            }
+        }
+    }
+    delete [] origin;
+    delete [] packed;
+}
+
+#pragma mark Statistics
+// odd size 4:2:0, sums by samples of each plane, which holds a half sample
+static void TestStatistics() {
+    ImageFormat in  = Image(kPixelFormat420YpCbCrPlanar, IMAGE_WIDTH + 1, IMAGE_HEIGHT + 1);
+    ImageFormat out = in;
+    out.height      = in.rect.h;
+    const UInt32 bytes = GetImageBytes(in);
+    UInt8 * origin = new UInt8[bytes];
+    Randomize(origin, bytes);
+
+    MediaFormat ifmt, ofmt;
+    memset(&ifmt, 0, sizeof(ifmt));
+    memset(&ofmt, 0, sizeof(ofmt));
+    ifmt.image  = in;
+    ofmt.image  = out;
+
+    MediaBufferList4 input, output;
+    GetImagePlanes(in, origin, input);
+    ImageStatisticsBlock * block = new ImageStatisticsBlock;
+    output.list.count           = 1;
+    output.buffers[0].data      = (UInt8 *)block;
+    output.buffers[0].capacity  = sizeof(ImageStatisticsBlock);
+    output.buffers[0].size      = 0;
+
+    MediaUnitContext instance = kStatisticsUnit.alloc();
+    MediaError st = kStatisticsUnit.init(instance, &ifmt, &ofmt);
+    if (st == kMediaNoError) st = kStatisticsUnit.process(instance, &input.list, &output.list);
+    kStatisticsUnit.dealloc(instance);
+    EXPECT(st == kMediaNoError, "%s failed", kStatisticsUnit.name);
+
+    for (UInt32 p = 0; st == kMediaNoError && p < 3; ++p) {
+        const UInt8 * data = input.buffers[p].data;
+        const UInt64 samples = input.buffers[p].size;
+        UInt64 sum = 0, squares = 0;
+        UInt32 min = 255, max = 0, histogram[256] = { 0 };
+        for (UInt64 i = 0; i < samples; ++i) {
+            sum     += data[i];
+            squares += data[i] * data[i];
+            if (data[i] < min)  min = data[i];
+            if (data[i] > max)  max = data[i];
+            ++histogram[data[i]];
+        }
+        EXPECT(block->planes[p].samples == samples, "plane %u: %llu samples, not %llu", p,
+               (unsigned long long)block->planes[p].samples, (unsigned long long)samples);
+        EXPECT(block->planes[p].sum == sum && block->planes[p].squares == squares,
+               "plane %u: sums differ", p);
+        EXPECT(block->planes[p].min == min && block->planes[p].max == max,
+               "plane %u: [%u, %u], not [%u, %u]", p, block->planes[p].min, block->planes[p].max, min, max);
+        EXPECT(memcmp(block->planes[p].histogram, histogram, sizeof(histogram)) == 0,
+               "plane %u: histograms differ", p);
+    }
+    delete block;
+    delete [] origin;
+}
+
+#pragma mark Diff
+// planes of both frames in one list
+static MediaError RunDiff(const MediaUnit * unit, const ImageFormat& in, const ImageFormat& out,
+                          UInt8 * a, UInt8 * b, UInt8 * odata) {
+    MediaFormat ifmt, ofmt;
+    memset(&ifmt, 0, sizeof(ifmt));
+    memset(&ofmt, 0, sizeof(ofmt));
+    ifmt.image  = in;
+    ofmt.image  = out;
+
+    MediaBufferList4 first, second, input, output;
+    const UInt32 n = GetImagePlanes(in, a, first);
+    GetImagePlanes(in, b, second);
+    GetImagePlanes(out, odata, output);
+    input.list.count = n * 2;
+    for (UInt32 i = 0; i < n; ++i) {
+        input.buffers[i]        = first.buffers[i];
+        input.buffers[n + i]    = second.buffers[i];
+    }
+
+    MediaUnitContext instance = unit->alloc();
+    MediaError st = unit->init(instance, &ifmt, &ofmt);
+    if (st == kMediaNoError) {
+        st = unit->process(instance, &input.list, &output.list);
+    }
+    unit->dealloc(instance);
+    return st;
+}
+
+// identical frames are black, a changed luma sample lights its pixel only
+static void TestDiff() {
+    static const eDiffMode kModes[] = { kDiffHeat, kDiffSplit };
+    const ImageFormat in    = Image(kPixelFormat420YpCbCrSemiPlanar, IMAGE_WIDTH + 1, IMAGE_HEIGHT + 1);
+    const ImageFormat out   = Image(kPixelFormatBGRA, in.width, in.height);
+    const Int32 x = 13, y = 7;
+    const UInt32 ibytes = GetImageBytes(in);
+    const UInt32 obytes = GetImageBytes(out);
+    UInt8 * a       = new UInt8[ibytes];
+    UInt8 * b       = new UInt8[ibytes];
+    UInt8 * diff    = new UInt8[obytes];
+    Randomize(a, ibytes);
+
+    for (UInt32 k = 0; k < NELEM(kModes); ++k) {
+        const MediaUnit * unit = DiffUnitFind(kModes[k], kDiffGainDefault);
+        EXPECT(unit != Nil, "no diff unit of mode %u", kModes[k]);
+        if (unit == Nil) continue;
+
+        for (UInt32 changed = 0; changed < 2; ++changed) {
+            memcpy(b, a, ibytes);
+            if (changed) b[y * in.width + x] ^= 0x40;
+            memset(diff, 0xFF, obytes);
+            const MediaError st = RunDiff(unit, in, out, a, b, diff);
+            EXPECT(st == kMediaNoError, "%s failed", unit->name);
+            if (st != kMediaNoError) break;
+
+            UInt32 lit = 0;
+            Bool found = False;
+            for (Int32 i = 0; i < out.width * out.height; ++i) {
+                const UInt8 * p = diff + i * 4;
+                if (p[0] | p[1] | p[2]) {
+                    ++lit;
+                    found = found || i == y * out.width + x;
+                }
+            }
+            EXPECT(lit == changed && found == (changed != 0), "%s: %u pixels lit by %u changed samples",
+                   unit->name, lit, changed);
+        }
+    }
+    delete [] a;
+    delete [] b;
+    delete [] diff;
+}
+
+#pragma mark Tone Map
+// gray ramp from black to peak white of video range
+static void TestToneMap() {
+    static const eTransfer kTransfers[] = { kTransferPQ, kTransferHLG };
+    EXPECT(ToneMapUnitFind(kTransferSDR) == Nil, "SDR needs no tone map");
+
+    ImageFormat in          = Image(kPixelFormat444YpCbCrPlanar, 220, 2);
+    in.matrix               = kColorMatrixBT2020;
+    const ImageFormat out   = Image(kPixelFormatRGBA, in.width, in.height);
+    const UInt32 ibytes = GetImageBytes(in);
+    const UInt32 obytes = GetImageBytes(out);
+    UInt8 * origin  = new UInt8[ibytes];
+    UInt8 * mapped  = new UInt8[obytes];
+    MediaBufferList4 planes;
+    GetImagePlanes(in, origin, planes);
+    for (Int32 i = 0; i < in.width * in.height; ++i) {
+        planes.buffers[0].data[i] = 16 + (i % in.width) * 219 / (in.width - 1);
+    }
+    memset(planes.buffers[1].data, 128, planes.buffers[1].size);
+    memset(planes.buffers[2].data, 128, planes.buffers[2].size);
+
+    for (UInt32 k = 0; k < NELEM(kTransfers); ++k) {
+        const MediaUnit * unit = ToneMapUnitFind(kTransfers[k]);
+        EXPECT(unit != Nil, "no tone map unit of transfer %u", kTransfers[k]);
+        if (unit == Nil) continue;
+
+        const MediaError st = RunUnit(unit, in, out, origin, mapped);
+        EXPECT(st == kMediaNoError, "%s failed", unit->name);
+        if (st != kMediaNoError) continue;
+
+        const UInt8 * last = mapped + (out.width - 1) * 4;
+        EXPECT(mapped[0] == 0 && mapped[1] == 0 && mapped[2] == 0, "%s: black is %u %u %u",
+               unit->name, mapped[0], mapped[1], mapped[2]);
+        EXPECT(last[0] >= 254 && last[1] >= 254 && last[2] >= 254, "%s: white is %u %u %u",
+               unit->name, last[0], last[1], last[2]);
+        UInt32 reversed = 0;
+        for (Int32 i = 1; i < out.width; ++i) {
+            for (UInt32 c = 0; c < 3; ++c) {
+                if (mapped[i * 4 + c] < mapped[(i - 1) * 4 + c]) ++reversed;
+            }
+        }
+        EXPECT(reversed == 0, "%s: ramp is not monotone at %u samples", unit->name, reversed);
+    }
+    delete [] origin;
+    delete [] mapped;
+}
+
+int main() {
+    srand(1);
+    TestRows();
+    // SIMD rows are bit-exact with C rows
+    TestAccuracy(&kColorKernelsC);
+    TestRotate();
+    TestSwizzle();
+    TestScaleIdentity();
+    TestScaleFlat();
+    TestColorScaleDepth();
+    TestDither();
+    TestStatistics();
+    TestDiff();
+    TestToneMap();
+    return TestResult();
+}
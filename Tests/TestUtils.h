@@ -0,0 +1,102 @@
+/******************************************************************************
+ * Copyright (c) 2020, Chen Fang <mtdcy.chen@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+
+// File:    TestUtils.h
+// Author:  mtdcy.chen
+// Changes:
+//          1. 20261017     initial version
+//
+// helpers shared by standalone tests, one failure counter per binary.
+//
+
+#ifndef MACYUV_TEST_UTILS_H
+#define MACYUV_TEST_UTILS_H
+
+#include <ABE/ABE.h>
+#include <MediaFramework/MediaTypes.h>
+#include <MediaFramework/MediaUnit.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PixelFormats.h"
+
+USING_NAMESPACE_MFWK
+
+#define NELEM(x)    (sizeof(x) / sizeof(x[0]))
+
+static UInt32 gFailures = 0;
+
+#define EXPECT(x, fmt, ...) do {                                                        \
+    if (!(x)) {                                                                         \
+        ++gFailures;                                                                    \
+        printf("FAIL %s:%d: " fmt "\n", __FUNCTION__, __LINE__, ##__VA_ARGS__);         \
+    }                                                                                   \
+} while (0)
+
+static inline int TestResult() {
+    printf("%s, %u failures\n", gFailures ? "FAILED" : "PASSED", gFailures);
+    return gFailures ? 1 : 0;
+}
+
+static inline void Randomize(UInt8 * data, UInt32 bytes) {
+    for (UInt32 i = 0; i < bytes; ++i) data[i] = rand();
+}
+
+static inline ImageFormat Image(ePixelFormat format, Int32 width, Int32 height) {
+    ImageFormat image;
+    memset(&image, 0, sizeof(image));
+    image.format    = format;
+    image.matrix    = kColorMatrixBT709;
+    image.width     = image.rect.w = width;
+    image.height    = image.rect.h = height;
+    return image;
+}
+
+static inline MediaError RunUnit(const MediaUnit * unit, const ImageFormat& in, const ImageFormat& out,
+                                 UInt8 * idata, UInt8 * odata) {
+    MediaFormat ifmt, ofmt;
+    memset(&ifmt, 0, sizeof(ifmt));
+    memset(&ofmt, 0, sizeof(ofmt));
+    ifmt.image  = in;
+    ofmt.image  = out;
+
+    MediaBufferList4 input, output;
+    GetImagePlanes(in, idata, input);
+    GetImagePlanes(out, odata, output);
+
+    MediaUnitContext instance = unit->alloc();
+    MediaError st = unit->init(instance, &ifmt, &ofmt);
+    if (st == kMediaNoError) {
+        st = unit->process(instance, &input.list, &output.list);
+    }
+    unit->dealloc(instance);
+    return st;
+}
+
+#endif // MACYUV_TEST_UTILS_H